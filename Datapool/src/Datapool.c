@@ -38,6 +38,11 @@
 #include <stdio.h>
 #include <pthread.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 //#include <bsd/string.h>
 
 #include <gp_types.h>		// Yazaki GP processor type definitions
@@ -45,11 +50,42 @@
 #include <gp_utils.h>		// Common GP program utility functions
 
 #include "pool_def.h"		// Datapool public definitions
+#include "Datapool.h"		// Datapool access function prototypes
 
 /***********************************
 	Private Macros and Typedefs
 ***********************************/
 #define Success 0
+
+/*! Set while a writer is updating the datapool, see dpWriteBegin() */
+#define DP_SEQ_WRITING(seq) (((seq) & 1u) != 0)
+
+/*! Storage of a datapool item in the active datapool.  dp_tbl points into the private 
+	dp_data, the offset is kept when the datapool is in shared memory. */
+#define DP_ITEM_OFFSET(id) ((uint8_t *)dp_tbl[id].p_data - (uint8_t *)&dp_data)
+#define DP_ITEM_DATA(id) ((void *)((uint8_t *)p_dpData + DP_ITEM_OFFSET(id)))
+
+/*! Wire format of the numeric data types: X(type, wire type, wire store, wire read).  The 
+	item is stored as DP_CTYPE_<type> (pool_def.h) and encoded as its wire type. */
+#define DP_TYPE_SCHEMA(X) \
+	X(GP_INT32,		int32_t,	gp_Store32bitSigned,	gp_Read32bitSigned) \
+	X(GP_UINT32,	uint32_t,	dpWireStoreU32,			dpWireReadU32) \
+	X(GP_INT64,		int64_t,	gp_Store64bitSigned,	gp_Read64bitSigned) \
+	X(GP_UINT64,	uint64_t,	gp_Store64bit,			gp_Read64bit) \
+	X(GP_FLOAT,		uint32_t,	gp_StoreFloat,			gp_ReadFloat) \
+	X(GP_DBL,		uint64_t,	gp_StoreDouble,			gp_ReadDouble) \
+	X(GP_INT16,		int16_t,	gp_Store16bitSigned,	gp_Read16bitSigned) \
+	X(GP_UINT16,	uint16_t,	dpWireStoreU16,			dpWireReadU16) \
+	X(GP_UINT8,		uint8_t,	dpWireStoreU8,			dpWireReadU8)
+
+/*! Data type specific handlers of a datapool item, see dpCodecTbl[] */
+typedef struct {
+	gp_retcode_t (*check)(const void *p_value, int datlen);					/*!< Check a value before it is stored */
+	gp_retcode_t (*store)(void *p_item, const void *p_value, int datlen);		/*!< Store a value in the item */
+	void (*copy)(void *p_value, const void *p_item, int datlen);				/*!< Copy the item, seqlock read side */
+	int (*encode)(const void *p_value, int datlen, uint8_t *p_buf, int bufsz);	/*!< Encode a value, returns its size or -1 */
+	int (*decode)(const uint8_t *p_buf, int bufsz, void *p_value, int datlen);	/*!< Decode a value, returns its size or -1 */
+} DP_CODEC_T;
 /***********************************
 	      Private Config Macros
 ***********************************/
@@ -61,6 +97,42 @@
 /*! Locking semaphore used to read/write the datapool */
 //static LocalMutex DataPoolLock = NULL;
 static pthread_mutex_t dataPoolLock;
+
+/*! Datapool sequence counter.  Writers (serialized by dataPoolLock) make it odd while they 
+	update the datapool and even again when done, so readers never take the lock: they 
+	copy the item and retry if the counter was odd or changed during the copy. */
+static uint32_t dataPoolSeq = 0;
+
+/*! Active datapool storage and sequence counter.  They are the private dp_data and 
+	dataPoolSeq unless InitPoolShared() or AttachPoolShared() moved them to shared memory. */
+static DP_ITEM_STORAGE_T *p_dpData = &dp_data;
+static uint32_t *p_dpSeq = &dataPoolSeq;
+
+/*! Set by AttachPoolShared(), the datapool is owned (written) by another process */
+static bool dpReadOnly = false;
+
+/*! Datapool version, incremented for every item change, and version of the last change of 
+	every item.  They are written with the datapool (under dataPoolLock, inside the 
+	sequence counter update) so a reader gets the items changed since any version, see 
+	GetPoolDirty() and GetPoolDelta().  Version 0 is older than any change. */
+static uint32_t dataPoolVer = 0;
+static uint32_t dpElemVer[ELEM_MAX_ID];
+
+/*! Callback executed by the writers after datapool items changed, see SetPoolChangeHook() */
+static DP_CHANGE_HOOK_T dpChangeHook = NULL;
+
+/*! Stale items bitmap, see SetPoolStale().  It is local to the process, not part of the 
+	datapool storage, and each word is updated atomically so it takes no lock. */
+static uint32_t dpStale[DP_DIRTY_WORDS];
+
+/*! Handlers of every data type, indexed by GP_DATATYPES_T, see DP_TYPE_SCHEMA */
+static const DP_CODEC_T dpCodecTbl[GP_UINT8 + 1];
+
+/*! CAN signal to datapool item map of every CAN channel, sorted by signal ID so the 
+	signals of a VP message are found by binary search, see SetCanSigMap() */
+static DP_CANSIG_MAP_T dpCanSigMap[DP_CANSIG_NUM_CHAN][DP_CANSIG_MAX];
+static DP_CANSIG_STORE_T dpCanSigStore[DP_CANSIG_NUM_CHAN][DP_CANSIG_MAX];	/*!< Store of each dpCanSigMap entry */
+static int dpCanSigNum[DP_CANSIG_NUM_CHAN];
 /*err = pthread_mutex_init(datapoolLock,NULL)
 if(err != 0)
 {
@@ -73,6 +145,22 @@ if(err != 0)
 	Private Function Prototypes
 ***********************************/
 static void dpSetDfltVal(unsigned int id);
+static inline void dpWriteBegin(void);
+static inline void dpWriteEnd(void);
+static inline uint32_t dpReadBegin(void);
+static inline bool dpReadRetry(uint32_t seq);
+static gp_retcode_t dpCopyElem(int id, void *p_value);
+static gp_retcode_t dpCheckElem(int id, void *p_value);
+static gp_retcode_t dpStoreElem(int id, void *p_value);
+static inline void dpTouchElem(unsigned int id, uint32_t p_changed[]);
+static void dpNotifyChange(uint32_t p_changed[], uint32_t ver);
+static const DP_CANSIG_MAP_T *dpFindCanSig(int chan, uint16_t sig_id);
+static int dpWireStoreU8(uint8_t value, uint8_t *p_buf);
+static int dpWireReadU8(uint8_t *p_value, uint8_t *p_buf);
+static int dpWireStoreU16(uint16_t value, uint8_t *p_buf);
+static int dpWireReadU16(uint16_t *p_value, uint8_t *p_buf);
+static int dpWireStoreU32(uint32_t value, uint8_t *p_buf);
+static int dpWireReadU32(uint32_t *p_value, uint8_t *p_buf);
 
 
 /************ Start of code ******************/
@@ -95,6 +183,13 @@ static void dpSetDfltVal(unsigned int id);
 gp_retcode_t InitPool(void)
 {
     uint32_t err;
+	unsigned int id;
+
+	/* The datapool of another process can't be initialized */
+	if(dpReadOnly)
+	{
+		return GP_DP_ACCESS_ERR;
+	}
 
 	/* Create the datapool access mutex */
     err = pthread_mutex_init((pthread_mutex_t *restrict)&dataPoolLock,NULL);
@@ -110,7 +205,8 @@ gp_retcode_t InitPool(void)
 	    return GP_DP_ACCESS_ERR;
 	}
 	/* Clear the datapool */    
-    memset((void *)&dp_data, 0, sizeof(DP_ITEM_STORAGE_T));
+	dpWriteBegin();
+    memset((void *)p_dpData, 0, sizeof(DP_ITEM_STORAGE_T));
 
 	/* Set specific default values */
 	/*dpSetDfltVal(YzTdWarpMesh);			// WarpMesh
@@ -122,6 +218,13 @@ gp_retcode_t InitPool(void)
 	*/dpSetDfltVal(YzTdoNavSimFname);		// NavSimFname
 	dpSetDfltVal(YzTdoAudioSimFname);	// AudioSimFname
 
+	/* Every item has changed */
+	for(id = ELEM_MIN_ID; id < ELEM_MAX_ID; id++)
+	{
+		dpTouchElem(id, NULL);
+	}
+	dpWriteEnd();
+
 	/* Release the datapool */ 
 	err = pthread_mutex_unlock(&dataPoolLock);
 	if(err != Success) 
@@ -132,6 +235,127 @@ gp_retcode_t InitPool(void)
     return GP_SUCCESS;
 }
 
+/**************************************************************************************/
+/*! \fn InitPoolShared(const char shm_name[])
+ *
+ *	\param[in] shm_name - Name of the POSIX shared-memory segment of the datapool
+ *
+ *  \par Description:	  
+ *  Create the shared-memory datapool, make it the active datapool of this process and 
+ *	initialize its items to default values.  Other processes map it with 
+ *	AttachPoolShared() and read the items in place instead of requesting a pool copy.
+ *	The header is published last, so an attached process never sees a datapool that 
+ *	is not initialized.
+ *
+ *  \retval	Return code of type ::gp_retcode_t
+ *
+ *  \par Limitations/Caveats:
+ *	 1) Shall only be called by the owner (the only writer) of the datapool, instead of 
+ *	    InitPool().
+ *
+ *	\ingroup dpfcns_public
+ **************************************************************************************/
+gp_retcode_t InitPoolShared(const char shm_name[])
+{
+	DP_SHM_T *p_shm;
+	gp_retcode_t rc;
+	int shm_fd;
+
+	shm_unlink(shm_name);		// Remove a segment left over by a previous run
+	shm_fd = shm_open(shm_name, O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+	if(shm_fd < 0)
+	{
+		printf("\nInitPoolShared() shm_open error %s\n", strerror(errno));
+		return GP_INIT_ERR;
+	}
+	if(ftruncate(shm_fd, sizeof(DP_SHM_T)) != 0)
+	{
+		printf("\nInitPoolShared() ftruncate error %s\n", strerror(errno));
+		close(shm_fd);
+		shm_unlink(shm_name);
+		return GP_INIT_ERR;
+	}
+	p_shm = mmap(NULL, sizeof(DP_SHM_T), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+	close(shm_fd);
+	if(p_shm == MAP_FAILED)
+	{
+		printf("\nInitPoolShared() mmap error %s\n", strerror(errno));
+		shm_unlink(shm_name);
+		return GP_INIT_ERR;
+	}
+
+	/* Make the segment the active datapool and initialize it */
+	memset(&p_shm->Hdr, 0, sizeof(DP_SHM_HDR_T));
+	p_dpData = &p_shm->Dt;
+	p_dpSeq = &p_shm->Hdr.Seq;
+	rc = InitPool();
+	if(rc != GP_SUCCESS)
+	{
+		return rc;
+	}
+
+	/* Publish the datapool */
+	p_shm->Hdr.Version = DP_SHM_VERSION;
+	p_shm->Hdr.PoolSz = sizeof(DP_ITEM_STORAGE_T);
+	__atomic_store_n(&p_shm->Hdr.Magic, DP_SHM_MAGIC, __ATOMIC_RELEASE);
+
+    return GP_SUCCESS;
+}
+
+/**************************************************************************************/
+/*! \fn AttachPoolShared(const char shm_name[])
+ *
+ *	\param[in] shm_name - Name of the POSIX shared-memory segment of the datapool
+ *
+ *  \par Description:	  
+ *  Map the datapool created by InitPoolShared() in another process and make it the 
+ *	active datapool of this process.  GetElem() and GetPool() then read the items in 
+ *	place; SetElem(), SetPool() and InitPool() fail since the segment is read only.
+ *
+ *  \retval	Return code of type ::gp_retcode_t.  GP_INIT_ERR if the segment does not exist
+ *			yet, or was created with a different datapool layout.
+ *
+ *  \par Limitations/Caveats:
+ *	 None
+ *
+ *	\ingroup dpfcns_public
+ **************************************************************************************/
+gp_retcode_t AttachPoolShared(const char shm_name[])
+{
+	DP_SHM_T *p_shm;
+	int shm_fd;
+
+	shm_fd = shm_open(shm_name, O_RDONLY, 0);
+	if(shm_fd < 0)
+	{
+		printf("\nAttachPoolShared() shm_open error %s\n", strerror(errno));
+		return GP_INIT_ERR;
+	}
+	p_shm = mmap(NULL, sizeof(DP_SHM_T), PROT_READ, MAP_SHARED, shm_fd, 0);
+	close(shm_fd);
+	if(p_shm == MAP_FAILED)
+	{
+		printf("\nAttachPoolShared() mmap error %s\n", strerror(errno));
+		return GP_INIT_ERR;
+	}
+
+	/* Check the owner has published a datapool with the same layout */
+	if((__atomic_load_n(&p_shm->Hdr.Magic, __ATOMIC_ACQUIRE) != DP_SHM_MAGIC) ||
+	   (p_shm->Hdr.Version != DP_SHM_VERSION) ||
+	   (p_shm->Hdr.PoolSz != sizeof(DP_ITEM_STORAGE_T)))
+	{
+		printf("\nAttachPoolShared() %s is not a compatible datapool\n", shm_name);
+		munmap(p_shm, sizeof(DP_SHM_T));
+		return GP_INIT_ERR;
+	}
+
+	p_dpData = &p_shm->Dt;
+	p_dpSeq = &p_shm->Hdr.Seq;
+	dpReadOnly = true;
+
+    return GP_SUCCESS;
+}
+
 /**************************************************************************************/
 /*! \fn GetElemInfo(int id, GP_DATATYPES_T *p_type, int *p_len)
  *
@@ -189,9 +413,17 @@ gp_retcode_t SetElem(int id, void *p_value)
 {
 	gp_retcode_t retval = GP_SUCCESS;
     uint32_t err;
+	uint32_t changed[DP_DIRTY_WORDS] = {0};
+	uint32_t ver;
+
+	/* Only the owner of the datapool can write it */
+	if(dpReadOnly)
+	{
+		return GP_DP_ACCESS_ERR;
+	}
 
 	/* If the parameters are valid */
-    if((p_value != NULL) && (id >= ELEM_MIN_ID) && (id <= ELEM_MAX_ID))
+    if((p_value != NULL) && (id >= ELEM_MIN_ID) && (id < ELEM_MAX_ID))
     {
     	/* Lock the datapool */	
 		err = pthread_mutex_lock(&dataPoolLock);
@@ -201,61 +433,14 @@ gp_retcode_t SetElem(int id, void *p_value)
 		}
 
 		/* Update the datapool item value based on its data type */
-		switch(dp_tbl[id].type)
+		dpWriteBegin();
+		retval = dpStoreElem(id, p_value);
+		if(retval == GP_SUCCESS)
 		{
-			case GP_INT32:
-				*(int *)(dp_tbl[id].p_data) = *(int *)p_value;
-				break;
-
-			case GP_UINT32:
-				*(uint32_t *)(dp_tbl[id].p_data) = *(uint32_t *)p_value;
-				break;
-
-			case GP_INT64:
-				*(int64_t *)(dp_tbl[id].p_data) = *(int64_t *)p_value;
-				break;
-
-			case GP_UINT64:
-				*(uint64_t *)(dp_tbl[id].p_data) = *(uint64_t *)p_value;
-				break;
-
-			case GP_FLOAT:
-				*(float *)(dp_tbl[id].p_data) = *(float *)p_value;
-				break;
-
-			case GP_DBL:
-				*(double *)(dp_tbl[id].p_data) = *(double *)p_value;
-				break;
-
-			case GP_STRING:
-				{
-				 int len = strlen((char *)p_value);
-				 if(len < dp_tbl[id].datlen)		// comparison allows for NULL char
-				 {
-					strlcpy((char *)dp_tbl[id].p_data, (char *)p_value, dp_tbl[id].datlen);
-				 }
-				 else
-				 {
-					retval = GP_DP_DATA_ERR;
-				 }
-				 break;
-				}
-			case GP_ARRAY:
-				memcpy(dp_tbl[id].p_data, p_value, dp_tbl[id].datlen);
-				break;
-
-			case GP_INT16:
-				*(int16_t *)(dp_tbl[id].p_data) = *(int16_t *)p_value;
-				break;
-
-			case GP_UINT16:
-				*(uint16_t *)(dp_tbl[id].p_data) = *(uint16_t *)p_value;
-				break;
-
-			default:
-				retval = GP_DP_DATA_ERR;
-				break;
+			dpTouchElem(id, changed);
 		}
+		ver = dataPoolVer;
+		dpWriteEnd();
 
 		/* Release the datapool */ 
 		err = pthread_mutex_unlock(&dataPoolLock);
@@ -264,6 +449,7 @@ gp_retcode_t SetElem(int id, void *p_value)
 		    printf("\nReleaseLocalMutex() error %d\n", err);
 		    retval = GP_DP_ACCESS_ERR;
 		}
+		dpNotifyChange(changed, ver);
     }
 	/* Else the datapool item ID is invalid */
 	else
@@ -287,93 +473,171 @@ gp_retcode_t SetElem(int id, void *p_value)
  *
  *  \par Limitations/Caveats:
  *	 1) The caller must ensure that the destination provided is the proper size 
+ *	 2) The datapool lock is not taken, readers never block writers or each other.  The
+ *	    item may be copied more than once if a writer updates the datapool meanwhile.
  *
  *	\ingroup dpfcns_public
  **************************************************************************************/
 gp_retcode_t GetElem(int id, void *p_value)//needs minimum changes
 {
-	gp_retcode_t retval = GP_SUCCESS;
-    uint32_t err;
+	gp_retcode_t retval;
+	uint32_t seq;
 
 	/* If the parameters are valid */
-    if((p_value != NULL) && (id >= ELEM_MIN_ID) && (id <= ELEM_MAX_ID))
+    if((p_value != NULL) && (id >= ELEM_MIN_ID) && (id < ELEM_MAX_ID))
     {
-    	/* Lock the datapool */	
-		err = pthread_mutex_lock(&dataPoolLock);
-		if(err != Success) 
+		/* Copy the item without locking, retry if a writer updated the datapool meanwhile */
+		do
 		{
-		    return GP_DP_ACCESS_ERR;
-		}
+			seq = dpReadBegin();
+			retval = dpCopyElem(id, p_value);
+		} while(dpReadRetry(seq));
 
-		/* Update the datapool item value based on its data type */
-		switch(dp_tbl[id].type)
+		/* A string is only checked once a consistent copy has been taken */
+		if((retval == GP_SUCCESS) && (dp_tbl[id].type == GP_STRING))
 		{
-			case GP_INT32:
-				*(int *)p_value = *(int *)(dp_tbl[id].p_data);
-				break;
-
-			case GP_UINT32:
-				*(uint32_t *)p_value = *(uint32_t *)(dp_tbl[id].p_data);
-				break;
-
-			case GP_INT64:
-				*(int64_t *)p_value = *(int64_t *)(dp_tbl[id].p_data);
-				break;
+			if(strnlen((char *)p_value, dp_tbl[id].datlen) >= (size_t)dp_tbl[id].datlen)		// should never be an error
+			{
+				retval = GP_DP_DATA_ERR;
+			}
+		}
+    }
+	/* Else datapool item ID is invalid */
+	else
+	{
+		retval = GP_DP_PARMS_ERR;
+	}
+    return retval;
+}
 
-			case GP_UINT64:
-				*(uint64_t *)p_value = *(uint64_t *)(dp_tbl[id].p_data);
-				break;
+/**************************************************************************************/
+/*! \fn SetElems(int num, const int p_ids[], void *p_values[])
+ *
+ *	\param[in] num 	    - Number of items
+ *	\param[in] p_ids    - Element ids as defined in #DP_ELEMENT_IDS (pool_def.h)
+ *	\param[in] p_values - Void pointers to the new element values, same order as p_ids
+ *
+ *  \par Description:	  
+ *  Set several datapool items at once.  Every value is checked first, then all the items 
+ *	are written under a single lock, so a reader sees either none or all of the changes.
+ *
+ *  \retval	Return code of type ::gp_retcode_t.  No item is changed on error.
+ *
+ *  \par Limitations/Caveats:
+ *	 1) See SetElem().
+ *
+ *	\ingroup dpfcns_public
+ **************************************************************************************/
+gp_retcode_t SetElems(int num, const int p_ids[], void *p_values[])
+{
+	gp_retcode_t retval = GP_SUCCESS;
+	uint32_t changed[DP_DIRTY_WORDS] = {0};
+    uint32_t err, ver;
+	int i;
 
-			case GP_FLOAT:
-				*(float *)p_value = *(float *)(dp_tbl[id].p_data);
-				break;
+	/* Only the owner of the datapool can write it */
+	if(dpReadOnly)
+	{
+		return GP_DP_ACCESS_ERR;
+	}
+	if((num < 0) || ((num > 0) && ((p_ids == NULL) || (p_values == NULL))))
+	{
+		return GP_DP_PARMS_ERR;
+	}
 
-			case GP_DBL:
-				*(double *)p_value = *(double *)(dp_tbl[id].p_data);
-				break;
+	/* Check every item before changing any */
+	for(i = 0; i < num; i++)
+	{
+		retval = dpCheckElem(p_ids[i], p_values[i]);
+		if(retval != GP_SUCCESS)
+		{
+			return retval;
+		}
+	}
 
-			case GP_STRING:
-				{
-				 int len = strlen((char *)dp_tbl[id].p_data);
-				 if(len < dp_tbl[id].datlen)		// should never be an error
-				 {
-					strlcpy((char *)p_value, (char *)dp_tbl[id].p_data, len);
-				 }
-				 else
-				 {
-					retval = GP_DP_DATA_ERR;
-				 }
-				 break;
-				}
+	/* Lock the datapool */	
+	err = pthread_mutex_lock(&dataPoolLock);
+	if(err != Success) 
+	{
+	    return GP_DP_ACCESS_ERR;
+	}
 
-			case GP_ARRAY:
-				memcpy(dp_tbl[id].p_data, p_value, dp_tbl[id].datlen);
-				break;
+	/* Update the datapool item values */
+	dpWriteBegin();
+	for(i = 0; i < num; i++)
+	{
+		dpStoreElem(p_ids[i], p_values[i]);
+		dpTouchElem(p_ids[i], changed);
+	}
+	ver = dataPoolVer;
+	dpWriteEnd();
 
-			case GP_INT16:
-				*(int16_t *)p_value = *(int16_t *)(dp_tbl[id].p_data);
-				break;
+	/* Release the datapool */ 
+	err = pthread_mutex_unlock(&dataPoolLock);
+	if(err != Success) 
+	{
+	    printf("\nReleaseLocalMutex() error %d\n", err);
+	    retval = GP_DP_ACCESS_ERR;
+	}
+	dpNotifyChange(changed, ver);
+    return retval;
+}
 
-			case GP_UINT16:
-				*(uint16_t *)p_value = *(uint16_t *)(dp_tbl[id].p_data);
-				break;
+/**************************************************************************************/
+/*! \fn GetElems(int num, const int p_ids[], void *p_values[])
+ *
+ *	\param[in] num 	    - Number of items
+ *	\param[in] p_ids    - Element ids as defined in #DP_ELEMENT_IDS (pool_def.h)
+ *	\param[in] p_values - Void pointers to storage for the element values, same order as 
+ *						  p_ids
+ *
+ *  \par Description:	  
+ *  Read several datapool items at once.  The items are copied in a single seqlock window, 
+ *	so they are a consistent snapshot: no write happened between the first and the last.
+ *
+ *  \retval	Return code of type ::gp_retcode_t
+ *
+ *  \par Limitations/Caveats:
+ *	 1) See GetElem().
+ *
+ *	\ingroup dpfcns_public
+ **************************************************************************************/
+gp_retcode_t GetElems(int num, const int p_ids[], void *p_values[])
+{
+	gp_retcode_t retval = GP_SUCCESS;
+	uint32_t seq;
+	int i;
 
-			default:
-				retval = GP_DP_DATA_ERR;
-				break;
+	if((num < 0) || ((num > 0) && ((p_ids == NULL) || (p_values == NULL))))
+	{
+		return GP_DP_PARMS_ERR;
+	}
+	for(i = 0; i < num; i++)
+	{
+		if((p_values[i] == NULL) || (p_ids[i] < ELEM_MIN_ID) || (p_ids[i] >= ELEM_MAX_ID))
+		{
+			return GP_DP_PARMS_ERR;
 		}
+	}
 
-		/* Release the datapool */ 
-		err = pthread_mutex_unlock(&dataPoolLock);
-		if(err != Success) 
+	/* Copy the items without locking, retry if a writer updated the datapool meanwhile */
+	do
+	{
+		seq = dpReadBegin();
+		for(i = 0; (i < num) && (retval == GP_SUCCESS); i++)
 		{
-		    retval = GP_DP_ACCESS_ERR;
+			retval = dpCopyElem(p_ids[i], p_values[i]);
 		}
-    }
-	/* Else datapool item ID is invalid */
-	else
+	} while(dpReadRetry(seq) && (retval == GP_SUCCESS));
+
+	/* The strings are only checked once a consistent copy has been taken */
+	for(i = 0; (i < num) && (retval == GP_SUCCESS); i++)
 	{
-		retval = GP_DP_PARMS_ERR;
+		if((dp_tbl[p_ids[i]].type == GP_STRING) && 
+		   (strnlen((char *)p_values[i], dp_tbl[p_ids[i]].datlen) >= (size_t)dp_tbl[p_ids[i]].datlen))
+		{
+			retval = GP_DP_DATA_ERR;
+		}
 	}
     return retval;
 }
@@ -386,7 +650,8 @@ gp_retcode_t GetElem(int id, void *p_value)//needs minimum changes
  *
  *  \par Description:	  
  *  Store the contents of the supplied datapool image pointed to by p_data into the
- *	datapool storage area.  Block size is set by ::DP_ITEM_STORAGE_T.     
+ *	datapool storage area.  Block size is set by ::DP_ITEM_STORAGE_T.  Only the items 
+ *	whose value differs from the image get a new version.     
  *
  *  \retval	Return code of type ::gp_retcode_t
  *
@@ -398,6 +663,15 @@ gp_retcode_t GetElem(int id, void *p_value)//needs minimum changes
 gp_retcode_t SetPool(DP_ITEM_STORAGE_T *p_data)
 {
     uint32_t err;
+	unsigned int id;
+	uint32_t changed[DP_DIRTY_WORDS] = {0};
+	uint32_t ver;
+
+	/* Only the owner of the datapool can write it */
+	if(dpReadOnly)
+	{
+		return GP_DP_ACCESS_ERR;
+	}
 
 	/* Get access to the datapool */    
     err = pthread_mutex_lock(&dataPoolLock);
@@ -407,7 +681,17 @@ gp_retcode_t SetPool(DP_ITEM_STORAGE_T *p_data)
     }
 
 	/* Copy datapool image to the datapool */	
-	memcpy(&dp_data, p_data, sizeof(DP_ITEM_STORAGE_T));
+	dpWriteBegin();
+	for(id = ELEM_MIN_ID; id < ELEM_MAX_ID; id++)
+	{
+		if(memcmp(DP_ITEM_DATA(id), (uint8_t *)p_data + DP_ITEM_OFFSET(id), dp_tbl[id].datlen) != 0)
+		{
+			dpTouchElem(id, changed);
+		}
+	}
+	memcpy(p_dpData, p_data, sizeof(DP_ITEM_STORAGE_T));
+	ver = dataPoolVer;
+	dpWriteEnd();
 
 	/* Release the datapool */
     err = pthread_mutex_unlock(&dataPoolLock);
@@ -416,6 +700,7 @@ gp_retcode_t SetPool(DP_ITEM_STORAGE_T *p_data)
 		return GP_DP_ACCESS_ERR;
     }
 
+	dpNotifyChange(changed, ver);
     return GP_SUCCESS;
 }
 
@@ -437,87 +722,1168 @@ gp_retcode_t SetPool(DP_ITEM_STORAGE_T *p_data)
  **************************************************************************************/
 gp_retcode_t GetPool(DP_ITEM_STORAGE_T *p_data)
 {
-    uint32_t err;
-
-	/* Get access to the datapool */    
-    err = pthread_mutex_lock(&dataPoolLock);
-    if(err != Success) 
-    {
-		return GP_DP_ACCESS_ERR;
-    }
+	uint32_t seq;
 
-	/* Copy datapool image to the datapool */	
-	memcpy(p_data, &dp_data, sizeof(DP_ITEM_STORAGE_T));
-
-	/* Release the datapool */
-    err = pthread_mutex_unlock(&dataPoolLock);
-    if(err != Success) 
-    {
-		return GP_DP_ACCESS_ERR;
-    }
+	/* Copy the datapool image, retry if a writer updated the datapool meanwhile */	
+	do
+	{
+		seq = dpReadBegin();
+		memcpy(p_data, p_dpData, sizeof(DP_ITEM_STORAGE_T));
+	} while(dpReadRetry(seq));
 
     return GP_SUCCESS;
 }
 
 /**************************************************************************************/
-/*! \fn dpSetDfltVal(unsigned int id)
+/*! \fn GetPoolDirty(uint32_t since_ver, uint32_t p_dirty[], uint32_t *p_ver)
  *
- *	\param[in] id - element id
+ *	\param[in] since_ver - Datapool version already known by the caller, 0 for none
+ *	\param[out] p_dirty  - Dirty bitmap of ::DP_DIRTY_WORDS words, bit n is set if item 
+ *						   ID n changed since since_ver
+ *	\param[out] p_ver	  - Current datapool version, to pass as since_ver next time
  *
  *  \par Description:	  
- *  Set the datapool element to its default value.
+ *  Return which datapool items changed since a datapool version.
  *
- *  \returns none 
+ *  \retval	Return code of type ::gp_retcode_t
  *
  *  \par Limitations/Caveats:
- *	 1) Assumes that element ID is valid.
+ *	 1) The versions are kept by the process that writes the datapool, an attached 
+ *	    process (AttachPoolShared()) never sees a change.
  *
+ *	\ingroup dpfcns_public
  **************************************************************************************/
-void dpSetDfltVal(unsigned int id)
+gp_retcode_t GetPoolDirty(uint32_t since_ver, uint32_t p_dirty[], uint32_t *p_ver)
 {
-	switch(dp_tbl[id].type)
-	{
-		case GP_INT32:
-			*(int *)(dp_tbl[id].p_data) = *(int *)(dp_tbl[id].p_default);
-			break;
-
-		case GP_UINT32:
-			*(uint32_t *)(dp_tbl[id].p_data) = *(uint32_t *)(dp_tbl[id].p_default);
-			break;
+	uint32_t seq;
+	unsigned int id;
 
-		case GP_INT64:
-			*(int64_t *)(dp_tbl[id].p_data) = *(int64_t *)(dp_tbl[id].p_default);
-			break;
-
-		case GP_UINT64:
-			*(uint64_t *)(dp_tbl[id].p_data) = *(uint64_t *)(dp_tbl[id].p_default);
-			break;
-
-		case GP_FLOAT:
-			*(float *)(dp_tbl[id].p_data) = *(float *)(dp_tbl[id].p_default);
-			break;
+	if((p_dirty == NULL) || (p_ver == NULL))
+	{
+		return GP_DP_PARMS_ERR;
+	}
 
-		case GP_DBL:
-			*(double *)(dp_tbl[id].p_data) = *(double *)(dp_tbl[id].p_default);
-			break;
+	do
+	{
+		seq = dpReadBegin();
+		memset(p_dirty, 0, DP_DIRTY_WORDS * sizeof(uint32_t));
+		for(id = ELEM_MIN_ID; id < ELEM_MAX_ID; id++)
+		{
+			if(__atomic_load_n(&dpElemVer[id], __ATOMIC_RELAXED) > since_ver)
+			{
+				DP_DIRTY_SET(p_dirty, id);
+			}
+		}
+		*p_ver = __atomic_load_n(&dataPoolVer, __ATOMIC_RELAXED);
+	} while(dpReadRetry(seq));
 
-		case GP_STRING:
-			strlcpy((char *)dp_tbl[id].p_data, (char *)(dp_tbl[id].p_default), strlen((char *)(dp_tbl[id].p_default)));
-            break;
-            
-		case GP_INT16:
-			*(int16_t *)(dp_tbl[id].p_data) = *(int16_t *)(dp_tbl[id].p_default);
-			break;
+    return GP_SUCCESS;
+}
 
-		case GP_UINT16:
-			*(uint16_t *)(dp_tbl[id].p_data) = *(uint16_t *)(dp_tbl[id].p_default);
-			break;
+/**************************************************************************************/
+/*! \fn GetPoolDelta(uint32_t since_ver, const uint32_t p_mask[], uint8_t *p_buf, int bufsz, int *p_len)
+ *
+ *	\param[in] since_ver - Datapool version already known by the receiver, 0 for none
+ *	\param[in] p_mask	  - Bitmap of the items of interest (::DP_DIRTY_WORDS words), NULL 
+ *						   for all the items
+ *	\param[out] p_buf	  - Buffer for the delta image
+ *	\param[in] bufsz	  - Size in bytes of p_buf
+ *	\param[out] p_len	  - Size in bytes of the delta image
+ *
+ *  \par Description:	  
+ *  Build the delta image of the datapool items changed since since_ver: the version 
+ *	the image brings the receiver to (32 bit), the dirty bitmap (::DP_DIRTY_WORDS 32 bit 
+ *	words) and the value of every item of the bitmap in item ID order (datlen bytes 
+ *	each).  If the changed items do not all fit in p_buf the oldest changes are sent 
+ *	first and the version of the image is the one of the last item sent, so the 
+ *	receiver gets the rest with its next request.
+ *
+ *  \retval	Return code of type ::gp_retcode_t
+ *
+ *  \par Limitations/Caveats:
+ *	 1) See GetPoolDirty().  The version wraps after 2^32 changes.
+ *	 2) The item values are copied in the byte order of the host.
+ *
+ *	\ingroup dpfcns_public
+ **************************************************************************************/
+gp_retcode_t GetPoolDelta(uint32_t since_ver, const uint32_t p_mask[], uint8_t *p_buf, int bufsz, int *p_len)
+{
+	gp_retcode_t retval;
+	uint32_t dirty[DP_DIRTY_WORDS];
+	uint32_t seq, ver, elem_ver, next_ver = 0;
+	int id, next_id, len, offset, i;
 
-		default:
-			break;
+	if((p_buf == NULL) || (p_len == NULL) || (bufsz < DP_DELTA_HDR_SZ))
+	{
+		return GP_DP_PARMS_ERR;
 	}
+
+	do
+	{
+		seq = dpReadBegin();
+		retval = GP_SUCCESS;
+		memset(dirty, 0, sizeof(dirty));
+		ver = since_ver;
+		len = DP_DELTA_HDR_SZ;
+
+		/* Select the changed items, oldest change first, as long as they fit */
+		do
+		{
+			next_id = -1;
+			for(id = ELEM_MIN_ID; id < ELEM_MAX_ID; id++)
+			{
+				if((p_mask != NULL) && !DP_DIRTY_TEST(p_mask, id))
+				{
+					continue;
+				}
+				elem_ver = __atomic_load_n(&dpElemVer[id], __ATOMIC_RELAXED);
+				if((elem_ver > ver) && ((next_id < 0) || (elem_ver < next_ver)))
+				{
+					next_id = id;
+					next_ver = elem_ver;
+				}
+			}
+			if((next_id >= 0) && ((len + dp_tbl[next_id].datlen) <= bufsz))
+			{
+				DP_DIRTY_SET(dirty, next_id);
+				len += dp_tbl[next_id].datlen;
+				ver = next_ver;
+			}
+			else if(next_id >= 0)
+			{
+				/* An item bigger than the buffer would never be sent */
+				if(len == DP_DELTA_HDR_SZ)
+				{
+					retval = GP_DP_DATA_ERR;
+				}
+				break;
+			}
+		} while(next_id >= 0);
+
+		/* Every change was selected, the receiver is brought to the current version */
+		if(next_id < 0)
+		{
+			ver = __atomic_load_n(&dataPoolVer, __ATOMIC_RELAXED);
+		}
+
+		/* Encode the version, the bitmap and the item values */
+		offset = gp_Store32bit(ver, &p_buf[0]);
+		for(i = 0; i < DP_DIRTY_WORDS; i++)
+		{
+			offset += gp_Store32bit(dirty[i], &p_buf[offset]);
+		}
+		for(id = ELEM_MIN_ID; id < ELEM_MAX_ID; id++)
+		{
+			if(DP_DIRTY_TEST(dirty, id))
+			{
+				memcpy(&p_buf[offset], DP_ITEM_DATA(id), dp_tbl[id].datlen);
+				offset += dp_tbl[id].datlen;
+			}
+		}
+	} while(dpReadRetry(seq));
+
+	*p_len = offset;
+    return retval;
+}
+
+/**************************************************************************************/
+/*! \fn SetPoolDelta(uint8_t *p_buf, int bufsz, uint32_t *p_ver)
+ *
+ *	\param[in] p_buf	  - Delta image built by GetPoolDelta()
+ *	\param[in] bufsz	  - Size in bytes of p_buf, the image must fit in it
+ *	\param[out] p_ver	  - Version of the image, to pass to GetPoolDelta() next time
+ *
+ *  \par Description:	  
+ *  Store the item values of a delta image into the datapool.  The whole image is 
+ *	checked before any item is changed.
+ *
+ *  \retval	Return code of type ::gp_retcode_t
+ *
+ *  \par Limitations/Caveats:
+ *	 1) The image shall come from a datapool with the same layout (pool_def.h).
+ *
+ *	\ingroup dpfcns_public
+ **************************************************************************************/
+gp_retcode_t SetPoolDelta(uint8_t *p_buf, int bufsz, uint32_t *p_ver)
+{
+	uint32_t dirty[DP_DIRTY_WORDS];
+	uint32_t changed[DP_DIRTY_WORDS] = {0};
+	uint32_t err, ver, pool_ver;
+	int id, len, offset, i;
+
+	/* Only the owner of the datapool can write it */
+	if(dpReadOnly)
+	{
+		return GP_DP_ACCESS_ERR;
+	}
+	if((p_buf == NULL) || (p_ver == NULL) || (bufsz < DP_DELTA_HDR_SZ))
+	{
+		return GP_DP_PARMS_ERR;
+	}
+
+	/* Decode the version and the bitmap, and check the size of the item values */
+	offset = gp_Read32bit(&ver, &p_buf[0]);
+	for(i = 0; i < DP_DIRTY_WORDS; i++)
+	{
+		offset += gp_Read32bit(&dirty[i], &p_buf[offset]);
+	}
+	len = DP_DELTA_HDR_SZ;
+	for(id = ELEM_MIN_ID; id < (DP_DIRTY_WORDS * 32); id++)
+	{
+		if(DP_DIRTY_TEST(dirty, id))
+		{
+			if(id >= ELEM_MAX_ID)
+			{
+				return GP_DP_DATA_ERR;
+			}
+			len += dp_tbl[id].datlen;
+		}
+	}
+	if(len > bufsz)
+	{
+		return GP_DP_DATA_ERR;
+	}
+
+	/* Get access to the datapool */    
+    err = pthread_mutex_lock(&dataPoolLock);
+    if(err != Success) 
+    {
+		return GP_DP_ACCESS_ERR;
+    }
+
+	/* Copy the item values to the datapool */	
+	dpWriteBegin();
+	for(id = ELEM_MIN_ID; id < ELEM_MAX_ID; id++)
+	{
+		if(DP_DIRTY_TEST(dirty, id))
+		{
+			memcpy(DP_ITEM_DATA(id), &p_buf[offset], dp_tbl[id].datlen);
+			offset += dp_tbl[id].datlen;
+			dpTouchElem(id, changed);
+		}
+	}
+	pool_ver = dataPoolVer;
+	dpWriteEnd();
+
+	/* Release the datapool */
+    err = pthread_mutex_unlock(&dataPoolLock);
+    if(err != Success) 
+    {
+		return GP_DP_ACCESS_ERR;
+    }
+
+	dpNotifyChange(changed, pool_ver);
+	*p_ver = ver;
+    return GP_SUCCESS;
+}
+
+/**************************************************************************************/
+/*! \fn SetPoolChangeHook(DP_CHANGE_HOOK_T p_hook)
+ *
+ *	\param[in] p_hook - Callback executed after datapool items changed, NULL for none
+ *
+ *  \par Description:	  
+ *  Register the callback executed by SetElem(), SetPool() and SetPoolDelta() once they 
+ *	changed datapool items.  It receives the bitmap of the changed items and the 
+ *	datapool version after the change, see GetPoolDelta().
+ *
+ *  \retval	Return code of type ::gp_retcode_t
+ *
+ *  \par Limitations/Caveats:
+ *	 1) The callback is executed on the thread of the writer, after the datapool is 
+ *	    released, so it may read the datapool but writers run it concurrently.
+ *
+ *	\ingroup dpfcns_public
+ **************************************************************************************/
+gp_retcode_t SetPoolChangeHook(DP_CHANGE_HOOK_T p_hook)
+{
+	__atomic_store_n(&dpChangeHook, p_hook, __ATOMIC_RELEASE);
+    return GP_SUCCESS;
+}
+
+/**************************************************************************************/
+/*! \fn SetPoolStale(const uint32_t p_mask[], bool stale)
+ *
+ *	\param[in] p_mask - Bitmap of the items (::DP_DIRTY_WORDS words)
+ *	\param[in] stale  - true to mark the items stale, false to mark them valid again
+ *
+ *  \par Description:	  
+ *  Mark datapool items stale, i.e. their source stopped updating them (e.g. a CAN 
+ *	signal timed out), or valid again.  Item values and versions are not changed, the 
+ *	readers check the staleness with GetPoolStale().
+ *
+ *  \retval	Return code of type ::gp_retcode_t
+ *
+ *  \par Limitations/Caveats:
+ *	 1) The stale bitmap is local to the process, an attached process (AttachPoolShared())
+ *	    keeps its own copy, e.g. from ElemStaleNotify messages.
+ *
+ *	\ingroup dpfcns_public
+ **************************************************************************************/
+gp_retcode_t SetPoolStale(const uint32_t p_mask[], bool stale)
+{
+	int i;
+
+	if(p_mask == NULL)
+	{
+		return GP_DP_PARMS_ERR;
+	}
+	for(i = 0; i < DP_DIRTY_WORDS; i++)
+	{
+		if(stale)
+		{
+			__atomic_fetch_or(&dpStale[i], p_mask[i], __ATOMIC_RELEASE);
+		}
+		else
+		{
+			__atomic_fetch_and(&dpStale[i], ~p_mask[i], __ATOMIC_RELEASE);
+		}
+	}
+    return GP_SUCCESS;
+}
+
+/**************************************************************************************/
+/*! \fn GetPoolStale(uint32_t p_stale[])
+ *
+ *	\param[out] p_stale - Stale bitmap of ::DP_DIRTY_WORDS words, bit n is set if item 
+ *						  ID n is stale
+ *
+ *  \par Description:	  
+ *  Return which datapool items are stale, see SetPoolStale().
+ *
+ *  \retval	Return code of type ::gp_retcode_t
+ *
+ *  \par Limitations/Caveats:
+ *	 None.
+ *
+ *	\ingroup dpfcns_public
+ **************************************************************************************/
+gp_retcode_t GetPoolStale(uint32_t p_stale[])
+{
+	int i;
+
+	if(p_stale == NULL)
+	{
+		return GP_DP_PARMS_ERR;
+	}
+	for(i = 0; i < DP_DIRTY_WORDS; i++)
+	{
+		p_stale[i] = __atomic_load_n(&dpStale[i], __ATOMIC_ACQUIRE);
+	}
+    return GP_SUCCESS;
+}
+
+/**************************************************************************************/
+/*! \fn EncodeElem(int id, const void *p_value, uint8_t *p_buf, int bufsz, int *p_len)
+ *
+ *	\param[in] id 	   - Element id as defined in #DP_ELEMENT_IDS (pool_def.h)
+ *	\param[in] p_value - Element value, as read by GetElem()
+ *	\param[out] p_buf  - Storage for the encoded value
+ *	\param[in] bufsz   - Size in bytes of p_buf
+ *	\param[out] p_len  - Number of bytes encoded
+ *
+ *  \par Description:	  
+ *  Encode the value of a datapool item in the IPC message format, with the handler of 
+ *	its data type.  Numbers are encoded in the IPC byte order, strings with their NULL.
+ *
+ *  \retval	Return code of type ::gp_retcode_t
+ *
+ *  \par Limitations/Caveats:
+ *	 None.
+ *
+ *	\ingroup dpfcns_public
+ **************************************************************************************/
+gp_retcode_t EncodeElem(int id, const void *p_value, uint8_t *p_buf, int bufsz, int *p_len)
+{
+	const DP_CODEC_T *p_codec;
+	int len;
+
+	if((p_value == NULL) || (p_buf == NULL) || (p_len == NULL) || (id < ELEM_MIN_ID) || (id >= ELEM_MAX_ID))
+	{
+		return GP_DP_PARMS_ERR;
+	}
+	p_codec = &dpCodecTbl[dp_tbl[id].type];
+	if(p_codec->encode == NULL)
+	{
+		return GP_DP_DATA_ERR;
+	}
+	len = p_codec->encode(p_value, dp_tbl[id].datlen, p_buf, bufsz);
+	if(len < 0)
+	{
+		return GP_DP_DATA_ERR;
+	}
+	*p_len = len;
+    return GP_SUCCESS;
+}
+
+/**************************************************************************************/
+/*! \fn DecodeElem(int id, const uint8_t *p_buf, int bufsz, void *p_value, int *p_len)
+ *
+ *	\param[in] id 	   - Element id as defined in #DP_ELEMENT_IDS (pool_def.h)
+ *	\param[in] p_buf   - Encoded value, see EncodeElem()
+ *	\param[in] bufsz   - Number of bytes available at p_buf
+ *	\param[out] p_value - Storage for the value, to pass to SetElem()
+ *	\param[out] p_len  - Number of bytes decoded
+ *
+ *  \par Description:	  
+ *  Decode the value of a datapool item from the IPC message format, with the handler of 
+ *	its data type.
+ *
+ *  \retval	Return code of type ::gp_retcode_t
+ *
+ *  \par Limitations/Caveats:
+ *	 1) p_value shall hold the item, a ::DP_ITEM_VALUE_T holds any of them.
+ *
+ *	\ingroup dpfcns_public
+ **************************************************************************************/
+gp_retcode_t DecodeElem(int id, const uint8_t *p_buf, int bufsz, void *p_value, int *p_len)
+{
+	const DP_CODEC_T *p_codec;
+	int len;
+
+	if((p_value == NULL) || (p_buf == NULL) || (p_len == NULL) || (id < ELEM_MIN_ID) || (id >= ELEM_MAX_ID))
+	{
+		return GP_DP_PARMS_ERR;
+	}
+	p_codec = &dpCodecTbl[dp_tbl[id].type];
+	if(p_codec->decode == NULL)
+	{
+		return GP_DP_DATA_ERR;
+	}
+	len = p_codec->decode(p_buf, bufsz, p_value, dp_tbl[id].datlen);
+	if(len < 0)
+	{
+		return GP_DP_DATA_ERR;
+	}
+	*p_len = len;
+    return GP_SUCCESS;
+}
+
+/**************************************************************************************/
+/*! \fn GetCanSigStore(int id, int bits, DP_CANSIG_STORE_T *p_store)
+ *
+ *	\param[in] id 	   - Element id as defined in #DP_ELEMENT_IDS (pool_def.h)
+ *	\param[in] bits    - Size in bits of the signal data, 1 to 32
+ *	\param[out] p_store - How the signal data is stored in the item, for StoreCanSig()
+ *
+ *  \par Description:	  
+ *  Check that the data of a CAN signal fits in its datapool item, which shall be a numeric 
+ *	item (a GP_FLOAT item is read from a 32 bit pattern), and describe how StoreCanSig() 
+ *	stores it: sign extended for the signed items, then the size of the item.  The check is 
+ *	done once per signal when a map or a plan is built, so storing a value takes no branch 
+ *	on the item type.
+ *
+ *  \retval	Return code of type ::gp_retcode_t
+ *
+ *  \par Limitations/Caveats:
+ *	 None
+ *
+ *	\ingroup dpfcns_public
+ **************************************************************************************/
+gp_retcode_t GetCanSigStore(int id, int bits, DP_CANSIG_STORE_T *p_store)
+{
+	const uint64_t one = 1;
+	bool is_signed = false;
+	int width;
+
+	if((p_store == NULL) || (id < ELEM_MIN_ID) || (id >= ELEM_MAX_ID) || (bits < 1) || (bits > 32)
+		|| (bits > (dp_tbl[id].datlen * 8)))
+	{
+		return GP_DP_PARMS_ERR;
+	}
+	switch(dp_tbl[id].type)
+	{
+	case GP_INT32:	width = sizeof(DP_CTYPE_GP_INT32);	is_signed = true;	break;
+	case GP_UINT32:	width = sizeof(DP_CTYPE_GP_UINT32);						break;
+	case GP_INT64:	width = sizeof(DP_CTYPE_GP_INT64);	is_signed = true;	break;
+	case GP_UINT64:	width = sizeof(DP_CTYPE_GP_UINT64);						break;
+	case GP_INT16:	width = sizeof(DP_CTYPE_GP_INT16);	is_signed = true;	break;
+	case GP_UINT16:	width = sizeof(DP_CTYPE_GP_UINT16);						break;
+	case GP_UINT8:	width = sizeof(DP_CTYPE_GP_UINT8);						break;
+	case GP_FLOAT:
+		if(bits != 32)
+		{
+			return GP_DP_PARMS_ERR;
+		}
+		width = sizeof(DP_CTYPE_GP_FLOAT);
+		break;
+	default:
+		return GP_DP_PARMS_ERR;
+	}
+	p_store->Sign = is_signed ? ((uint64_t)1 << (bits - 1)) : 0;
+	p_store->Width = (uint8_t)width;
+	p_store->Offset = (*(const uint8_t *)&one == 1) ? 0 : (uint8_t)(sizeof(uint64_t) - width);
+    return GP_SUCCESS;
+}
+
+/**************************************************************************************/
+/*! \fn StoreCanSig(const DP_CANSIG_STORE_T *p_store, uint32_t raw, void *p_value)
+ *
+ *	\param[in] p_store  - Store of the signal, from GetCanSigStore()
+ *	\param[in] raw      - Signal data, right aligned and masked to its size
+ *	\param[out] p_value - Storage for the value of the datapool item
+ *
+ *  \par Description:	  
+ *  Convert the data of a CAN signal to the value of its datapool item without a branch: 
+ *	the data is sign extended to 64 bits (an xor and a subtraction, 0 for the unsigned 
+ *	items) and its low order bytes are copied as the item value.
+ *
+ *  \returns none 
+ *
+ *  \par Limitations/Caveats:
+ *	 None
+ *
+ *	\ingroup dpfcns_public
+ **************************************************************************************/
+void StoreCanSig(const DP_CANSIG_STORE_T *p_store, uint32_t raw, void *p_value)
+{
+	uint64_t value = ((uint64_t)raw ^ p_store->Sign) - p_store->Sign;
+
+	memcpy(p_value, (const uint8_t *)&value + p_store->Offset, p_store->Width);
+}
+
+/**************************************************************************************/
+/*! \fn SetCanSigMap(int chan, int num, const DP_CANSIG_MAP_T p_map[])
+ *
+ *	\param[in] chan  - CAN channel, DP_CANSIG_CHAN_BODY or DP_CANSIG_CHAN_CHASSIS
+ *	\param[in] num 	 - Number of signals, 0 to DP_CANSIG_MAX
+ *	\param[in] p_map - Datapool item of every signal, in any order
+ *
+ *  \par Description:	  
+ *  Replace the CAN signal to datapool item map of the channel used by SetCanSigElems().
+ *	Every signal shall have a unique ID, a size of 1 to SIGNAL_DATA_SZ_MAX bytes that fits 
+ *	in its item and a numeric item (a GP_FLOAT item is read from a 4 byte bit pattern).
+ *
+ *  \retval	Return code of type ::gp_retcode_t.  The map is not changed on error.
+ *
+ *  \par Limitations/Caveats:
+ *	 1) Not synchronized with SetCanSigElems(), shall be called before the CAN signal data 
+ *	    of the channel is received or from the thread receiving it.
+ *
+ *	\ingroup dpfcns_public
+ **************************************************************************************/
+gp_retcode_t SetCanSigMap(int chan, int num, const DP_CANSIG_MAP_T p_map[])
+{
+	DP_CANSIG_MAP_T sorted[DP_CANSIG_MAX];
+	DP_CANSIG_STORE_T store[DP_CANSIG_MAX];
+	DP_CANSIG_MAP_T sig;
+	int i, j;
+
+	if((chan < 0) || (chan >= DP_CANSIG_NUM_CHAN) || (num < 0) || (num > DP_CANSIG_MAX) 
+		|| ((num > 0) && (p_map == NULL)))
+	{
+		return GP_DP_PARMS_ERR;
+	}
+
+	/* Check every signal and insert it in signal ID order */
+	for(i = 0; i < num; i++)
+	{
+		sig = p_map[i];
+		if((sig.DataSz < 1) || (sig.DataSz > SIGNAL_DATA_SZ_MAX))
+		{
+			return GP_DP_PARMS_ERR;
+		}
+		for(j = i; (j > 0) && (sorted[j - 1].SigId > sig.SigId); j--)
+		{
+			sorted[j] = sorted[j - 1];
+		}
+		if((j > 0) && (sorted[j - 1].SigId == sig.SigId))
+		{
+			return GP_DP_PARMS_ERR;
+		}
+		sorted[j] = sig;
+	}
+
+	/* The data of every signal shall fit in its item */
+	for(i = 0; i < num; i++)
+	{
+		if(GetCanSigStore(sorted[i].ElemId, sorted[i].DataSz * 8, &store[i]) != GP_SUCCESS)
+		{
+			return GP_DP_PARMS_ERR;
+		}
+	}
+
+	memcpy(dpCanSigMap[chan], sorted, num * sizeof(sorted[0]));
+	memcpy(dpCanSigStore[chan], store, num * sizeof(store[0]));
+	dpCanSigNum[chan] = num;
+    return GP_SUCCESS;
+}
+
+/**************************************************************************************/
+/*! \fn SetCanSigElems(int chan, const uint8_t *p_buf, int bufsz, int *p_num)
+ *
+ *	\param[in] chan   - CAN channel, DP_CANSIG_CHAN_BODY or DP_CANSIG_CHAN_CHASSIS
+ *	\param[in] p_buf  - Signal records of a VP_BCanSigDataMsg or VP_CCanSigDataMsg
+ *	\param[in] bufsz  - Number of bytes at p_buf
+ *	\param[out] p_num - Number of datapool items set, or NULL
+ *
+ *  \par Description:	  
+ *  Decode the signal records of a VP CAN signal data message (signal ID followed by the 
+ *	signal data, see SIGNAL_ID_IDX) with the map of the channel and set all their 
+ *	datapool items with a single SetElems(), so the SPI receive handler updates the 
+ *	datapool directly without a SetElemReq per signal.  The signal data is read in the 
+ *	IPC byte order and sign extended for the signed items.  If a message has several 
+ *	records of the same item the last one is stored.
+ *
+ *  \retval	Return code of type ::gp_retcode_t.  No item is changed on error.
+ *
+ *  \par Limitations/Caveats:
+ *	 1) A signal missing from the map is an error: its size, so the next record, is 
+ *	    not known.
+ *
+ *	\ingroup dpfcns_public
+ **************************************************************************************/
+gp_retcode_t SetCanSigElems(int chan, const uint8_t *p_buf, int bufsz, int *p_num)
+{
+	const DP_CANSIG_MAP_T *p_sig;
+	DP_ITEM_VALUE_T values[ELEM_MAX_ID];
+	void *p_values[ELEM_MAX_ID];
+	int ids[ELEM_MAX_ID];
+	int slot[ELEM_MAX_ID];
+	gp_retcode_t retval;
+	uint16_t sig_id;
+	uint32_t raw;
+	int offset = 0;
+	int num = 0;
+	int i, j;
+
+	if((chan < 0) || (chan >= DP_CANSIG_NUM_CHAN) || (bufsz < 0) || ((bufsz > 0) && (p_buf == NULL)))
+	{
+		return GP_DP_PARMS_ERR;
+	}
+
+	/* Decode every record, the items are collected once */
+	memset(slot, -1, sizeof(slot));
+	while(offset < bufsz)
+	{
+		if((bufsz - offset) < SIGNAL_DATA_IDX)
+		{
+			return GP_DP_DATA_ERR;
+		}
+		gp_Read16bit(&sig_id, (uint8_t *)&p_buf[offset + SIGNAL_ID_IDX]);
+		p_sig = dpFindCanSig(chan, sig_id);
+		if((p_sig == NULL) || ((bufsz - offset - SIGNAL_DATA_IDX) < p_sig->DataSz))
+		{
+			return GP_DP_DATA_ERR;
+		}
+		i = slot[p_sig->ElemId];
+		if(i < 0)
+		{
+			i = num++;
+			slot[p_sig->ElemId] = i;
+			ids[i] = p_sig->ElemId;
+			p_values[i] = &values[i];
+		}
+		raw = 0;
+		for(j = p_sig->DataSz - 1; j >= 0; j--)
+		{
+			raw = (raw << 8) | p_buf[offset + SIGNAL_DATA_IDX + j];
+		}
+		StoreCanSig(&dpCanSigStore[chan][p_sig - dpCanSigMap[chan]], raw, &values[i]);
+		offset += SIGNAL_DATA_IDX + p_sig->DataSz;
+	}
+
+	/* Commit all the items at once */
+	retval = SetElems(num, ids, p_values);
+	if((retval == GP_SUCCESS) && (p_num != NULL))
+	{
+		*p_num = num;
+	}
+    return retval;
+}
+
+/**************************************************************************************/
+/*! \fn dpSetDfltVal(unsigned int id)
+ *
+ *	\param[in] id - element id
+ *
+ *  \par Description:	  
+ *  Set the datapool element to its default value.
+ *
+ *  \returns none 
+ *
+ *  \par Limitations/Caveats:
+ *	 1) Assumes that element ID is valid.
+ *
+ **************************************************************************************/
+void dpSetDfltVal(unsigned int id)
+{
+	const DP_CODEC_T *p_codec = &dpCodecTbl[dp_tbl[id].type];
+
+	if(p_codec->store != NULL)
+	{
+		(void)p_codec->store(DP_ITEM_DATA(id), dp_tbl[id].p_default, dp_tbl[id].datlen);
+	}
+}
+
+
+/**************************************************************************************/
+/*! \fn dpWriteBegin(void)
+ *
+ *  \par Description:	  
+ *  Mark the start of a datapool update.  The sequence counter becomes odd before any 
+ *	item is written.
+ *
+ *  \returns none 
+ *
+ *  \par Limitations/Caveats:
+ *	 1) The caller must hold dataPoolLock.
+ *
+ **************************************************************************************/
+static inline void dpWriteBegin(void)
+{
+	__atomic_store_n(p_dpSeq, *p_dpSeq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**************************************************************************************/
+/*! \fn dpWriteEnd(void)
+ *
+ *  \par Description:	  
+ *  Mark the end of a datapool update.  The sequence counter becomes even after every 
+ *	item has been written.
+ *
+ *  \returns none 
+ *
+ *  \par Limitations/Caveats:
+ *	 1) The caller must hold dataPoolLock.
+ *
+ **************************************************************************************/
+static inline void dpWriteEnd(void)
+{
+	__atomic_store_n(p_dpSeq, *p_dpSeq + 1, __ATOMIC_RELEASE);
+}
+
+/**************************************************************************************/
+/*! \fn dpReadBegin(void)
+ *
+ *  \par Description:	  
+ *  Wait until no writer is updating the datapool and return the sequence counter.
+ *
+ *  \returns Sequence counter to pass to dpReadRetry()
+ *
+ *  \par Limitations/Caveats:
+ *	 None
+ *
+ **************************************************************************************/
+static inline uint32_t dpReadBegin(void)
+{
+	uint32_t seq;
+
+	while(DP_SEQ_WRITING(seq = __atomic_load_n(p_dpSeq, __ATOMIC_ACQUIRE)))
+	{
+		/* A writer only holds the counter odd for the time of a copy, spin */
+	}
+	return seq;
+}
+
+/**************************************************************************************/
+/*! \fn dpReadRetry(uint32_t seq)
+ *
+ *	\param[in] seq - Sequence counter returned by dpReadBegin()
+ *
+ *  \par Description:	  
+ *  Check whether the datapool was updated since dpReadBegin(), in which case the data 
+ *	copied in between may be inconsistent and must be read again.
+ *
+ *  \returns true if the read must be retried
+ *
+ *  \par Limitations/Caveats:
+ *	 None
+ *
+ **************************************************************************************/
+static inline bool dpReadRetry(uint32_t seq)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return (__atomic_load_n(p_dpSeq, __ATOMIC_RELAXED) != seq);
+}
+
+/**************************************************************************************/
+/*! \fn dpCheckElem(int id, void *p_value)
+ *
+ *	\param[in] id 	   - Element id
+ *	\param[in] p_value - New element value
+ *
+ *  \par Description:	  
+ *  Check that the item ID is valid and that the value can be stored by dpStoreElem().
+ *
+ *  \retval	Return code of type ::gp_retcode_t
+ *
+ *  \par Limitations/Caveats:
+ *	 None
+ *
+ **************************************************************************************/
+static gp_retcode_t dpCheckElem(int id, void *p_value)
+{
+	const DP_CODEC_T *p_codec;
+
+	if((p_value == NULL) || (id < ELEM_MIN_ID) || (id >= ELEM_MAX_ID))
+	{
+		return GP_DP_PARMS_ERR;
+	}
+	p_codec = &dpCodecTbl[dp_tbl[id].type];
+	if(p_codec->check == NULL)
+	{
+		return GP_DP_DATA_ERR;
+	}
+	return p_codec->check(p_value, dp_tbl[id].datlen);
+}
+
+/**************************************************************************************/
+/*! \fn dpStoreElem(int id, void *p_value)
+ *
+ *	\param[in] id 	   - Element id, assumed to be valid
+ *	\param[in] p_value - New element value
+ *
+ *  \par Description:	  
+ *  Store the value in the datapool item with the handler of its data type.
+ *
+ *  \retval	Return code of type ::gp_retcode_t
+ *
+ *  \par Limitations/Caveats:
+ *	 1) The caller must hold dataPoolLock and be between dpWriteBegin() and dpWriteEnd().
+ *
+ **************************************************************************************/
+static gp_retcode_t dpStoreElem(int id, void *p_value)
+{
+	const DP_CODEC_T *p_codec = &dpCodecTbl[dp_tbl[id].type];
+
+	if(p_codec->store == NULL)
+	{
+		return GP_DP_DATA_ERR;
+	}
+	return p_codec->store(DP_ITEM_DATA(id), p_value, dp_tbl[id].datlen);
+}
+
+/**************************************************************************************/
+/*! \fn dpCopyElem(int id, void *p_value)
+ *
+ *	\param[in] id 	   - Element id, assumed to be valid
+ *	\param[out] p_value - Storage for the element value
+ *
+ *  \par Description:	  
+ *  Copy the datapool item to p_value with the handler of its data type.  Strings are copied as a
+ *	whole item (datlen bytes) so the copy is bounded even if a writer is changing the 
+ *	string length meanwhile.
+ *
+ *  \retval	Return code of type ::gp_retcode_t
+ *
+ *  \par Limitations/Caveats:
+ *	 1) Part of the seqlock read side, it shall not have any side effect.
+ *
+ **************************************************************************************/
+static gp_retcode_t dpCopyElem(int id, void *p_value)
+{
+	const DP_CODEC_T *p_codec = &dpCodecTbl[dp_tbl[id].type];
+
+	if(p_codec->copy == NULL)
+	{
+		return GP_DP_DATA_ERR;
+	}
+	p_codec->copy(p_value, DP_ITEM_DATA(id), dp_tbl[id].datlen);
+	return GP_SUCCESS;
+}
+
+/**************************************************************************************/
+/*! \fn dpTouchElem(unsigned int id, uint32_t p_changed[])
+ *
+ *	\param[in] id 		  - Element id
+ *	\param[out] p_changed - Bitmap of the items changed by the caller, or NULL
+ *
+ *  \par Description:	  
+ *  Record a change of the datapool item: the datapool version is incremented and 
+ *	becomes the version of the item.
+ *
+ *  \returns none 
+ *
+ *  \par Limitations/Caveats:
+ *	 1) The caller must hold dataPoolLock and be between dpWriteBegin() and dpWriteEnd().
+ *
+ **************************************************************************************/
+static inline void dpTouchElem(unsigned int id, uint32_t p_changed[])
+{
+	if(id < ELEM_MAX_ID)
+	{
+		__atomic_store_n(&dataPoolVer, dataPoolVer + 1, __ATOMIC_RELAXED);
+		__atomic_store_n(&dpElemVer[id], dataPoolVer, __ATOMIC_RELAXED);
+		if(p_changed != NULL)
+		{
+			DP_DIRTY_SET(p_changed, id);
+		}
+	}
+}
+
+/**************************************************************************************/
+/*! \fn dpNotifyChange(uint32_t p_changed[], uint32_t ver)
+ *
+ *	\param[in] p_changed - Bitmap of the items changed by the caller
+ *	\param[in] ver		  - Datapool version after the change
+ *
+ *  \par Description:	  
+ *  Execute the change callback registered by SetPoolChangeHook() if any item changed.
+ *
+ *  \returns none 
+ *
+ *  \par Limitations/Caveats:
+ *	 1) The caller must have released dataPoolLock.
+ *
+ **************************************************************************************/
+static void dpNotifyChange(uint32_t p_changed[], uint32_t ver)
+{
+	DP_CHANGE_HOOK_T p_hook = __atomic_load_n(&dpChangeHook, __ATOMIC_ACQUIRE);
+	int i;
+
+	if(p_hook == NULL)
+	{
+		return;
+	}
+	for(i = 0; i < DP_DIRTY_WORDS; i++)
+	{
+		if(p_changed[i] != 0)
+		{
+			p_hook(p_changed, ver);
+			return;
+		}
+	}
+}
+
+
+/**************************************************************************************/
+/*! \fn dpFindCanSig(int chan, uint16_t sig_id)
+ *
+ *	\param[in] chan   - CAN channel, assumed to be valid
+ *	\param[in] sig_id - CAN signal ID
+ *
+ *  \par Description:	  
+ *  Binary search of the signal in the map of the channel.
+ *
+ *  \returns The map entry of the signal, NULL if it is not mapped
+ *
+ *  \par Limitations/Caveats:
+ *	 None
+ *
+ **************************************************************************************/
+static const DP_CANSIG_MAP_T *dpFindCanSig(int chan, uint16_t sig_id)
+{
+	const DP_CANSIG_MAP_T *p_map = dpCanSigMap[chan];
+	int lo = 0;
+	int hi = dpCanSigNum[chan] - 1;
+	int mid;
+
+	while(lo <= hi)
+	{
+		mid = (lo + hi) / 2;
+		if(p_map[mid].SigId == sig_id)
+		{
+			return &p_map[mid];
+		}
+		if(p_map[mid].SigId < sig_id)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid - 1;
+		}
+	}
+	return NULL;
+}
+
+/************************************************************/
+/*					DATA TYPE HANDLERS						*/
+/*  Generated from DP_TYPE_SCHEMA for the numeric types, 	*/
+/*  dispatched through dpCodecTbl[] 						*/
+/************************************************************/
+
+/**************************************************************************************/
+/*! \fn dpWireStoreU8(uint8_t value, uint8_t *p_buf)
+ *
+ *  \par Description:	  
+ *  Wire store and read functions of the types gp_utils.h only provides as macros.
+ *
+ *  \returns Number of bytes stored or read
+ *
+ **************************************************************************************/
+static int dpWireStoreU8(uint8_t value, uint8_t *p_buf)
+{
+	p_buf[0] = value;
+	return 1;
+}
+
+static int dpWireReadU8(uint8_t *p_value, uint8_t *p_buf)
+{
+	*p_value = p_buf[0];
+	return 1;
+}
+
+static int dpWireStoreU16(uint16_t value, uint8_t *p_buf)
+{
+	return gp_Store16bit(value, p_buf);
+}
+
+static int dpWireReadU16(uint16_t *p_value, uint8_t *p_buf)
+{
+	return gp_Read16bit(p_value, p_buf);
+}
+
+static int dpWireStoreU32(uint32_t value, uint8_t *p_buf)
+{
+	return gp_Store32bit(value, p_buf);
+}
+
+static int dpWireReadU32(uint32_t *p_value, uint8_t *p_buf)
+{
+	return gp_Read32bit(p_value, p_buf);
+}
+
+/*! Handlers of a numeric data type.  A value is decoded into its wire type, which has the 
+	size of the item (the float types are read as their bit pattern), then copied. */
+#define DP_NUM_CODEC(type, wtype, wstore, wread) \
+static gp_retcode_t dpCheck_##type(const void *p_value, int datlen) \
+{ \
+	(void)p_value; \
+	(void)datlen; \
+	return GP_SUCCESS; \
+} \
+static gp_retcode_t dpStore_##type(void *p_item, const void *p_value, int datlen) \
+{ \
+	(void)datlen; \
+	*(DP_CTYPE_##type *)p_item = *(const DP_CTYPE_##type *)p_value; \
+	return GP_SUCCESS; \
+} \
+static void dpCopy_##type(void *p_value, const void *p_item, int datlen) \
+{ \
+	(void)datlen; \
+	*(DP_CTYPE_##type *)p_value = *(const volatile DP_CTYPE_##type *)p_item; \
+} \
+static int dpEncode_##type(const void *p_value, int datlen, uint8_t *p_buf, int bufsz) \
+{ \
+	(void)datlen; \
+	if(bufsz < (int)sizeof(wtype)) \
+	{ \
+		return -1; \
+	} \
+	return wstore(*(const DP_CTYPE_##type *)p_value, p_buf); \
+} \
+static int dpDecode_##type(const uint8_t *p_buf, int bufsz, void *p_value, int datlen) \
+{ \
+	wtype wval; \
+	int len; \
+	(void)datlen; \
+	if(bufsz < (int)sizeof(wtype)) \
+	{ \
+		return -1; \
+	} \
+	len = wread(&wval, (uint8_t *)p_buf); \
+	memcpy(p_value, &wval, sizeof(wtype)); \
+	return len; \
+}
+DP_TYPE_SCHEMA(DP_NUM_CODEC)
+
+/**************************************************************************************/
+/*! \fn dpCheck_GP_STRING(const void *p_value, int datlen)
+ *
+ *  \par Description:	  
+ *  Handlers of the string type: a NULL terminated string that fits in the item (datlen 
+ *	bytes, NULL included).  It is encoded with its NULL.
+ *
+ **************************************************************************************/
+static gp_retcode_t dpCheck_GP_STRING(const void *p_value, int datlen)
+{
+	// comparison allows for NULL char
+	return (strnlen((const char *)p_value, datlen) < (size_t)datlen) ? GP_SUCCESS : GP_DP_DATA_ERR;
+}
+
+static gp_retcode_t dpStore_GP_STRING(void *p_item, const void *p_value, int datlen)
+{
+	if(dpCheck_GP_STRING(p_value, datlen) != GP_SUCCESS)
+	{
+		return GP_DP_DATA_ERR;
+	}
+	strlcpy((char *)p_item, (const char *)p_value, datlen);
+	return GP_SUCCESS;
+}
+
+static int dpEncode_GP_STRING(const void *p_value, int datlen, uint8_t *p_buf, int bufsz)
+{
+	int len = strnlen((const char *)p_value, datlen) + 1;
+
+	if((len > datlen) || (len > bufsz))
+	{
+		return -1;
+	}
+	memcpy(p_buf, p_value, len);
+	return len;
 }
 
+static int dpDecode_GP_STRING(const uint8_t *p_buf, int bufsz, void *p_value, int datlen)
+{
+	int len = strnlen((const char *)p_buf, bufsz);
+
+	if((len >= bufsz) || (len >= datlen))
+	{
+		return -1;
+	}
+	memcpy(p_value, p_buf, len + 1);
+	return len + 1;
+}
+
+/**************************************************************************************/
+/*! \fn dpCheck_GP_ARRAY(const void *p_value, int datlen)
+ *
+ *  \par Description:	  
+ *  Handlers of the byte array type, always datlen bytes.  Arrays and strings are copied 
+ *	out of the datapool as a whole item by dpCopy_GP_BYTES().
+ *
+ **************************************************************************************/
+static gp_retcode_t dpCheck_GP_ARRAY(const void *p_value, int datlen)
+{
+	(void)p_value;
+	(void)datlen;
+	return GP_SUCCESS;
+}
+
+static gp_retcode_t dpStore_GP_ARRAY(void *p_item, const void *p_value, int datlen)
+{
+	memcpy(p_item, p_value, datlen);
+	return GP_SUCCESS;
+}
+
+static void dpCopy_GP_BYTES(void *p_value, const void *p_item, int datlen)
+{
+	memcpy(p_value, p_item, datlen);
+}
+
+static int dpEncode_GP_ARRAY(const void *p_value, int datlen, uint8_t *p_buf, int bufsz)
+{
+	if(datlen > bufsz)
+	{
+		return -1;
+	}
+	memcpy(p_buf, p_value, datlen);
+	return datlen;
+}
+
+static int dpDecode_GP_ARRAY(const uint8_t *p_buf, int bufsz, void *p_value, int datlen)
+{
+	if(datlen > bufsz)
+	{
+		return -1;
+	}
+	memcpy(p_value, p_buf, datlen);
+	return datlen;
+}
+
+/*! Handlers of every data type, a type without handlers is not supported */
+#define DP_CODEC_ENTRY(type, wtype, wstore, wread) \
+	[type] = { dpCheck_##type, dpStore_##type, dpCopy_##type, dpEncode_##type, dpDecode_##type },
+static const DP_CODEC_T dpCodecTbl[GP_UINT8 + 1] =
+{
+	DP_TYPE_SCHEMA(DP_CODEC_ENTRY)
+	[GP_STRING] = { dpCheck_GP_STRING, dpStore_GP_STRING, dpCopy_GP_BYTES, dpEncode_GP_STRING, dpDecode_GP_STRING },
+	[GP_ARRAY]  = { dpCheck_GP_ARRAY, dpStore_GP_ARRAY, dpCopy_GP_BYTES, dpEncode_GP_ARRAY, dpDecode_GP_ARRAY },
+};
+
 
 /************************************************************/
 /*						LEGACY FUNCTIONS					*/
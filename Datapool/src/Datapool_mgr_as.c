@@ -34,6 +34,7 @@
 		   INCLUDE FILES
 ***********************************/
 #include <semaphore.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -48,11 +49,13 @@
 
 #include "msg_buf.h"
 #include "msg_api_signals.h"
+#include "msg_evloop.h"
 #include "msg_def.h"
 #include "msg_fcn.h"
 #include "App_cfg.h"
 
 #include "Datapool.h"	// Also includes pool_def.h
+#include "can_tmo.h"
 #include "Hmi_demo.h"
 #include "identification_data.h"
 
@@ -67,6 +70,7 @@ typedef struct {
     uint8_t * Buf;   /*!< Pointer to data buffer */
 } BufInfoType;
 
+
 /***********************************
 	              Config Macros
 ***********************************/
@@ -104,11 +108,26 @@ static BufInfoType TskBufInfo[BUFINFO_NUM_ENTRIES];
 
 #define IM_READY 10
 
+/* Number of ElemChangeNotify messages sent to HMI manager by one TxMsgBatch() call */
+#define NOTIFY_BATCH_SZ 8
+
 /***********************************
 	Private Data and Structures
 ***********************************/
 static uint8_t  cmp_buf_num = MAIN_COMPONENT;
 static uint8_t  component = DP_MGR_AS;
+
+/*! Datapool items the HMI manager subscribed to, and datapool version it was last notified of */
+static uint32_t HmSubMask[DP_DIRTY_WORDS];
+static uint32_t HmSubVer = 0;
+static uint32_t HmSubGen = 0;			/*!< Incremented by every subscription, restarts HmSubVer */
+static pthread_mutex_t HmSubLock = PTHREAD_MUTEX_INITIALIZER;
+
+/*! Notifications queued for the notify thread, protected by HmSubLock */
+static bool HmChangePending = false;
+static bool HmStalePending = false;
+static pthread_cond_t HmNotifyCond = PTHREAD_COND_INITIALIZER;
+static pthread_t HmNotifyThread;
 /*********************************/
 /*  Memory allocation            */
 /*********************************/
@@ -117,21 +136,28 @@ static uint8_t  component = DP_MGR_AS;
 	Private Function Prototypes
 ***********************************/
 
-void IntTsk_HmasBufRxHandler(void * data);//HMASCON1_BUF_S
+void IntTsk_HmasBufRxHandler(void * data, uint16_t size);//HMASCON1_BUF_S
 
 function_cb_t msg_receive_handler[] ={
     IntTsk_HmasBufRxHandler
 };
 static int32_t ProcHbtReq(uint8_t * data, uint32_t size);
 static int32_t ProcPoolCopyReq(void);
+static int32_t ProcPoolDeltaReq(uint8_t * data, uint32_t size);
+static int32_t ProcElemSubscribeMsg(uint8_t * data, uint32_t size, bool subscribe);
+static int32_t NotifyElemChanges(const uint32_t p_mask[], uint32_t * p_ver);
+static void IntTsk_DpChangeHook(const uint32_t p_dirty[], uint32_t ver);
+static int32_t NotifyElemStale(void);
+static void IntTsk_CanTmoHook(const uint32_t p_changed[], bool stale);
+static void * IntTsk_NotifyThread(void * ignore);
 static int32_t ProcSetElemMsg(uint8_t * data, uint32_t size);
-static int32_t ProcGetElemMsg(int8_t socket_fd, pid_t tid, uint8_t ImComponent, uint8_t * data, uint8_t dataSz);
+static int32_t ProcGetElemMsg(int8_t socket_fd, pid_t tid, uint8_t ImComponent, uint8_t * data, uint32_t size);
+static int32_t ProcSetElemsMsg(uint8_t * data, uint32_t size);
+static int32_t ProcGetElemsMsg(uint8_t * data, uint32_t size);
 
 static gp_retcode_t PmProcOpMode(uint8_t *p_buf, int cmdlen);
 static gp_retcode_t PmProcOpInitData(uint8_t *p_buf, int cmdlen);
 
-void MsgRxHandler(int sig, siginfo_t *si, void *uc);
-
 uint8_t components[] = {HMI_MGR_WRKTSK1};
 component_info_t componentsId[BUFINFO_NUM_ENTRIES];
 
@@ -162,10 +188,10 @@ int main()
         }
     }while(rc != GP_SUCCESS);
 
-    /* Init data pool */
+    /* Init data pool, in shared memory if the HMI reads it in place */
     do 
     {
-		rc = InitPool();//needs minimum changes
+		rc = (DpMgr_SharedPool) ? InitPoolShared(CommonDp_ShmName) : InitPool();//needs minimum changes
 		if(rc != GP_SUCCESS) 
 		{    
 		    gp_Printf(DFLT_DBG_PRNTLVL, "\nPMAS_INTTSK: InitPool() error %d\n", rc);
@@ -199,27 +225,44 @@ int main()
             printf("Msg_WaitForRx, failed in Component:%i\n", component);
         }
     }while(tmpCom[0].Fd < 0);
+    if(SetMsgTransport(&tmpCom[0], HmiMgrWrkTsk1DpMgr_Transport) != 0){
+        printf("SetMsgTransport, failed in Component:%i\n", component);
+    }
 
+    memcpy(&componentsId[0], &tmpCom[0], sizeof(tmpCom));
+    /* Messages are received and dispatched on the event loop thread */
     do 
     {
-        sigset_t mask;
-        struct sigaction sa;
-
-        sa.sa_flags = SA_SIGINFO;
-        sa.sa_sigaction = MsgRxHandler;
-        sigemptyset(&sa.sa_mask);
-        sigaddset(&sa.sa_mask, SIGPOLL);
-        sigaddset(&sa.sa_mask, SIGURG);
-        rc = sigaction(CB_TRUE, &sa, NULL);
+        rc = MsgEvLoop_Start(componentsId, sizeof(components)/sizeof(uint8_t), msg_receive_handler);
+        if(rc != 0) 
+        {
+            printf("\nPMAS_INTTSK: MsgEvLoop_Start() error %d\n", rc);
+        }
+    } while(rc != 0);
 
+    /* The notifications are sent on their own thread, so datapool writers never wait for HMI manager */
+    do 
+    {
+        rc = pthread_create(&HmNotifyThread, NULL, IntTsk_NotifyThread, NULL);
         if(rc != 0) 
         {
-            printf("\nHMAS_INTTSK: Msg_AsyncRxEvent(alarm) error %d\n", rc);
+            printf("\nPMAS_INTTSK: pthread_create() error %d\n", rc);
         }
     } while(rc != 0);
 
+    /* Notify the subscribers of every datapool change */
+    SetPoolChangeHook(IntTsk_DpChangeHook);
+
+    /* Track the CAN signal timeouts, HMI manager is notified of the stale items */
+    do 
+    {
+        rc = CanTmo_Start(IntTsk_CanTmoHook);
+        if(rc != GP_SUCCESS) 
+        {
+            gp_Printf(DFLT_DBG_PRNTLVL, "\nPMAS_INTTSK: CanTmo_Start() error %d\n", rc);
+        }
+    } while(rc != GP_SUCCESS);
 
-    memcpy(&componentsId[0], &tmpCom[0], sizeof(tmpCom));
     PostSemaphore(dp_semaphore, 2);
 
     while(1){int inside_infinite_while = 456;};
@@ -231,28 +274,6 @@ int main()
     
 
 }
-/**
-    @brief MsgRxHandler()   this function gets called when a message is 
-                    received, and depending on which "component" sent the
-                    message (see the man page for sigqueue for more info)
-                    a specific callback is executed.
-
-*/
-void MsgRxHandler(int sig, siginfo_t *si, void *uc){
-
-    uint8_t buffer[256], ret = 0;
-    memset(&buffer[0], 0, sizeof(buffer));
-    for (int i = 0; i < (sizeof(components)/sizeof(uint8_t)); ++i)
-    {
-        if (componentsId[i].Component == si->si_value.sival_int){
-            ret = read(componentsId[i].Fd, &buffer[0],sizeof(buffer));
-            msg_receive_handler[i](&buffer[0]);
-            break;
-        }
-    }   
-    sem_unlink(dp_semaphore);
-}
-
 /**************************************************************************************/
 /*! \fn IntTsk_UmasBufRxHandler(uint32_t data, uint32_t size)
  *
@@ -324,7 +345,7 @@ static int32_t ProcHbtReq(uint8_t * data, uint32_t size){//TODO: who is te recei
 }
 
 /**************************************************************************************/
-/*! \fn IntTsk_HmasBufRxHandler(uint32_t data, uint32_t size)
+/*! \fn IntTsk_HmasBufRxHandler(void * data, uint16_t size)
  *
  *	\param[in] data	- data received
  *	\param[in] size	- number of bytes received
@@ -335,19 +356,30 @@ static int32_t ProcHbtReq(uint8_t * data, uint32_t size){//TODO: who is te recei
  *  \retval	None
  *
  *  \par Limitations/Caveats:
- *	 None
+ *	 Runs on the event loop thread only.
  *
  **************************************************************************************/
-void IntTsk_HmasBufRxHandler(void * data)
+void IntTsk_HmasBufRxHandler(void * data, uint16_t size)
 {
     
+    static bool semUnlinked = false;
     gp_retcode_t rc;
     int32_t ret;
     uint16_t msgId;
     uint8_t * msgDt;
     int offset;
 
+    /* The HMI manager is already past WaitSemaphore(), only the first message unlinks it */
+    if(!semUnlinked)
+    {
+	sem_unlink(dp_semaphore);
+	semUnlinked = true;
+    }
     msgDt = (uint8_t *)data;
+    if(size < sizeof(msgId))
+    {
+	return;
+    }
     offset = gp_Read16bit(&msgId, &msgDt[0]);
     switch(msgId) 
     {
@@ -360,6 +392,53 @@ void IntTsk_HmasBufRxHandler(void * data)
 	    }else{
             printf("ProcPoolCopyReq Success!\n");
         }
+	    break;
+	    /* Process datapool delta request */	
+	case PoolDeltaReq:
+	    ret = ProcPoolDeltaReq(&msgDt[offset], (size - offset));
+	    if(ret != 0) 
+	    {
+		gp_Printf(DFLT_DBG_PRNTLVL, "\nPMAS_INTTSK: ProcPoolDeltaReq() error %d\n", ret);
+	    }
+	    break;
+	    /* Process datapool item subscriptions */	
+	case ElemSubscribeReq:
+	case ElemUnsubscribeReq:
+	    ret = ProcElemSubscribeMsg(&msgDt[offset], (size - offset), (msgId == ElemSubscribeReq));
+	    if(ret != 0) 
+	    {
+		gp_Printf(DFLT_DBG_PRNTLVL, "\nPMAS_INTTSK: ProcElemSubscribeMsg() error %d\n", ret);
+	    }
+	    break;
+	    /* Process single element set/get requests */	
+	case SetElemReq:
+	    ret = ProcSetElemMsg(&msgDt[offset], (size - offset));
+	    if(ret != 0) 
+	    {
+		gp_Printf(DFLT_DBG_PRNTLVL, "\nPMAS_INTTSK: ProcSetElemMsg() error %d\n", ret);
+	    }
+	    break;
+	case GetElemReq:
+	    ret = ProcGetElemMsg(componentsId[0].Fd, componentsId[0].Tid, component, &msgDt[offset], (size - offset));
+	    if(ret != 0) 
+	    {
+		gp_Printf(DFLT_DBG_PRNTLVL, "\nPMAS_INTTSK: ProcGetElemMsg() error %d\n", ret);
+	    }
+	    break;
+	    /* Process multi-element set/get requests */	
+	case SetElemsReq:
+	    ret = ProcSetElemsMsg(&msgDt[offset], (size - offset));
+	    if(ret != 0) 
+	    {
+		gp_Printf(DFLT_DBG_PRNTLVL, "\nPMAS_INTTSK: ProcSetElemsMsg() error %d\n", ret);
+	    }
+	    break;
+	case GetElemsReq:
+	    ret = ProcGetElemsMsg(&msgDt[offset], (size - offset));
+	    if(ret != 0) 
+	    {
+		gp_Printf(DFLT_DBG_PRNTLVL, "\nPMAS_INTTSK: ProcGetElemsMsg() error %d\n", ret);
+	    }
 	    break;
 	    /* Unknown/unsupported request - Do nothing */		    
 	default:
@@ -402,7 +481,345 @@ static int32_t ProcPoolCopyReq(void)//TODO: wich process will receie this messag
     }
     return 0;
 }
+
+/**************************************************************************************/
+/*! \fn ProcPoolDeltaReq(uint8_t * data, uint32_t size)
+ *
+ *	\param[in] data	- PoolDeltaReq payload, the datapool version known by HMI manager
+ *	\param[in] size	- number of bytes in data
+ *
+ *  \par Description:	  
+ *   Services a datapool delta request by sending to HMI manager only the datapool 
+ *   items changed since the version it supplied. 
+ *
+ *  \retval	Returns 0 if OK, non-0 if error.
+ *
+ *  \par Limitations/Caveats:
+ *	 None
+ *
+ **************************************************************************************/
+static int32_t ProcPoolDeltaReq(uint8_t * data, uint32_t size)
+{
+    gp_retcode_t rc;
+    uint8_t msg[UINT8_MAX];
+    uint32_t sinceVer;
+    int offset;
+    int len;
+
+    if(size < (MSG_POOLDELTAREQ_SZ - MSG_ID_SZ))
+    {
+		return -3;
+    }
+    gp_Read32bit(&sinceVer, &data[MSG_POOLDELTA_VER]);
+
+    offset = gp_Store16bit(PoolDeltaRes, &msg[0]);
+    rc = GetPoolDelta(sinceVer, NULL, &msg[offset], sizeof(msg) - offset, &len);
+    if(rc != GP_SUCCESS) 
+    {
+		return -1;
+    }
+
+    rc = TxMsg(componentsId[0].Fd, componentsId[0].Tid, component, &msg[0], offset + len, true);
+    if(rc != GP_SUCCESS) 
+    {
+        return -2;
+    }
+    return 0;
+}
+
+/**************************************************************************************/
+/*! \fn ProcElemSubscribeMsg(uint8_t * data, uint32_t size, bool subscribe)
+ *
+ *	\param[in] data		- ElemSubscribeReq/ElemUnsubscribeReq payload, the datapool item IDs
+ *	\param[in] size		- number of bytes in data
+ *	\param[in] subscribe	- true to subscribe to the items, false to unsubscribe
+ *
+ *  \par Description:	  
+ *   Updates the datapool items HMI manager is notified of with ElemChangeNotify.  A 
+ *   subscription is answered with the current value of every subscribed item.
+ *
+ *  \retval	Returns 0 if OK, non-0 if error.
+ *
+ *  \par Limitations/Caveats:
+ *	 None
+ *
+ **************************************************************************************/
+static int32_t ProcElemSubscribeMsg(uint8_t * data, uint32_t size, bool subscribe)
+{
+    int32_t ret = 0;
+    uint16_t elemId;
+    uint8_t num;
+    int offset;
+    int i;
+
+    /* Every ID announced shall have been received */
+    if(size < MSG_ELEMSUB_IDS)
+    {
+        return -1;
+    }
+    num = data[MSG_ELEMSUB_NUM];
+    if((uint32_t)(MSG_ELEMSUB_IDS + (num * MSG_ELEMSUB_ID_SZ)) > size)
+    {
+        return -1;
+    }
+
+    pthread_mutex_lock(&HmSubLock);
+    offset = MSG_ELEMSUB_IDS;
+    for(i = 0; i < num; i++)
+    {
+        offset += gp_Read16bit(&elemId, &data[offset]);
+        if(elemId >= ELEM_MAX_ID)
+        {
+            ret = -2;
+        }
+        else if(subscribe)
+        {
+            DP_DIRTY_SET(HmSubMask, elemId);
+        }
+        else
+        {
+            DP_DIRTY_CLR(HmSubMask, elemId);
+        }
+    }
+    if(subscribe)
+    {
+        HmSubVer = 0;       // resend every subscribed item
+        HmSubGen++;
+        HmChangePending = true;
+        pthread_cond_signal(&HmNotifyCond);
+    }
+    pthread_mutex_unlock(&HmSubLock);
+    return ret;
+}
+
+/**************************************************************************************/
+/*! \fn NotifyElemChanges(const uint32_t p_mask[], uint32_t * p_ver)
+ *
+ *	\param[in] p_mask		- Bitmap of the subscribed datapool items
+ *	\param[in,out] p_ver	- Datapool version HMI manager was last notified of, updated 
+ *						  with every message sent
+ *
+ *  \par Description:	  
+ *   Sends to HMI manager the subscribed datapool items that changed since *p_ver.  A 
+ *   delta image larger than a message is split by GetPoolDelta(), the oldest changes 
+ *   first, and sent in as many ElemChangeNotify messages as needed.  The messages are
+ *   sent NOTIFY_BATCH_SZ at a time with TxMsgBatch(), one write and one signal each.
+ *
+ *  \retval	Returns 0 if OK, -1 if an item can't fit in a message, -2 if a message 
+ *			can't be sent.
+ *
+ *  \par Limitations/Caveats:
+ *	 Only called on the notify thread, see IntTsk_NotifyThread().
+ *
+ **************************************************************************************/
+static int32_t NotifyElemChanges(const uint32_t p_mask[], uint32_t * p_ver)
+{
+    gp_retcode_t rc;
+    uint8_t msg[NOTIFY_BATCH_SZ][UINT8_MAX];	// TxMsg() sizes are 8 bit
+    msg_batch_entry_t batch[NOTIFY_BATCH_SZ];
+    uint32_t ver;
+    int32_t ret;
+    int offset;
+    int len;
+    int n;
+
+    ver = *p_ver;
+    ret = 1;
+    while(ret > 0)
+    {
+        /* Each message continues from the version of the previous one */
+        for(n = 0; n < NOTIFY_BATCH_SZ; n++)
+        {
+            offset = gp_Store16bit(ElemChangeNotify, &msg[n][0]);
+            rc = GetPoolDelta(ver, p_mask, &msg[n][offset], sizeof(msg[n]) - offset, &len);
+            if(rc != GP_SUCCESS)
+            {
+                ret = -1;
+                break;
+            }
+            gp_Read32bit(&ver, &msg[n][offset]);
+            /* An empty image means HMI manager is up to date */
+            if(len == DP_DELTA_HDR_SZ)
+            {
+                ret = 0;
+                break;
+            }
+            batch[n].Data = &msg[n][0];
+            batch[n].DataSz = (uint8_t)(offset + len);
+        }
+        if(n > 0)
+        {
+            if(TxMsgBatch(componentsId[0].Fd, componentsId[0].Tid, component, &batch[0], (uint8_t)n, true) != 0)
+            {
+                return -2;
+            }
+        }
+        *p_ver = ver;
+    }
+    return ret;
+}
+
+/**************************************************************************************/
+/*! \fn IntTsk_DpChangeHook(const uint32_t p_dirty[], uint32_t ver)
+ *
+ *	\param[in] p_dirty	- Bitmap of the changed datapool items
+ *	\param[in] ver		- Datapool version after the change
+ *
+ *  \par Description:	  
+ *   Datapool change callback, wakes the notify thread if HMI manager subscribed to a 
+ *   changed item.  The version is not needed, the notify thread sends every change 
+ *   since the last one it sent.
+ *
+ *  \retval	None
+ *
+ *  \par Limitations/Caveats:
+ *	 Executed on the thread of the datapool writer, so nothing is sent from here.
+ *
+ **************************************************************************************/
+static void IntTsk_DpChangeHook(const uint32_t p_dirty[], uint32_t ver)
+{
+    int i;
+
+    (void)ver;
+    pthread_mutex_lock(&HmSubLock);
+    for(i = 0; (i < DP_DIRTY_WORDS) && !HmChangePending; i++)
+    {
+        HmChangePending = ((p_dirty[i] & HmSubMask[i]) != 0);
+    }
+    if(HmChangePending)
+    {
+        pthread_cond_signal(&HmNotifyCond);
+    }
+    pthread_mutex_unlock(&HmSubLock);
+}
    
+/**************************************************************************************/
+/*! \fn NotifyElemStale(void)
+ *
+ *  \par Description:	  
+ *   Sends to HMI manager the bitmap of the stale datapool items in an ElemStaleNotify 
+ *   message.
+ *
+ *  \retval	Returns 0 if OK, non-0 if error.
+ *
+ *  \par Limitations/Caveats:
+ *	 Only called on the notify thread, see IntTsk_NotifyThread().
+ *
+ **************************************************************************************/
+static int32_t NotifyElemStale(void)
+{
+    gp_retcode_t rc;
+    uint32_t stale[DP_DIRTY_WORDS];
+    uint8_t msg[MSG_ELEMSTALE_SZ];
+    int offset;
+    int i;
+
+    GetPoolStale(stale);
+    offset = gp_Store16bit(ElemStaleNotify, &msg[0]);
+    for(i = 0; i < DP_DIRTY_WORDS; i++)
+    {
+        offset += gp_Store32bit(stale[i], &msg[offset]);
+    }
+
+    rc = TxMsg(componentsId[0].Fd, componentsId[0].Tid, component, &msg[0], offset, true);
+    return (rc == GP_SUCCESS) ? 0 : -1;
+}
+
+/**************************************************************************************/
+/*! \fn IntTsk_CanTmoHook(const uint32_t p_changed[], bool stale)
+ *
+ *	\param[in] p_changed	- Bitmap of the datapool items whose staleness changed
+ *	\param[in] stale		- true if they timed out, false if they are valid again
+ *
+ *  \par Description:	  
+ *   CAN timeout tracker callback, wakes the notify thread to send the stale datapool 
+ *   items to HMI manager.  The whole stale bitmap is sent, so the changed items are 
+ *   not needed.
+ *
+ *  \retval	None
+ *
+ *  \par Limitations/Caveats:
+ *	 Executed on the tick thread of the tracker, or on the thread refreshing a signal.
+ *
+ **************************************************************************************/
+static void IntTsk_CanTmoHook(const uint32_t p_changed[], bool stale)
+{
+    (void)p_changed;
+    (void)stale;
+    pthread_mutex_lock(&HmSubLock);
+    HmStalePending = true;
+    pthread_cond_signal(&HmNotifyCond);
+    pthread_mutex_unlock(&HmSubLock);
+}
+
+/**************************************************************************************/
+/*! \fn IntTsk_NotifyThread(void * ignore)
+ *
+ *  \par Description:	  
+ *   Sends the notifications queued by the datapool and CAN timeout hooks to HMI manager. 
+ *   The subscription is copied under HmSubLock and the messages are sent without it, 
+ *   so a slow HMI manager never blocks the datapool writers.  Being the only sender 
+ *   keeps the ElemChangeNotify messages in version order.
+ *
+ *  \retval	None
+ *
+ *  \par Limitations/Caveats:
+ *	 None
+ *
+ **************************************************************************************/
+static void * IntTsk_NotifyThread(void * ignore)
+{
+    uint32_t mask[DP_DIRTY_WORDS];
+    uint32_t ver;
+    uint32_t gen;
+    bool changes;
+    bool stale;
+    int32_t ret;
+
+    (void)ignore;
+    while(1)
+    {
+	pthread_mutex_lock(&HmSubLock);
+	while(!HmChangePending && !HmStalePending)
+	{
+	    pthread_cond_wait(&HmNotifyCond, &HmSubLock);
+	}
+	changes = HmChangePending;
+	stale = HmStalePending;
+	HmChangePending = false;
+	HmStalePending = false;
+	memcpy(mask, HmSubMask, sizeof(mask));
+	ver = HmSubVer;
+	gen = HmSubGen;
+	pthread_mutex_unlock(&HmSubLock);
+
+	if(stale)
+	{
+	    ret = NotifyElemStale();
+	    if(ret != 0)
+	    {
+		gp_Printf(DFLT_DBG_PRNTLVL, "\nPMAS_INTTSK: NotifyElemStale() error %d\n", ret);
+	    }
+	}
+	if(changes)
+	{
+	    ret = NotifyElemChanges(mask, &ver);
+	    if(ret != 0)
+	    {
+		gp_Printf(DFLT_DBG_PRNTLVL, "\nPMAS_INTTSK: NotifyElemChanges() error %d\n", ret);
+	    }
+	    /* A subscription received meanwhile restarts from version 0 */
+	    pthread_mutex_lock(&HmSubLock);
+	    if(gen == HmSubGen)
+	    {
+		HmSubVer = ver;
+	    }
+	    pthread_mutex_unlock(&HmSubLock);
+	}
+    }
+    return NULL;
+}
+
 /**************************************************************************************/
 /*! \fn IntTsk_UmasBufRxHandler2(uint32_t data, uint32_t size)
  *
@@ -672,9 +1089,8 @@ static gp_retcode_t PmProcOpInitData(uint8_t *p_buf, int cmdlen)//needs changes
 }*/
 
 /**************************************************************************************/
-/*! \fn ProcSetElemMsg(Object obj, uint8_t * data, uint32_t size)
+/*! \fn ProcSetElemMsg(uint8_t * data, uint32_t size)
  *
- *      param[in] obj	- INTEGRITY Connection to be used for transfers
  *	param[in] data	- pointer to the message
  *	param[in] size	- number of bytes in the message
  *
@@ -689,190 +1105,41 @@ static gp_retcode_t PmProcOpInitData(uint8_t *p_buf, int cmdlen)//needs changes
  *
  **************************************************************************************/
 
-static int32_t ProcSetElemMsg(uint8_t * data, uint32_t size)//needs minimum changes
+static int32_t ProcSetElemMsg(uint8_t * data, uint32_t size)
 {
-    
     gp_retcode_t rc;
-    int32_t ret;
-    int offset;
+    DP_ITEM_VALUE_T temp;
     uint16_t elemId;
-    GP_DATATYPES_T elemType;
-    int32_t elemLen;
-    uint32_t sizeCounter;
+    int offset;
+    int len;
 
     /* Read element id */
     if(size < ELEM_ID_SZ) {
 	return -1;
     }
     offset = gp_Read16bit(&elemId, &data[0]);
-    sizeCounter = size - ELEM_ID_SZ;
 
-    /* Read element type */
-    rc = GetElemInfo(elemId, &elemType, &elemLen);//safe to reuse
-    if(rc != GP_SUCCESS) {
+    /* Decode the element value with the codec of its type */
+    rc = DecodeElem(elemId, &data[offset], size - offset, (void *)&temp, &len);
+    if(rc == GP_DP_PARMS_ERR) {
 	return -2;
+    } else if(rc != GP_SUCCESS) {
+	return -3;
     }
-    
-    /* Set element value */
-    ret = 0;
-    switch(elemType)
-    {
-	/*case GP_UINT8:
-	    {
-		uint8_t temp;
-		if(sizeCounter < elemLen) {
-		    ret = -3;
-		} else {
-		    temp = data[offset];
-		    rc = SetElem(elemId, (void *)&temp);
-		    if(rc != 0) {
-			ret = -4;
-		    }
-		}
-		break;
-	    }*/
-	case GP_INT16:
-	    {
-		int16_t temp;
-		if(sizeCounter < elemLen) {
-		    ret = -3;
-		} else {
-		    gp_Read16bitSigned(&temp, &data[offset]);
-		    rc = SetElem(elemId, (void *)&temp);
-		    if(rc != 0) {
-			ret = -4;
-		    }
-		}
-		break;
-	    }
-	case GP_UINT16:
-	    {
-		uint16_t temp;
-		if(sizeCounter < elemLen) {
-		    ret = -3;
-		} else {
-		    gp_Read16bit(&temp, &data[offset]);
-		    rc = SetElem(elemId, (void *)&temp);
-		    if(rc != 0) {
-			ret = -4;
-		    }
-		}
-		break;
-	    }
-	case GP_INT32:
-	    {
-		int32_t temp;
-		if(sizeCounter < elemLen) {
-		    ret = -3;
-		} else {
-		    gp_Read32bitSigned(&temp, &data[offset]);
-		    rc = SetElem(elemId, (void *)&temp);
-		    if(rc != 0) {
-			ret = -4;
-		    }
-		}
-		break;
-	    }
-	case GP_UINT32:
-	    {
-		uint32_t temp;
-		if(sizeCounter < elemLen) {
-		    ret = -3;
-		} else {
-		    gp_Read32bit(&temp, &data[offset]);
-		    rc = SetElem(elemId, (void *)&temp);
-		    if(rc != 0) {
-			ret = -4;
-		    }
-		}
-		break;
-	    }
-	case GP_INT64:
-	    {
-		int64_t temp;
-		if(sizeCounter < elemLen) {
-		    ret = -3;
-		} else {
-		    gp_Read64bitSigned(&temp, &data[offset]);
-		    rc = SetElem(elemId, (void *)&temp);
-		    if(rc != 0) {
-			ret = -4;
-		    }
-		}
-		break;
-	    }
 
-	case GP_UINT64:
-	    {
-		uint64_t temp;
-		if(sizeCounter < elemLen) {
-		    ret = -3;
-		} else {
-		    gp_Read64bit(&temp, &data[offset]);
-		    rc = SetElem(elemId, (void *)&temp);
-		    if(rc != 0) {
-			ret = -4;
-		    }
-		}
-		break;
-	    }
-	case GP_FLOAT:
-	    {
-		uint32_t temp;
-		if(sizeCounter < elemLen) {
-		    ret = -3;
-		} else {
-		    gp_ReadFloat(&temp, &data[offset]);
-		    rc = SetElem(elemId, (void *)&temp);
-		    if(rc != 0) {
-			ret = -4;
-		    }
-		}
-		break;
-	    }
-	case GP_DBL:
-	    {
-		uint64_t temp;
-		if(sizeCounter < elemLen) {
-		    ret = -3;
-		} else {
-		    gp_ReadDouble(&temp, &data[offset]);
-		    rc = SetElem(elemId, (void *)&temp);
-		    if(rc != 0) {
-			ret = -4;
-		    }
-		}
-		break;
-	    }
-	case GP_STRING:
-	    {
-		if(sizeCounter < 1) {
-		    ret = -3;
-		} else {
-		    rc = SetElem(elemId, (void *)&data[offset]);
-		    if(rc != 0) {
-			ret = -4;
-		    }
-		}
-		break;
-	    }
-	default:
-	    ret = -5;
-	    break;
-    }
-
-    if(ret != 0) {
+    /* Set element value */
+    rc = SetElem(elemId, (void *)&temp);
+    if(rc != GP_SUCCESS) {
 	gp_Printf(DFLT_DBG_PRNTLVL, "\nPMAS_INTTSK: SetElem(%d) error %d\n", elemId, rc);
+	return -4;
     }
-
-    return ret;
-    
+    return 0;
 }
 
 /**************************************************************************************/
-/*! \fn ProcGetElemMsg(Object obj, uint8_t * data, uint32_t size)
+/*! \fn ProcGetElemMsg(int8_t socket_fd, pid_t tid, uint8_t ImComponent, uint8_t * data, uint32_t size)
  *
- *      param[in] obj	- INTEGRITY Connection to be used for transfers
+ *      param[in] socket_fd, tid, ImComponent	- Connection the response is sent to
  *	param[in] data	- pointer to the message
  *	param[in] size	- number of bytes in the message
  *
@@ -886,204 +1153,180 @@ static int32_t ProcSetElemMsg(uint8_t * data, uint32_t size)//needs minimum chan
  *	 None
  *
  **************************************************************************************/
-static int32_t ProcGetElemMsg(int8_t socket_fd, pid_t tid, uint8_t ImComponent, uint8_t * data, uint8_t dataSz)
+static int32_t ProcGetElemMsg(int8_t socket_fd, pid_t tid, uint8_t ImComponent, uint8_t * data, uint32_t size)
 {
     gp_retcode_t rc;
-    int32_t ret;
-    uint16_t msgId;
-    uint8_t * pMsg;
-    uint32_t * pBufId = (uint32_t *)malloc(sizeof(uint32_t));
+    DP_ITEM_VALUE_T temp;
+    uint8_t msg[UINT8_MAX];
     uint16_t elemId;
-    GP_DATATYPES_T elemType;
-    int32_t elemLen;
     int offset;
+    int len;
 
     /* Get element id from get element request message */
+    if(size < ELEM_ID_SZ) {
+	return -1;
+    }
     gp_Read16bit(&elemId, &data[0]);
 
-    /* Get element type */
-    rc = GetElemInfo(elemId, &elemType, &elemLen);
+    /* Get element value */
+    rc = GetElem(elemId, (void *)&temp);
     if(rc != GP_SUCCESS) {
 	return -1;
     }
 
-    /* Compose get element response message into buffer */
-    ret = 0;
-    msgId = GetElemRes;
-    switch(elemType)
-    {
-	/*case GP_UINT8:
-	    {
-		uint8_t temp;
-		GetElem(elemId, (void *)&temp);
-		txMsg.MsgSize = Msg_GetBufSize(MSG_ID_SZ + ELEM_ID_SZ + 1);
-
-		txMsg.pMsg = Msg_GetBuf(txMsg.MsgSize, pBufId, txMsg.Component);
-		if(txMsg.pMsg == NULL) {
-		    ret = -2;
-		} else {
-		    offset = gp_Store16bit(msgId, txMsg.pMsg);
-		    offset += gp_Store16bit(elemId, (txMsg.pMsg+offset));
-		    *((uint8_t *)txMsg.pMsg+offset) = temp;
-		}
-		break;
-	    }*/
-	case GP_INT16:
-	    {
-		int16_t temp;
-        GetElem(elemId, (void *)&temp);
-
-        pMsg = Msg_GetBuf(dataSz, pBufId, MAIN_COMPONENT);
-        if(pMsg == NULL) {
-            ret = -2;
-        } else {
-            offset = gp_Store16bit(msgId, pMsg);
-            offset += gp_Store16bit(elemId, (pMsg+offset));
-            *((int16_t *)pMsg+offset) = temp;
-        }
-		break;
-	    }
-	case GP_UINT16:
-	    {
-		uint16_t temp;
-        GetElem(elemId, (void *)&temp);
+    /* Compose get element response message, the value is encoded by the codec of its type */
+    offset = gp_Store16bit(GetElemRes, &msg[0]);
+    offset += gp_Store16bit(elemId, &msg[offset]);
+    rc = EncodeElem(elemId, (void *)&temp, &msg[offset], sizeof(msg) - offset, &len);
+    if(rc != GP_SUCCESS) {
+	return -3;
+    }
+    offset += len;
 
-        pMsg = Msg_GetBuf(dataSz, pBufId, MAIN_COMPONENT);
-        if(pMsg == NULL) {
-            ret = -2;
-        } else {
-            offset = gp_Store16bit(msgId, pMsg);
-            offset += gp_Store16bit(elemId, (pMsg+offset));
-            *((uint16_t *)pMsg+offset) = temp;
-        }
-		break;
-	    }
-	case GP_INT32:
-	    {
-		int32_t temp;
-        GetElem(elemId, (void *)&temp);
+    /* Send the message */
+    rc = TxMsg(socket_fd, tid, ImComponent, &msg[0], offset, true);
+    if(rc != GP_SUCCESS) {
+	return -4;
+    }
+    return 0;
+}
 
-        pMsg = Msg_GetBuf(dataSz, pBufId, MAIN_COMPONENT);
-        if(pMsg == NULL) {
-            ret = -2;
-        } else {
-            offset = gp_Store16bit(msgId, pMsg);
-            offset += gp_Store16bit(elemId, (pMsg+offset));
-            *((int32_t *)pMsg+offset) = temp;
-		}
-		break;
-	    }
-	case GP_UINT32:
-	    {
-		uint32_t temp;
-        GetElem(elemId, (void *)&temp);
+/**************************************************************************************/
+/*! \fn ProcSetElemsMsg(uint8_t * data, uint32_t size)
+ *
+ *	param[in] data	- pointer to the message payload
+ *	param[in] size	- number of bytes in the message payload
+ *
+ *  \par Description:	  
+ *   Process a multi-element set request message by parsing every (id, value) tuple and 
+ *   setting all the datapool elements under a single datapool lock.
+ *
+ *  \returns 0 of no errors else non-zero if error
+ *
+ *  \par Limitations/Caveats:
+ *	 No element is set if any tuple is invalid.
+ *
+ **************************************************************************************/
+static int32_t ProcSetElemsMsg(uint8_t * data, uint32_t size)
+{
+    gp_retcode_t rc;
+    DP_ITEM_VALUE_T temp[MSG_ELEMS_MAX];
+    void * values[MSG_ELEMS_MAX];
+    int ids[MSG_ELEMS_MAX];
+    uint16_t elemId;
+    uint8_t num;
+    uint32_t offset;
+    int len;
+    int i;
 
-        pMsg = Msg_GetBuf(dataSz, pBufId, MAIN_COMPONENT);
-        if(pMsg == NULL) {
-            ret = -2;
-        } else {
-            offset = gp_Store16bit(msgId, pMsg);
-            offset += gp_Store16bit(elemId, (pMsg+offset));
-            *((uint32_t *)pMsg+offset) = temp;
-        }
-		break;
-	    }
-	case GP_INT64:
-	    {
-		int64_t temp;
-        GetElem(elemId, (void *)&temp);
+    /* Read the number of elements */
+    if(size < MSG_ELEMS_ITEMS) {
+	return -1;
+    }
+    num = data[MSG_ELEMS_NUM];
+    if(num > MSG_ELEMS_MAX) {
+	return -1;
+    }
 
-        pMsg = Msg_GetBuf(dataSz, pBufId, MAIN_COMPONENT);
-        if(pMsg == NULL) {
-            ret = -2;
-        } else {
-            offset = gp_Store16bit(msgId, pMsg);
-            offset += gp_Store16bit(elemId, (pMsg+offset));
-            *((int64_t *)pMsg+offset) = temp;
-        }
-		break;
-	    }
+    /* Read every element id and value */
+    offset = MSG_ELEMS_ITEMS;
+    for(i = 0; i < num; i++) {
+	if((size - offset) < ELEM_ID_SZ) {
+	    return -2;
+	}
+	offset += gp_Read16bit(&elemId, &data[offset]);
+	if(DecodeElem(elemId, &data[offset], size - offset, (void *)&temp[i], &len) != GP_SUCCESS) {
+	    return -3;
+	}
+	ids[i] = elemId;
+	values[i] = &temp[i];
+	offset += len;
+    }
 
-	case GP_UINT64:
-	    {
-		uint64_t temp;
-		GetElem(elemId, (void *)&temp);
+    /* Set the element values */
+    rc = SetElems(num, ids, values);
+    if(rc != GP_SUCCESS) {
+	gp_Printf(DFLT_DBG_PRNTLVL, "\nPMAS_INTTSK: SetElems() error %d\n", rc);
+	return -4;
+    }
+    return 0;
+}
 
-        pMsg = Msg_GetBuf(dataSz, pBufId, MAIN_COMPONENT);
-        if(pMsg == NULL) {
-            ret = -2;
-        } else {
-            offset = gp_Store16bit(msgId, pMsg);
-            offset += gp_Store16bit(elemId, (pMsg+offset));
-            *((uint64_t *)pMsg+offset) = temp;
-        }
-		break;
-	    }
-	case GP_FLOAT:
-	    {
-		float temp;
-		GetElem(elemId, (void *)&temp);
+/**************************************************************************************/
+/*! \fn ProcGetElemsMsg(uint8_t * data, uint32_t size)
+ *
+ *	param[in] data	- pointer to the message payload
+ *	param[in] size	- number of bytes in the message payload
+ *
+ *  \par Description:	  
+ *   Process a multi-element get request message by reading all the requested datapool 
+ *   elements as one consistent snapshot and sending their values back to HMI manager.
+ *
+ *  \returns 0 of no errors else non-zero if error
+ *
+ *  \par Limitations/Caveats:
+ *	 The response must fit in one message.
+ *
+ **************************************************************************************/
+static int32_t ProcGetElemsMsg(uint8_t * data, uint32_t size)
+{
+    gp_retcode_t rc;
+    DP_ITEM_VALUE_T temp[MSG_ELEMS_MAX];
+    void * values[MSG_ELEMS_MAX];
+    int ids[MSG_ELEMS_MAX];
+    uint8_t msg[UINT8_MAX];
+    uint16_t elemId;
+    uint8_t num;
+    uint32_t offset;
+    int len;
+    int i;
 
-        pMsg = Msg_GetBuf(dataSz, pBufId, MAIN_COMPONENT);
-        if(pMsg == NULL) {
-            ret = -2;
-        } else {
-            offset = gp_Store16bit(msgId, pMsg);
-            offset += gp_Store16bit(elemId, (pMsg+offset));
-            *((float *)pMsg+offset) = temp;
-        }
-		break;
-	    }
-	case GP_DBL:
-	    {
-		double temp;
-		GetElem(elemId, (void *)&temp);
+    /* Read the number of elements */
+    if(size < MSG_ELEMS_ITEMS) {
+	return -1;
+    }
+    num = data[MSG_ELEMS_NUM];
+    if((num > MSG_ELEMS_MAX) || ((size - MSG_ELEMS_ITEMS) < (num * ELEM_ID_SZ))) {
+	return -1;
+    }
 
-        pMsg = Msg_GetBuf(dataSz, pBufId, MAIN_COMPONENT);
-        if(pMsg == NULL) {
-            ret = -2;
-        } else {
-            offset = gp_Store16bit(msgId, pMsg);
-            offset += gp_Store16bit(elemId, (pMsg+offset));
-            *((double *)pMsg+offset) = temp;
-        }
-		break;
-	    }
-	case GP_STRING:
-	    {
-		char temp[MAX_FNAME_LEN];
-		GetElem(elemId, (void *)&temp[0]);
-        int len = strlen(temp);
+    /* Read every element id, any element value fits in its storage */
+    offset = MSG_ELEMS_ITEMS;
+    for(i = 0; i < num; i++) {
+	offset += gp_Read16bit(&elemId, &data[offset]);
+	if(elemId >= ELEM_MAX_ID) {
+	    return -2;
+	}
+	ids[i] = elemId;
+	values[i] = &temp[i];
+    }
 
-        pMsg = Msg_GetBuf(dataSz, pBufId, MAIN_COMPONENT);
-        if(pMsg == NULL) {
-            ret = -2;
-        } else {
-            offset = gp_Store16bit(msgId, pMsg);
-            offset += gp_Store16bit(elemId, (pMsg+offset));
-            strncpy((((char *)(pMsg))+offset),&temp[0],len);
-        }
-		break;
-	    }
-	default:
-	    ret = -3;
-	    break;
+    /* Take the snapshot */
+    rc = GetElems(num, ids, values);
+    if(rc != GP_SUCCESS) {
+	gp_Printf(DFLT_DBG_PRNTLVL, "\nPMAS_INTTSK: GetElems() error %d\n", rc);
+	return -3;
     }
 
-    if(ret != 0) {
-	Msg_FreeBuf(dataSz, *pBufId, MAIN_COMPONENT);
-    free(pBufId);
-	return ret;
+    /* Compose the multi-element get response message */
+    offset = gp_Store16bit(GetElemsRes, &msg[0]);
+    msg[offset + MSG_ELEMS_NUM] = num;
+    offset += MSG_ELEMS_ITEMS;
+    for(i = 0; i < num; i++) {
+	if((sizeof(msg) - offset) < ELEM_ID_SZ) {
+	    return -4;
+	}
+	offset += gp_Store16bit(ids[i], &msg[offset]);
+	if(EncodeElem(ids[i], values[i], &msg[offset], sizeof(msg) - offset, &len) != GP_SUCCESS) {
+	    return -4;
+	}
+	offset += len;
     }
 
     /* Send the message */
-    rc = TxMsg(socket_fd, tid, ImComponent, pMsg, dataSz, true);
-    Msg_FreeBuf(dataSz, *pBufId, MAIN_COMPONENT);
-    free(pBufId);
+    rc = TxMsg(componentsId[0].Fd, componentsId[0].Tid, component, &msg[0], offset, true);
     if(rc != GP_SUCCESS) {
-	return -4;
+	return -5;
     }
-
     return 0;
-    
 }
@@ -0,0 +1,304 @@
+/**************************************************************************************/
+/*!
+ *  \file		can_sig.c
+ *
+ *  \brief		Extraction of bit-packed CAN signals into the datapool, driven by plans
+ *				compiled from the CAN signal definitions.
+ *
+ ***************************************************************************************
+ * \page sw_component_overview Software Component Overview page
+ *	CanSig_Compile() sorts the signal definitions by CAN message and builds one plan
+ *	per message: the range of its signals in flat shift, mask, sign and datapool item
+ *	tables.  A received frame only costs a binary search for its plan, a single 64 bit
+ *	load of its payload, then a shift and a mask per signal and its store as the type of
+ *	its item, described by GetCanSigStore() when the plan is compiled (sign extension
+ *	is an xor and a subtraction, 0 for the unsigned items, then a copy of the size of
+ *	the item), so hundreds of signals are handled without a branch per signal.  The
+ *	values of a frame are stored with one SetElems(), a reader sees all or none of them.
+ */
+/***************************************************************************************/
+#define CAN_SIG_C		/*!< File label definition */
+
+/***********************************
+		   INCLUDE FILES
+***********************************/
+#include <string.h>
+#include <stdlib.h>
+
+#include "gp_cfg.h"         // Common GP program configuration settings
+#include "gp_types.h"       // Common GP program data type definitions
+#include "gp_utils.h"       // Common GP program utility functions
+
+#include "pool_def.h"
+#include "Datapool.h"
+#include "can_sig.h"
+
+/***********************************
+	Private Macros and Typedefs
+***********************************/
+/*! Extraction plan of a CAN message, its signals are SigShift[First] to SigShift[First + Num - 1] */
+typedef struct{
+    uint32_t CanMsgId;      /*!< ID of the CAN message */
+    uint8_t  Bus;           /*!< CAN bus of the message */
+    uint8_t  MinDlc;        /*!< Size in bytes of the payload holding all the signals */
+    uint16_t First;         /*!< Index of the first signal in the tables */
+    uint16_t Num;           /*!< Number of signals */
+}can_sig_plan_t;
+
+/***********************************
+	Private Data and Structures
+***********************************/
+/* Plans sorted by bus and CAN message ID */
+static can_sig_plan_t SigPlan[CAN_SIG_MAX_MSGS];
+static uint16_t SigPlanNum = 0;
+
+/* Extraction tables, indexed by signal, the signals of a plan are contiguous */
+static uint8_t  SigShift[CAN_SIG_MAX_SIGS];     /*!< StartBit of the signal */
+static uint32_t SigMask[CAN_SIG_MAX_SIGS];      /*!< BitLen ones */
+static DP_CANSIG_STORE_T SigStore[CAN_SIG_MAX_SIGS];    /*!< Store of the value in the datapool item */
+static int      SigElem[CAN_SIG_MAX_SIGS];      /*!< Datapool item */
+
+/* Definitions being compiled */
+static can_sig_def_t SigDefs[CAN_SIG_MAX_SIGS];
+
+/***********************************
+	Private Function Prototypes
+***********************************/
+static int CanSigCmpDef(const void * pA, const void * pB);
+static gp_retcode_t CanSigCheckDef(const can_sig_def_t * pDef, DP_CANSIG_STORE_T * pStore);
+static const can_sig_plan_t * CanSigFindPlan(uint8_t bus, uint32_t canMsgId);
+
+
+/************ Start of code ******************/
+
+/**************************************************************************************/
+/*! \fn uint8_t CanSig_ParseDef(can_sig_def_t * pDef, const uint8_t * pBuf)
+ *
+ *  param[in]
+ *		-pBuf:		an encoded CAN_MSG_SIGNAL record
+ *  param[out]
+ *		-pDef:		the decoded definition, ElemId is not changed
+ *
+ *  \par Description:
+ *		Decodes a signal definition in the IPC byte order.
+ *
+ *  \retval
+ *		The size in bytes of the record
+ **************************************************************************************/
+uint8_t CanSig_ParseDef(can_sig_def_t * pDef, const uint8_t * pBuf){
+
+    gp_Read16bit(&pDef->SigId, (uint8_t *)&pBuf[CANSIGID_IDX]);
+    pDef->StartBit = pBuf[CANSIGSTARTBIT_IDX];
+    pDef->BitLen = pBuf[CANSIGDLC_IDX];
+    gp_Read32bit(&pDef->CanMsgId, (uint8_t *)&pBuf[CANMSGSIGID_IDX]);
+    pDef->Bus = pBuf[CANSIGBUSID_IDX];
+    return CANSIG_DEF_MSG_SZ;
+}
+
+/**************************************************************************************/
+/*! \fn gp_retcode_t CanSig_Compile(const can_sig_def_t defs[], uint16_t num)
+ *
+ *  param[in]
+ *		-defs:		the signal definitions, in any order
+ *		-num:		the number of definitions
+ *
+ *  \par Description:
+ *		Checks every definition, sorts them by bus, CAN message ID and start bit and
+ *		builds the plan of every CAN message and the extraction tables of its signals.
+ *
+ *  \retval
+ *		GP_SUCCESS, else the plans are left empty and:
+ *		GP_DP_PARMS_ERR if a definition is invalid or a limit (CAN_SIG_MAX_SIGS,
+ *		CAN_SIG_MAX_MSGS, CAN_SIG_MAX_PER_MSG) is exceeded
+ *
+ *  \par Limitations/Caveats:
+ *		Not synchronized with CanSig_Extract(), shall be called from the thread
+ *		receiving the CAN frames or before they are received.
+ **************************************************************************************/
+gp_retcode_t CanSig_Compile(const can_sig_def_t defs[], uint16_t num){
+
+    can_sig_plan_t * pPlan = NULL;
+    const can_sig_def_t * pDef;
+    uint8_t endByte;
+    uint16_t i;
+
+    SigPlanNum = 0;
+    if((num > CAN_SIG_MAX_SIGS) || ((num > 0) && (defs == NULL))){
+        return GP_DP_PARMS_ERR;
+    }
+    memcpy(&SigDefs[0], &defs[0], num * sizeof(SigDefs[0]));
+    qsort(&SigDefs[0], num, sizeof(SigDefs[0]), CanSigCmpDef);
+
+    for(i = 0; i < num; i++){
+        pDef = &SigDefs[i];
+        if(CanSigCheckDef(pDef, &SigStore[i]) != GP_SUCCESS){
+            SigPlanNum = 0;
+            return GP_DP_PARMS_ERR;
+        }
+
+        /* A new CAN message starts a new plan */
+        if((pPlan == NULL) || (pPlan->Bus != pDef->Bus) || (pPlan->CanMsgId != pDef->CanMsgId)){
+            if(SigPlanNum >= CAN_SIG_MAX_MSGS){
+                SigPlanNum = 0;
+                return GP_DP_PARMS_ERR;
+            }
+            pPlan = &SigPlan[SigPlanNum++];
+            pPlan->CanMsgId = pDef->CanMsgId;
+            pPlan->Bus = pDef->Bus;
+            pPlan->MinDlc = 0;
+            pPlan->First = i;
+            pPlan->Num = 0;
+        }
+        if(pPlan->Num >= CAN_SIG_MAX_PER_MSG){
+            SigPlanNum = 0;
+            return GP_DP_PARMS_ERR;
+        }
+        pPlan->Num++;
+        endByte = (pDef->StartBit + pDef->BitLen + 7) / 8;
+        if(endByte > pPlan->MinDlc){
+            pPlan->MinDlc = endByte;
+        }
+
+        SigShift[i] = pDef->StartBit;
+        SigMask[i] = (pDef->BitLen >= 32) ? UINT32_MAX : ((1u << pDef->BitLen) - 1);
+        SigElem[i] = pDef->ElemId;
+    }
+    return GP_SUCCESS;
+}
+
+/**************************************************************************************/
+/*! \fn gp_retcode_t CanSig_Extract(uint8_t bus, uint32_t canMsgId, const uint8_t * pData, uint8_t dlc, uint16_t * pNum)
+ *
+ *  param[in]
+ *		-bus:		the CAN bus of the frame
+ *		-canMsgId:	the CAN message ID of the frame
+ *		-pData:		the payload of the frame
+ *		-dlc:		the size in bytes of the payload
+ *  param[out]
+ *		-pNum:		the number of signals extracted, may be NULL
+ *
+ *  \par Description:
+ *		Runs the plan of the CAN message: the payload is read as a little endian
+ *		64 bit word, every signal is shifted, masked and stored as the type of its
+ *		item by StoreCanSig() in one loop, then all the items are set at once.
+ *
+ *  \retval
+ *		GP_SUCCESS if the items are set or the message has no plan, GP_DP_DATA_ERR if
+ *		the payload does not hold all the signals, else the SetElems() error
+ **************************************************************************************/
+gp_retcode_t CanSig_Extract(uint8_t bus, uint32_t canMsgId, const uint8_t * pData, uint8_t dlc, uint16_t * pNum){
+
+    const can_sig_plan_t * pPlan;
+    DP_ITEM_VALUE_T values[CAN_SIG_MAX_PER_MSG];
+    void * pValues[CAN_SIG_MAX_PER_MSG];
+    uint32_t raw;
+    uint64_t payload = 0;
+    gp_retcode_t rc;
+    uint16_t first, num;
+    uint16_t i;
+    int j;
+
+    if(pNum != NULL){
+        *pNum = 0;
+    }
+    pPlan = CanSigFindPlan(bus, canMsgId);
+    if(pPlan == NULL){
+        return GP_SUCCESS;
+    }
+    if((pData == NULL) || (dlc < pPlan->MinDlc)){
+        return GP_DP_DATA_ERR;
+    }
+    first = pPlan->First;
+    num = pPlan->Num;
+
+    /* Load the payload once, byte 0 is the least significant */
+    for(j = ((dlc < 8) ? dlc : 8) - 1; j >= 0; j--){
+        payload = (payload << 8) | pData[j];
+    }
+
+    /* Extract and store every signal as the type of its item, no branch per signal */
+    for(i = 0; i < num; i++){
+        raw = (uint32_t)(payload >> SigShift[first + i]) & SigMask[first + i];
+        StoreCanSig(&SigStore[first + i], raw, &values[i]);
+        pValues[i] = &values[i];
+    }
+
+    rc = SetElems(num, &SigElem[first], pValues);
+    if((rc == GP_SUCCESS) && (pNum != NULL)){
+        *pNum = num;
+    }
+    return rc;
+}
+
+/**************************************************************************************/
+/*! \fn static int CanSigCmpDef(const void * pA, const void * pB)
+ *
+ *  \par Description:
+ *		qsort() order of the definitions: bus, CAN message ID, then start bit.
+ **************************************************************************************/
+static int CanSigCmpDef(const void * pA, const void * pB){
+
+    const can_sig_def_t * pDefA = (const can_sig_def_t *)pA;
+    const can_sig_def_t * pDefB = (const can_sig_def_t *)pB;
+
+    if(pDefA->Bus != pDefB->Bus){
+        return (pDefA->Bus < pDefB->Bus) ? -1 : 1;
+    }
+    if(pDefA->CanMsgId != pDefB->CanMsgId){
+        return (pDefA->CanMsgId < pDefB->CanMsgId) ? -1 : 1;
+    }
+    return (int)pDefA->StartBit - (int)pDefB->StartBit;
+}
+
+/**************************************************************************************/
+/*! \fn static gp_retcode_t CanSigCheckDef(const can_sig_def_t * pDef, DP_CANSIG_STORE_T * pStore)
+ *
+ *  param[in]
+ *		-pDef:		a signal definition
+ *  param[out]
+ *		-pStore:	the store of the signal in its datapool item
+ *
+ *  \par Description:
+ *		Checks that the signal fits in the payload, and in its datapool item with
+ *		GetCanSigStore(), shared with the VP CAN signal map of SetCanSigMap().
+ *
+ *  \retval
+ *		GP_SUCCESS or GP_DP_PARMS_ERR
+ **************************************************************************************/
+static gp_retcode_t CanSigCheckDef(const can_sig_def_t * pDef, DP_CANSIG_STORE_T * pStore){
+
+    if((pDef->BitLen < 1) || (pDef->BitLen > CAN_SIG_MAX_BITS)
+        || ((pDef->StartBit + pDef->BitLen) > CAN_SIG_PAYLOAD_BITS)){
+        return GP_DP_PARMS_ERR;
+    }
+    return GetCanSigStore(pDef->ElemId, pDef->BitLen, pStore);
+}
+
+/**************************************************************************************/
+/*! \fn static const can_sig_plan_t * CanSigFindPlan(uint8_t bus, uint32_t canMsgId)
+ *
+ *  \par Description:
+ *		Binary search of the plan of a CAN message.
+ *
+ *  \retval
+ *		The plan, NULL if the message has no signal
+ **************************************************************************************/
+static const can_sig_plan_t * CanSigFindPlan(uint8_t bus, uint32_t canMsgId){
+
+    int lo = 0;
+    int hi = SigPlanNum - 1;
+    int mid;
+
+    while(lo <= hi){
+        mid = (lo + hi) / 2;
+        if((SigPlan[mid].Bus == bus) && (SigPlan[mid].CanMsgId == canMsgId)){
+            return &SigPlan[mid];
+        }
+        if((SigPlan[mid].Bus < bus) || ((SigPlan[mid].Bus == bus) && (SigPlan[mid].CanMsgId < canMsgId))){
+            lo = mid + 1;
+        }else{
+            hi = mid - 1;
+        }
+    }
+    return NULL;
+}
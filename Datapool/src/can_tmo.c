@@ -0,0 +1,469 @@
+/**************************************************************************************/
+/*!
+ *  \file		can_tmo.c
+ *
+ *  \brief		CAN message/signal timeout tracker built on a hierarchical timer wheel.
+ *
+ ***************************************************************************************
+ * \page sw_component_overview Software Component Overview page
+ *	A deadline d ticks away is linked in level 0 if d < CAN_TMO_SLOTS, else in the
+ *	lowest level whose span holds it, at the slot given by the bits of its expiry tick
+ *	for that level.  Every tick expires the current level 0 slot; when the level 0
+ *	index wraps the current slot of level 1 is cascaded (its deadlines are linked again,
+ *	now in level 0), and so on up the levels.  The deadlines are kept in a fixed table
+ *	and linked by index, so arming, refreshing and removing one only unlinks and links
+ *	it, and a tick only touches the deadlines that expire or cascade.
+ */
+/***************************************************************************************/
+#define CAN_TMO_C		/*!< File label definition */
+
+/***********************************
+		   INCLUDE FILES
+***********************************/
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "gp_cfg.h"         // Common GP program configuration settings
+#include "gp_types.h"       // Common GP program data type definitions
+
+#include "pool_def.h"
+#include "Datapool.h"
+#include "can_tmo.h"
+
+/***********************************
+	Private Macros and Typedefs
+***********************************/
+#define TMO_SLOT_MASK		(CAN_TMO_SLOTS - 1)
+
+/*! State of a deadline */
+typedef enum{
+    TMO_FREE = 0,           /*!< Not used */
+    TMO_ARMED,              /*!< Linked in the wheel */
+    TMO_EXPIRED             /*!< Expired, its item is stale until refreshed */
+}can_tmo_state_t;
+
+/*! A tracked deadline */
+typedef struct{
+    uint32_t Expiry;        /*!< Tick of the deadline */
+    uint32_t Timeout;       /*!< Timeout in ticks */
+    uint16_t Next;          /*!< Next deadline of the slot (or of the free list) */
+    uint16_t Prev;          /*!< Previous deadline of the slot, CAN_TMO_NONE if first */
+    uint16_t Slot;          /*!< Slot linking the deadline, CAN_TMO_NONE if none */
+    uint16_t ElemId;        /*!< Datapool item of the signal */
+    uint8_t  State;         /*!< can_tmo_state_t */
+}can_tmo_t;
+
+/***********************************
+	Private Data and Structures
+***********************************/
+static pthread_mutex_t TmoLock = PTHREAD_MUTEX_INITIALIZER;
+static can_tmo_t Tmo[CAN_TMO_MAX_TIMERS];
+static uint16_t TmoSlot[CAN_TMO_LEVELS * CAN_TMO_SLOTS];   /*!< First deadline of every slot */
+static uint16_t TmoFree = CAN_TMO_NONE;                     /*!< Free list of deadlines */
+static uint32_t TmoTick = 0;                                /*!< Current tick of the wheel */
+static uint32_t TmoLastMs = 0;                              /*!< Time of the current tick */
+static bool TmoTimeValid = false;                           /*!< false until CanTmo_Advance() set TmoLastMs */
+static can_tmo_hook_t TmoHook = NULL;
+static pthread_t TmoThread;
+
+/***********************************
+	Private Function Prototypes
+***********************************/
+static void CanTmoLink(uint16_t id);
+static void CanTmoUnlink(uint16_t id);
+static void CanTmoArm(uint16_t id);
+static uint32_t CanTmoStep(uint32_t pExpired[]);
+static void CanTmoNotify(const uint32_t pChanged[], bool stale);
+static uint32_t CanTmoNowMs(void);
+static void * CanTmoThread(void * ignore);
+
+
+/************ Start of code ******************/
+
+/**************************************************************************************/
+/*! \fn gp_retcode_t CanTmo_Init(can_tmo_hook_t hook)
+ *
+ *  param[in]
+ *		-hook:		the staleness change callback, may be NULL
+ *
+ *  \par Description:
+ *		Empties the slots and puts every deadline in the free list.
+ *
+ *  \retval
+ *		GP_SUCCESS
+ **************************************************************************************/
+gp_retcode_t CanTmo_Init(can_tmo_hook_t hook){
+
+    uint16_t i;
+
+    pthread_mutex_lock(&TmoLock);
+    for(i = 0; i < (CAN_TMO_LEVELS * CAN_TMO_SLOTS); i++){
+        TmoSlot[i] = CAN_TMO_NONE;
+    }
+    for(i = 0; i < CAN_TMO_MAX_TIMERS; i++){
+        Tmo[i].State = TMO_FREE;
+        Tmo[i].Slot = CAN_TMO_NONE;
+        Tmo[i].Next = ((i + 1u) < CAN_TMO_MAX_TIMERS) ? (i + 1) : CAN_TMO_NONE;
+    }
+    TmoFree = 0;
+    TmoTick = 0;
+    TmoTimeValid = false;
+    __atomic_store_n(&TmoHook, hook, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&TmoLock);
+    return GP_SUCCESS;
+}
+
+/**************************************************************************************/
+/*! \fn gp_retcode_t CanTmo_Start(can_tmo_hook_t hook)
+ *
+ *  param[in]
+ *		-hook:		the staleness change callback, may be NULL
+ *
+ *  \par Description:
+ *		Empties the wheel, sets its time and starts the tick thread.
+ *
+ *  \retval
+ *		GP_SUCCESS, GP_INIT_ERR if the thread can't be created
+ *
+ *  \par Limitations/Caveats:
+ *		Shall be called once per process.
+ **************************************************************************************/
+gp_retcode_t CanTmo_Start(can_tmo_hook_t hook){
+
+    CanTmo_Init(hook);
+    CanTmo_Advance(CanTmoNowMs());
+    if(pthread_create(&TmoThread, NULL, CanTmoThread, NULL) != 0){
+        printf("CanTmo_Start(): pthread_create() failed\n");
+        return GP_INIT_ERR;
+    }
+    return GP_SUCCESS;
+}
+
+/**************************************************************************************/
+/*! \fn gp_retcode_t CanTmo_Add(uint16_t elemId, uint32_t timeoutMs, can_tmo_id_t * pId)
+ *
+ *  param[in]
+ *		-elemId:	the datapool item of the signal
+ *		-timeoutMs:	the timeout of the signal in msec, rounded up to a tick
+ *  param[out]
+ *		-pId:		the handle of the deadline
+ *
+ *  \par Description:
+ *		Takes a deadline from the free list and arms it.
+ *
+ *  \retval
+ *		GP_SUCCESS, GP_DP_PARMS_ERR if a parameter is invalid, GP_MALLOC_ERR if every
+ *		deadline is used
+ **************************************************************************************/
+gp_retcode_t CanTmo_Add(uint16_t elemId, uint32_t timeoutMs, can_tmo_id_t * pId){
+
+    uint32_t ticks;
+    uint16_t id;
+
+    if((pId == NULL) || (elemId >= ELEM_MAX_ID) || (timeoutMs == 0)){
+        return GP_DP_PARMS_ERR;
+    }
+    ticks = (timeoutMs + CAN_TMO_TICK_MS - 1) / CAN_TMO_TICK_MS;
+    if(ticks > CAN_TMO_MAX_TICKS){
+        ticks = CAN_TMO_MAX_TICKS;
+    }
+
+    pthread_mutex_lock(&TmoLock);
+    id = TmoFree;
+    if(id == CAN_TMO_NONE){
+        pthread_mutex_unlock(&TmoLock);
+        return GP_MALLOC_ERR;
+    }
+    TmoFree = Tmo[id].Next;
+    Tmo[id].ElemId = elemId;
+    Tmo[id].Timeout = ticks;
+    CanTmoArm(id);
+    pthread_mutex_unlock(&TmoLock);
+
+    *pId = id;
+    return GP_SUCCESS;
+}
+
+/**************************************************************************************/
+/*! \fn gp_retcode_t CanTmo_Refresh(can_tmo_id_t id)
+ *
+ *  param[in]
+ *		-id:		the handle of the deadline
+ *
+ *  \par Description:
+ *		Moves the deadline a full timeout after the current tick.  If it had expired
+ *		its item is marked valid again and the hook is executed.
+ *
+ *  \retval
+ *		GP_SUCCESS, GP_DP_PARMS_ERR if the handle is invalid
+ *
+ *  \par Limitations/Caveats:
+ *		The item is marked valid even if another deadline of the same item expired,
+ *		one deadline per item is expected.
+ **************************************************************************************/
+gp_retcode_t CanTmo_Refresh(can_tmo_id_t id){
+
+    uint32_t valid[DP_DIRTY_WORDS] = {0};
+    bool wasExpired;
+
+    pthread_mutex_lock(&TmoLock);
+    if((id >= CAN_TMO_MAX_TIMERS) || (Tmo[id].State == TMO_FREE)){
+        pthread_mutex_unlock(&TmoLock);
+        return GP_DP_PARMS_ERR;
+    }
+    wasExpired = (Tmo[id].State == TMO_EXPIRED);
+    if(wasExpired){
+        DP_DIRTY_SET(valid, Tmo[id].ElemId);
+        SetPoolStale(valid, false);
+    }else{
+        CanTmoUnlink(id);
+    }
+    CanTmoArm(id);
+    pthread_mutex_unlock(&TmoLock);
+
+    if(wasExpired){
+        CanTmoNotify(valid, false);
+    }
+    return GP_SUCCESS;
+}
+
+/**************************************************************************************/
+/*! \fn gp_retcode_t CanTmo_Remove(can_tmo_id_t id)
+ *
+ *  param[in]
+ *		-id:		the handle of the deadline
+ *
+ *  \par Description:
+ *		Unlinks the deadline and returns it to the free list.
+ *
+ *  \retval
+ *		GP_SUCCESS, GP_DP_PARMS_ERR if the handle is invalid
+ **************************************************************************************/
+gp_retcode_t CanTmo_Remove(can_tmo_id_t id){
+
+    pthread_mutex_lock(&TmoLock);
+    if((id >= CAN_TMO_MAX_TIMERS) || (Tmo[id].State == TMO_FREE)){
+        pthread_mutex_unlock(&TmoLock);
+        return GP_DP_PARMS_ERR;
+    }
+    if(Tmo[id].State == TMO_ARMED){
+        CanTmoUnlink(id);
+    }
+    Tmo[id].State = TMO_FREE;
+    Tmo[id].Next = TmoFree;
+    TmoFree = id;
+    pthread_mutex_unlock(&TmoLock);
+    return GP_SUCCESS;
+}
+
+/**************************************************************************************/
+/*! \fn uint32_t CanTmo_Advance(uint32_t nowMs)
+ *
+ *  param[in]
+ *		-nowMs:		the current time in msec
+ *
+ *  \par Description:
+ *		Runs every tick elapsed since the last call (the rest of a tick is kept for
+ *		the next call), marks the items of the expired deadlines stale and executes
+ *		the hook once for all of them.
+ *
+ *  \retval
+ *		The number of deadlines expired
+ **************************************************************************************/
+uint32_t CanTmo_Advance(uint32_t nowMs){
+
+    uint32_t expired[DP_DIRTY_WORDS] = {0};
+    uint32_t num = 0;
+    uint32_t ticks;
+
+    pthread_mutex_lock(&TmoLock);
+    if(!TmoTimeValid){
+        TmoLastMs = nowMs;
+        TmoTimeValid = true;
+        pthread_mutex_unlock(&TmoLock);
+        return 0;
+    }
+    ticks = (nowMs - TmoLastMs) / CAN_TMO_TICK_MS;
+    TmoLastMs += ticks * CAN_TMO_TICK_MS;
+    while(ticks-- > 0){
+        num += CanTmoStep(expired);
+    }
+    if(num > 0){
+        SetPoolStale(expired, true);
+    }
+    pthread_mutex_unlock(&TmoLock);
+
+    if(num > 0){
+        CanTmoNotify(expired, true);
+    }
+    return num;
+}
+
+/**************************************************************************************/
+/*! \fn static void CanTmoLink(uint16_t id)
+ *
+ *  \par Description:
+ *		Links an armed deadline in the slot of its expiry tick, in the lowest level
+ *		holding it.  A deadline of the current tick goes to the current level 0 slot.
+ *		Called with TmoLock held.
+ **************************************************************************************/
+static void CanTmoLink(uint16_t id){
+
+    uint32_t delta = Tmo[id].Expiry - TmoTick;
+    uint16_t level = 0;
+    uint16_t slot;
+
+    while(((level + 1u) < CAN_TMO_LEVELS) && (delta >= (1u << (CAN_TMO_SLOT_BITS * (level + 1))))){
+        level++;
+    }
+    slot = (level * CAN_TMO_SLOTS) + ((Tmo[id].Expiry >> (CAN_TMO_SLOT_BITS * level)) & TMO_SLOT_MASK);
+
+    Tmo[id].Slot = slot;
+    Tmo[id].Prev = CAN_TMO_NONE;
+    Tmo[id].Next = TmoSlot[slot];
+    if(TmoSlot[slot] != CAN_TMO_NONE){
+        Tmo[TmoSlot[slot]].Prev = id;
+    }
+    TmoSlot[slot] = id;
+}
+
+/**************************************************************************************/
+/*! \fn static void CanTmoUnlink(uint16_t id)
+ *
+ *  \par Description:
+ *		Removes a deadline from its slot.  Called with TmoLock held.
+ **************************************************************************************/
+static void CanTmoUnlink(uint16_t id){
+
+    if(Tmo[id].Prev != CAN_TMO_NONE){
+        Tmo[Tmo[id].Prev].Next = Tmo[id].Next;
+    }else{
+        TmoSlot[Tmo[id].Slot] = Tmo[id].Next;
+    }
+    if(Tmo[id].Next != CAN_TMO_NONE){
+        Tmo[Tmo[id].Next].Prev = Tmo[id].Prev;
+    }
+    Tmo[id].Slot = CAN_TMO_NONE;
+}
+
+/**************************************************************************************/
+/*! \fn static void CanTmoArm(uint16_t id)
+ *
+ *  \par Description:
+ *		Sets the deadline a timeout after the current tick and links it.  Called with
+ *		TmoLock held.
+ **************************************************************************************/
+static void CanTmoArm(uint16_t id){
+
+    Tmo[id].State = TMO_ARMED;
+    Tmo[id].Expiry = TmoTick + Tmo[id].Timeout;
+    CanTmoLink(id);
+}
+
+/**************************************************************************************/
+/*! \fn static uint32_t CanTmoStep(uint32_t pExpired[])
+ *
+ *  param[out]
+ *		-pExpired:	the bitmap of the items of the expired deadlines is updated
+ *
+ *  \par Description:
+ *		Runs one tick: the slots whose index wrapped are cascaded from the highest
+ *		level down, then every deadline of the current level 0 slot expires.  Called
+ *		with TmoLock held.
+ *
+ *  \retval
+ *		The number of deadlines expired
+ **************************************************************************************/
+static uint32_t CanTmoStep(uint32_t pExpired[]){
+
+    uint32_t num = 0;
+    uint16_t level;
+    uint16_t slot;
+    uint16_t id;
+
+    TmoTick++;
+    for(level = CAN_TMO_LEVELS - 1; level > 0; level--){
+        if((TmoTick & ((1u << (CAN_TMO_SLOT_BITS * level)) - 1)) != 0){
+            continue;
+        }
+        slot = (level * CAN_TMO_SLOTS) + ((TmoTick >> (CAN_TMO_SLOT_BITS * level)) & TMO_SLOT_MASK);
+        id = TmoSlot[slot];
+        TmoSlot[slot] = CAN_TMO_NONE;
+        while(id != CAN_TMO_NONE){
+            uint16_t next = Tmo[id].Next;
+            CanTmoLink(id);
+            id = next;
+        }
+    }
+
+    slot = TmoTick & TMO_SLOT_MASK;
+    id = TmoSlot[slot];
+    TmoSlot[slot] = CAN_TMO_NONE;
+    while(id != CAN_TMO_NONE){
+        Tmo[id].State = TMO_EXPIRED;
+        Tmo[id].Slot = CAN_TMO_NONE;
+        DP_DIRTY_SET(pExpired, Tmo[id].ElemId);
+        num++;
+        id = Tmo[id].Next;
+    }
+    return num;
+}
+
+/**************************************************************************************/
+/*! \fn static void CanTmoNotify(const uint32_t pChanged[], bool stale)
+ *
+ *  \par Description:
+ *		Executes the hook.  The stale bitmap of the datapool is updated with TmoLock
+ *		held, so it follows the order of the expiries and refreshes; the hook is
+ *		executed without TmoLock, it may use the tracker.
+ **************************************************************************************/
+static void CanTmoNotify(const uint32_t pChanged[], bool stale){
+
+    can_tmo_hook_t hook = __atomic_load_n(&TmoHook, __ATOMIC_ACQUIRE);
+
+    if(hook != NULL){
+        hook(pChanged, stale);
+    }
+}
+
+/**************************************************************************************/
+/*! \fn static uint32_t CanTmoNowMs(void)
+ *
+ *  \par Description:
+ *		Returns CLOCK_MONOTONIC in msec, wrapping at 32 bits.
+ **************************************************************************************/
+static uint32_t CanTmoNowMs(void){
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint32_t)now.tv_sec * 1000u) + (uint32_t)(now.tv_nsec / 1000000);
+}
+
+/**************************************************************************************/
+/*! \fn static void * CanTmoThread(void * ignore)
+ *
+ *  \par Description:
+ *		Body of the tick thread, sleeps until the next absolute tick so the ticks do
+ *		not drift, then advances the wheel to the current time.
+ **************************************************************************************/
+static void * CanTmoThread(void * ignore){
+
+    struct timespec next;
+
+    (void)ignore;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while(1){
+        next.tv_nsec += CAN_TMO_TICK_MS * 1000000;
+        if(next.tv_nsec >= 1000000000){
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR);   //the message doorbells may interrupt the sleep
+        CanTmo_Advance(CanTmoNowMs());
+    }
+    return NULL;
+}
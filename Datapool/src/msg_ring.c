@@ -0,0 +1,325 @@
+/**************************************************************************************/
+/*!
+ *  \file		msg_ring.c
+ *
+ *  \brief		Shared-memory single-producer/single-consumer message ring.  Provides the
+ *				ring transport used by TxMsg()/RxMsg() in msg_api_signals.c when a
+ *				connection is switched to MSG_TRANSPORT_RING.
+ *
+ ***************************************************************************************
+ * \page sw_component_overview Software Component Overview page
+ *	Each component pair shares one POSIX shared-memory segment holding a ring per
+ *	direction.  Every ring has exactly one producer and one consumer, so the indexes
+ *	are published with acquire/release ordering and no lock is needed.  The consumer
+ *	arms a wakeup flag when it finds its ring empty; the producer only notifies the
+ *	peer (which costs a system call) when it consumes that flag.
+ */
+/***************************************************************************************/
+#define MSG_RING_C		/*!< File label definition */
+
+/***********************************
+		   INCLUDE FILES
+***********************************/
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "msg_ring.h"
+
+/***********************************
+	Private Macros and Typedefs
+***********************************/
+#define MSG_RING_MASK		(MSG_RING_SZ - 1u)	/*!< Converts a free running index to a data offset */
+#define MSG_RING_NAME_LEN	32					/*!< Size of the segment name buffer */
+
+#if ((MSG_RING_SZ & MSG_RING_MASK) != 0)
+   #error MSG_RING_SZ must be a power of 2.
+#endif
+
+/***********************************
+	Private Function Prototypes
+***********************************/
+static void RingCopyIn(msg_ring_t * pRing, uint32_t idx, const uint8_t * src, uint32_t size);
+static void RingCopyOut(const msg_ring_t * pRing, uint32_t idx, uint8_t * dst, uint32_t size);
+
+
+/************ Start of code ******************/
+
+/**************************************************************************************/
+/*! \fn msg_ring_shm_t * MsgRing_Create(uint8_t server, uint8_t client)
+ *
+ *  param[in]
+ *		-server:	the "component" id of the process calling GetTids()
+ *		-client:	the "component" id of the process calling PostTid()
+ *
+ *  \par Description:
+ *		Removes any segment left over by a previous run, then creates, sizes and maps
+ *		the segment shared by the two components.  Both rings start empty and armed so
+ *		the first message of each direction notifies the consumer.
+ *
+ *  \retval
+ *		Pointer to the mapped segment, NULL on error
+ *
+ *  \par Limitations/Caveats:
+ *		Shall be called before the client is allowed to call MsgRing_Open().
+ **************************************************************************************/
+msg_ring_shm_t * MsgRing_Create(uint8_t server, uint8_t client){
+
+    char name[MSG_RING_NAME_LEN];
+    msg_ring_shm_t * pShm;
+    int shm_fd;
+    int i;
+
+    snprintf(name, sizeof(name), MSG_RING_SHM_NAME, server, client);
+    shm_unlink(name);      //ensure the segment for the connection is clean
+
+    shm_fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR);
+    if(shm_fd < 0){
+        printf("shm_open() failed: %s\n", strerror(errno));
+        return NULL;
+    }
+    if(ftruncate(shm_fd, sizeof(msg_ring_shm_t)) != 0){
+        printf("ftruncate() failed: %s\n", strerror(errno));
+        close(shm_fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    pShm = mmap(NULL, sizeof(msg_ring_shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    close(shm_fd);
+    if(pShm == MAP_FAILED){
+        printf("mmap() failed: %s\n", strerror(errno));
+        shm_unlink(name);
+        return NULL;
+    }
+
+    memset(pShm, 0, sizeof(msg_ring_shm_t));
+    for(i = 0; i < MSG_RING_NUM_DIRS; i++){
+        pShm->Ring[i].RxArmed = 1;
+    }
+    pShm->Version = MSG_RING_VERSION;
+    __atomic_store_n(&pShm->Magic, MSG_RING_MAGIC, __ATOMIC_RELEASE);
+
+    return pShm;
+}
+
+/**************************************************************************************/
+/*! \fn msg_ring_shm_t * MsgRing_Open(uint8_t server, uint8_t client)
+ *
+ *  param[in]
+ *		-server:	the "component" id of the process calling GetTids()
+ *		-client:	the "component" id of the process calling PostTid()
+ *
+ *  \par Description:
+ *		Maps the segment created by the server side and validates its header.
+ *
+ *  \retval
+ *		Pointer to the mapped segment, NULL on error
+ *
+ *  \par Limitations/Caveats:
+ *		None.
+ **************************************************************************************/
+msg_ring_shm_t * MsgRing_Open(uint8_t server, uint8_t client){
+
+    char name[MSG_RING_NAME_LEN];
+    msg_ring_shm_t * pShm;
+    int shm_fd;
+
+    snprintf(name, sizeof(name), MSG_RING_SHM_NAME, server, client);
+    shm_fd = shm_open(name, O_RDWR, 0);
+    if(shm_fd < 0){
+        printf("shm_open() failed: %s\n", strerror(errno));
+        return NULL;
+    }
+    pShm = mmap(NULL, sizeof(msg_ring_shm_t), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    close(shm_fd);
+    if(pShm == MAP_FAILED){
+        printf("mmap() failed: %s\n", strerror(errno));
+        return NULL;
+    }
+
+    if((__atomic_load_n(&pShm->Magic, __ATOMIC_ACQUIRE) != MSG_RING_MAGIC) ||
+       (pShm->Version != MSG_RING_VERSION)){
+        printf("MsgRing_Open(): %s is not a valid ring segment\n", name);
+        munmap(pShm, sizeof(msg_ring_shm_t));
+        return NULL;
+    }
+
+    return pShm;
+}
+
+/**************************************************************************************/
+/*! \fn void MsgRing_Close(msg_ring_shm_t * pShm)
+ *
+ *  param[in]
+ *		-pShm:		the segment to unmap
+ *
+ *  \par Description:
+ *		Unmaps the segment.  The name is left in place, it is removed the next time
+ *		the server side calls MsgRing_Create().
+ *
+ *  \retval
+ *		None.
+ **************************************************************************************/
+void MsgRing_Close(msg_ring_shm_t * pShm){
+
+    if(pShm != NULL){
+        munmap(pShm, sizeof(msg_ring_shm_t));
+    }
+}
+
+/**************************************************************************************/
+/*! \fn int8_t MsgRing_Push(msg_ring_t * pRing, const uint8_t * data, uint16_t dataSz, bool * pWake)
+ *
+ *  param[in]
+ *		-pRing:		the ring to write (this process must be its only producer)
+ *		-data:		the message to copy
+ *		-dataSz:	the size in bytes of the message
+ *  param[out]
+ *		-pWake:		true if the consumer armed a wakeup, the caller must notify it
+ *
+ *  \par Description:
+ *		Copies the length prefixed record into the ring and publishes it by moving the
+ *		head index.  No system call is made.
+ *
+ *  \retval
+ *		-1 if the message is empty or there is not enough room, 0 on success
+ *
+ *  \par Limitations/Caveats:
+ *		Single producer only.
+ **************************************************************************************/
+int8_t MsgRing_Push(msg_ring_t * pRing, const uint8_t * data, uint16_t dataSz, bool * pWake){
+
+    uint32_t head;
+    uint32_t tail;
+    uint32_t recSz;
+    uint8_t hdr[MSG_RING_REC_HDR_SZ];
+
+    *pWake = false;
+    recSz = MSG_RING_REC_HDR_SZ + dataSz;
+    if((dataSz == 0) || (recSz > MSG_RING_SZ)){
+        return -1;
+    }
+
+    head = pRing->Head;
+    tail = __atomic_load_n(&pRing->Tail, __ATOMIC_ACQUIRE);
+    if((MSG_RING_SZ - (head - tail)) < recSz){
+        return -1;      //ring full, the consumer is lagging
+    }
+
+    hdr[0] = (uint8_t)(dataSz & 0xFF);
+    hdr[1] = (uint8_t)(dataSz >> 8);
+    RingCopyIn(pRing, head, &hdr[0], MSG_RING_REC_HDR_SZ);
+    RingCopyIn(pRing, head + MSG_RING_REC_HDR_SZ, data, dataSz);
+    __atomic_store_n(&pRing->Head, head + recSz, __ATOMIC_SEQ_CST);
+
+    /* Only pay for a notification when the consumer is idle */
+    if(__atomic_load_n(&pRing->RxArmed, __ATOMIC_SEQ_CST) != 0){
+        *pWake = (__atomic_exchange_n(&pRing->RxArmed, 0, __ATOMIC_SEQ_CST) != 0);
+    }
+    return 0;
+}
+
+/**************************************************************************************/
+/*! \fn uint32_t MsgRing_Free(const msg_ring_t * pRing)
+ *
+ *  param[in]
+ *		-pRing:		the ring to write (this process must be its only producer)
+ *
+ *  \par Description:
+ *		Returns the room left in the ring, the consumer may only make it larger.
+ *
+ *  \retval
+ *		The number of free bytes
+ **************************************************************************************/
+uint32_t MsgRing_Free(const msg_ring_t * pRing){
+
+    return MSG_RING_SZ - (pRing->Head - __atomic_load_n(&pRing->Tail, __ATOMIC_ACQUIRE));
+}
+
+/**************************************************************************************/
+/*! \fn uint16_t MsgRing_Pop(msg_ring_t * pRing, uint8_t * data, uint16_t dataSz)
+ *
+ *  param[in]
+ *		-pRing:		the ring to read (this process must be its only consumer)
+ *		-dataSz:	the size in bytes of data
+ *  param[out]
+ *		-data:		storage for the message
+ *
+ *  \par Description:
+ *		Copies the oldest record out of the ring and releases its room to the
+ *		producer.  If the ring is empty the wakeup flag is armed and the ring is checked
+ *		once more, so a message published concurrently is never left unnotified.
+ *
+ *  \retval
+ *		The size in bytes of the message, 0 if the ring is empty
+ *
+ *  \par Limitations/Caveats:
+ *		Single consumer only.  A message longer than dataSz is truncated.
+ **************************************************************************************/
+uint16_t MsgRing_Pop(msg_ring_t * pRing, uint8_t * data, uint16_t dataSz){
+
+    uint32_t head;
+    uint32_t tail;
+    uint16_t recLen;
+    uint8_t hdr[MSG_RING_REC_HDR_SZ];
+
+    tail = pRing->Tail;
+    head = __atomic_load_n(&pRing->Head, __ATOMIC_ACQUIRE);
+    if(head == tail){
+        __atomic_store_n(&pRing->RxArmed, 1, __ATOMIC_SEQ_CST);
+        head = __atomic_load_n(&pRing->Head, __ATOMIC_SEQ_CST);
+        if(head == tail){
+            return 0;
+        }
+        __atomic_store_n(&pRing->RxArmed, 0, __ATOMIC_RELAXED);
+    }
+
+    RingCopyOut(pRing, tail, &hdr[0], MSG_RING_REC_HDR_SZ);
+    recLen = (uint16_t)(hdr[0] | (hdr[1] << 8));
+    RingCopyOut(pRing, tail + MSG_RING_REC_HDR_SZ, data, (recLen < dataSz) ? recLen : dataSz);
+    __atomic_store_n(&pRing->Tail, tail + MSG_RING_REC_HDR_SZ + recLen, __ATOMIC_RELEASE);
+
+    return (recLen < dataSz) ? recLen : dataSz;
+}
+
+/**************************************************************************************/
+/*! \fn static void RingCopyIn(msg_ring_t * pRing, uint32_t idx, const uint8_t * src, uint32_t size)
+ *
+ *  \par Description:
+ *		Copies size bytes to the ring data area starting at the free running index idx,
+ *		wrapping around the end of the data area.
+ **************************************************************************************/
+static void RingCopyIn(msg_ring_t * pRing, uint32_t idx, const uint8_t * src, uint32_t size){
+
+    uint32_t offset = idx & MSG_RING_MASK;
+    uint32_t first = MSG_RING_SZ - offset;
+
+    if(first > size){
+        first = size;
+    }
+    memcpy(&pRing->Data[offset], src, first);
+    memcpy(&pRing->Data[0], src + first, size - first);
+}
+
+/**************************************************************************************/
+/*! \fn static void RingCopyOut(const msg_ring_t * pRing, uint32_t idx, uint8_t * dst, uint32_t size)
+ *
+ *  \par Description:
+ *		Copies size bytes from the ring data area starting at the free running index
+ *		idx, wrapping around the end of the data area.
+ **************************************************************************************/
+static void RingCopyOut(const msg_ring_t * pRing, uint32_t idx, uint8_t * dst, uint32_t size){
+
+    uint32_t offset = idx & MSG_RING_MASK;
+    uint32_t first = MSG_RING_SZ - offset;
+
+    if(first > size){
+        first = size;
+    }
+    memcpy(dst, &pRing->Data[offset], first);
+    memcpy(dst + first, &pRing->Data[0], size - first);
+}
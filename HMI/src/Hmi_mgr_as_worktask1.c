@@ -45,6 +45,7 @@
 #include "clk_api_linux.h"
 #include "msg_buf.h"
 #include "msg_api_signals.h"
+#include "msg_evloop.h"
 #include "msg_def.h"
 #include "msg_fcn.h"
 
@@ -94,6 +95,15 @@ uint8_t WarpLoad = 0;
 uint8_t WarpDisplay = 0;
 int32_t MirrorPos = 0;
 
+/*! Version of the last datapool changes applied to the local datapool copy */
+static uint32_t HmDpVersion = 0;
+
+/*! Datapool items the HMI manager is notified of */
+static const uint16_t HmSubscribedIds[] = {YzTdWarpLoad, YzTdWarpDisplay, YzTdMirrorPos};
+
+/*! Posted by the HMI alarm, the work task then sends the datapool subscription */
+static sem_t HmAlarmSem;
+
 /*! Connection to the Unit Manager */
 //Connection HmAs_UmAsCon2;
 
@@ -103,9 +113,12 @@ int32_t MirrorPos = 0;
 /***********************************
 	Private Function Prototypes
 ***********************************/
-static void MsgRxHandler(int sig, siginfo_t *si, void *uc);
 void DplTsk_HmiAlarmHandler(int sig, siginfo_t *si, void *uc);
-void DplTsk_HmiReceiveHandler(void * data);
+void DplTsk_HmiReceiveHandler(void * data, uint16_t size);
+static int32_t DplTsk_HmiSubscribe(void);
+static gp_retcode_t DplTsk_HmiRearmAlarm(uint64_t thisInterval);
+static void DplTsk_HmiUpdateData(void);
+static void DplTsk_HmiUpdateStale(uint8_t * data);
 static gp_retcode_t GetConnections(void);
 static int32_t ProcHbtReq(uint8_t * data, uint32_t size);
 
@@ -137,6 +150,7 @@ void * Hm_DplTskMain(void * ignore)
 {
     gp_retcode_t rc;
     component_info_t tmpCom[BUFINFO_NUM_ENTRIES];
+    bool subscribed = false;
 
     gp_Printf(DFLT_DBG_PRNTLVL, "\nHM_DPLTSK: Started\n");
 
@@ -170,8 +184,12 @@ void * Hm_DplTskMain(void * ignore)
         }
     }while(tmpCom[0].Fd < 0);
     printf("SetTxOn passed!\n");
+    if(SetMsgTransport(&tmpCom[0], HmiMgrWrkTsk1DpMgr_Transport) != 0){
+        printf("SetMsgTransport, failed in Component:%i\n", component);
+    }
 
     /* Start hmi alarm */
+    sem_init(&HmAlarmSem, 0, 0);
     do 
     {
 		sigset_t mask;
@@ -190,21 +208,14 @@ void * Hm_DplTskMain(void * ignore)
     } while(rc != 0);
     printf("WrkTsk1 passed sigaction\n");
     
+    memcpy(&componentsId[0], &tmpCom[0], sizeof(tmpCom));
+    /* Messages are received and dispatched on the event loop thread */
     do 
     {
-        sigset_t mask;
-        struct sigaction sa;
-
-        sa.sa_flags = SA_SIGINFO;
-        sa.sa_sigaction = MsgRxHandler;
-        sigemptyset(&sa.sa_mask);
-        sigaddset(&sa.sa_mask, CLKSETALARM2);
-        //sigaddset(&sa.sa_mask, SIGURG);
-        rc = sigaction(CB_TRUE, &sa, NULL);
-
+        rc = MsgEvLoop_Start(componentsId, BUFINFO_NUM_ENTRIES, msg_receive_handler);
         if(rc != 0) 
         {
-            printf("\nHMAS_INTTSK: Msg_AsyncRxEvent(alarm) error %d\n", rc);
+            printf("\nHMAS_INTTSK: MsgEvLoop_Start() error %d\n", rc);
         }
     } while(rc != 0);
 
@@ -212,10 +223,22 @@ void * Hm_DplTskMain(void * ignore)
         rc = WaitSemaphore(dp_semaphore);
         printf("rc after WaitSemaphore is:%i\n",rc );
     }while(rc != 0);*/
-    memcpy(&componentsId[0], &tmpCom[0], sizeof(tmpCom));
     rc = WaitSemaphore(dp_semaphore);
     printf("rc after WaitSemaphore is:%i\n",rc );
     printf("WaitSemaphore passed!\n");
+
+    /* Read the datapool of the Datapool Manager in place instead of requesting copies */
+    if(DpMgr_SharedPool)
+    {
+        do 
+        {
+            rc = AttachPoolShared(CommonDp_ShmName);
+            if(rc != GP_SUCCESS) 
+            {
+                gp_Printf(DFLT_DBG_PRNTLVL, "\nHMAS_DPLTSK: AttachPoolShared() error %d\n", rc);
+            }
+        } while(rc != GP_SUCCESS);
+    }
     
     do 
     {
@@ -232,23 +255,28 @@ void * Hm_DplTskMain(void * ignore)
     
     
     
-    /* Main HMI manager loop */
-    while(1);
-}
-
-static void MsgRxHandler(int sig, siginfo_t *si, void *uc){
-
-    uint8_t buffer[256];
-    memset(&buffer[0], 0, sizeof(buffer));
-    for (int i = 0; i < (sizeof(componentsId)/sizeof(component_info_t)); ++i)
+    /* Main HMI manager loop, the datapool subscription is sent at the HMI alarm and
+       the alarm is re-armed to retry until it is sent */
+    while(1)
     {
-        if (componentsId[i].Component == si->si_value.sival_int){
-            read(componentsId[i].Fd, &buffer[0],sizeof(buffer));
-            msg_receive_handler[i](&buffer[0]);
-            break;
+        if((sem_wait(&HmAlarmSem) != 0) || subscribed)
+        {
+            continue;
+        }
+        if(DplTsk_HmiSubscribe() == 0)
+        {
+            subscribed = true;
+            continue;
         }
-    }   
+        do {
+            rc = DplTsk_HmiRearmAlarm(MSEC_30);
+            if(rc != GP_SUCCESS) {
+                gp_Printf(DFLT_DBG_PRNTLVL, "\nHMAS_DPLTSK: DplTsk_HmiRearmAlarm() error %d\n", rc);
+            }
+        } while(rc != GP_SUCCESS);
+    }
 }
+
 /**************************************************************************************/
 /*! \fn DplTsk_UmasRxHandler(uint32_t data, uint32_t size)
  *
@@ -292,66 +320,169 @@ void DplTsk_UmasRxHandler(void * data, uint32_t size)
 }
 
 /**************************************************************************************/
-/*! \fn DplTsk_HmiAlarmHandler(uint32_t data, uint32_t size)
+/*! \fn DplTsk_HmiAlarmHandler(int sig, siginfo_t *si, void *uc)
  *
- *	param[in] data	- ignore since this is an event
- *	param[in] size	- ignore since this is an event
+ *	param[in] sig	- ignore since this is an event
+ *	param[in] si	- ignore since this is an event
+ *	param[in] uc	- ignore since this is an event
  *
  *  \par Description:	  
- *   Handle HMI screen update timer.  
+ *   Handle HMI start timer.  Only posts HmAlarmSem, the work task sends the 
+ *   datapool subscription outside of the signal handler.
  *
  *  \retval	none
  *
  *  \par Limitations/Caveats:
- *	 None
+ *	 Async-signal-safe, shall not do more than sem_post().
  *
  **************************************************************************************/
 void DplTsk_HmiAlarmHandler(int sig, siginfo_t *si, void *uc)
 {
-    gp_retcode_t rc;
-    int32_t ret;
-    PoolCopyResType Msg;
-    uint32_t transferred = 0;
-    uint8_t data[4];
+    (void)sig;
+    (void)si;
+    (void)uc;
+    sem_post(&HmAlarmSem);
+}
 
-    /* Get copy of the datapool from the Datapool Manager */
+/**************************************************************************************/
+/*! \fn DplTsk_HmiSubscribe(void)
+ *
+ *  \par Description:	  
+ *   Subscribes to the datapool items used by the HMI, the Datapool Manager then 
+ *   sends their changes with ElemChangeNotify.
+ *
+ *  \retval	Returns 0 if OK, non-0 if the request can't be sent.
+ *
+ *  \par Limitations/Caveats:
+ *	 Called by the work task, not by a signal handler.
+ *
+ **************************************************************************************/
+static int32_t DplTsk_HmiSubscribe(void)
+{
+    int32_t ret;
+    uint8_t msg[MSG_ID_SZ + MSG_ELEMSUB_IDS + sizeof(HmSubscribedIds)];
+    int offset;
+    uint32_t i;
 
-    /* Send the datapool copy request */
-    
-    
+    /* Send the datapool subscription request */
+    offset = gp_Store16bit(ElemSubscribeReq, &msg[0]);
+    msg[offset + MSG_ELEMSUB_NUM] = sizeof(HmSubscribedIds) / sizeof(HmSubscribedIds[0]);
+    offset += MSG_ELEMSUB_IDS;
+    for(i = 0; i < (sizeof(HmSubscribedIds) / sizeof(HmSubscribedIds[0])); i++)
+    {
+        offset += gp_Store16bit(HmSubscribedIds[i], &msg[offset]);
+    }
 
-    ret = TxBufMsg(component, componentsId[0].Fd, PoolCopyReq, componentsId[0].Tid, &data[0], sizeof(PoolCopyReq));
-    //TxBufMsg(HMI_MGR_WRKTSK1, connection_to_HmiMgr, PoolCopyReq, NULL, 0);
+    ret = TxMsg(componentsId[0].Fd, componentsId[0].Tid, component, &msg[0], offset, true);
     if(ret != 0) {
-	gp_Printf(DFLT_DBG_PRNTLVL, "\nHMAS_DPLTSK: TxBufMsg(PM) error %d\n", ret);
-    }else{
-        printf("TxBufMsg success!\n" );
-    } 
-    
+	gp_Printf(DFLT_DBG_PRNTLVL, "\nHMAS_DPLTSK: TxMsg(PM) error %d\n", ret);
+    }
+    return ret;
 }
 
-void DplTsk_HmiReceiveHandler(void * data){
+/**************************************************************************************/
+/*! \fn DplTsk_HmiRearmAlarm(uint64_t thisInterval)
+ *
+ *	param[in] thisInterval	- time in msec until the HMI alarm
+ *
+ *  \par Description:	  
+ *   Re-arms the one-shot HMI alarm timer created by Clk_SetTimer(), so the retries 
+ *   don't create a new timer each.
+ *
+ *  \retval	Returns GP_SUCCESS if OK, GP_GENERR if error.
+ *
+ *  \par Limitations/Caveats:
+ *	 None
+ *
+ **************************************************************************************/
+static gp_retcode_t DplTsk_HmiRearmAlarm(uint64_t thisInterval)
+{
+    struct itimerspec its;
+
+    its.it_value.tv_sec = thisInterval / 1000u;
+    its.it_value.tv_nsec = (thisInterval % 1000u) * 1000000u;
+    its.it_interval.tv_sec = 0;
+    its.it_interval.tv_nsec = 0;
+    if(timer_settime(HmWrkTskClk, 0, &its, NULL) == -1) {
+        return GP_GENERR;
+    }
+    return GP_SUCCESS;
+}
+
+void DplTsk_HmiReceiveHandler(void * data, uint16_t size){
 	
 	PoolCopyResType Msg = *((PoolCopyResType *)data);
-	gp_retcode_t rc;
+	uint8_t * msgDt = (uint8_t *)data;
+	uint16_t msgId;
+	int offset;
+
+	if(size < MSG_ID_SZ){
+		return;
+	}
+	offset = gp_Read16bit(&msgId, &msgDt[0]);
 	/* If the datapool was received correctly then update the local datapool */
 	if(Msg.Id == PoolCopyRes){
 		SetPool(&Msg.Dt);
+	}else if((msgId == PoolDeltaRes) || (msgId == ElemChangeNotify)){
+		/* A shared datapool already holds the changes */
+		if(!DpMgr_SharedPool){
+			SetPoolDelta(&msgDt[offset], size - offset, &HmDpVersion);
+		}
+	}else if((msgId == ElemStaleNotify) && (size >= MSG_ELEMSTALE_SZ)){
+		DplTsk_HmiUpdateStale(&msgDt[offset + MSG_ELEMSTALE_BITMAP]);
 	}
+	DplTsk_HmiUpdateData();
+}
 
+/**************************************************************************************/
+/*! \fn DplTsk_HmiUpdateData(void)
+ *
+ *  \par Description:	  
+ *   Update the local data parameters from the datapool.  
+ *
+ *  \retval	none
+ *
+ *  \par Limitations/Caveats:
+ *	 None
+ *
+ **************************************************************************************/
+static void DplTsk_HmiUpdateData(void)
+{
 	/* Update local data parameters from the datapool */
 	GetElem(YzTdWarpLoad, &WarpLoad);
 	GetElem(YzTdWarpDisplay, &WarpDisplay);
 	GetElem(YzTdMirrorPos, &MirrorPos);
-	
-	/* Start HMI alarm for periodic datapool requests */
-    do {
-		rc = Clk_SetTimer(&HmWrkTskClk, false, MSEC_30, CLKSETALARM2);
-		if(rc != GP_SUCCESS) {
-		    gp_Printf(DFLT_DBG_PRNTLVL, "\nHMAS_DPLTSK: Clk_SetTimer() error %d\n", rc);
-		}
-    } while(rc != GP_SUCCESS);
+}
 
+/**************************************************************************************/
+/*! \fn DplTsk_HmiUpdateStale(uint8_t * data)
+ *
+ *	param[in] data	- stale bitmap of an ElemStaleNotify message
+ *
+ *  \par Description:	  
+ *   Copy the stale datapool items reported by the Datapool Manager to the stale bitmap
+ *   of the local datapool, read with GetPoolStale().
+ *
+ *  \retval	none
+ *
+ *  \par Limitations/Caveats:
+ *	 None
+ *
+ **************************************************************************************/
+static void DplTsk_HmiUpdateStale(uint8_t * data)
+{
+	uint32_t stale[DP_DIRTY_WORDS];
+	uint32_t valid[DP_DIRTY_WORDS];
+	int offset = 0;
+	int i;
+
+	for(i = 0; i < DP_DIRTY_WORDS; i++)
+	{
+		offset += gp_Read32bit(&stale[i], &data[offset]);
+		valid[i] = ~stale[i];
+	}
+	SetPoolStale(stale, true);
+	SetPoolStale(valid, false);
 }
 
 /**************************************************************************************/
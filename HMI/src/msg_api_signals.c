@@ -4,13 +4,43 @@
 #include <string.h>
 #include <errno.h>
 #include <stdio.h>
+#include <poll.h>
+#include <pthread.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include "gp_types.h"
+#include "msg_frame.h"
 extern uint8_t component;
 
 #define MAX_NUM_COMPONENTS  4
 #define INVALID_CONNECTION  -1
+#define MSG_TX_POLL_MS      1000    /*!< Max wait in msec for a full socket to accept more bytes */
 #define MAX_NUM_MSGS        2
 
+/*! Transport information of a connection, recorded during the rendezvous */
+typedef struct{
+    pid_t           Tid;        /*!< tid of the peer */
+    int8_t          Fd;         /*!< socket bound by SetMsgTransport(), -1 until then */
+    msg_transport_t Transport;  /*!< transport used by TxMsg()/RxMsg() */
+    msg_ring_shm_t * pShm;      /*!< shared-memory segment of the connection */
+    msg_ring_t *    pTx;        /*!< ring written by this process */
+    msg_ring_t *    pRx;        /*!< ring read by this process */
+    uint32_t        TxSeq;      /*!< sequence number of the next frame sent on the socket */
+    pthread_mutex_t RingLock;   /*!< serializes the producers of pTx, the ring has a single producer */
+}msg_conn_t;
+
+static msg_conn_t MsgConn[MAX_NUM_COMPONENTS];
+static uint8_t MsgConnNum = 0;
+static uint32_t MsgTxSeq = 0;   /*!< sequence of the sockets never bound by SetMsgTransport() */
+static pthread_mutex_t MsgTxLock = PTHREAD_MUTEX_INITIALIZER;  /*!< serializes the frame writers and the sequence numbers */
+
+static void AddMsgConn(pid_t tid, msg_ring_shm_t * pShm, msg_ring_dir_t txDir, msg_ring_dir_t rxDir);
+static msg_conn_t * FindMsgConn(int8_t socket_fd);
+static int8_t WriteFrame(int8_t socket_fd, msg_conn_t * pConn, uint8_t * data, uint8_t dataSz);
+static int8_t WriteAllV(int8_t socket_fd, struct iovec iov[], int iovCnt);
+static int8_t ReadFrame(int8_t socket_fd, uint8_t * data, uint8_t dataSz, uint16_t * pRxSz);
+static int8_t ReadAll(int8_t socket_fd, uint8_t * data, uint16_t dataSz);
+
 /**************************************************************************************/
 /*! \fn void WaitForTids(const char connection_path[], uint8_t  components[], uint8_t connectionsToWait,  component_info_t * componentsId)
  *
@@ -49,6 +79,7 @@ int8_t GetTids(const char connection_path[], uint8_t  components[], uint8_t conn
     int socket_fd, connection_fd;
     socklen_t address_length;
     uint8_t component_found;
+    msg_ring_shm_t * pShm;
     
     socket_fd = socket(PF_UNIX, SOCK_STREAM,0); //create an unix domain socket
     if(socket_fd < 0)
@@ -97,6 +128,12 @@ int8_t GetTids(const char connection_path[], uint8_t  components[], uint8_t conn
         
         for(i = 0; i < MAX_NUM_COMPONENTS; i++){
             if(bufferRead[1] == components[i]){
+                /*the ring must exist before the peer is answered, PostTid() maps it right after*/
+                pShm = MsgRing_Create(ImComponent, bufferRead[1]);
+                if(pShm == NULL){
+                    printf("MsgRing_Create() failed, component %d is limited to socket transport\n", bufferRead[1]);
+                }
+                AddMsgConn(bufferRead[0], pShm, MSG_RING_SERVER_TX, MSG_RING_CLIENT_TX);
                 if(write(connection_fd, &bufferWrite[0],sizeof(bufferWrite)) == -1){
                     printf("write() failed: %s\n",strerror(errno) );
                 }
@@ -160,6 +197,7 @@ int8_t PostTid(const char connection_path[], uint8_t component, component_info_t
     int socket_fd, connection_fd;
     socklen_t address_length;
     uint8_t pending_connections = 1;
+    msg_ring_shm_t * pShm;
     printf("sizeof buffer is: %lu\n",sizeof(buffer) );
     
     socket_fd = socket(PF_UNIX, SOCK_STREAM,0); //create an unix domain socket
@@ -196,6 +234,13 @@ int8_t PostTid(const char connection_path[], uint8_t component, component_info_t
     }
     serverInfo->Tid = buffer[0];
     serverInfo->Component = buffer[1];
+    if(serverInfo->Tid != INVALID_CONNECTION){
+        pShm = MsgRing_Open(serverInfo->Component, component);
+        if(pShm == NULL){
+            printf("MsgRing_Open() failed, component %d is limited to socket transport\n", component);
+        }
+        AddMsgConn(serverInfo->Tid, pShm, MSG_RING_CLIENT_TX, MSG_RING_SERVER_TX);
+    }
     fsync(socket_fd);
     close(socket_fd);
     for (int i = 0; i < sizeof(buffer)/sizeof(pid_t); ++i)
@@ -272,11 +317,15 @@ int8_t SetRxOn(const char connection_path[]){
  *
  *
  *  \par Description:
- *		This function will read the content of the file descriptor socket_fd and will 
- *		store it in data, data should be a pointer with previously allocated memory
+ *		This function will read the next frame of the file descriptor socket_fd and will 
+ *		store its payload in data, data should be a pointer with previously allocated memory.
+ *		A payload longer than dataSz is truncated, the rest of the frame is discarded.
+ *		If the connection uses MSG_TRANSPORT_RING the oldest message is taken from the
+ *		shared-memory ring instead, without any system call.
  *  
  *  \retval 
- *		On error this function return -1, on Succes 0 is returned
+ *		On error this function return -1, on Succes 0 is returned. With the ring
+ *		transport -1 means the ring is empty.
  *
  *  \par Limitations/Caveats:
  *  None (yet).
@@ -284,24 +333,60 @@ int8_t SetRxOn(const char connection_path[]){
  *  TODO:
  **************************************************************************************/
 int8_t RxMsg(int8_t socket_fd, uint8_t * data, uint8_t dataSz){
-	if(read(socket_fd, data ,dataSz) != dataSz){
-		printf(" write() failed: %s\n", strerror(errno));
-		return -1;
-	}
-	return 0;
+	return RxMsgSz(socket_fd, data, dataSz, NULL);
 }
 
-void EncodeMsg(uint8_t * dataToEncode,uint8_t bufSz, bool cb){
-    
-    uint8_t tmpBuf[bufSz+1];
-    memset((void *)&tmpBuf[0], 0, sizeof(tmpBuf));//start with a clean tmp buffer
-    memcpy(&tmpBuf[0], dataToEncode, bufSz);//copy the data to be transmited to the tmp buffer
-    if(cb){
-    	memset((void *)dataToEncode, 1, 1);
-    }else{
-    	memset((void *)dataToEncode, 0, 1);
+/**************************************************************************************/
+/*! \fn int8_t RxMsgSz(int8_t socket_fd, uint8_t * data, uint8_t dataSz, uint16_t * pRxSz)
+ *
+ *  param[in] 
+ *		-socked_fd:			the file descriptor of the socket file you want to read from
+ *		-data:				a pointer in which you will receive the content of the reading
+ *		-dataSz:			the expected size in bytes of the message
+ *		-pRxSz:				the number of bytes stored in data, may be NULL
+ *
+ *  \par Description:
+ *		Same as RxMsg(), the size of the message read is also returned.
+ *  
+ *  \retval 
+ *		Same as RxMsg()
+ **************************************************************************************/
+int8_t RxMsgSz(int8_t socket_fd, uint8_t * data, uint8_t dataSz, uint16_t * pRxSz){
+    msg_conn_t * pConn = FindMsgConn(socket_fd);
+    uint16_t rxSz;
+    if((pConn != NULL) && (pConn->Transport == MSG_TRANSPORT_RING)){
+        /*an empty ring arms the wakeup of the next message*/
+        rxSz = MsgRing_Pop(pConn->pRx, data, dataSz);
+        if(pRxSz != NULL){
+            *pRxSz = rxSz;
+        }
+        return (rxSz > 0) ? 0 : -1;
     }
-    memcpy((void *)dataToEncode+1, (const void *)&tmpBuf[0], bufSz+1);  
+	return ReadFrame(socket_fd, data, dataSz, pRxSz);
+}
+
+/**************************************************************************************/
+/*! \fn uint8_t * EncodeMsg(uint8_t * dataToEncode, bool cb)
+ *
+ *  param[in] 
+ *		-dataToEncode:		the message, preceded by at least one byte of headroom
+ *		-cb:				a flag indicating wheter or not a Callback should be executed
+ *
+ *  \par Description:
+ *		Writes the callback flag in the byte in front of the message, the message is 
+ *		left in place.  A buffer from Msg_GetMsgBuf() reserves the byte with its
+ *		headroom (see msg_buf.h).
+ *  
+ *  \retval 
+ *		Pointer to the encoded message, one byte before dataToEncode
+ *
+ *  \par Limitations/Caveats:
+ *  None (yet).
+ **************************************************************************************/
+uint8_t * EncodeMsg(uint8_t * dataToEncode, bool cb){
+
+    dataToEncode[-1] = cb ? 1 : 0;
+    return &dataToEncode[-1];
 }
 /**************************************************************************************/
 /*! \fn int8_t SetTxOn(const char connection_path[])
@@ -366,32 +451,52 @@ int8_t SetTxOn(const char connection_path[]){
  *
  *  \par Description:
  *		This function will write the content of "data" into the socket file refered by  
- *		socked_fd
+ *		socked_fd, preceded by a frame header (see msg_frame.h). If the connection uses MSG_TRANSPORT_RING the data is copied into the
+ *		shared-memory ring instead, and the peer is signaled only if it armed a wakeup.
  *  
  *  \retval 
  *		On error this function return -1, on Succes 0 is returned
  *
  *  \par Limitations/Caveats:
- *  None (yet).
+ *  May be called by several threads, the pushes to a ring are serialized by the
+ *  RingLock of its connection.  Not async-signal-safe.
  *
  *  TODO:
  **************************************************************************************/
 int8_t TxMsg(int8_t socket_fd, pid_t tid, uint8_t ImComponent, uint8_t * data, uint8_t dataSz, bool cb){
 	int8_t rc = 0;
     union sigval component;
+    msg_conn_t * pConn;
+    bool wake;
     component.sival_int = ImComponent;
+
+    pConn = FindMsgConn(socket_fd);
+    if((pConn != NULL) && (pConn->Transport == MSG_TRANSPORT_RING)){
+        pthread_mutex_lock(&pConn->RingLock);
+        rc = MsgRing_Push(pConn->pTx, data, dataSz, &wake);
+        pthread_mutex_unlock(&pConn->RingLock);
+        if(rc != 0){
+            printf("TxMsg of component (%d), ring full\n", ImComponent);
+            return -1;
+        }
+        /*the peer is only signaled when it has drained its ring*/
+        if(wake){
+            sigqueue(tid, (cb ? CB_TRUE : CB_FALSE), (const union sigval)component);
+        }
+        return 0;
+    }
     if (cb)
     {
-        rc = write(socket_fd, data ,dataSz);
-        if(rc != dataSz){
+        rc = WriteFrame(socket_fd, pConn, data, dataSz);
+        if(rc != 0){
             printf("TxMsg of component (%d), write() failed: %s\n", ImComponent, strerror(errno));
             return -1;
         }else{
             sigqueue(tid, CB_TRUE, (const union sigval)component);    
         }
     }else{
-        rc = write(socket_fd, data ,dataSz);
-        if(rc != dataSz){
+        rc = WriteFrame(socket_fd, pConn, data, dataSz);
+        if(rc != 0){
             printf("TxMsg of component (%d), write() failed: %s\n", ImComponent, strerror(errno));
             return -1;
         }else{
@@ -402,6 +507,101 @@ int8_t TxMsg(int8_t socket_fd, pid_t tid, uint8_t ImComponent, uint8_t * data, u
 	return 0;
 }
 
+/**************************************************************************************/
+/*! \fn int8_t TxMsgBatch(int8_t socket_fd, pid_t tid, uint8_t ImComponent, msg_batch_entry_t msgs[], uint8_t numMsgs, bool cb)
+ *
+ *  param[in] 
+ *		-socked_fd:			the file descriptor of the socket file you want to write
+ *		-msgs:				the messages to be transmited
+ *		-numMsgs:			the number of messages in msgs
+ *		-cb:				a flag indicating wheter or not a Callback should be executed
+ *
+ *  \par Description:
+ *		This function will write every message of "msgs", each one preceded by its own
+ *		frame header, into the socket file refered by socked_fd with writev() (short
+ *		writes are resumed, see WriteAllV()), and then signals the peer once.  If the
+ *		connection uses MSG_TRANSPORT_RING the messages are pushed to the ring and the
+ *		peer is signaled once if it armed a wakeup at any point of the batch.  The
+ *		ring is checked to have room for the whole batch first, so either every
+ *		message is pushed or none is.
+ *  
+ *  \retval 
+ *		On error this function return -1, on Succes 0 is returned
+ *
+ *  \par Limitations/Caveats:
+ *  At most MSG_BATCH_MAX messages per call.
+ *
+ *  TODO:
+ **************************************************************************************/
+int8_t TxMsgBatch(int8_t socket_fd, pid_t tid, uint8_t ImComponent, msg_batch_entry_t msgs[], uint8_t numMsgs, bool cb){
+    union sigval component;
+    msg_conn_t * pConn;
+    uint8_t hdr[MSG_BATCH_MAX][MSG_FRAME_HDR_SZ];
+    struct iovec iov[2 * MSG_BATCH_MAX];
+    uint32_t * pSeq;
+    uint32_t need = 0;
+    bool wake;
+    bool anyWake = false;
+    int8_t rc = 0;
+    int i;
+    component.sival_int = ImComponent;
+
+    if((numMsgs == 0) || (numMsgs > MSG_BATCH_MAX)){
+        printf("TxMsgBatch of component (%d), invalid batch size %d\n", ImComponent, numMsgs);
+        return -1;
+    }
+
+    pConn = FindMsgConn(socket_fd);
+    if((pConn != NULL) && (pConn->Transport == MSG_TRANSPORT_RING)){
+        for(i = 0; i < numMsgs; i++){
+            if(msgs[i].DataSz == 0){
+                printf("TxMsgBatch of component (%d), empty message %d\n", ImComponent, i);
+                return -1;
+            }
+            need += MSG_RING_REC_HDR_SZ + msgs[i].DataSz;
+        }
+        /*all or nothing, a retry must not duplicate the first messages*/
+        pthread_mutex_lock(&pConn->RingLock);
+        if(MsgRing_Free(pConn->pTx) < need){
+            pthread_mutex_unlock(&pConn->RingLock);
+            printf("TxMsgBatch of component (%d), ring full\n", ImComponent);
+            return -1;
+        }
+        for(i = 0; i < numMsgs; i++){
+            if(MsgRing_Push(pConn->pTx, msgs[i].Data, msgs[i].DataSz, &wake) != 0){
+                rc = -1;    //can't happen, the room was checked
+                break;
+            }
+            anyWake |= wake;
+        }
+        pthread_mutex_unlock(&pConn->RingLock);
+        /*the peer is only signaled when it has drained its ring*/
+        if(anyWake){
+            sigqueue(tid, (cb ? CB_TRUE : CB_FALSE), (const union sigval)component);
+        }
+        return rc;
+    }
+
+    pthread_mutex_lock(&MsgTxLock);
+    pSeq = (pConn != NULL) ? &pConn->TxSeq : &MsgTxSeq;
+    for(i = 0; i < numMsgs; i++){
+        iov[2 * i].iov_base = &hdr[i][0];
+        iov[2 * i].iov_len = MsgFrame_PutHdr(&hdr[i][0], msgs[i].Data, msgs[i].DataSz, *pSeq + i);
+        iov[(2 * i) + 1].iov_base = msgs[i].Data;
+        iov[(2 * i) + 1].iov_len = msgs[i].DataSz;
+    }
+    rc = WriteAllV(socket_fd, &iov[0], 2 * numMsgs);
+    if(rc == 0){
+        *pSeq += numMsgs;
+    }
+    pthread_mutex_unlock(&MsgTxLock);
+    if(rc != 0){
+        printf("TxMsgBatch of component (%d), writev() failed: %s\n", ImComponent, strerror(errno));
+        return -1;
+    }
+    sigqueue(tid, (cb ? CB_TRUE : CB_FALSE), (const union sigval)component);
+    return 0;
+}
 /**************************************************************************************/
 /*! \fn int8_t WaitSemaphore(const char named_semaphore[])
  *
@@ -479,4 +679,257 @@ int8_t PostSemaphore(const char named_semaphore[], uint8_t semaphores_count){
         sem_unlink(named_semaphore);
         return -1;
     }
-}
\ No newline at end of file
+}
+/**************************************************************************************/
+/*! \fn int8_t SetMsgTransport(component_info_t * componentInfo, msg_transport_t transport)
+ *
+ *  param[in] 
+ *      -componentInfo:     the tid and socket fd of the peer
+ *      -transport:         the transport TxMsg()/RxMsg() will use for the socket
+ *
+ *  \par Description:
+ *      This function binds the socket of a peer to the connection recorded for it by
+ *      GetTids()/PostTid() and selects the transport used for it.
+ *  
+ *  \retval 
+ *      On error this function return -1, on Succes 0 is returned
+ *
+ *  \par Limitations/Caveats:
+ *  Both sides of a connection must select the same transport.
+ *
+ *  TODO:
+ **************************************************************************************/
+int8_t SetMsgTransport(component_info_t * componentInfo, msg_transport_t transport){
+
+    msg_conn_t * pConn = NULL;
+
+    for (int i = 0; i < MsgConnNum; ++i)
+    {
+        if(MsgConn[i].Tid == componentInfo->Tid){
+            pConn = &MsgConn[i];
+            break;
+        }
+    }
+    if(pConn == NULL){
+        /*no rendezvous was made with this peer, only the socket is available*/
+        return (transport == MSG_TRANSPORT_SOCKET) ? 0 : -1;
+    }
+    if((transport == MSG_TRANSPORT_RING) && (pConn->pShm == NULL)){
+        printf("SetMsgTransport(), no ring available for tid %d\n", componentInfo->Tid);
+        return -1;
+    }
+    pConn->Fd = componentInfo->Fd;
+    pConn->Transport = transport;
+    return 0;
+}
+/**************************************************************************************/
+/*! \fn msg_transport_t GetMsgTransport(int8_t socket_fd)
+ *
+ *  param[in] 
+ *      -socket_fd:         the file descriptor of the socket
+ *
+ *  \par Description:
+ *      This function returns the transport selected with SetMsgTransport() for the
+ *      socket.
+ *  
+ *  \retval 
+ *      The transport of the connection, MSG_TRANSPORT_SOCKET if none was selected
+ *
+ *  \par Limitations/Caveats:
+ *  None (yet).
+ *
+ *  TODO:
+ **************************************************************************************/
+msg_transport_t GetMsgTransport(int8_t socket_fd){
+
+    msg_conn_t * pConn = FindMsgConn(socket_fd);
+
+    return (pConn != NULL) ? pConn->Transport : MSG_TRANSPORT_SOCKET;
+}
+/**************************************************************************************/
+/*! \fn static void AddMsgConn(pid_t tid, msg_ring_shm_t * pShm, msg_ring_dir_t txDir, msg_ring_dir_t rxDir)
+ *
+ *  \par Description:
+ *      Records the shared-memory segment of a peer, the socket is bound later by
+ *      SetMsgTransport().  A peer that repeats the rendezvous reuses its entry.
+ **************************************************************************************/
+static void AddMsgConn(pid_t tid, msg_ring_shm_t * pShm, msg_ring_dir_t txDir, msg_ring_dir_t rxDir){
+
+    msg_conn_t * pConn = NULL;
+
+    for (int i = 0; i < MsgConnNum; ++i)
+    {
+        if(MsgConn[i].Tid == tid){
+            pConn = &MsgConn[i];
+            MsgRing_Close(pConn->pShm);
+            break;
+        }
+    }
+    if(pConn == NULL){
+        if(MsgConnNum >= MAX_NUM_COMPONENTS){
+            MsgRing_Close(pShm);
+            return;
+        }
+        pConn = &MsgConn[MsgConnNum++];
+        pthread_mutex_init(&pConn->RingLock, NULL);
+    }
+    pConn->Tid = tid;
+    pConn->Fd = INVALID_CONNECTION;
+    pConn->Transport = MSG_TRANSPORT_SOCKET;
+    pConn->pShm = pShm;
+    pConn->pTx = (pShm != NULL) ? &pShm->Ring[txDir] : NULL;
+    pConn->pRx = (pShm != NULL) ? &pShm->Ring[rxDir] : NULL;
+    pConn->TxSeq = 0;
+}
+/**************************************************************************************/
+/*! \fn static msg_conn_t * FindMsgConn(int8_t socket_fd)
+ *
+ *  \par Description:
+ *      Returns the connection bound to socket_fd, NULL if the socket was never bound.
+ **************************************************************************************/
+static msg_conn_t * FindMsgConn(int8_t socket_fd){
+
+    for (int i = 0; i < MsgConnNum; ++i)
+    {
+        if(MsgConn[i].Fd == socket_fd){
+            return &MsgConn[i];
+        }
+    }
+    return NULL;
+}
+/**************************************************************************************/
+/*! \fn static int8_t WriteFrame(int8_t socket_fd, msg_conn_t * pConn, uint8_t * data, uint8_t dataSz)
+ *
+ *  \par Description:
+ *      Writes the frame header and the payload with writev() until the whole frame is
+ *      in the socket.  Writers are serialized by MsgTxLock, so frames of concurrent
+ *      writers are never interleaved, and the sequence number is only consumed once
+ *      the frame is written.
+ **************************************************************************************/
+static int8_t WriteFrame(int8_t socket_fd, msg_conn_t * pConn, uint8_t * data, uint8_t dataSz){
+
+    uint8_t hdr[MSG_FRAME_HDR_SZ];
+    struct iovec iov[2];
+    uint32_t * pSeq;
+    int8_t rc;
+
+    pthread_mutex_lock(&MsgTxLock);
+    pSeq = (pConn != NULL) ? &pConn->TxSeq : &MsgTxSeq;
+    iov[0].iov_base = &hdr[0];
+    iov[0].iov_len = MsgFrame_PutHdr(&hdr[0], data, dataSz, *pSeq);
+    iov[1].iov_base = data;
+    iov[1].iov_len = dataSz;
+    rc = WriteAllV(socket_fd, &iov[0], 2);
+    if(rc == 0){
+        (*pSeq)++;
+    }
+    pthread_mutex_unlock(&MsgTxLock);
+    return rc;
+}
+/**************************************************************************************/
+/*! \fn static int8_t WriteAllV(int8_t socket_fd, struct iovec iov[], int iovCnt)
+ *
+ *  \par Description:
+ *      Writes every byte of iov, the sockets are non-blocking so a short write is
+ *      resumed after poll() reports room in the socket.  iov is updated in place.
+ *      Gives up with -1 if no byte can be written for MSG_TX_POLL_MS, the stream is
+ *      then left with a partial frame.
+ **************************************************************************************/
+static int8_t WriteAllV(int8_t socket_fd, struct iovec iov[], int iovCnt){
+
+    struct pollfd pfd;
+    ssize_t rc;
+
+    while(iovCnt > 0){
+        rc = writev(socket_fd, iov, iovCnt);
+        if(rc < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            if((errno != EAGAIN) && (errno != EWOULDBLOCK)){
+                return -1;
+            }
+            pfd.fd = socket_fd;
+            pfd.events = POLLOUT;
+            rc = poll(&pfd, 1, MSG_TX_POLL_MS);
+            if((rc < 0) && (errno != EINTR)){
+                return -1;
+            }
+            if(rc == 0){
+                errno = ETIMEDOUT;
+                return -1;
+            }
+            continue;
+        }
+        /*skip the buffers fully written, then trim the partially written one*/
+        while((iovCnt > 0) && ((size_t)rc >= iov[0].iov_len)){
+            rc -= iov[0].iov_len;
+            iov++;
+            iovCnt--;
+        }
+        if(iovCnt > 0){
+            iov[0].iov_base = (uint8_t *)iov[0].iov_base + rc;
+            iov[0].iov_len -= rc;
+        }
+    }
+    return 0;
+}
+/**************************************************************************************/
+/*! \fn static int8_t ReadFrame(int8_t socket_fd, uint8_t * data, uint8_t dataSz, uint16_t * pRxSz)
+ *
+ *  \par Description:
+ *      Blocking read of one frame, the payload bytes that don't fit in data are
+ *      read and discarded to keep the stream aligned on the next frame.  The number
+ *      of bytes kept is returned in pRxSz when it is not NULL.
+ **************************************************************************************/
+static int8_t ReadFrame(int8_t socket_fd, uint8_t * data, uint8_t dataSz, uint16_t * pRxSz){
+
+    uint8_t hdrBuf[MSG_FRAME_HDR_SZ];
+    uint8_t discard[MAX_MSG_BUFFER];
+    msg_frame_hdr_t hdr;
+    uint16_t keep;
+    uint16_t chunk;
+
+    if(ReadAll(socket_fd, &hdrBuf[0], MSG_FRAME_HDR_SZ) != 0){
+        return -1;
+    }
+    MsgFrame_GetHdr(&hdr, &hdrBuf[0]);
+    keep = (hdr.Len < dataSz) ? hdr.Len : dataSz;
+    if(ReadAll(socket_fd, data, keep) != 0){
+        return -1;
+    }
+    if(pRxSz != NULL){
+        *pRxSz = keep;
+    }
+    for(hdr.Len -= keep; hdr.Len > 0; hdr.Len -= chunk){
+        chunk = (hdr.Len < sizeof(discard)) ? hdr.Len : sizeof(discard);
+        if(ReadAll(socket_fd, &discard[0], chunk) != 0){
+            return -1;
+        }
+    }
+    return 0;
+}
+/**************************************************************************************/
+/*! \fn static int8_t ReadAll(int8_t socket_fd, uint8_t * data, uint16_t dataSz)
+ *
+ *  \par Description:
+ *      Reads exactly dataSz bytes, SOCK_STREAM may return them in several pieces.
+ **************************************************************************************/
+static int8_t ReadAll(int8_t socket_fd, uint8_t * data, uint16_t dataSz){
+
+    ssize_t rc;
+
+    while(dataSz > 0){
+        rc = read(socket_fd, data, dataSz);
+        if(rc < 0 && errno == EINTR){
+            continue;
+        }
+        if(rc <= 0){
+            printf(" read() failed: %s\n", (rc == 0) ? "connection closed" : strerror(errno));
+            return -1;
+        }
+        data += rc;
+        dataSz -= rc;
+    }
+    return 0;
+}
@@ -46,9 +46,12 @@
 /*    I N C L U D E   F I L E S                                              */
 /*****************************************************************************/
 #include <string.h>
+#include <stdio.h>
 #include <stdint.h>
+#include <stddef.h>
 
 #include "gp_types.h"
+#include "msg_buf.h"
 
 
 /*****************************************************************************/
@@ -57,7 +60,7 @@
 /* Max number of buffer pools per VAS */
 #define MAX_NUM_POOLS 4
 
-/* Max number of buffers (for each buffer type) */
+/* Default number of buffers (for each buffer type), see Msg_InitBufs() */
 #define MAX_NUM_BUF4  64 	/*!< Maximum number of 4 byte buffers(YZ_SPI_MAX_MSG_SIZE*2/4u) */
 #define MAX_NUM_BUF8  32 	/*!< Maximum number of 8 byte buffers(YZ_SPI_MAX_MSG_SIZE*2/8u) */
 #define MAX_NUM_BUF16 16 	/*!< Maximum number of 16 byte buffers(YZ_SPI_MAX_MSG_SIZE*2/16u)	*/
@@ -71,74 +74,113 @@
 
 #define CTL_BYTES 3
 
+/* Buffer size classes.  Class n holds buffers of (1 << (n + BUF_CLASS_MIN_SHIFT)) bytes */
+#define BUF_CLASS_MIN_SHIFT	2			/*!< log2 of the size of the smallest buffers (4 bytes) */
+#define BUF_IDX_NONE		0xFFFFu		/*!< End of a free list */
+#define BUF_CLASS_NONE		0xFFu		/*!< No size class holds the request */
+
+/*! Free list head made of a generation tag (bits 31-16) and a buffer index (bits 15-0).
+	The tag is incremented by every update so that a head popped and pushed back between
+	the load and the compare-and-swap of another caller is not mistaken as unchanged. */
+#define BUF_HEAD(tag, bufIdx)	((((uint32_t)(tag)) << 16) | ((uint32_t)(bufIdx) & 0xFFFFu))
+#define BUF_HEAD_IDX(head)		((uint16_t)((head) & 0xFFFFu))
+#define BUF_HEAD_TAG(head)		((uint16_t)((head) >> 16))
+
+/*! Size in bytes of the buffers of a size class */
+#define BUF_CLASS_SZ(cls)	(1u << ((cls) + BUF_CLASS_MIN_SHIFT))
+
+/*! Distance in bytes between two buffers of the given size, header included */
+#define BUF_STRIDE(sz)		MSG_BUF_STRIDE(sz)
+
+/*! Header of the buffer bufIdx of a size class */
+#define BUF_HDR(pClass, bufIdx)	((BufHdrType *)((pClass)->pMem + ((bufIdx) * (pClass)->Stride)))
+
+/*! Size in bytes of the default number of buffers */
+#define BUF_DEFAULT_MEM_SZ	(BUF_STRIDE(4) * MAX_NUM_BUF4 + BUF_STRIDE(8) * MAX_NUM_BUF8 +		\
+						 BUF_STRIDE(16) * MAX_NUM_BUF16 + BUF_STRIDE(32) * MAX_NUM_BUF32 +	\
+						 BUF_STRIDE(64) * MAX_NUM_BUF64 + BUF_STRIDE(128) * MAX_NUM_BUF128 +	\
+						 BUF_STRIDE(256) * MAX_NUM_BUF256)
+
+/*! Size in bytes of the memory of a buffer pool (see msg_buf.h) */
+#define BUF_POOL_MEM_SZ	MSG_BUF_POOL_MEM_SZ
+
+#if (BUF_DEFAULT_MEM_SZ > BUF_POOL_MEM_SZ)
+   #error MSG_BUF_POOL_MEM_SZ is too small for the default size classes.
+#endif
+#if ((BUF_POOL_MEM_SZ % 8u) != 0)
+   #error MSG_BUF_POOL_MEM_SZ must be a multiple of 8.
+#endif
+
 /*****************************************************************************/
 /*    T Y P E S   A N D   E N U M E R A T I O N S                            */
 /*****************************************************************************/
-/*! 4 byte buffer type descriptor */
-typedef struct {
-	uint8_t Buf[4+CTL_BYTES];			/*!< Data buffer */			
-	uint16_t BytesUsed;		/*!< 0= Buffer is available, Non-zero= Buffer is in use */
-} Buf4Type;
-/*! 8 byte buffer type descriptor */
+/*! Buffer size classes */
+enum {
+	BUF_CLASS_4 = 0,		/*!< 1 - 4 byte requests */
+	BUF_CLASS_8,			/*!< 5 - 8 byte requests */
+	BUF_CLASS_16,			/*!< 9 - 16 byte requests */
+	BUF_CLASS_32,			/*!< 17 - 32 byte requests */
+	BUF_CLASS_64,			/*!< 33 - 64 byte requests */
+	BUF_CLASS_128,			/*!< 65 - 128 byte requests */
+	BUF_CLASS_256,			/*!< 129 - 256 byte requests */
+	NUM_BUF_CLASSES
+};
+
+/*! Buffer header, the data buffer follows it */
 typedef struct {
-	uint8_t Buf[8+CTL_BYTES];			/*!< Data buffer */			
+	uint16_t NextFree;		/*!< Index of the next buffer of the free list while the buffer is available */
 	uint16_t BytesUsed;		/*!< 0= Buffer is available, Non-zero= Buffer is in use */
-} Buf8Type;
-/*! 16 byte buffer type descriptor */
-typedef struct {
-	uint8_t Buf[16+CTL_BYTES];	   /*!< Data buffer */			
-	uint16_t BytesUsed;	   /*!< 0= Buffer is available, Non-zero= Buffer is in use */
-} Buf16Type;
-/*! 32 byte buffer type descriptor */
-typedef struct {
-	uint8_t Buf[32+CTL_BYTES];	   /*!< Data buffer */			
-	uint16_t BytesUsed;	   /*!< 0= Buffer is available, Non-zero= Buffer is in use */
-} Buf32Type;
-/*! 64 byte buffer type descriptor */
-typedef struct {
-	uint8_t Buf[64+CTL_BYTES];	  /*!< Data buffer */			
-	uint16_t BytesUsed;	  /*!< 0= Buffer is available, Non-zero= Buffer is in use */
-} Buf64Type;
-/*! 128 byte buffer type descriptor */
-typedef struct {
-	uint8_t Buf[128+CTL_BYTES];	  /*!< Data buffer */			
-	uint16_t BytesUsed;	  /*!< 0= Buffer is available, Non-zero= Buffer is in use */
-} Buf128Type;
-/*! 256 byte buffer type descriptor */
+	uint32_t Reserved;		/*!< Keeps the data buffer 8 byte aligned */
+} BufHdrType;				/* 8 bytes, see MSG_BUF_STRIDE() */
+
+/*! Size class descriptor */
 typedef struct {
-	uint8_t Buf[256+CTL_BYTES];	 /*!< Data buffer */			
-	uint16_t BytesUsed;	 /*!< 0= Buffer is available, Non-zero= Buffer is in use */
-} Buf256Type;
+	uint8_t * pMem;			/*!< Header of the first buffer of the class */
+	uint32_t Stride;		/*!< Distance in bytes between two buffers */
+	uint16_t NumBufs;		/*!< Number of buffers of the class, 0 if the class is not configured */
+	uint32_t FreeHead;		/*!< Free list head (see BUF_HEAD()), index BUF_IDX_NONE if none */
+	uint16_t InUse;			/*!< Number of buffers in use */
+	uint16_t HighWater;		/*!< Highest number of buffers in use at once */
+	uint32_t Failed;		/*!< Number of requests that found no buffer available */
+} BufClassType;
 
 /*! Buffer pool structure */
 typedef struct {
-    Buf4Type 	Buf4[MAX_NUM_BUF4];			/*!< Array of 4 byte buffer entries */
-    Buf8Type 	Buf8[MAX_NUM_BUF8];			/*!< Array of 8 byte buffer entries */
-    Buf16Type 	Buf16[MAX_NUM_BUF16];		/*!< Array of 16 byte buffer entries */
-    Buf32Type 	Buf32[MAX_NUM_BUF32];		/*!< Array of 32 byte buffer entries */
-    Buf64Type 	Buf64[MAX_NUM_BUF64];		/*!< Array of 64 byte buffer entries */
-    Buf128Type 	Buf128[MAX_NUM_BUF128];		/*!< Array of 128 byte buffer entries */
-    Buf256Type 	Buf256[MAX_NUM_BUF256];		/*!< Array of 256 byte buffer entries */
+	BufClassType Class[NUM_BUF_CLASSES];	/*!< Size classes */
+	uint8_t Route[NUM_BUF_CLASSES];			/*!< Smallest configured class holding the requests of each class */
+	uint64_t Mem[BUF_POOL_MEM_SZ / sizeof(uint64_t)];	/*!< Buffers of every class */
 } BufPoolType;
 
 /*****************************************************************************/
 /*    M E M O R Y   A L L O C A T I O N                                      */
 /*****************************************************************************/
 
+/*! Default size classes */
+static const MsgBufCfgType BufDefaultCfg[NUM_BUF_CLASSES] = {
+	{4, MAX_NUM_BUF4}, {8, MAX_NUM_BUF8}, {16, MAX_NUM_BUF16}, {32, MAX_NUM_BUF32},
+	{64, MAX_NUM_BUF64}, {128, MAX_NUM_BUF128}, {256, MAX_NUM_BUF256}
+};
+
 /*! Array of buffer pools available to a VAS */
 static BufPoolType BufPool[MAX_NUM_POOLS];
 
-//TODO: adapt the code to use an enum type instead of the explicit buffer size
-//		as control for the switch cases
+/*****************************************************************************/
+/*    P R I V A T E   F U N C T I O N   P R O T O T Y P E S                  */
+/*****************************************************************************/
+static inline uint32_t BufClassOf(uint32_t reqSz);
+static BufHdrType * BufLookup(uint32_t bufSz, uint32_t bufIdx, uint8_t component, BufClassType ** ppClass);
 
 
 /************ Start of code ******************/
 
 /**************************************************************************************/
-/*! \fn Msg_InitBufs(void)
+/*! \fn Msg_InitBufs(uint8_t component)
+ *
+ *	\param[in] component - Index of the buffer pool of the task
  *
  *  \par Description:	  
- *  Assigns a buffer pool to the task, then initializes the task's buffer pool.
+ *  Assigns a buffer pool to the task, then initializes the task's buffer pool with the
+ *	default size classes (MAX_NUM_BUF4 .. MAX_NUM_BUF256 buffers).
  *
  *  \retval	Return code of type ::gp_retcode_t
  *
@@ -149,187 +191,340 @@ static BufPoolType BufPool[MAX_NUM_POOLS];
  **************************************************************************************/
 gp_retcode_t Msg_InitBufs(uint8_t component)
 {
-    BufPoolType * pBufPool;
-    
-    pBufPool = &BufPool[component];
-
-    memset(&pBufPool->Buf4, 0, sizeof(Buf4Type)*MAX_NUM_BUF4);
-    memset(&pBufPool->Buf8, 0, sizeof(Buf8Type)*MAX_NUM_BUF8);
-    memset(&pBufPool->Buf16, 0, sizeof(Buf16Type)*MAX_NUM_BUF16);
-    memset(&pBufPool->Buf32, 0, sizeof(Buf32Type)*MAX_NUM_BUF32);
-    memset(&pBufPool->Buf64, 0, sizeof(Buf64Type)*MAX_NUM_BUF64);
-    memset(&pBufPool->Buf128, 0, sizeof(Buf128Type)*MAX_NUM_BUF128);
-    memset(&pBufPool->Buf256, 0, sizeof(Buf256Type)*MAX_NUM_BUF256);
-    return GP_SUCCESS;
+    return Msg_InitBufsCfg(component, &BufDefaultCfg[0], NUM_BUF_CLASSES);
 }
 
 /**************************************************************************************/
-/*! \fn Msg_GetBuf(uint32_t reqSz, uint32_t *bufSz, uint32_t *bufIdx)
+/*! \fn Msg_InitBufsCfg(uint8_t component, const MsgBufCfgType cfg[], uint8_t numCfg)
  *
- *	\param[in] reqSz  - Requested buffer size in bytes
- *	\param[out] bufSz - Pointer to size of buffer reserved, updated by this function.
- *	\param[out] bufIdx - Pointer to the index of buffer reserved, updated by this function.
+ *	\param[in] component - Index of the buffer pool of the task
+ *	\param[in] cfg - Size and number of buffers of each size class
+ *	\param[in] numCfg - Number of entries in cfg
  *
  *  \par Description:	  
- *  Reserves a buffer from the task's buffer pool. Finds an available buffer of the
- *	appropriate size in the buffer pool, marks it as 'assigned', then returns a pointer
- *	to the buffer.
+ *  Assigns a buffer pool to the task, then initializes the task's buffer pool: the 
+ *	buffers of each configured size class are laid out in the pool memory and chained in
+ *	the free list of their class, and the statistics are cleared.  A request is served
+ *	by the smallest configured class holding it.
  *
- *  \retval	Pointer to reserved buffer if ok, NULL pointer if no buffer found or there
- *			were errors.
+ *  \retval	Return code of type ::gp_retcode_t
  *
  *  \par Limitations/Caveats:
- *  None.
+ *  The buffer sizes must be powers of two from MSG_BUF_MIN_SZ to MSG_BUF_MAX_SZ, each 
+ *	one configured once, and the buffers must fit MSG_BUF_POOL_MEM_SZ bytes: the classes
+ *	share the pool memory, its size is set at build time.
  *
  *	\ingroup msgfcns_public
  **************************************************************************************/
-uint8_t *Msg_GetBuf(uint8_t reqSz, uint32_t *bufIdx, uint8_t component)
+gp_retcode_t Msg_InitBufsCfg(uint8_t component, const MsgBufCfgType cfg[], uint8_t numCfg)
 {
-    uint32_t i;
-    uint8_t * pBuf = NULL;
     BufPoolType * pBufPool;
-    uint32_t tskIdx;
+    BufClassType * pClass;
+    uint16_t numBufs[NUM_BUF_CLASSES];
+    uint8_t * pMem;
+    uint32_t memSz;
+    uint32_t cls;
+    uint8_t route;
+    uint32_t i;
 
-	/* Get the address of the buffer pool for this task */
-    pBufPool = &BufPool[component];
+    if(component >= MAX_NUM_POOLS)
+    {
+		return GP_INIT_ERR;
+    }
 
-	/* If the request buffer size is 1 - 4 bytes then */
-    if(reqSz <= 4) 
+	/* Check the configuration before touching the pool */
+    memset(&numBufs[0], 0, sizeof(numBufs));
+    memSz = 0;
+    for(i = 0; i < numCfg; i++)
     {
-		/* Look for an available 4 byte buffer */
-		for(i=0; i<MAX_NUM_BUF4; i++) 
+		cls = BufClassOf(cfg[i].BufSz);
+		if((cls >= NUM_BUF_CLASSES) || (BUF_CLASS_SZ(cls) != cfg[i].BufSz) || 
+		   (numBufs[cls] != 0) || (cfg[i].NumBufs >= BUF_IDX_NONE))
 		{
-			/* If an available buffer is found, reserve it and return buffer info */
-		    if(pBufPool->Buf4[i].BytesUsed == 0) 
-		    {
-				pBuf = pBufPool->Buf4[i].Buf;			// get buffer address 
-				pBufPool->Buf4[i].BytesUsed = reqSz;	// save request size and mark as 'reserved'
-				//*bufSz = 4+3;								// return the max buffer size
-				*bufIdx = (uint32_t)i;							// return the buffer index
-				return pBuf;
-		    }
+			printf("Msg_InitBufsCfg(): invalid size class %u (%u buffers)\n", cfg[i].BufSz, cfg[i].NumBufs);
+			return GP_INIT_ERR;
 		}
+		numBufs[cls] = cfg[i].NumBufs;
+		memSz += BUF_STRIDE(cfg[i].BufSz) * cfg[i].NumBufs;
     }
-    
-	/* Else if the request buffer size is 5 - 8 bytes then */
-    else if( (reqSz > 4) && (reqSz <= 8) ) 
+    if(memSz > BUF_POOL_MEM_SZ)
     {
-		/* Look for an available 8 byte buffer */
-		for(i=0; i<MAX_NUM_BUF8; i++) 
-		{
-			/* If an available buffer is found, reserve it and return buffer info */
-		    if(pBufPool->Buf8[i].BytesUsed == 0) 
-		    {
-				pBuf = pBufPool->Buf8[i].Buf;		   // get buffer address 
-				pBufPool->Buf8[i].BytesUsed = reqSz;   // save request size and mark as 'reserved'
-				//*bufSz = 8+3;							   // return the max buffer size
-				*bufIdx = (uint32_t)i;						   // return the buffer index
-				return pBuf;
-		    }
-		}
+		printf("Msg_InitBufsCfg(): %u bytes of buffers, %u available\n", memSz, (uint32_t)BUF_POOL_MEM_SZ);
+		return GP_INIT_ERR;
     }
 
-	/* Else if the request buffer size is 9 - 16 bytes then */
-    else if( (reqSz > 8) && (reqSz <= 16) ) 
+    pBufPool = &BufPool[component];
+    memset(pBufPool, 0, sizeof(BufPoolType));
+
+    pMem = (uint8_t *)&pBufPool->Mem[0];
+    for(cls = 0; cls < NUM_BUF_CLASSES; cls++)
     {
-		/* Look for an available 16 byte buffer */
-		for(i=0; i<MAX_NUM_BUF16; i++) 
+		pClass = &pBufPool->Class[cls];
+		pClass->pMem = pMem;
+		pClass->Stride = BUF_STRIDE(BUF_CLASS_SZ(cls));
+		pClass->NumBufs = numBufs[cls];
+
+		/* Chain every buffer of the class in its free list */
+		for(i = 0; i < pClass->NumBufs; i++)
 		{
-			/* If an available buffer is found, reserve it and return buffer info */
-		    if(pBufPool->Buf16[i].BytesUsed == 0) 
-		    {
-				pBuf = pBufPool->Buf16[i].Buf;		   // get buffer address 
-				pBufPool->Buf16[i].BytesUsed = reqSz;  // save request size and mark as 'reserved'
-				//*bufSz = 16+3;						   // return the max buffer size
-				*bufIdx = (uint32_t)i;						   // return the buffer index
-				return pBuf;
-		    }
+			BUF_HDR(pClass, i)->NextFree = ((i + 1) < pClass->NumBufs) ? (uint16_t)(i + 1) : BUF_IDX_NONE;
 		}
+		pClass->FreeHead = BUF_HEAD(0, (pClass->NumBufs > 0) ? 0 : BUF_IDX_NONE);
+		pMem += pClass->Stride * pClass->NumBufs;
     }
 
-	/* Else if the request buffer size is 17 - 32 bytes then */
-    else if( (reqSz > 16) && (reqSz <= 32) ) 
+	/* Route the requests of every class to the next configured class */
+    route = BUF_CLASS_NONE;
+    for(cls = NUM_BUF_CLASSES; cls-- > 0; )
     {
-		/* Look for an available 32 byte buffer */
-		for(i=0; i<MAX_NUM_BUF32; i++) 
+		if(pBufPool->Class[cls].NumBufs > 0)
 		{
-			/* If an available buffer is found, reserve it and return buffer info */
-		    if(pBufPool->Buf32[i].BytesUsed == 0) 
-		    {
-				pBuf = pBufPool->Buf32[i].Buf;		   // get buffer address 
-				pBufPool->Buf32[i].BytesUsed = reqSz;  // save request size and mark as 'reserved'
-				//*bufSz = 32+3;						   // return the max buffer size
-				*bufIdx = (uint32_t)i;						   // return the buffer index
-				return pBuf;
-		    }
+			route = (uint8_t)cls;
 		}
+		pBufPool->Route[cls] = route;
     }
+    return GP_SUCCESS;
+}
 
-	/* Else if the request buffer size is 33 - 64 bytes then */
-    else if( (reqSz > 32) && (reqSz <= 64) ) 
+/**************************************************************************************/
+/*! \fn Msg_GetBufStats(uint8_t component, MsgBufStatsType stats[], uint8_t * pNumClasses)
+ *
+ *	\param[in] component - Index of the buffer pool of the task
+ *	\param[out] stats - Statistics of each configured size class, smallest first
+ *	\param[out] pNumClasses - Number of entries stored in stats
+ *
+ *  \par Description:	  
+ *  Returns the number of buffers in use, the highest number of buffers in use at once
+ *	and the number of failed requests of every configured size class of the task's 
+ *	buffer pool.
+ *
+ *  \retval	Return code of type ::gp_retcode_t
+ *
+ *  \par Limitations/Caveats:
+ *  stats must hold MSG_BUF_MAX_CLASSES entries.  The counters of a class are read one
+ *	by one while the pool is in use, so they may not be consistent with each other.
+ *
+ *	\ingroup msgfcns_public
+ **************************************************************************************/
+gp_retcode_t Msg_GetBufStats(uint8_t component, MsgBufStatsType stats[], uint8_t * pNumClasses)
+{
+    BufClassType * pClass;
+    uint32_t cls;
+    uint8_t num;
+
+    if(component >= MAX_NUM_POOLS)
     {
-		/* Look for an available 64 byte buffer */
-		for(i=0; i<MAX_NUM_BUF64; i++) 
+		return GP_GENERR;
+    }
+    num = 0;
+    for(cls = 0; cls < NUM_BUF_CLASSES; cls++)
+    {
+		pClass = &BufPool[component].Class[cls];
+		if(pClass->NumBufs == 0)
 		{
-			/* If an available buffer is found, reserve it and return buffer info */
-		    if(pBufPool->Buf64[i].BytesUsed == 0) 
-		    {
-				pBuf = pBufPool->Buf64[i].Buf;		   // get buffer address 
-				pBufPool->Buf64[i].BytesUsed = reqSz;  // save request size and mark as 'reserved'
-				//*bufSz = 64+3;						   // return the max buffer size
-				*bufIdx = (uint32_t)i;						   // return the buffer index
-				return pBuf;
-		    }
+			continue;
 		}
+		stats[num].BufSz = BUF_CLASS_SZ(cls);
+		stats[num].NumBufs = pClass->NumBufs;
+		stats[num].InUse = __atomic_load_n(&pClass->InUse, __ATOMIC_RELAXED);
+		stats[num].HighWater = __atomic_load_n(&pClass->HighWater, __ATOMIC_RELAXED);
+		stats[num].Failed = __atomic_load_n(&pClass->Failed, __ATOMIC_RELAXED);
+		num++;
     }
+    *pNumClasses = num;
+    return GP_SUCCESS;
+}
 
-	/* Else if the request buffer size is 65 - 128 bytes then */
-    else if( (reqSz > 64) && (reqSz <= 128) ) 
+/**************************************************************************************/
+/*! \fn Msg_GetBuf(uint32_t reqSz, uint32_t *bufIdx, uint8_t component)
+ *
+ *	\param[in] reqSz  - Requested buffer size in bytes
+ *	\param[out] bufIdx - Pointer to the index of buffer reserved, updated by this function.
+ *	\param[in] component - Index of the buffer pool of the task
+ *
+ *  \par Description:	  
+ *  Reserves a buffer from the task's buffer pool. Takes the first buffer of the free 
+ *	list of the size class of the request, marks it as 'assigned', then returns a pointer
+ *	to the buffer.  The cost does not depend on the number of buffers.  A request that
+ *	finds its class empty is counted in the statistics of the class.
+ *	The free list is updated with a compare-and-swap, so threads and signal handlers may
+ *	get and free buffers of the same pool concurrently without any lock.
+ *
+ *  \retval	Pointer to reserved buffer if ok, NULL pointer if no buffer found or there
+ *			were errors.
+ *
+ *  \par Limitations/Caveats:
+ *  None.
+ *
+ *	\ingroup msgfcns_public
+ **************************************************************************************/
+uint8_t *Msg_GetBuf(uint32_t reqSz, uint32_t *bufIdx, uint8_t component)
+{
+    BufClassType * pClass;
+    BufHdrType * pHdr;
+    uint32_t cls;
+    uint32_t head;
+    uint32_t next;
+    uint16_t idx;
+    uint16_t inUse;
+    uint16_t highWater;
+
+    cls = BufClassOf(reqSz);
+    if((component >= MAX_NUM_POOLS) || (cls >= NUM_BUF_CLASSES))
     {
-		/* Look for an available 128 byte buffer */
-		for(i=0; i<MAX_NUM_BUF128; i++) 
-		{
-			/* If an available buffer is found, reserve it and return buffer info */
-		    if(pBufPool->Buf128[i].BytesUsed == 0) 
-		    {
-				pBuf = pBufPool->Buf128[i].Buf;			// get buffer address 
-				pBufPool->Buf128[i].BytesUsed = reqSz;	// save request size and mark as 'reserved'
-				//*bufSz = 128+3;							// return the max buffer size
-				*bufIdx = (uint32_t)i;							// return the buffer index
-				return pBuf;
-		    }
-		}
+		return NULL;
+    }
+    cls = BufPool[component].Route[cls];
+    if(cls == BUF_CLASS_NONE)
+    {
+		return NULL;
     }
 
-	/* Else if the request buffer size is 129 - 256 bytes then */
-    /*else*/ if( (reqSz > 128) && (reqSz <= 256) ) 
+	/* Take the first available buffer of the size class */
+    pClass = &BufPool[component].Class[cls];
+    head = __atomic_load_n(&pClass->FreeHead, __ATOMIC_ACQUIRE);
+    do
     {
-		/* Look for an available 256 byte buffer */
-		for( i=0; i<MAX_NUM_BUF256; i++) 
+		idx = BUF_HEAD_IDX(head);
+		if(idx == BUF_IDX_NONE)
 		{
-	/* If an available buffer is found, reserve it and return buffer info */
-		    if(pBufPool->Buf256[i].BytesUsed == 0) 
-		    {
-				pBuf = pBufPool->Buf256[i].Buf;			 // get buffer address 
-				pBufPool->Buf256[i].BytesUsed = reqSz;	 // save request size and mark as 'reserved'
-			//	//*bufSz = 256+3;							 // return the max buffer size
-				*bufIdx = (uint32_t)i;							 // return the buffer index
-				//printf("bufIdx is: %i\n",bufIdx );
-				return pBuf;
-		    }
+			__atomic_add_fetch(&pClass->Failed, 1, __ATOMIC_RELAXED);
+			return NULL;
 		}
-    }
-    return pBuf;
+		pHdr = BUF_HDR(pClass, idx);
+		/* NextFree may be stale if the buffer was taken meanwhile, the tag then fails the swap */
+		next = BUF_HEAD(BUF_HEAD_TAG(head) + 1, __atomic_load_n(&pHdr->NextFree, __ATOMIC_RELAXED));
+    } while(!__atomic_compare_exchange_n(&pClass->FreeHead, &head, next, true,
+										 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+    pHdr->BytesUsed = reqSz;	// save request size and mark as 'reserved'
+
+    inUse = __atomic_add_fetch(&pClass->InUse, 1, __ATOMIC_RELAXED);
+    highWater = __atomic_load_n(&pClass->HighWater, __ATOMIC_RELAXED);
+    while((inUse > highWater) &&
+		  !__atomic_compare_exchange_n(&pClass->HighWater, &highWater, inUse, true,
+									   __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    *bufIdx = (uint32_t)idx;	// return the buffer index
+    return (uint8_t *)(pHdr + 1);
 }
 
 /**************************************************************************************/
-/*! \fn Msg_FreeBuf(uint32_t bufSz, uint32_t bufIdx)
+/*! \fn Msg_FreeBuf(uint32_t bufSz, uint32_t bufIdx, uint8_t component)
  *
- *	\param[in] bufSz - Size of buffer to free
+ *	\param[in] bufSz - Size of buffer to free, as requested to Msg_GetBuf()
  *	\param[in] bufIdx - Index of buffer to free
+ *	\param[in] component - Index of the buffer pool of the task
+ *
+ *  \par Description:	  
+ *  Frees a buffer from the task's buffer pool by marking it as 'available' and putting
+ *	it back at the head of the free list of its size class.  May be called concurrently
+ *	with Msg_GetBuf() and Msg_FreeBuf() on the same pool.
+ *
+ *  \retval	None.
+ *
+ *  \par Limitations/Caveats:
+ *  A buffer that is not in use is ignored.
+ *
+ *	\ingroup msgfcns_public
+ **************************************************************************************/
+void Msg_FreeBuf(uint32_t bufSz, uint32_t bufIdx, uint8_t component)
+{
+    BufClassType * pClass;
+    BufHdrType * pHdr;
+    uint32_t head;
+
+    pHdr = BufLookup(bufSz, bufIdx, component, &pClass);
+    if(pHdr == NULL)
+    {
+		return;
+    }
+    if(__atomic_exchange_n(&pHdr->BytesUsed, 0, __ATOMIC_RELAXED) == 0)
+    {
+		return;
+    }
+    __atomic_sub_fetch(&pClass->InUse, 1, __ATOMIC_RELAXED);
+    head = __atomic_load_n(&pClass->FreeHead, __ATOMIC_RELAXED);
+    do
+    {
+		__atomic_store_n(&pHdr->NextFree, BUF_HEAD_IDX(head), __ATOMIC_RELAXED);
+    } while(!__atomic_compare_exchange_n(&pClass->FreeHead, &head, BUF_HEAD(BUF_HEAD_TAG(head) + 1, bufIdx),
+										 true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/**************************************************************************************/
+/*! \fn Msg_GetMsgBuf(MsgBufType * pMsg, uint32_t headroom, uint32_t dataSz, uint8_t component)
+ *
+ *	\param[out] pMsg - The message buffer
+ *	\param[in] headroom - Number of bytes reserved in front of the payload
+ *	\param[in] dataSz - Size in bytes of the payload
+ *	\param[in] component - Index of the buffer pool of the task
+ *
+ *  \par Description:	  
+ *  Reserves a buffer from the task's buffer pool for the headers and the payload of a 
+ *	message.  The payload is composed at pMsg->pData, then each layer writes its header
+ *	in front of it with Msg_PushHdr() instead of copying the message after its header.
+ *
+ *  \retval	Return code of type ::gp_retcode_t
+ *
+ *  \par Limitations/Caveats:
+ *  None.
+ *
+ *	\ingroup msgfcns_public
+ **************************************************************************************/
+gp_retcode_t Msg_GetMsgBuf(MsgBufType * pMsg, uint32_t headroom, uint32_t dataSz, uint8_t component)
+{
+    uint8_t * pBuf;
+
+    pMsg->BufSz = headroom + dataSz;
+    pBuf = Msg_GetBuf(pMsg->BufSz, &pMsg->BufIdx, component);
+    if(pBuf == NULL)
+    {
+		pMsg->pData = NULL;
+		return GP_MSG_NONEAVAIL;
+    }
+    pMsg->Component = component;
+    pMsg->pData = pBuf + headroom;
+    pMsg->DataSz = dataSz;
+    pMsg->Headroom = headroom;
+    return GP_SUCCESS;
+}
+
+/**************************************************************************************/
+/*! \fn Msg_PushHdr(MsgBufType * pMsg, uint32_t hdrSz)
+ *
+ *	\param[in] pMsg - The message buffer
+ *	\param[in] hdrSz - Size in bytes of the header
  *
  *  \par Description:	  
- *  Frees a buffer from the task's buffer pool by marking it as 'available'.
+ *  Moves the start of the message hdrSz bytes back into the headroom.
+ *
+ *  \retval	Pointer to the header, to be written by the caller, NULL pointer if the 
+ *			headroom left is too small.
+ *
+ *  \par Limitations/Caveats:
+ *  None.
+ *
+ *	\ingroup msgfcns_public
+ **************************************************************************************/
+uint8_t * Msg_PushHdr(MsgBufType * pMsg, uint32_t hdrSz)
+{
+    if(hdrSz > pMsg->Headroom)
+    {
+		return NULL;
+    }
+    pMsg->pData -= hdrSz;
+    pMsg->DataSz += hdrSz;
+    pMsg->Headroom -= hdrSz;
+    return pMsg->pData;
+}
+
+/**************************************************************************************/
+/*! \fn Msg_FreeMsgBuf(MsgBufType * pMsg)
+ *
+ *	\param[in] pMsg - The message buffer
+ *
+ *  \par Description:	  
+ *  Releases the caller's hold on the buffer of a message, see Msg_FreeBuf().
  *
  *  \retval	None.
  *
@@ -338,62 +533,73 @@ uint8_t *Msg_GetBuf(uint8_t reqSz, uint32_t *bufIdx, uint8_t component)
  *
  *	\ingroup msgfcns_public
  **************************************************************************************/
-void Msg_FreeBuf(uint8_t bufSz, uint32_t bufIdx, uint8_t component)
+void Msg_FreeMsgBuf(MsgBufType * pMsg)
 {
-    BufPoolType * pBufPool;
-    uint32_t tskIdx;
-    
-    pBufPool = &BufPool[component];
-    
-    switch(bufSz) 
+    Msg_FreeBuf(pMsg->BufSz, pMsg->BufIdx, pMsg->Component);
+    pMsg->pData = NULL;
+}
+
+/**************************************************************************************/
+/*! \fn BufLookup(uint32_t bufSz, uint32_t bufIdx, uint8_t component, BufClassType ** ppClass)
+ *
+ *	\param[in] bufSz - Size of the buffer, as requested to Msg_GetBuf()
+ *	\param[in] bufIdx - Index of the buffer
+ *	\param[in] component - Index of the buffer pool of the task
+ *	\param[out] ppClass - Size class of the buffer
+ *
+ *  \par Description:	  
+ *  Validates a buffer reference and returns the header of the buffer.
+ *
+ *  \retval	Pointer to the buffer header, NULL pointer if the reference is invalid.
+ *
+ *  \par Limitations/Caveats:
+ *  None.
+ *
+ **************************************************************************************/
+static BufHdrType * BufLookup(uint32_t bufSz, uint32_t bufIdx, uint8_t component, BufClassType ** ppClass)
+{
+    uint32_t cls;
+
+    cls = BufClassOf(bufSz);
+    if((component >= MAX_NUM_POOLS) || (cls >= NUM_BUF_CLASSES))
+    {
+		return NULL;
+    }
+    cls = BufPool[component].Route[cls];
+    if(cls == BUF_CLASS_NONE)
+    {
+		return NULL;
+    }
+    *ppClass = &BufPool[component].Class[cls];
+    if(bufIdx >= (*ppClass)->NumBufs)
+    {
+		return NULL;
+    }
+    return BUF_HDR(*ppClass, bufIdx);
+}
+
+/**************************************************************************************/
+/*! \fn BufClassOf(uint32_t reqSz)
+ *
+ *	\param[in] reqSz  - Requested buffer size in bytes
+ *
+ *  \par Description:	  
+ *  Returns the size class of the smallest buffers holding reqSz bytes, computed from 
+ *	the position of the highest bit set in (reqSz - 1).
+ *
+ *  \retval	Size class, NUM_BUF_CLASSES or above if the request is too big.
+ *
+ *  \par Limitations/Caveats:
+ *  None.
+ *
+ **************************************************************************************/
+static inline uint32_t BufClassOf(uint32_t reqSz)
+{
+    if(reqSz <= BUF_CLASS_SZ(0))
     {
-		/* Release a 4 byte buffer */
-		case RSIZE4:
-		    if(bufIdx < MAX_NUM_BUF4) 
-		    {
-				pBufPool->Buf4[bufIdx].BytesUsed = 0;
-		    }
-		    break;
-		/* Release a 8 byte buffer */
-		case RSIZE8:
-		    if(bufIdx < MAX_NUM_BUF8) {
-			pBufPool->Buf8[bufIdx].BytesUsed = 0;
-		    }
-		    break;
-		/* Release a 16 byte buffer */
-		case RSIZE16:
-		    if(bufIdx < MAX_NUM_BUF16) {
-			pBufPool->Buf16[bufIdx].BytesUsed = 0;
-		    }
-		    break;
-		/* Release a 32 byte buffer */
-		case RSIZE32:
-		    if(bufIdx < MAX_NUM_BUF32) {
-			pBufPool->Buf32[bufIdx].BytesUsed = 0;
-		    }
-		    break;
-		/* Release a 64 byte buffer */
-		case RSIZE64:
-		    if(bufIdx < MAX_NUM_BUF64) {
-			pBufPool->Buf64[bufIdx].BytesUsed = 0;
-		    }
-		    break;
-		/* Release a 128 byte buffer */
-		case RSIZE128:
-		    if(bufIdx < MAX_NUM_BUF128) {
-			pBufPool->Buf128[bufIdx].BytesUsed = 0;
-		    }
-		    break;
-		/* Release a 256 byte buffer */
-		case RSIZE256:
-		    if(bufIdx < MAX_NUM_BUF256) {
-			pBufPool->Buf256[bufIdx].BytesUsed = 0;
-		    }
-		    break;
-		default:
-		    break;
+		return 0;
     }
-   
+    return (32u - (uint32_t)__builtin_clz(reqSz - 1u)) - BUF_CLASS_MIN_SHIFT;
 }
 
 /* MSG_BUF_C */
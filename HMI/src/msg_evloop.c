@@ -0,0 +1,314 @@
+/**************************************************************************************/
+/*!
+ *  \file		msg_evloop.c
+ *
+ *  \brief		Event driven message reception.  Waits with epoll() on the sockets of the
+ *				connections of the component and executes the "component" callbacks on a
+ *				dedicated receive thread.
+ *
+ ***************************************************************************************
+ * \page sw_component_overview Software Component Overview page
+ *	Previously every message was read and dispatched inside the CB_TRUE signal handler,
+ *	one read() per signal.  The receive thread instead drains a socket until it would
+ *	block each time epoll() reports it readable and reassembles the frames it reads,
+ *	so a burst of messages costs one wakeup and a few read() calls.  The signal handler is reduced to an async-signal-safe write() of the
+ *	sender "component" id into a pipe also watched by epoll(), which wakes the thread
+ *	for connections using the shared-memory ring transport.
+ */
+/***************************************************************************************/
+#define MSG_EVLOOP_C		/*!< File label definition */
+
+/***********************************
+		   INCLUDE FILES
+***********************************/
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "msg_frame.h"
+#include "msg_evloop.h"
+
+/***********************************
+	Private Macros and Typedefs
+***********************************/
+#define EVLOOP_WAKEUP_TAG	UINT32_MAX		/*!< epoll data of the wakeup pipe */
+
+/*! A connection served by the receive thread */
+typedef struct{
+    component_info_t Info;                  /*!< peer of the connection */
+    function_cb_t    Handler;               /*!< callback executed per message */
+    bool             Open;                  /*!< false once the peer closed the socket */
+    uint8_t          Buf[MSG_EVLOOP_RX_BUF_SZ]; /*!< receive buffer of the ring transport */
+    msg_frame_reasm_t Reasm;                /*!< reassembler of the socket transport */
+}evloop_conn_t;
+
+/***********************************
+	Private Data and Structures
+***********************************/
+static evloop_conn_t EvConn[MSG_EVLOOP_MAX_CONNS];
+static uint8_t EvConnNum = 0;
+static int EvEpollFd = -1;
+static int EvWakeupPipe[2] = {-1, -1};
+static pthread_t EvThread;
+
+/***********************************
+	Private Function Prototypes
+***********************************/
+static void EvWakeupHandler(int sig, siginfo_t *si, void *uc);
+static void * EvLoopThread(void * ignore);
+static void EvDrainWakeups(void);
+static void EvDrainSocket(evloop_conn_t * pConn);
+static void EvDrainRing(evloop_conn_t * pConn);
+static void EvClose(void);
+
+
+/************ Start of code ******************/
+
+/**************************************************************************************/
+/*! \fn int8_t MsgEvLoop_Start(component_info_t * componentsId, uint8_t numComponents, function_cb_t handlers[])
+ *
+ *  param[in]
+ *		-componentsId:	the connections of the component (peer id, tid and socket fd)
+ *		-numComponents:	the number of entries in componentsId and handlers
+ *		-handlers:		the callback of each connection
+ *
+ *  \par Description:
+ *		Creates the wakeup pipe and the epoll instance, registers the socket of every
+ *		connection, installs the doorbell handler for CB_TRUE and CB_FALSE and starts
+ *		the receive thread.  On error the pipe and the epoll instance are closed, so
+ *		the call may be retried.
+ *
+ *  \retval
+ *		On error this function return -1, on Succes 0 is returned
+ *
+ *  \par Limitations/Caveats:
+ *		Shall be called once per process, after the connections are established.
+ **************************************************************************************/
+int8_t MsgEvLoop_Start(component_info_t * componentsId, uint8_t numComponents, function_cb_t handlers[]){
+
+    struct epoll_event ev;
+    struct sigaction sa;
+    int i;
+
+    if(numComponents > MSG_EVLOOP_MAX_CONNS){
+        printf("MsgEvLoop_Start(): too many connections (%d)\n", numComponents);
+        return -1;
+    }
+
+    if(pipe(EvWakeupPipe) != 0){
+        printf("pipe() failed: %s\n", strerror(errno));
+        EvWakeupPipe[0] = EvWakeupPipe[1] = -1;
+        return -1;
+    }
+    /* Neither end may block: the reader drains it, the signal handler can't wait */
+    for(i = 0; i < 2; i++){
+        fcntl(EvWakeupPipe[i], F_SETFL, fcntl(EvWakeupPipe[i], F_GETFL) | O_NONBLOCK);
+        fcntl(EvWakeupPipe[i], F_SETFD, FD_CLOEXEC);
+    }
+    EvEpollFd = epoll_create1(EPOLL_CLOEXEC);
+    if(EvEpollFd < 0){
+        printf("epoll_create1() failed: %s\n", strerror(errno));
+        EvClose();
+        return -1;
+    }
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = EVLOOP_WAKEUP_TAG;
+    if(epoll_ctl(EvEpollFd, EPOLL_CTL_ADD, EvWakeupPipe[0], &ev) != 0){
+        printf("epoll_ctl() failed: %s\n", strerror(errno));
+        EvClose();
+        return -1;
+    }
+
+    for(i = 0; i < numComponents; i++){
+        EvConn[i].Info = componentsId[i];
+        EvConn[i].Handler = handlers[i];
+        EvConn[i].Open = true;
+        MsgFrame_InitReasm(&EvConn[i].Reasm);
+        EvConn[i].Reasm.SeqErrors = 0;
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.u32 = i;
+        if(epoll_ctl(EvEpollFd, EPOLL_CTL_ADD, componentsId[i].Fd, &ev) != 0){
+            printf("epoll_ctl() failed for component (%d): %s\n", componentsId[i].Component, strerror(errno));
+            EvClose();
+            return -1;
+        }
+    }
+    EvConnNum = numComponents;
+
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sa.sa_sigaction = EvWakeupHandler;
+    sigemptyset(&sa.sa_mask);
+    if((sigaction(CB_TRUE, &sa, NULL) != 0) || (sigaction(CB_FALSE, &sa, NULL) != 0)){
+        printf("sigaction() failed: %s\n", strerror(errno));
+        EvClose();
+        return -1;
+    }
+
+    if(pthread_create(&EvThread, NULL, EvLoopThread, NULL) != 0){
+        printf("pthread_create() failed\n");
+        EvClose();
+        return -1;
+    }
+    return 0;
+}
+
+/**************************************************************************************/
+/*! \fn static void EvWakeupHandler(int sig, siginfo_t *si, void *uc)
+ *
+ *  \par Description:
+ *		Doorbell of TxMsg(), forwards the sender "component" id to the receive thread.
+ *		If the pipe is full a wakeup is already pending, so the byte can be dropped.
+ **************************************************************************************/
+static void EvWakeupHandler(int sig, siginfo_t *si, void *uc){
+
+    int savedErrno = errno;
+    uint8_t sender = (uint8_t)si->si_value.sival_int;
+
+    (void)sig;
+    (void)uc;
+    (void)write(EvWakeupPipe[1], &sender, sizeof(sender));
+    errno = savedErrno;
+}
+
+/**************************************************************************************/
+/*! \fn static void * EvLoopThread(void * ignore)
+ *
+ *  \par Description:
+ *		Body of the receive thread, dispatches every event reported by epoll_wait().
+ **************************************************************************************/
+static void * EvLoopThread(void * ignore){
+
+    struct epoll_event events[MSG_EVLOOP_MAX_EVENTS];
+    int numEvents;
+    int i;
+
+    (void)ignore;
+    while(1){
+        numEvents = epoll_wait(EvEpollFd, events, MSG_EVLOOP_MAX_EVENTS, -1);
+        if(numEvents < 0){
+            if(errno != EINTR){     //the clock alarms may interrupt the wait
+                printf("epoll_wait() failed: %s\n", strerror(errno));
+            }
+            continue;
+        }
+        for(i = 0; i < numEvents; i++){
+            if(events[i].data.u32 == EVLOOP_WAKEUP_TAG){
+                EvDrainWakeups();
+            }else if(events[i].data.u32 < EvConnNum){
+                EvDrainSocket(&EvConn[events[i].data.u32]);
+            }
+        }
+    }
+    return NULL;
+}
+
+/**************************************************************************************/
+/*! \fn static void EvDrainWakeups(void)
+ *
+ *  \par Description:
+ *		Empties the wakeup pipe, then drains the ring of every connection using the
+ *		ring transport.  The sender ids are not needed: an empty ring costs one index
+ *		load, and a dropped byte (pipe full) can not leave a ring unserved.
+ *		Connections using sockets are served by their own epoll event.
+ **************************************************************************************/
+static void EvDrainWakeups(void){
+
+    uint8_t senders[MSG_EVLOOP_RX_BUF_SZ];
+    int i;
+
+    while(read(EvWakeupPipe[0], &senders[0], sizeof(senders)) > 0);
+    for(i = 0; i < EvConnNum; i++){
+        EvDrainRing(&EvConn[i]);
+    }
+}
+
+/**************************************************************************************/
+/*! \fn static void EvDrainSocket(evloop_conn_t * pConn)
+ *
+ *  \par Description:
+ *		Reads the socket until it would block and executes the callback of the
+ *		connection for every complete frame, the payload is passed in place with its
+ *		length.  A partial frame is kept in the reassembler until the rest of it is
+ *		read.  A closed socket is removed from epoll.
+ **************************************************************************************/
+static void EvDrainSocket(evloop_conn_t * pConn){
+
+    msg_frame_hdr_t hdr;
+    uint8_t * pPayload;
+    uint8_t * pSpace;
+    uint16_t space;
+    ssize_t rc;
+
+    if(!pConn->Open){
+        return;
+    }
+    while(1){
+        pSpace = MsgFrame_RxSpace(&pConn->Reasm, &space);
+        rc = recv(pConn->Info.Fd, pSpace, space, MSG_DONTWAIT);
+        if(rc > 0){
+            MsgFrame_RxCommit(&pConn->Reasm, (uint16_t)rc);
+            while(MsgFrame_Next(&pConn->Reasm, &hdr, &pPayload) > 0){
+                pConn->Handler(pPayload, hdr.Len);
+            }
+        }else if((rc < 0) && (errno == EINTR)){
+            continue;
+        }else if((rc < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK))){
+            break;
+        }else{
+            printf("component (%d) closed its connection\n", pConn->Info.Component);
+            epoll_ctl(EvEpollFd, EPOLL_CTL_DEL, pConn->Info.Fd, NULL);
+            pConn->Open = false;
+            break;
+        }
+    }
+}
+
+/**************************************************************************************/
+/*! \fn static void EvDrainRing(evloop_conn_t * pConn)
+ *
+ *  \par Description:
+ *		Executes the callback of the connection for every message in its ring, RxMsgSz()
+ *		arms the next wakeup once the ring is empty.
+ **************************************************************************************/
+static void EvDrainRing(evloop_conn_t * pConn){
+
+    uint16_t rxSz;
+
+    if(GetMsgTransport(pConn->Info.Fd) != MSG_TRANSPORT_RING){
+        return;
+    }
+    memset(&pConn->Buf[0], 0, sizeof(pConn->Buf));
+    while(RxMsgSz(pConn->Info.Fd, &pConn->Buf[0], UINT8_MAX, &rxSz) == 0){
+        pConn->Handler(&pConn->Buf[0], rxSz);
+        memset(&pConn->Buf[0], 0, sizeof(pConn->Buf));
+    }
+}
+
+/**************************************************************************************/
+/*! \fn static void EvClose(void)
+ *
+ *  \par Description:
+ *		Closes the wakeup pipe and the epoll instance of a failed MsgEvLoop_Start().
+ **************************************************************************************/
+static void EvClose(void){
+
+    int i;
+
+    if(EvEpollFd >= 0){
+        close(EvEpollFd);
+        EvEpollFd = -1;
+    }
+    for(i = 0; i < 2; i++){
+        if(EvWakeupPipe[i] >= 0){
+            close(EvWakeupPipe[i]);
+            EvWakeupPipe[i] = -1;
+        }
+    }
+}
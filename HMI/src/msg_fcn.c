@@ -35,6 +35,7 @@
 #include "msg_buf.h"
 #include "msg_api_signals.h"
 #include "msg_def.h"
+#include "msg_fcn.h"
 
 #include "pool_def.h"
 
@@ -79,37 +80,103 @@
 int32_t TxBufMsg(	uint8_t component, 	int socket_fd,	uint16_t id, 
 					pid_t tid,			uint8_t * data,	uint32_t size)
 {
-    
+    component_info_t dest;
+
+    dest.Component = component;
+    dest.Tid = tid;
+    dest.Fd = socket_fd;
+    return TxBufMsgFanout(component, &dest, 1, id, data, size);
+}
+
+/**************************************************************************************/
+/*! \fn TxBufMsgFanout(uint8_t component, const component_info_t dest[], uint8_t numDest, uint16_t id, uint8_t * data, uint32_t size)
+ *
+ *  \param[in] component- the "component" id of the calling process
+ *	\param[in] dest		- the connections (socket fd and tid) of the destinations
+ *	\param[in] numDest	- number of entries in dest
+ *	\param[in] id 		- the id of the message
+ *	\param[in] data		- pointer to the message
+ *	\param[in] size		- number of bytes in the message
+ *
+ *  \par Description:	  
+ *   Sends the same message to several destinations.  The payload is copied once in
+ *   a buffer of the task's pool, with headroom for the message id, and sent with
+ *   TxMsgBufFanout().
+ *
+ *  \returns 0 of no errors else non-zero if error
+ *
+ *  \par Limitations/Caveats:
+ *	 A transfer error to a destination does not stop the transfer to the next ones.
+ *
+ *	\ingroup msgfcns_public
+ **************************************************************************************/
+int32_t TxBufMsgFanout(	uint8_t component, 	const component_info_t dest[],	uint8_t numDest,
+						uint16_t id,		uint8_t * data,	uint32_t size)
+{
+    MsgBufType msg;
+
+    if((MSG_ID_SZ + size) > UINT8_MAX){
+    	return -1;
+    }
+    if(Msg_GetMsgBuf(&msg, MSG_ID_SZ, size, component) != GP_SUCCESS){
+    	return -1;
+    }
+    memcpy(msg.pData, &data[0], size);	// Copy the message payload
+    return TxMsgBufFanout(component, dest, numDest, id, &msg);
+}
+
+/**************************************************************************************/
+/*! \fn TxMsgBufFanout(uint8_t component, const component_info_t dest[], uint8_t numDest, uint16_t id, MsgBufType * pMsg)
+ *
+ *  \param[in] component- the "component" id of the calling process
+ *	\param[in] dest		- the connections (socket fd and tid) of the destinations
+ *	\param[in] numDest	- number of entries in dest
+ *	\param[in] id 		- the id of the message
+ *	\param[in] pMsg		- the payload, composed in place with MSG_ID_SZ bytes of headroom
+ *
+ *  \par Description:	  
+ *   Writes the message id in the headroom in front of the payload and sends the 
+ *   message to several destinations.  The message is built once, without copying the
+ *   payload, and TxMsg() copies it to the socket or ring of every destination, so the
+ *   buffer is released once the last transfer returns.
+ *
+ *  \returns 0 of no errors else non-zero if error
+ *
+ *  \par Limitations/Caveats:
+ *	 The buffer of pMsg is released in every case.  A transfer error to a destination
+ *	 does not stop the transfer to the next ones.
+ *
+ *	\ingroup msgfcns_public
+ **************************************************************************************/
+int32_t TxMsgBufFanout(	uint8_t component, 	const component_info_t dest[],	uint8_t numDest,
+						uint16_t id,		MsgBufType * pMsg)
+{
     gp_retcode_t rc;
     Boolean cb = true;
-    uint32_t * pBufId = (uint32_t *)malloc(sizeof(uint32_t));
-    int offset;
-    uint8_t * pMsg;
+    int32_t ret = 0;
+    uint8_t * pHdr;
+    uint8_t i;
 
-    pMsg = Msg_GetBuf(size, pBufId, component);
-    if(pMsg == NULL){
+    /* Store the IPC message ID in front of the payload */
+    pHdr = Msg_PushHdr(pMsg, MSG_ID_SZ);
+    if((pHdr == NULL) || (pMsg->DataSz > UINT8_MAX)){
+		Msg_FreeMsgBuf(pMsg);
     	return -1;
     }
+    gp_Store16bit(id, pHdr);
 
-    /* Compose requested message into the buffer */
-    offset = gp_Store16bit(id, pMsg);		// Store the IPC message ID
-    if(pMsg != NULL) 
+    /* Send the message to every destination, TxMsg() copies it */
+    for(i = 0; i < numDest; i++)
     {
-		memcpy((pMsg+offset), &data[0], size);	// Copy the message payload
-    }
+		rc = TxMsg(dest[i].Fd, dest[i].Tid, component, pMsg->pData, pMsg->DataSz, cb);
 
-    /* Send the message */
-    rc = TxMsg(socket_fd, tid, component, pMsg, size, cb);
-
-    /* Return error if any transfer error ocurred */
-    if(rc != GP_SUCCESS) 
-    {
-		Msg_FreeBuf(size,*pBufId, component);
-		free(pBufId);
-		return -2;		// Tx failure
+		/* Return error if any transfer error ocurred */
+		if(rc != GP_SUCCESS) 
+		{
+			ret = -2;		// Tx failure
+		}
     }
-    Msg_FreeBuf(size,*pBufId, component);
-    free(pBufId);
-    return 0;			// Success
+    Msg_FreeMsgBuf(pMsg);
+    return ret;
 }
 
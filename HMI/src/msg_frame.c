@@ -0,0 +1,212 @@
+/**************************************************************************************/
+/*!
+ *  \file		msg_frame.c
+ *
+ *  \brief		Framing and stream reassembly of the messages sent on the socket
+ *				transport of TxMsg()/RxMsg().
+ *
+ ***************************************************************************************
+ * \page sw_component_overview Software Component Overview page
+ *	Every message written to a connection socket is preceded by a header holding the
+ *	payload length, the IPC message id and a per connection sequence number.  The
+ *	receiver reads as many bytes as are available into the reassembler of the
+ *	connection and pulls every complete frame out of it, so one read() can deliver
+ *	many messages and a message split across reads is only delivered once whole.
+ */
+/***************************************************************************************/
+#define MSG_FRAME_C		/*!< File label definition */
+
+/***********************************
+		   INCLUDE FILES
+***********************************/
+#include <string.h>
+#include <stdio.h>
+
+#include "gp_cfg.h"         // Common GP program configuration settings
+#include "gp_types.h"       // Common GP program data type definitions
+#include "gp_utils.h"       // Common GP program utility functions
+
+#include "msg_def.h"
+#include "msg_frame.h"
+
+/***********************************
+	Private Macros and Typedefs
+***********************************/
+
+/***********************************
+	Private Data and Structures
+***********************************/
+
+/***********************************
+	Private Function Prototypes
+***********************************/
+
+
+/************ Start of code ******************/
+
+/**************************************************************************************/
+/*! \fn uint8_t MsgFrame_PutHdr(uint8_t * pBuf, const uint8_t * data, uint16_t dataSz, uint32_t seq)
+ *
+ *  param[in]
+ *		-data:		the payload of the frame
+ *		-dataSz:	the size in bytes of the payload
+ *		-seq:		the sequence number of the frame
+ *  param[out]
+ *		-pBuf:		storage for the encoded header
+ *
+ *  \par Description:
+ *		Encodes the header of a frame.  The msg id is taken from the first MSG_ID_SZ
+ *		bytes of the payload, as stored by TxBufMsg().
+ *
+ *  \retval
+ *		The size in bytes of the encoded header
+ **************************************************************************************/
+uint8_t MsgFrame_PutHdr(uint8_t * pBuf, const uint8_t * data, uint16_t dataSz, uint32_t seq){
+
+    uint16_t msgId = MsgIdInvalid;
+    int offset;
+
+    if(dataSz >= MSG_ID_SZ){
+        gp_Read16bit(&msgId, (uint8_t *)data);
+    }
+    offset = gp_Store16bit(dataSz, &pBuf[0]);
+    offset += gp_Store16bit(msgId, &pBuf[offset]);
+    offset += gp_Store32bit(seq, &pBuf[offset]);
+    return (uint8_t)offset;
+}
+
+/**************************************************************************************/
+/*! \fn uint8_t MsgFrame_GetHdr(msg_frame_hdr_t * pHdr, uint8_t * pBuf)
+ *
+ *  param[in]
+ *		-pBuf:		an encoded header
+ *  param[out]
+ *		-pHdr:		the decoded header
+ *
+ *  \par Description:
+ *		Decodes the header of a frame.
+ *
+ *  \retval
+ *		The size in bytes of the encoded header
+ **************************************************************************************/
+uint8_t MsgFrame_GetHdr(msg_frame_hdr_t * pHdr, uint8_t * pBuf){
+
+    int offset;
+
+    offset = gp_Read16bit(&pHdr->Len, &pBuf[0]);
+    offset += gp_Read16bit(&pHdr->MsgId, &pBuf[offset]);
+    offset += gp_Read32bit(&pHdr->Seq, &pBuf[offset]);
+    return (uint8_t)offset;
+}
+
+/**************************************************************************************/
+/*! \fn void MsgFrame_InitReasm(msg_frame_reasm_t * pReasm)
+ *
+ *  param[in]
+ *		-pReasm:	the reassembler
+ *
+ *  \par Description:
+ *		Discards any received byte, the next frame received restarts the sequence.
+ *
+ *  \retval
+ *		None.
+ **************************************************************************************/
+void MsgFrame_InitReasm(msg_frame_reasm_t * pReasm){
+
+    pReasm->Start = 0;
+    pReasm->End = 0;
+    pReasm->NextSeq = 0;
+    pReasm->SeqValid = false;
+}
+
+/**************************************************************************************/
+/*! \fn uint8_t * MsgFrame_RxSpace(msg_frame_reasm_t * pReasm, uint16_t * pSpace)
+ *
+ *  param[in]
+ *		-pReasm:	the reassembler
+ *  param[out]
+ *		-pSpace:	the number of bytes that can be stored
+ *
+ *  \par Description:
+ *		Moves the bytes of a partially received frame to the start of the buffer,
+ *		which invalidates the payloads returned by MsgFrame_Next(), and returns the
+ *		free space after them.
+ *
+ *  \retval
+ *		Pointer to the free space of the buffer
+ **************************************************************************************/
+uint8_t * MsgFrame_RxSpace(msg_frame_reasm_t * pReasm, uint16_t * pSpace){
+
+    if(pReasm->Start != 0){
+        memmove(&pReasm->Buf[0], &pReasm->Buf[pReasm->Start], pReasm->End - pReasm->Start);
+        pReasm->End -= pReasm->Start;
+        pReasm->Start = 0;
+    }
+    *pSpace = MSG_FRAME_REASM_SZ - pReasm->End;
+    return &pReasm->Buf[pReasm->End];
+}
+
+/**************************************************************************************/
+/*! \fn void MsgFrame_RxCommit(msg_frame_reasm_t * pReasm, uint16_t count)
+ *
+ *  param[in]
+ *		-pReasm:	the reassembler
+ *		-count:		the number of bytes stored after MsgFrame_RxSpace()
+ *
+ *  \par Description:
+ *		Makes the stored bytes available to MsgFrame_Next().
+ *
+ *  \retval
+ *		None.
+ **************************************************************************************/
+void MsgFrame_RxCommit(msg_frame_reasm_t * pReasm, uint16_t count){
+
+    pReasm->End += count;
+}
+
+/**************************************************************************************/
+/*! \fn int8_t MsgFrame_Next(msg_frame_reasm_t * pReasm, msg_frame_hdr_t * pHdr, uint8_t ** ppPayload)
+ *
+ *  param[in]
+ *		-pReasm:	the reassembler
+ *  param[out]
+ *		-pHdr:		the header of the frame
+ *		-ppPayload:	the payload of the frame, left in the reassembly buffer
+ *
+ *  \par Description:
+ *		Returns the oldest complete frame and consumes it.  A sequence number other
+ *		than the expected one is counted and reported, the frame is still returned.
+ *
+ *  \retval
+ *		1 if a frame was returned, 0 if more data is needed, -1 if the length of the
+ *		frame can't fit in the buffer (the stream can't be resynchronized, so the
+ *		reassembler is emptied)
+ **************************************************************************************/
+int8_t MsgFrame_Next(msg_frame_reasm_t * pReasm, msg_frame_hdr_t * pHdr, uint8_t ** ppPayload){
+
+    uint16_t avail = pReasm->End - pReasm->Start;
+
+    if(avail < MSG_FRAME_HDR_SZ){
+        return 0;
+    }
+    MsgFrame_GetHdr(pHdr, &pReasm->Buf[pReasm->Start]);
+    if(pHdr->Len > MSG_FRAME_MAX_PAYLOAD){
+        printf("MsgFrame_Next(): invalid frame length %d\n", pHdr->Len);
+        MsgFrame_InitReasm(pReasm);
+        return -1;
+    }
+    if(avail < (MSG_FRAME_HDR_SZ + pHdr->Len)){
+        return 0;
+    }
+
+    if(pReasm->SeqValid && (pHdr->Seq != pReasm->NextSeq)){
+        pReasm->SeqErrors++;
+        printf("MsgFrame_Next(): frame %u received, %u expected\n", pHdr->Seq, pReasm->NextSeq);
+    }
+    pReasm->NextSeq = pHdr->Seq + 1;
+    pReasm->SeqValid = true;
+
+    *ppPayload = &pReasm->Buf[pReasm->Start + MSG_FRAME_HDR_SZ];
+    pReasm->Start += MSG_FRAME_HDR_SZ + pHdr->Len;
+    return 1;
+}
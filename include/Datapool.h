@@ -23,6 +23,9 @@
 /***********************************
 	  Public Macros and Typedefs
 ***********************************/
+/*! Datapool change callback, see SetPoolChangeHook().  p_dirty is the bitmap of the changed 
+	items (::DP_DIRTY_WORDS words) and ver the datapool version after the change. */
+typedef void (*DP_CHANGE_HOOK_T)(const uint32_t p_dirty[], uint32_t ver);
 
 /***********************************
 	        Public Config Macros
@@ -38,6 +41,12 @@
 /* Initialize datapool items to default values */
 gp_retcode_t InitPool(void);
 
+/* Create the shared-memory datapool and initialize its items to default values */
+gp_retcode_t InitPoolShared(const char shm_name[]);
+
+/* Map the shared-memory datapool of the owner process read only */
+gp_retcode_t AttachPoolShared(const char shm_name[]);
+
 /* Return the type and data length of the requested datapool item. */
 gp_retcode_t GetElemInfo(int id, GP_DATATYPES_T *p_type, int *p_len);
 
@@ -47,12 +56,54 @@ gp_retcode_t SetElem(int id, void *p_value);
 /* Retrieve the data from a datapool item */
 gp_retcode_t GetElem(int id, void *p_value);
 
+/* Set the data of several datapool items under a single lock */
+gp_retcode_t SetElems(int num, const int p_ids[], void *p_values[]);
+
+/* Retrieve a consistent snapshot of several datapool items */
+gp_retcode_t GetElems(int num, const int p_ids[], void *p_values[]);
+
 /* Copy the datapool storage to the datapool image pointed to by p_data */
 gp_retcode_t SetPool(DP_ITEM_STORAGE_T *p_data);
 
 /* Copy the datapool image to the storage pointed to by p_data */
 gp_retcode_t GetPool(DP_ITEM_STORAGE_T *p_data);
 
+/* Return the bitmap of the datapool items changed since a datapool version */
+gp_retcode_t GetPoolDirty(uint32_t since_ver, uint32_t p_dirty[], uint32_t *p_ver);
+
+/* Build the delta image of the datapool items changed since a datapool version */
+gp_retcode_t GetPoolDelta(uint32_t since_ver, const uint32_t p_mask[], uint8_t *p_buf, int bufsz, int *p_len);
+
+/* Store the items of a delta image built by GetPoolDelta() into the datapool */
+gp_retcode_t SetPoolDelta(uint8_t *p_buf, int bufsz, uint32_t *p_ver);
+
+/* Register the callback executed after datapool items changed */
+gp_retcode_t SetPoolChangeHook(DP_CHANGE_HOOK_T p_hook);
+
+/* Mark datapool items stale or valid again */
+gp_retcode_t SetPoolStale(const uint32_t p_mask[], bool stale);
+
+/* Return the bitmap of the stale datapool items */
+gp_retcode_t GetPoolStale(uint32_t p_stale[]);
+
+/* Encode the value of a datapool item in the IPC message format */
+gp_retcode_t EncodeElem(int id, const void *p_value, uint8_t *p_buf, int bufsz, int *p_len);
+
+/* Decode the value of a datapool item from the IPC message format */
+gp_retcode_t DecodeElem(int id, const uint8_t *p_buf, int bufsz, void *p_value, int *p_len);
+
+/* Check a CAN signal against its datapool item and return how its data is stored */
+gp_retcode_t GetCanSigStore(int id, int bits, DP_CANSIG_STORE_T *p_store);
+
+/* Store the raw data of a CAN signal as the value of its datapool item */
+void StoreCanSig(const DP_CANSIG_STORE_T *p_store, uint32_t raw, void *p_value);
+
+/* Set the CAN signal to datapool item map of a CAN channel */
+gp_retcode_t SetCanSigMap(int chan, int num, const DP_CANSIG_MAP_T p_map[]);
+
+/* Set the datapool items of all the signals of a VP CAN signal data message at once */
+gp_retcode_t SetCanSigElems(int chan, const uint8_t *p_buf, int bufsz, int *p_num);
+
 /************* Legacy functions *****************/
 /* 	  These will eventually be eliminated 		*/
 /************************************************/
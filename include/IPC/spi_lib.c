@@ -41,6 +41,19 @@
 #include "spi_lib.h"
 #include "spi_callbacks.h"
 
+/*
+** SL_CRC_HAVE_CLMUL - defined when the carry-less multiply CRC engine is built.  
+** It is only used if the CPU supports PCLMULQDQ (checked by SL_SetCrcEngine).
+*/
+#if (defined(__GNUC__) && defined(__x86_64__))
+   #define SL_CRC_HAVE_CLMUL
+   #include <wmmintrin.h>
+#endif
+
+#ifdef SL_TEST
+   #include <time.h>
+#endif
+
 /******************************************************************************/
 /*     C O N F I G U R A T I O N   P A R A M A T E R  C H E C K S             */
 /******************************************************************************/
@@ -157,7 +170,8 @@
  is clamped at 0xFFFFFF5A (prevents overflow and is an unlikely value 
  in a corruption scenario).
 */
-#define INCREMENT_STAT(stat)  (stat = ((stat<STAT_CLAMP_VAL) ? ++stat : stat))
+#define INCREMENT_STAT(stat)  do { if ((stat) < STAT_CLAMP_VAL) ++(stat); } while (0)
+#define ADD_STAT(stat, n)     (stat = ((stat<(STAT_CLAMP_VAL-(n))) ? (stat+(n)) : STAT_CLAMP_VAL))
 
 /*
 ** MESSAGE TYPE ID's
@@ -173,67 +187,96 @@
 */
 #define LAST_MSG_DISPATCH_TABLE_ID (sizeof(msg_dispatch_table)/sizeof(MsgHandler)-2)
 
+/*
+** States of the one-time initializations crc_tables_state and crc_engine_state
+*/
+#define CRC_INIT_EMPTY  0     /* not done yet */
+#define CRC_INIT_BUSY   1     /* being done by one thread */
+#define CRC_INIT_READY  2     /* done */
+
+/*
+** States of dispatch_table_state
+*/
+#define DISPATCH_TABLE_EMPTY  0     /* msg_dispatch_table not registered yet */
+#define DISPATCH_TABLE_BUSY   1     /* being registered by one thread */
+#define DISPATCH_TABLE_READY  2     /* registered */
+
 /*
 ** STATUS MESSAGE ID's 
 **    ID_COMM_RESET_MSG - ID of the communications reset status message
 **    ID_PROTOCOL_VERSION_MSG  - ID of the protocol vesion status message
 **    ID_TPL_TX_ABT_MSG - ID of the transport layer Tx abort messsage
+**    ID_LINK_ACK_MSG - ID of the selective repeat acknowledgement message
 **
 **    LEN_COMM_RESET_MSG - length, in bytes, of the COMM RESET msg
 **    LEN_PROTOCOL_VERSION_MSG - length, in bytes, of the COMM RESET msg
 **    LEN_TPL_TX_ABT_MSG - length, in bytes, of the COMM RESET msg
+**    LEN_PROTOCOL_VERSION_WIN_MSG - length, in bytes, of the PROTOCOL VERSION msg 
+**       advertising a window (the window size follows the version)
+**    LEN_LINK_ACK_MSG - length, in bytes, of the LINK ACK msg
 **    
-*  NOTE: The values of these messages are dictated by the SPI Protocol Specification
+*  NOTE: The values of these messages are dictated by the SPI Protocol Specification,
+*  except the LINK ACK msg and the window of the PROTOCOL VERSION msg which are only
+*  sent to a node which advertised a window (see SL_EnableWindow).
 */
 #define ID_COMM_RESET_MSG        (1)
 #define ID_PROTOCOL_VERSION_MSG  (2)
 #define ID_TPL_TX_ABT_MSG        (3)
+#define ID_LINK_ACK_MSG          (4)
 #define LEN_COMM_RESET_MSG       (5)
 #define LEN_PROTOCOL_VERSION_MSG (2)
 #define LEN_TPL_TX_ABT_MSG       (5)
+#define LEN_PROTOCOL_VERSION_WIN_MSG (3)
+#define LEN_LINK_ACK_MSG         (5)
 
-#define YZ_SPI_TPL_MAX_SIM_TFRS   (2)
+/*
+** LINK ACK message.  In selective repeat mode it is the first message of every packet,
+** LINK_ACK_OFFSET is the offset of its data in the packet.
+**    LINK_ACK_SN - next SN expected, every packet before it has been Rx'd.
+**    LINK_ACK_MAP - bit i set when packet LINK_ACK_SN+1+i has been Rx'd.
+**    LINK_ACK_WINDOW - window of the node (it also advertises the window, a PROTOCOL 
+**       VERSION msg Tx'd after a COMM RESET may be lost), LINK_ACK_FLAG_TX set when 
+**       the packet is Tx'd in selective repeat mode.
+*/
+#define LINK_ACK_OFFSET       (PKT_HDR_BYTES + (MSG_HDR_BYTES * 2))
+#define LINK_ACK_SN_LSB       (0)
+#define LINK_ACK_SN_MSB       (1)
+#define LINK_ACK_MAP_LSB      (2)
+#define LINK_ACK_MAP_MSB      (3)
+#define LINK_ACK_WINDOW       (4)
+#define LINK_ACK_WINDOW_MASK  (0x7F)
+#define LINK_ACK_FLAG_TX      (0x80)
 
-/******************************************************************************/
-/*     T Y P E S   A N D   E N U M E R A T I O N S                            */
-/******************************************************************************/
+/*
+** Window Tx buffer states.
+**    WIN_FREE - not in use.
+**    WIN_SENT - Tx'd, waiting for an acknowledgement.
+**    WIN_ACKED - Rx'd by the other node ahead of a missing packet.
+**    WIN_LOST - not Rx'd by the other node, to be retransmitted.
+*/
+#define WIN_FREE   (0)
+#define WIN_SENT   (1)
+#define WIN_ACKED  (2)
+#define WIN_LOST   (3)
 
 /*
- * Typedef: tx_info 
- *
- * 	Record holding Tx related information 
- */
-typedef struct TX_INFO
-{
-	int min_msg_id;      /* Min msg_id that can be Tx'd */ 
-	int max_msg_id;      /* Max msg_id that can be Tx'd */
-	int next_sn;         /* Sequence number to Tx in next packet */
-	int next_nack;       /* NACK value to Tx in next packet */ 
-    int msg_count;       /* Number of messages loaded in packet */
-    int load_index;      /* Index to next byte to load in packet buffer */
-    int go_back;         /* Maintains what packet to Tx in "go back" scenarios */ 
-    U16 last_sn_txd;     /* The SN sent in the last packet Tx'd */ 
-    U8 *oldest_pkt_ptr;  /* Pointer to oldest packet (next to overwrite when a new packet loaded for Tx) */
-    U8 *newest_pkt_ptr;  /* Pointer to newest packet */ 
-    U8 *pkt_ptr;         /* Pointer to packet to load next */
-    U8 comm_reset_flag;  /* a non-0 value indicates Tx of a COMM RESET status message has been requested */ 
-    U8 comm_reset_reason; /* indicates reason for Txing COMM RESET message */
-} TX_INFO;
+** Macros for the selective repeat window of a context.
+*/
+#define WIN_NEGOTIATED(ctx)    (((ctx)->win.size != 0) && ((ctx)->win.peer_size != 0))
+#define WIN_USED(ctx)          (((ctx)->win.size < (ctx)->win.peer_size) ? (ctx)->win.size : (ctx)->win.peer_size)
+#define WIN_TX_BUFFER(ctx, n)  (&(ctx)->win.tx_buffers[ (n) * YZ_SPI_PKT_SIZE ])
+#define WIN_RX_BUFFER(ctx, n)  (&(ctx)->win.rx_buffers[ (n) * YZ_SPI_PKT_SIZE ])
 
 /*
- * Typedef: rx_info 
- *
- * 	Record holding Rx related information 
- */
-typedef struct RX_INFO
-{
-	int min_msg_id;      /* Min msg_id that can be Rx'd */
-	int max_msg_id;      /* Max msg_id that can be Rx'd */
-	int next_sn;         /* Sequence number expected in next Rx packet */
-    int msgs_left;       /* Number of messages left to unload from Rx packet*/
-    U8 *pkt_ptr;         /* Pointer to start of Rx packet */
-    int unload_index;    /* Index to next byte to unload from Rx packet */
-} RX_INFO;
+** CRC_POLY_FULL - the CRC polynomial including its x^16 term, see CalculateCrcBitwise.
+** CRC_ZERO_VAL - value sent instead of a CRC of 0, so a packet of all 0's is never valid.
+*/
+#define CRC_POLY_FULL  (0x11021)
+#define CRC_ZERO_VAL   ((U16)0x5aa5)
+
+/******************************************************************************/
+/*     T Y P E S   A N D   E N U M E R A T I O N S                            */
+/******************************************************************************/
 
 /*
 ** Typedef: API_STATE
@@ -259,7 +302,28 @@ typedef enum API_STATE
 ** 
 **  Defines a type for Rx message handlers.
 */
-typedef void (*MsgHandler)(int, U8 * const);
+typedef SL_MSG_HANDLER MsgHandler;
+
+/*
+** Typedef: DISPATCH_ENTRY
+**
+**  The Rx message handlers of one msg id, in the order they are called, and the
+**  number of messages dispatched to them.  The entries are indexed by msg id so
+**  a message is dispatched without any search.
+*/
+typedef struct DISPATCH_ENTRY
+{
+   U32         dispatch_cnt;    /* messages dispatched */
+   int         num_handlers;    /* handlers in use */
+   MsgHandler  handler[ SL_MAX_MSG_HANDLERS ];
+} DISPATCH_ENTRY;
+
+/*
+** Typedef: CrcFunction
+** 
+**  Defines a type for the CRC engines, see SL_SetCrcEngine.
+*/
+typedef U16 (*CrcFunction)(U8 *, int);
 
 
 /******************************************************************************/
@@ -267,24 +331,50 @@ typedef void (*MsgHandler)(int, U8 * const);
 /******************************************************************************/
 static int ComputeNextSN(int current_sn);
 static U16 CalculateCrc(U8 * pBuf, int length);
-static void SL_VPSpecificInit(void);
-static void SL_GPSpecificInit(void);
-static int UnloadStatusMsg(int *msg_id, int *msg_size_bytes, U8 **buff_ptr);
-static void LoadPacketStatusMsg(int status_msg_id, int status_msg_size_bytes, U8 *msg_data, int *bytes_left);
-static void SendCommResetMsg(void);
+static U16 CalculateCrcBitwise(U8 * pBuf, int length);
+static U16 CalculateCrcSlice4(U8 * pBuf, int length);
+static U16 CalculateCrcSlice8(U8 * pBuf, int length);
+static void CrcInitTables(void);
+static void CrcInitEngine(void);
+static void DispatchInitTable(void);
+static int DispatchAddHandler(DISPATCH_ENTRY *entry, MsgHandler handler);
+#ifdef SL_CRC_HAVE_CLMUL
+   static U16 CalculateCrcClmul(U8 * pBuf, int length);
+#endif
+static void SL_VPSpecificInit(SL_CONTEXT *ctx);
+static void SL_GPSpecificInit(SL_CONTEXT *ctx);
+static int UnloadStatusMsg(SL_CONTEXT *ctx, int *msg_id, int *msg_size_bytes, U8 **buff_ptr);
+static void LoadPacketStatusMsg(SL_CONTEXT *ctx, int status_msg_id, int status_msg_size_bytes, U8 *msg_data, int *bytes_left);
+static void SendCommResetMsg(SL_CONTEXT *ctx);
+static void SendProtocolVersionMsg(SL_CONTEXT *ctx);
+static int PackPickMsg(SL_PACK_QUEUE *queue, int space, int *prev_node);
+static void PackRemoveMsg(SL_PACK_QUEUE *queue, int node, int prev_node);
+static int SnDistance(int from_sn, int to_sn);
+static int WinFindAck(U8 *packet_ptr);
+static void WinLoadAck(SL_CONTEXT *ctx, U8 *ack);
+static void WinRxAck(SL_CONTEXT *ctx, U8 *ack);
+static void WinTxStart(SL_CONTEXT *ctx, int ack_sn);
+static void WinTxStop(SL_CONTEXT *ctx);
+static void WinTxAck(SL_CONTEXT *ctx, int ack_sn, int ack_map);
+static void WinTxPick(SL_CONTEXT *ctx);
+static void WinTxRetransmit(SL_CONTEXT *ctx, int slot);
+static void WinTxSent(SL_CONTEXT *ctx);
+static int WinTxSlot(SL_CONTEXT *ctx, int sn);
+static void WinPeerReset(SL_CONTEXT *ctx);
+static int WinRxNext(SL_CONTEXT *ctx);
 
 #if (YZ_SPI_TPL_ENABLE != 0)
-   static void UnloadTPLMsg(int msg_length);
-   static int  LoadOneTPLMsg(int msg_id, int msg_size_bytes, U8 *msg_data, int bytes_remaining, int seg_number);
-   static void LoadTPLMsgs(void);
-   static void LoadTPLMsgsFill(unsigned int fill_packet);
-   static void TPLClearUnload(void);
-   static void TPLCheckUnload(void);
-   static void TPLInit(void);
-   static void TPLAbortTxMsgs(void);
-   static void TPLAbortRxMsgs(void);
-   static void TPLIncomingTxAbort(int msg_id, U8 error_code);
-   static int FindRxTableRec(int msg_id);
+   static void UnloadTPLMsg(SL_CONTEXT *ctx, int msg_length);
+   static int  LoadOneTPLMsg(SL_CONTEXT *ctx, int msg_id, int msg_size_bytes, U8 *msg_data, int bytes_remaining, int seg_number);
+   static void LoadTPLMsgs(SL_CONTEXT *ctx);
+   static void LoadTPLMsgsFill(SL_CONTEXT *ctx, unsigned int fill_packet);
+   static void TPLClearUnload(SL_CONTEXT *ctx);
+   static void TPLCheckUnload(SL_CONTEXT *ctx);
+   static void TPLInit(SL_CONTEXT *ctx);
+   static void TPLAbortTxMsgs(SL_CONTEXT *ctx);
+   static void TPLAbortRxMsgs(SL_CONTEXT *ctx);
+   static void TPLIncomingTxAbort(SL_CONTEXT *ctx, int msg_id, U8 error_code);
+   static int FindRxTableRec(SL_CONTEXT *ctx, int msg_id);
 #endif
 
 /******************************************************************************/
@@ -292,28 +382,17 @@ static void SendCommResetMsg(void);
 /******************************************************************************/
 
 /*
-** Variable: api_state
-** Maintains the API state used to determine which API's may be called.
-*/
-static int api_state = WAIT_INIT;
-
-/*
-** Variable: tx_info
-**   A structure containing information used for loading and transmitting packets.
-*/
-static TX_INFO  tx_info;
-
-/*
-** Variable: rx_info
-**   A structure containing information used packet receiving and unloading packets.
+** Variable: sl_default_ctx
+**   The state of the link driven by the SL_ functions without a context parameter.
 */
-static RX_INFO  rx_info;
+static SL_CONTEXT sl_default_ctx;
 
 /*
-** Variable: stats
-**   A structure containing statistics information.
+** Variable: sl_ctx
+**   The context used by the SL_ functions without a context parameter, the default
+**   context (or, in SL_TEST builds, the context of the node in focus).
 */
-static SL_STATS_RECORD stats;
+static SL_CONTEXT *sl_ctx = &sl_default_ctx;
 
 /*
 ** Constant: msg_dispatch_table
@@ -327,6 +406,50 @@ static const MsgHandler msg_dispatch_table[] =
    NULL
 };
 
+/*
+** Variable: dispatch_table, dispatch_table_state
+**   The handlers called by SL_DispatchMsg for each msg id.  The handler of 
+**   msg_dispatch_table is registered first for each id, once, by the first of
+**   SL_CtxInitialize or the handler functions (see DispatchInitTable).
+*/
+static DISPATCH_ENTRY dispatch_table[ SL_MSG_ID_SLOTS ];
+static int dispatch_table_state = DISPATCH_TABLE_EMPTY;
+
+/*
+** Variable: crc_engine_req, crc_engine, crc_function, crc_engine_state
+**   The CRC engine requested with SL_SetCrcEngine, the engine in use and its
+**   function.  The bitwise engine needs no tables so it is used until the
+**   first SL_CtxInitialize selects the requested engine, once (see CrcInitEngine).
+**   crc_function is published with release order after the tables it uses.
+*/
+static int crc_engine_req = SL_CRC_ENGINE_AUTO;
+static int crc_engine = SL_CRC_ENGINE_BITWISE;
+static CrcFunction crc_function = CalculateCrcBitwise;
+static int crc_engine_state = CRC_INIT_EMPTY;
+
+/*
+** Variable: crc_table, crc_low4, crc_low8
+**   Tables of the slice-by-4 and slice-by-8 CRC engines, built by CrcInitTables.
+**   crc_table[n-1][b] is the remainder after n bytes starting with byte b (the 
+**   bytes that follow being 0).  crc_low4[l] and crc_low8[l] are the remainders
+**   after 4 and 8 bytes of 0 starting from the remainder l.  crc_tables_state
+**   makes CrcInitTables build them once, whatever the number of threads.
+*/
+static U16 crc_table[8][256];
+static U16 crc_low4[256];
+static U16 crc_low8[256];
+static int crc_tables_state = CRC_INIT_EMPTY;
+
+#ifdef SL_CRC_HAVE_CLMUL
+/*
+** Variable: crc_clmul_k56, crc_clmul_k88, crc_clmul_mu
+**   Constants of the carry-less multiply CRC engine, x^56 mod P, x^88 mod P and x^64 / P.
+*/
+static unsigned long long crc_clmul_k56;
+static unsigned long long crc_clmul_k88;
+static unsigned long long crc_clmul_mu;
+#endif
+
 
 /******************************************************************************/
 /*     F U N C T I O N   D E F I N I T I O N S                                */
@@ -337,8 +460,9 @@ static const MsgHandler msg_dispatch_table[] =
 */
 
 /**************************************************************************************/
-/*! \fn SL_Initialize(U8 *buffer1_ptr, U8 *buffer2_ptr, U8 reason_for_init)
+/*! \fn SL_CtxInitialize(SL_CONTEXT *ctx, U8 *buffer1_ptr, U8 *buffer2_ptr, U8 reason_for_init)
  *
+ *  \param[in] ctx - the context of the link.
  *  \param[in] buffer1_ptr  - pointer to the first buffer being released
  *  \param[in] buffer2_ptr  - pointer to the second buffer being released
  *  \param[in] reason_for_init - reason why this function was called.  Constants that 
@@ -361,41 +485,60 @@ static const MsgHandler msg_dispatch_table[] =
  *
  *  \ingroup spi_public
  **************************************************************************************/
-void SL_Initialize(U8 *buffer1_ptr, U8 *buffer2_ptr, U8 reason_for_init)
+void SL_CtxInitialize(SL_CONTEXT *ctx, U8 *buffer1_ptr, U8 *buffer2_ptr, U8 reason_for_init)
 {
-   api_state = WAIT_GET_TX_PKT;
-
-   tx_info.next_sn = 0x1; 
-   tx_info.next_nack = 0x00;    
-   tx_info.pkt_ptr = NULL;
-   tx_info.go_back = 0;
-   tx_info.newest_pkt_ptr = buffer1_ptr;
-   tx_info.oldest_pkt_ptr = buffer2_ptr;
-   tx_info.comm_reset_flag = 1;
-   tx_info.comm_reset_reason = reason_for_init;
+   DispatchInitTable();
+   ctx->api_state = WAIT_GET_TX_PKT;
+
+   ctx->tx_info.next_sn = 0x1; 
+   ctx->tx_info.next_nack = 0x00;    
+   ctx->tx_info.pkt_ptr = NULL;
+   ctx->tx_info.go_back = 0;
+   ctx->tx_info.newest_pkt_ptr = buffer1_ptr;
+   ctx->tx_info.oldest_pkt_ptr = buffer2_ptr;
+   ctx->tx_info.comm_reset_flag = 1;
+   ctx->tx_info.comm_reset_reason = reason_for_init;
 
 #if (YZ_NODE_ID == VP_NODE)
-   SL_VPSpecificInit();
+   SL_VPSpecificInit(ctx);
 #else
-   SL_GPSpecificInit();
+   SL_GPSpecificInit(ctx);
 #endif
 
    /*
    ** Set Rx SN to 0 to indicate that any SN should be accepted in the first packet received 
    ** following initialization.
    */
-   rx_info.next_sn = 0x00;
+   ctx->rx_info.next_sn = 0x00;
+
+   /*
+   ** Start in stop-and-wait mode, selective repeat is used again once both nodes have
+   ** advertised a window (this node advertises it in the COMM RESET packet).
+   */
+   ctx->win.peer_size = 0;
+   ctx->win.tx_active = 0;
+   ctx->win.rx_active = 0;
+   ctx->win.version_flag = 0;
+   ctx->win.rx_base_slot = 0;
+   memset(ctx->win.rx_held, 0, sizeof(ctx->win.rx_held));
+
+   /*
+   ** Select the requested CRC engine when the first link is initialized.  The engine
+   ** is shared by every link so it is left alone afterwards, the other links may be
+   ** computing a CRC.
+   */
+   CrcInitEngine();
 
 #if (YZ_SPI_TPL_ENABLE != 0)
-   TPLInit();
+   TPLInit(ctx);
 #endif
 }
 
 
 /**************************************************************************************/
-/*! \fn SL_VPSpecificInit(void)
+/*! \fn SL_VPSpecificInit(SL_CONTEXT *ctx)
  *
- *  param None
+ *  \param[in] ctx - the context of the link.
  *
  *  \par Description:	  
  *  Initializes variables with information specific to VP node.
@@ -406,20 +549,20 @@ void SL_Initialize(U8 *buffer1_ptr, U8 *buffer2_ptr, U8 reason_for_init)
  *	None
  *
  **************************************************************************************/
-static void SL_VPSpecificInit(void)
+static void SL_VPSpecificInit(SL_CONTEXT *ctx)
 {
-   tx_info.min_msg_id = VP_TX_MIN_MSG_ID_MINUS_1 + 1;
-   tx_info.max_msg_id = VP_TX_MAX_MSG_ID_PLUS_1 - 1; 
+   ctx->tx_info.min_msg_id = VP_TX_MIN_MSG_ID_MINUS_1 + 1;
+   ctx->tx_info.max_msg_id = VP_TX_MAX_MSG_ID_PLUS_1 - 1; 
 
-   rx_info.min_msg_id = GP_TX_MIN_MSG_ID_MINUS_1 + 1;
-   rx_info.max_msg_id = GP_TX_MAX_MSG_ID_PLUS_1 - 1; 
+   ctx->rx_info.min_msg_id = GP_TX_MIN_MSG_ID_MINUS_1 + 1;
+   ctx->rx_info.max_msg_id = GP_TX_MAX_MSG_ID_PLUS_1 - 1; 
 }
 
 
 /**************************************************************************************/
-/*! \fn SL_GPSpecificInit(void)
+/*! \fn SL_GPSpecificInit(SL_CONTEXT *ctx)
  *
- *  param None
+ *  \param[in] ctx - the context of the link.
  *
  *  \par Description:	  
  *  Initializes variables with information specific to GP node.
@@ -430,19 +573,20 @@ static void SL_VPSpecificInit(void)
  *	None
  *
  **************************************************************************************/
-static void SL_GPSpecificInit(void)
+static void SL_GPSpecificInit(SL_CONTEXT *ctx)
 {
-   tx_info.min_msg_id = GP_TX_MIN_MSG_ID_MINUS_1 + 1;
-   tx_info.max_msg_id = GP_TX_MAX_MSG_ID_PLUS_1 - 1; 
+   ctx->tx_info.min_msg_id = GP_TX_MIN_MSG_ID_MINUS_1 + 1;
+   ctx->tx_info.max_msg_id = GP_TX_MAX_MSG_ID_PLUS_1 - 1; 
 
-   rx_info.min_msg_id = VP_TX_MIN_MSG_ID_MINUS_1 + 1;
-   rx_info.max_msg_id = VP_TX_MAX_MSG_ID_PLUS_1 - 1; 
+   ctx->rx_info.min_msg_id = VP_TX_MIN_MSG_ID_MINUS_1 + 1;
+   ctx->rx_info.max_msg_id = VP_TX_MAX_MSG_ID_PLUS_1 - 1; 
 }
 
 
 /**************************************************************************************/
-/*! \fn SL_GetPacketToTx(U8 **packet_ptr)
+/*! \fn SL_CtxGetPacketToTx(SL_CONTEXT *ctx, U8 **packet_ptr)
  *
+ *  \param[in] ctx - the context of the link.
  *  \param[out] packet_ptr - non-NULL pointer to the packet to Tx if the packet to be Tx'd is
  *         				    already buffered.  Will be NULL if a new packet needs to be loaded.
  *
@@ -460,22 +604,31 @@ static void SL_GPSpecificInit(void)
  *
  *  \ingroup spi_public
  **************************************************************************************/
-int SL_GetPacketToTx(U8 **packet_ptr)
+int SL_CtxGetPacketToTx(SL_CONTEXT *ctx, U8 **packet_ptr)
 {
    /*
    ** Confirm state is valid to get Tx pointer.
    */
-   if (api_state != WAIT_GET_TX_PKT)
+   if (ctx->api_state != WAIT_GET_TX_PKT)
    {
       return(SL_SEQ_ERROR);
    }
 
-   if (tx_info.pkt_ptr == NULL)
+   /*
+   ** In selective repeat mode pick the packet to retransmit, if any, from the 
+   ** acknowledgements received.
+   */
+   if ((ctx->win.tx_active != 0) && (ctx->tx_info.pkt_ptr == NULL))
+   {
+      WinTxPick(ctx);
+   }
+
+   if (ctx->tx_info.pkt_ptr == NULL)
    {
       /*
       ** No packet is ready to Tx, need to load a new one.
       */
-      api_state = WAIT_LOAD_START;
+      ctx->api_state = WAIT_LOAD_START;
       *packet_ptr = NULL;
    }
    else
@@ -484,17 +637,27 @@ int SL_GetPacketToTx(U8 **packet_ptr)
       ** Packet is ready to Tx (or retransmit).  Caller will Tx the packet then must
       ** start unloading after SPI transfer completes.
       */
-      INCREMENT_STAT(stats.pkt_tx_cnt);
-      api_state = WAIT_UNLOAD_START;
-      *packet_ptr = tx_info.pkt_ptr;
+      INCREMENT_STAT(ctx->stats.pkt_tx_cnt);
+      ++ctx->win.xfer;
+      ctx->api_state = WAIT_UNLOAD_START;
+      *packet_ptr = ctx->tx_info.pkt_ptr;
+      if (ctx->win.tx_active != 0)
+      {
+         /*
+         ** The window keeps the packet, the next one is picked after the Rx.
+         */
+         WinTxSent(ctx);
+         ctx->tx_info.pkt_ptr = NULL;
+      }
    }
    return(SL_SUCCESS);
 }
 
 
 /**************************************************************************************/
-/*! \fn SL_LoadPacketStart(int *bytes_left)
+/*! \fn SL_CtxLoadPacketStart(SL_CONTEXT *ctx, int *bytes_left)
  *
+ *  \param[in] ctx - the context of the link.
  *  \param[out] bytes_left - upon successful return, contains the bytes left in the packet
  *         				for message data (bytes_left reflects the amount of space left for data
  *         				for a "regular" (not "status") message; there are 4 fewer bytes available
@@ -515,56 +678,85 @@ int SL_GetPacketToTx(U8 **packet_ptr)
  *
  *  \ingroup spi_public
  **************************************************************************************/
-int SL_LoadPacketStart(int *bytes_left)
+int SL_CtxLoadPacketStart(SL_CONTEXT *ctx, int *bytes_left)
 {
+   U8 ack[LEN_LINK_ACK_MSG];
+
    /*
    ** Confirm state is valid to start loading.
    */
-   if (api_state != WAIT_LOAD_START)
+   if (ctx->api_state != WAIT_LOAD_START)
    {
       return(SL_SEQ_ERROR);
    }
-   api_state = LOADING; 
+   ctx->api_state = LOADING; 
    
    /* 
-   ** Advance to next packet buffer. 
+   ** Advance to next packet buffer (the buffer of the next SN in selective repeat mode). 
    */
-   tx_info.pkt_ptr = tx_info.oldest_pkt_ptr;     
-   tx_info.oldest_pkt_ptr = tx_info.newest_pkt_ptr;
-   tx_info.newest_pkt_ptr = tx_info.pkt_ptr;
+   if (ctx->win.tx_active != 0)
+   {
+      ctx->tx_info.pkt_ptr = WIN_TX_BUFFER(ctx, WinTxSlot(ctx, ctx->tx_info.next_sn));
+   }
+   else
+   {
+      ctx->tx_info.pkt_ptr = ctx->tx_info.oldest_pkt_ptr;     
+      ctx->tx_info.oldest_pkt_ptr = ctx->tx_info.newest_pkt_ptr;
+      ctx->tx_info.newest_pkt_ptr = ctx->tx_info.pkt_ptr;
+   }
 
    /* 
    ** Fill the packet with the "PAD BYTE" 
    */
-   memset(tx_info.pkt_ptr, YZ_SPI_PKT_PAD_BYTE, YZ_SPI_PKT_SIZE);
+   memset(ctx->tx_info.pkt_ptr, YZ_SPI_PKT_PAD_BYTE, YZ_SPI_PKT_SIZE);
 
    /*
    ** Setup control variables for loading messages.
    */
-   tx_info.msg_count = 0;
-   tx_info.load_index = PKT_HDR_BYTES;
+   ctx->tx_info.msg_count = 0;
+   ctx->tx_info.load_index = PKT_HDR_BYTES;
 
    /*
    ** Send COMM Reset message if triggered.
    */
-   if (tx_info.comm_reset_flag != 0)
+   if (ctx->tx_info.comm_reset_flag != 0)
    {
-      SendCommResetMsg();
-      tx_info.comm_reset_flag = 0;
+      SendCommResetMsg(ctx);
+      ctx->tx_info.comm_reset_flag = 0;
+      ctx->win.version_flag = 0;
    } 
 
+   /*
+   ** Once both nodes have advertised a window every packet starts with a LINK ACK 
+   ** message (there is no window, and no LINK ACK, in a COMM RESET packet).
+   */
+   if (WIN_NEGOTIATED(ctx))
+   {
+      WinLoadAck(ctx, &ack[0]);
+      (void) LoadPacketStatusMsg(ctx, ID_LINK_ACK_MSG, sizeof(ack), &ack[0], bytes_left);
+   }
+
+   /*
+   ** Send Protocol Version message if triggered (advertises a new window).
+   */
+   if (ctx->win.version_flag != 0)
+   {
+      SendProtocolVersionMsg(ctx);
+      ctx->win.version_flag = 0;
+   }
+
 #if (YZ_SPI_TPL_ENABLE != 0)
    /*
    ** If TPL is enabled, load the next segment of each TPL message xfer in progress.
    */
-   LoadTPLMsgs();
+   LoadTPLMsgs(ctx);
 #endif
 
    /*
    ** If there is not enough room for a 1-byte message return 0 bytes left.
    ** Note that bytes_left may be <0 so we need to account for this. 
    */
-   *bytes_left = YZ_SPI_PKT_SIZE - (tx_info.load_index + MSG_HDR_BYTES);
+   *bytes_left = YZ_SPI_PKT_SIZE - (ctx->tx_info.load_index + MSG_HDR_BYTES);
    if (*bytes_left < 1)
    {
       *bytes_left = 0;
@@ -574,8 +766,9 @@ int SL_LoadPacketStart(int *bytes_left)
 }
 
 /**************************************************************************************/
-/*! \fn SL_LoadPacketMsg(int msg_id, int msg_size_bytes, U8 *msg_data, int *bytes_left)
+/*! \fn SL_CtxLoadPacketMsg(SL_CONTEXT *ctx, int msg_id, int msg_size_bytes, U8 *msg_data, int *bytes_left)
  *
+ *  \param[in] ctx - the context of the link.
  *	\param[in] msg_id - id of the message to be loaded. 
  *  \param[in] msg_size_bytes - message size in bytes.
  *  \param[in] msg_data - pointer to message data.      
@@ -598,12 +791,12 @@ int SL_LoadPacketStart(int *bytes_left)
  *
  *  \ingroup spi_public
  **************************************************************************************/
-int SL_LoadPacketMsg(int msg_id, int msg_size_bytes, U8 *msg_data, int *bytes_left)
+int SL_CtxLoadPacketMsg(SL_CONTEXT *ctx, int msg_id, int msg_size_bytes, U8 *msg_data, int *bytes_left)
 {
    /*
    ** Confirm state is valid to load.
    */
-   if (api_state != LOADING)
+   if (ctx->api_state != LOADING)
    {
       return(SL_SEQ_ERROR);
    }
@@ -611,7 +804,7 @@ int SL_LoadPacketMsg(int msg_id, int msg_size_bytes, U8 *msg_data, int *bytes_le
    /*
    ** Confirm id is valid.
    */
-   if ((msg_id < tx_info.min_msg_id) || (msg_id > tx_info.max_msg_id))
+   if ((msg_id < ctx->tx_info.min_msg_id) || (msg_id > ctx->tx_info.max_msg_id))
    {
       return(SL_INVALID_ID);
    }
@@ -627,7 +820,7 @@ int SL_LoadPacketMsg(int msg_id, int msg_size_bytes, U8 *msg_data, int *bytes_le
    /*
    ** Confirm message will fit.
    */
-   if (((tx_info.load_index-1) + MSG_HDR_BYTES + msg_size_bytes) > OFFSET_LAST_PKT_BYTE) 
+   if (((ctx->tx_info.load_index-1) + MSG_HDR_BYTES + msg_size_bytes) > OFFSET_LAST_PKT_BYTE) 
    {
       return(SL_MSG_TOO_LONG);
    }
@@ -635,26 +828,26 @@ int SL_LoadPacketMsg(int msg_id, int msg_size_bytes, U8 *msg_data, int *bytes_le
    /* 
    ** Load message into packet.
    */
-   tx_info.pkt_ptr[ tx_info.load_index + MSG_ID_LSB  ] = GET_LSB(msg_id);
-   tx_info.pkt_ptr[ tx_info.load_index + MSG_ID_MSB  ] = GET_MSB(msg_id);
+   ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + MSG_ID_LSB  ] = GET_LSB(msg_id);
+   ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + MSG_ID_MSB  ] = GET_MSB(msg_id);
    
-   tx_info.pkt_ptr[ tx_info.load_index + MSG_LEN_LSB ] = GET_LSB(msg_size_bytes);
-   tx_info.pkt_ptr[ tx_info.load_index + MSG_LEN_MSB ] = GET_MSB(msg_size_bytes);
+   ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + MSG_LEN_LSB ] = GET_LSB(msg_size_bytes);
+   ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + MSG_LEN_MSB ] = GET_MSB(msg_size_bytes);
   
-   memcpy(&tx_info.pkt_ptr[ tx_info.load_index + MSG_HDR_BYTES ], msg_data, msg_size_bytes);
-   INCREMENT_STAT(stats.msgs_loaded);
+   memcpy(&ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + MSG_HDR_BYTES ], msg_data, msg_size_bytes);
+   INCREMENT_STAT(ctx->stats.msgs_loaded);
 
    /*
    ** Update load control variables.
    */
-   ++tx_info.msg_count;
-   tx_info.load_index += (msg_size_bytes + MSG_HDR_BYTES); 
+   ++ctx->tx_info.msg_count;
+   ctx->tx_info.load_index += (msg_size_bytes + MSG_HDR_BYTES); 
 
    /*
    ** If there is not enough room for a 1-byte message return 0 bytes left.
    ** Note that bytes_left may be <0 so we need to account for this. 
    */
-   *bytes_left = YZ_SPI_PKT_SIZE - (tx_info.load_index + MSG_HDR_BYTES);
+   *bytes_left = YZ_SPI_PKT_SIZE - (ctx->tx_info.load_index + MSG_HDR_BYTES);
    if (*bytes_left < 1)
    {
       *bytes_left = 0;
@@ -664,8 +857,9 @@ int SL_LoadPacketMsg(int msg_id, int msg_size_bytes, U8 *msg_data, int *bytes_le
 }
 
 /**************************************************************************************/
-/*! \fn SL_LoadPacketStatusMsg(int status_msg_id, int status_msg_size_bytes, U8 *msg_data, int *bytes_left)
+/*! \fn SL_CtxLoadPacketStatusMsg(SL_CONTEXT *ctx, int status_msg_id, int status_msg_size_bytes, U8 *msg_data, int *bytes_left)
  *
+ *  \param[in] ctx - the context of the link.
  *	\param[in] status_msg_id - id of the status message to be loaded. 
  *  \param[in] status_msg_size_bytes - status message size in bytes.
  *  \param[in] msg_data - pointer to message data.      
@@ -687,12 +881,12 @@ int SL_LoadPacketMsg(int msg_id, int msg_size_bytes, U8 *msg_data, int *bytes_le
  *
  *  \ingroup spi_public
  **************************************************************************************/
-int SL_LoadPacketStatusMsg(int status_msg_id, int status_msg_size_bytes, U8 *msg_data, int *bytes_left)
+int SL_CtxLoadPacketStatusMsg(SL_CONTEXT *ctx, int status_msg_id, int status_msg_size_bytes, U8 *msg_data, int *bytes_left)
 {
    /*
    ** Confirm state is valid to load.
    */
-   if (api_state != LOADING)
+   if (ctx->api_state != LOADING)
    {
       return(SL_SEQ_ERROR);
    }
@@ -717,7 +911,7 @@ int SL_LoadPacketStatusMsg(int status_msg_id, int status_msg_size_bytes, U8 *msg
    /*
    ** Confirm message will fit.
    */
-   if (((tx_info.load_index-1) + (MSG_HDR_BYTES*2) + status_msg_size_bytes) > OFFSET_LAST_PKT_BYTE) 
+   if (((ctx->tx_info.load_index-1) + (MSG_HDR_BYTES*2) + status_msg_size_bytes) > OFFSET_LAST_PKT_BYTE) 
    {
       return(SL_MSG_TOO_LONG);
    }
@@ -725,14 +919,14 @@ int SL_LoadPacketStatusMsg(int status_msg_id, int status_msg_size_bytes, U8 *msg
    /*
    ** Load message into packet.
    */
-  LoadPacketStatusMsg(status_msg_id, status_msg_size_bytes, msg_data, bytes_left);
+  LoadPacketStatusMsg(ctx, status_msg_id, status_msg_size_bytes, msg_data, bytes_left);
   return(SL_SUCCESS);
 }
 
 /**************************************************************************************/
-/*! \fn LoadPacketStatusMsg(int status_msg_id, int status_msg_size_bytes, U8 *msg_data, int *bytes_left)
+/*! \fn LoadPacketStatusMsg(SL_CONTEXT *ctx, int status_msg_id, int status_msg_size_bytes, U8 *msg_data, int *bytes_left)
  *
- *  param None
+ *  \param[in] ctx - the context of the link.
  *
  *  \par Description:	  
  *  Loads a status message into a packet. 
@@ -743,36 +937,36 @@ int SL_LoadPacketStatusMsg(int status_msg_id, int status_msg_size_bytes, U8 *msg
  *	None
  *
  **************************************************************************************/
-static void LoadPacketStatusMsg(int status_msg_id, int status_msg_size_bytes, U8 *msg_data, int *bytes_left)
+static void LoadPacketStatusMsg(SL_CONTEXT *ctx, int status_msg_id, int status_msg_size_bytes, U8 *msg_data, int *bytes_left)
 {
-   tx_info.pkt_ptr[ tx_info.load_index + MSG_ID_LSB ] = (U8) 0;  /* ID of packet status msg is 0*/
-   tx_info.pkt_ptr[ tx_info.load_index + MSG_ID_MSB ] = (U8) 0;  /* ID of packet status msg is 0*/
+   ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + MSG_ID_LSB ] = (U8) 0;  /* ID of packet status msg is 0*/
+   ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + MSG_ID_MSB ] = (U8) 0;  /* ID of packet status msg is 0*/
    
-   tx_info.pkt_ptr[ tx_info.load_index + MSG_LEN_LSB ] = GET_LSB(status_msg_size_bytes + MSG_HDR_BYTES);
-   tx_info.pkt_ptr[ tx_info.load_index + MSG_LEN_MSB ] = GET_MSB(status_msg_size_bytes + MSG_HDR_BYTES);
+   ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + MSG_LEN_LSB ] = GET_LSB(status_msg_size_bytes + MSG_HDR_BYTES);
+   ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + MSG_LEN_MSB ] = GET_MSB(status_msg_size_bytes + MSG_HDR_BYTES);
   
-   tx_info.load_index += MSG_HDR_BYTES;
+   ctx->tx_info.load_index += MSG_HDR_BYTES;
 
-   tx_info.pkt_ptr[ tx_info.load_index + MSG_ID_LSB ] = GET_LSB(status_msg_id);  /* ID of status msg */
-   tx_info.pkt_ptr[ tx_info.load_index + MSG_ID_MSB ] = GET_MSB(status_msg_id);
+   ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + MSG_ID_LSB ] = GET_LSB(status_msg_id);  /* ID of status msg */
+   ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + MSG_ID_MSB ] = GET_MSB(status_msg_id);
 
-   tx_info.pkt_ptr[ tx_info.load_index + MSG_LEN_LSB ] = GET_LSB(status_msg_size_bytes); /* size of status msg */
-   tx_info.pkt_ptr[ tx_info.load_index + MSG_LEN_MSB ] = GET_MSB(status_msg_size_bytes);
+   ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + MSG_LEN_LSB ] = GET_LSB(status_msg_size_bytes); /* size of status msg */
+   ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + MSG_LEN_MSB ] = GET_MSB(status_msg_size_bytes);
   
-   memcpy(&tx_info.pkt_ptr[ tx_info.load_index + MSG_HDR_BYTES ], msg_data, status_msg_size_bytes);
-   INCREMENT_STAT(stats.msgs_loaded);
+   memcpy(&ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + MSG_HDR_BYTES ], msg_data, status_msg_size_bytes);
+   INCREMENT_STAT(ctx->stats.msgs_loaded);
 
    /*
    ** Update load control variables.
    */
-   ++tx_info.msg_count;
-   tx_info.load_index += (status_msg_size_bytes + MSG_HDR_BYTES);
+   ++ctx->tx_info.msg_count;
+   ctx->tx_info.load_index += (status_msg_size_bytes + MSG_HDR_BYTES);
 
    /*
    ** If there is not enough room for a 1-byte message return 0 bytes left.
    ** Note that bytes_left may be <0 so we need to account for this. 
    */
-   *bytes_left = YZ_SPI_PKT_SIZE - (tx_info.load_index + MSG_HDR_BYTES);
+   *bytes_left = YZ_SPI_PKT_SIZE - (ctx->tx_info.load_index + MSG_HDR_BYTES);
    if (*bytes_left < 1)
    {
       *bytes_left = 0;
@@ -781,10 +975,10 @@ static void LoadPacketStatusMsg(int status_msg_id, int status_msg_size_bytes, U8
 
 
 /*************************************************************************************/
-/*! \fn SL_LoadPacketFinish(void)
+/*! \fn SL_CtxLoadPacketFinish(SL_CONTEXT *ctx)
  *
  * Parameters:
- *	     None.	
+ *	     ctx - the context of the link.
  *
  *	\par Description
  *  Completes loading of a packet.  Upon successful return, the packet is
@@ -797,14 +991,14 @@ static void LoadPacketStatusMsg(int status_msg_id, int status_msg_size_bytes, U8
  *	None
  *
  **************************************************************************************/
-int SL_LoadPacketFinish(void)
+int SL_CtxLoadPacketFinish(SL_CONTEXT *ctx)
 {
    U16 crc;
 
    /*
    ** Confirm state is valid to finish loading.
    */
-   if (api_state != LOADING)
+   if (ctx->api_state != LOADING)
    {
       return(SL_SEQ_ERROR);
    }
@@ -813,71 +1007,345 @@ int SL_LoadPacketFinish(void)
    /*
    ** If TPL is enabled, fill the remaining bytes left in packet with TPL messages. 
    */
-   LoadTPLMsgsFill(1);
+   LoadTPLMsgsFill(ctx, 1);
 #endif
 
+   /*
+   ** Packet utilization statistics.
+   */
+   INCREMENT_STAT(ctx->stats.pkts_loaded);
+   ADD_STAT(ctx->stats.pkt_bytes_loaded, (U32)(ctx->tx_info.load_index - PKT_HDR_BYTES));
+
    /* 
    ** Load packet header fields first, then compute and load CRC.
    */
-   tx_info.pkt_ptr[ PKT_MSG_COUNT_LSB ] =  GET_LSB(tx_info.msg_count);
-   tx_info.pkt_ptr[ PKT_MSG_COUNT_MSB ] =  GET_MSB(tx_info.msg_count);
+   ctx->tx_info.pkt_ptr[ PKT_MSG_COUNT_LSB ] =  GET_LSB(ctx->tx_info.msg_count);
+   ctx->tx_info.pkt_ptr[ PKT_MSG_COUNT_MSB ] =  GET_MSB(ctx->tx_info.msg_count);
 
-   tx_info.pkt_ptr[ PKT_SN_LSB ] = GET_LSB(tx_info.next_sn);
-   tx_info.pkt_ptr[ PKT_SN_MSB ] = GET_MSB(tx_info.next_sn);
+   ctx->tx_info.pkt_ptr[ PKT_SN_LSB ] = GET_LSB(ctx->tx_info.next_sn);
+   ctx->tx_info.pkt_ptr[ PKT_SN_MSB ] = GET_MSB(ctx->tx_info.next_sn);
    
-   tx_info.pkt_ptr[ PKT_NACK_LSB ] = GET_LSB(tx_info.next_nack);
-   tx_info.pkt_ptr[ PKT_NACK_MSB ] = GET_MSB(tx_info.next_nack);
+   ctx->tx_info.pkt_ptr[ PKT_NACK_LSB ] = GET_LSB(ctx->tx_info.next_nack);
+   ctx->tx_info.pkt_ptr[ PKT_NACK_MSB ] = GET_MSB(ctx->tx_info.next_nack);
 
-   crc = CalculateCrc(&tx_info.pkt_ptr[sizeof(crc)], (YZ_SPI_PKT_SIZE-sizeof(crc)));
+   crc = CalculateCrc(&ctx->tx_info.pkt_ptr[sizeof(crc)], (YZ_SPI_PKT_SIZE-sizeof(crc)));
 
-   tx_info.pkt_ptr[ PKT_CRC_LSB ] = GET_LSB(crc);
-   tx_info.pkt_ptr[ PKT_CRC_MSB ] = GET_MSB(crc);
+   ctx->tx_info.pkt_ptr[ PKT_CRC_LSB ] = GET_LSB(crc);
+   ctx->tx_info.pkt_ptr[ PKT_CRC_MSB ] = GET_MSB(crc);
 
 #if 0
 #if (defined(SL_LOGMSG))
    sprintf(log_buff, ">>>>>SL_LoadPacketFinish: TX packet w/SN=%d  NACK=%d \n", 
-       (tx_info.pkt_ptr[ PKT_SN_LSB ] + (tx_info.pkt_ptr[ PKT_SN_MSB ] * 256)),
-       (tx_info.pkt_ptr[ PKT_NACK_LSB ] + (tx_info.pkt_ptr[ PKT_NACK_MSB ] * 256)));
+       (ctx->tx_info.pkt_ptr[ PKT_SN_LSB ] + (ctx->tx_info.pkt_ptr[ PKT_SN_MSB ] * 256)),
+       (ctx->tx_info.pkt_ptr[ PKT_NACK_LSB ] + (ctx->tx_info.pkt_ptr[ PKT_NACK_MSB ] * 256)));
    LogMsg(log_buff);
 #endif
 #endif
 
-   tx_info.last_sn_txd = tx_info.next_sn;
-   tx_info.next_sn = ComputeNextSN(tx_info.next_sn);
+   ctx->tx_info.last_sn_txd = ctx->tx_info.next_sn;
+   ctx->tx_info.next_sn = ComputeNextSN(ctx->tx_info.next_sn);
+
+   ctx->api_state = WAIT_GET_TX_PKT;
+
+   return(SL_SUCCESS);
+}
+
+/*******************************************************************************
+ * Function: SL_PackInit
+ *		See documentation in spi_lib.h.
+ * 
+ * Parameters:
+ *		See documentation in spi_lib.h.
+ *
+ * Returns: 
+ *		See documentation in spi_lib.h.
+ ******************************************************************************/
+void SL_PackInit(SL_PACK_QUEUE *queue, SL_PACK_MSG *msgs, int max_msgs)
+{
+   int i;
+
+   queue->msgs = msgs;
+   queue->max_msgs = max_msgs;
+   queue->num_msgs = 0;
+   queue->head = -1;
+   queue->tail = -1;
+   queue->free_head = (max_msgs > 0) ? 0 : -1;
+   for (i = 0; i < max_msgs; ++i)
+   {
+      msgs[i].next_node = ((i + 1) < max_msgs) ? (i + 1) : -1;
+   }
+}
+
+/*******************************************************************************
+ * Function: SL_PackQueueMsg
+ *		See documentation in spi_lib.h.
+ * 
+ * Parameters:
+ *		See documentation in spi_lib.h.
+ *
+ * Returns: 
+ *		See documentation in spi_lib.h.
+ ******************************************************************************/
+int SL_PackQueueMsg(SL_PACK_QUEUE *queue, int msg_id, int msg_size_bytes, U8 *msg_data, int priority)
+{
+   SL_PACK_MSG *msg;
+   int node;
+
+   if ((msg_size_bytes < 0) || (msg_size_bytes > (int)YZ_SPI_PKT_MAX_MSG_SIZE))
+   {
+      return(SL_MSG_TOO_LONG);
+   }
+   if ((priority < 0) || (priority >= SL_PACK_PRIORITIES))
+   {
+      return(SL_NOT_SUPPORTED);
+   }
+   node = queue->free_head;
+   if (node == -1)
+   {
+      return(SL_QUEUE_FULL);
+   }
 
-   api_state = WAIT_GET_TX_PKT;
+   msg = &queue->msgs[ node ];
+   queue->free_head = msg->next_node;
+   msg->msg_id = msg_id;
+   msg->msg_size_bytes = msg_size_bytes;
+   msg->priority = priority;
+   msg->pkts_waited = 0;
+   msg->next_node = -1;
+   memcpy(msg->msg_data, msg_data, msg_size_bytes);
 
+   /*
+   ** Append to the queue, it is kept in the order messages are queued.
+   */
+   if (queue->head == -1)
+   {
+      queue->head = node;
+   }
+   else
+   {
+      queue->msgs[ queue->tail ].next_node = node;
+   }
+   queue->tail = node;
+   ++queue->num_msgs;
    return(SL_SUCCESS);
 }
 
+/*******************************************************************************
+ * Function: SL_PackNumMsgs
+ *		See documentation in spi_lib.h.
+ * 
+ * Parameters:
+ *		See documentation in spi_lib.h.
+ *
+ * Returns: 
+ *		See documentation in spi_lib.h.
+ ******************************************************************************/
+int SL_PackNumMsgs(const SL_PACK_QUEUE *queue)
+{
+   return(queue->num_msgs);
+}
+
+/**************************************************************************************/
+/*! \fn SL_CtxLoadPacketPacked(SL_CONTEXT *ctx, SL_PACK_QUEUE *queue, int *bytes_left)
+ *
+ *  \param[in] ctx - the context of the link.
+ *  \param[in] queue - the packing queue.
+ *  \param[out] bytes_left - upon successful return, contains the bytes left in the packet
+ *         				for message data.
+ *
+ *  \par Description:	  
+ *  Loads the messages of a packing queue that fit in the packet, see the 
+ *  documentation of SL_LoadPacketPacked in spi_lib.h.  The messages left in 
+ *  the queue age by one packet.
+ *
+ *  \retval SL_SEQ_ERROR - call sequence error.
+ *	\retval SL_SUCCESS - successful
+ *  \retval SL_INVALID_ID - a message with an id out of range was removed from the queue.
+ *
+ *  \par Limitations/Caveats:
+ *	None
+ *
+ *  \ingroup spi_public
+ **************************************************************************************/
+int SL_CtxLoadPacketPacked(SL_CONTEXT *ctx, SL_PACK_QUEUE *queue, int *bytes_left)
+{
+   SL_PACK_MSG *msg;
+   int rc = SL_SUCCESS;
+   int load_rc;
+   int node;
+   int prev_node;
+
+   /*
+   ** Confirm state is valid to load.
+   */
+   if (ctx->api_state != LOADING)
+   {
+      return(SL_SEQ_ERROR);
+   }
+
+   while ((node = PackPickMsg(queue, YZ_SPI_PKT_SIZE - (ctx->tx_info.load_index + MSG_HDR_BYTES), &prev_node)) != -1)
+   {
+      msg = &queue->msgs[ node ];
+      load_rc = SL_CtxLoadPacketMsg(ctx, msg->msg_id, msg->msg_size_bytes, msg->msg_data, bytes_left);
+      if (load_rc == SL_INVALID_ID)
+      {
+         rc = SL_INVALID_ID;
+      }
+      else if (load_rc != SL_SUCCESS)
+      {
+         break;
+      }
+      PackRemoveMsg(queue, node, prev_node);
+   }
+
+   /*
+   ** Age the messages left for the next packet, until they reach the highest priority.
+   */
+   for (node = queue->head; node != -1; node = queue->msgs[ node ].next_node)
+   {
+      if (queue->msgs[ node ].pkts_waited < (SL_PACK_PRIORITIES * SL_PACK_AGING_PKTS))
+      {
+         ++queue->msgs[ node ].pkts_waited;
+      }
+   }
+
+   *bytes_left = YZ_SPI_PKT_SIZE - (ctx->tx_info.load_index + MSG_HDR_BYTES);
+   if (*bytes_left < 1)
+   {
+      *bytes_left = 0;
+   }
+   return(rc);
+}
+
+/*******************************************************************************
+ * Function: PackPickMsg
+ *      Picks the message of a packing queue to load next: of the messages that
+ *      fit, the one of highest priority, once aged, then the largest one.  A 
+ *      message is not eligible while an older message of the same id is queued.
+ *
+ * Parameters:
+ *	    queue - the packing queue.
+ *	    space - bytes left in the packet for message data.
+ *	    prev_node - returns the offset of the message before the one picked in 
+ *         the queue, -1 if it is the oldest.
+ *
+ * Returns:
+ *		The offset of the message picked, -1 if none fits.
+ ******************************************************************************/
+static int PackPickMsg(SL_PACK_QUEUE *queue, int space, int *prev_node)
+{
+   SL_PACK_MSG *msg;
+   int best = -1;
+   int best_priority = SL_PACK_PRIORITIES;
+   int priority;
+   int prev = -1;
+   int older;
+   int node;
+
+   for (node = queue->head; node != -1; prev = node, node = msg->next_node)
+   {
+      msg = &queue->msgs[ node ];
+      if (msg->msg_size_bytes > space)
+      {
+         continue;
+      }
+      priority = msg->priority - (msg->pkts_waited / SL_PACK_AGING_PKTS);
+      if (priority < 0)
+      {
+         priority = 0;
+      }
+      if ((best != -1) && 
+          ((priority > best_priority) || 
+           ((priority == best_priority) && (msg->msg_size_bytes <= queue->msgs[ best ].msg_size_bytes))))
+      {
+         continue;
+      }
+      for (older = queue->head; queue->msgs[ older ].msg_id != msg->msg_id; older = queue->msgs[ older ].next_node)
+      {
+      }
+      if (older != node)
+      {
+         continue;
+      }
+      best = node;
+      best_priority = priority;
+      *prev_node = prev;
+   }
+   return(best);
+}
+
+/*******************************************************************************
+ * Function: PackRemoveMsg
+ *      Removes a message from a packing queue and frees it.
+ *
+ * Parameters:
+ *	    queue - the packing queue.
+ *	    node - the offset of the message.
+ *	    prev_node - the offset of the message before it, -1 if it is the oldest.
+ *
+ * Returns:
+ *		None.
+ ******************************************************************************/
+static void PackRemoveMsg(SL_PACK_QUEUE *queue, int node, int prev_node)
+{
+   SL_PACK_MSG *msg = &queue->msgs[ node ];
+
+   if (prev_node == -1)
+   {
+      queue->head = msg->next_node;
+   }
+   else
+   {
+      queue->msgs[ prev_node ].next_node = msg->next_node;
+   }
+   if (queue->tail == node)
+   {
+      queue->tail = prev_node;
+   }
+   msg->next_node = queue->free_head;
+   queue->free_head = node;
+   --queue->num_msgs;
+}
+
 /*******************************************************************************
  * Function: RetransmitPacket
  *      Retransmits the last packet transmitted.  
  *
  * Parameters:
+ *	    ctx - the context of the link.
  *	    nack - the nack value to send in the packet.
  *
  * Returns:
  *		See documenation in spi_lib.h
  ******************************************************************************/
-static void RetransmitPacket(int nack)
+static void RetransmitPacket(SL_CONTEXT *ctx, int nack)
 {
    U16 crc;
 
-   INCREMENT_STAT(stats.pkt_tx_retries);
-   if ((tx_info.go_back == 0) || (tx_info.go_back == -1))
+   /*
+   ** In selective repeat mode the other node acknowledges the packets it Rx'd, only 
+   ** the NACK is sent (for the other node, it may not Tx in selective repeat mode yet).
+   */
+   if (ctx->win.tx_active != 0)
+   {
+      ctx->tx_info.next_nack = nack;
+      return;
+   }
+
+   INCREMENT_STAT(ctx->stats.pkt_tx_retries);
+   if ((ctx->tx_info.go_back == 0) || (ctx->tx_info.go_back == -1))
    {
-      tx_info.newest_pkt_ptr[ PKT_NACK_LSB ] = GET_LSB(nack);
-      tx_info.newest_pkt_ptr[ PKT_NACK_MSB ] = GET_MSB(nack);
-      crc = CalculateCrc(&tx_info.newest_pkt_ptr[sizeof(crc)], (YZ_SPI_PKT_SIZE-sizeof(crc)));
-      tx_info.newest_pkt_ptr[ PKT_CRC_LSB ] = GET_LSB(crc);
-      tx_info.newest_pkt_ptr[ PKT_CRC_MSB ] = GET_MSB(crc);
-      tx_info.last_sn_txd = tx_info.newest_pkt_ptr[ PKT_SN_LSB ] + (tx_info.newest_pkt_ptr[ PKT_SN_MSB ] * 256);
+      ctx->tx_info.newest_pkt_ptr[ PKT_NACK_LSB ] = GET_LSB(nack);
+      ctx->tx_info.newest_pkt_ptr[ PKT_NACK_MSB ] = GET_MSB(nack);
+      crc = CalculateCrc(&ctx->tx_info.newest_pkt_ptr[sizeof(crc)], (YZ_SPI_PKT_SIZE-sizeof(crc)));
+      ctx->tx_info.newest_pkt_ptr[ PKT_CRC_LSB ] = GET_LSB(crc);
+      ctx->tx_info.newest_pkt_ptr[ PKT_CRC_MSB ] = GET_MSB(crc);
+      ctx->tx_info.last_sn_txd = ctx->tx_info.newest_pkt_ptr[ PKT_SN_LSB ] + (ctx->tx_info.newest_pkt_ptr[ PKT_SN_MSB ] * 256);
 #if (defined(SL_LOGMSG))
-      sprintf(log_buff, ">>>>>RetransmitPacket:(1)Retransmit packet (SN=%d, NACK/last_sn_txd=%d) \n", tx_info.last_sn_txd, nack);
+      sprintf(log_buff, ">>>>>RetransmitPacket:(1)Retransmit packet (SN=%d, NACK/last_sn_txd=%d) \n", ctx->tx_info.last_sn_txd, nack);
       LogMsg(log_buff);
 #endif
-      tx_info.pkt_ptr = tx_info.newest_pkt_ptr; 
+      ctx->tx_info.pkt_ptr = ctx->tx_info.newest_pkt_ptr; 
    }
    else 
    {
@@ -885,17 +1353,17 @@ static void RetransmitPacket(int nack)
       ** There was no check of the go_back value on the else by design.  If the go_back becomes corrupted we
       ** will transmit the oldest packet then move on to the next packet in the TransmitNextPacket function. 
       */
-      tx_info.oldest_pkt_ptr[ PKT_NACK_LSB ] = GET_LSB(nack);
-      tx_info.oldest_pkt_ptr[ PKT_NACK_MSB ] = GET_MSB(nack);
-      crc = CalculateCrc(&tx_info.oldest_pkt_ptr[sizeof(crc)], (YZ_SPI_PKT_SIZE-sizeof(crc)));
-      tx_info.oldest_pkt_ptr[ PKT_CRC_LSB ] = GET_LSB(crc);
-      tx_info.oldest_pkt_ptr[ PKT_CRC_MSB ] = GET_MSB(crc);
-      tx_info.last_sn_txd = tx_info.oldest_pkt_ptr[ PKT_SN_LSB ] + (tx_info.oldest_pkt_ptr[ PKT_SN_MSB ] * 256);
+      ctx->tx_info.oldest_pkt_ptr[ PKT_NACK_LSB ] = GET_LSB(nack);
+      ctx->tx_info.oldest_pkt_ptr[ PKT_NACK_MSB ] = GET_MSB(nack);
+      crc = CalculateCrc(&ctx->tx_info.oldest_pkt_ptr[sizeof(crc)], (YZ_SPI_PKT_SIZE-sizeof(crc)));
+      ctx->tx_info.oldest_pkt_ptr[ PKT_CRC_LSB ] = GET_LSB(crc);
+      ctx->tx_info.oldest_pkt_ptr[ PKT_CRC_MSB ] = GET_MSB(crc);
+      ctx->tx_info.last_sn_txd = ctx->tx_info.oldest_pkt_ptr[ PKT_SN_LSB ] + (ctx->tx_info.oldest_pkt_ptr[ PKT_SN_MSB ] * 256);
 #if (defined(SL_LOGMSG))
-      sprintf(log_buff, ">>>>>RetransmitPacket:(2)Retransmit packet (SN=%d, NACK/last_sn_txd=%d) \n", tx_info.last_sn_txd, nack);
+      sprintf(log_buff, ">>>>>RetransmitPacket:(2)Retransmit packet (SN=%d, NACK/last_sn_txd=%d) \n", ctx->tx_info.last_sn_txd, nack);
       LogMsg(log_buff);
 #endif
-      tx_info.pkt_ptr = tx_info.oldest_pkt_ptr; 
+      ctx->tx_info.pkt_ptr = ctx->tx_info.oldest_pkt_ptr; 
    }
 }
 
@@ -904,20 +1372,21 @@ static void RetransmitPacket(int nack)
  *      Transmits the next packet 
  *
  * Parameters:
+ *	    ctx - the context of the link.
  *	    nack - the nack value to send in the packet.
  *
  * Returns:
  *		See documenation in spi_lib.h
  ******************************************************************************/
-static void TransmitNextPacket(int nack)
+static void TransmitNextPacket(SL_CONTEXT *ctx, int nack)
 {
    U16 crc;
 
-   if ((tx_info.go_back == 0) || (tx_info.go_back == -1))
+   if ((ctx->tx_info.go_back == 0) || (ctx->tx_info.go_back == -1))
    {
-      tx_info.next_nack = nack;
-      tx_info.go_back = 0;
-      tx_info.pkt_ptr = NULL; 
+      ctx->tx_info.next_nack = nack;
+      ctx->tx_info.go_back = 0;
+      ctx->tx_info.pkt_ptr = NULL; 
    }
    else 
    {
@@ -926,17 +1395,17 @@ static void TransmitNextPacket(int nack)
       ** will transmit the newest packet then assign go_back a value which will cause loading of a new
       ** packet the next time.
       */
-      INCREMENT_STAT(stats.pkt_tx_retries);
-      tx_info.newest_pkt_ptr[ PKT_NACK_LSB ] = GET_LSB(nack);
-      tx_info.newest_pkt_ptr[ PKT_NACK_MSB ] = GET_MSB(nack);
-      crc = CalculateCrc(&tx_info.newest_pkt_ptr[sizeof(crc)], (YZ_SPI_PKT_SIZE-sizeof(crc)));
-      tx_info.newest_pkt_ptr[ PKT_CRC_LSB ] = GET_LSB(crc);
-      tx_info.newest_pkt_ptr[ PKT_CRC_MSB ] = GET_MSB(crc);
-      tx_info.last_sn_txd = tx_info.newest_pkt_ptr[ PKT_SN_LSB ] + (tx_info.newest_pkt_ptr[ PKT_SN_MSB ] * 256);
-      tx_info.pkt_ptr = tx_info.newest_pkt_ptr; 
-      tx_info.go_back = -1;
+      INCREMENT_STAT(ctx->stats.pkt_tx_retries);
+      ctx->tx_info.newest_pkt_ptr[ PKT_NACK_LSB ] = GET_LSB(nack);
+      ctx->tx_info.newest_pkt_ptr[ PKT_NACK_MSB ] = GET_MSB(nack);
+      crc = CalculateCrc(&ctx->tx_info.newest_pkt_ptr[sizeof(crc)], (YZ_SPI_PKT_SIZE-sizeof(crc)));
+      ctx->tx_info.newest_pkt_ptr[ PKT_CRC_LSB ] = GET_LSB(crc);
+      ctx->tx_info.newest_pkt_ptr[ PKT_CRC_MSB ] = GET_MSB(crc);
+      ctx->tx_info.last_sn_txd = ctx->tx_info.newest_pkt_ptr[ PKT_SN_LSB ] + (ctx->tx_info.newest_pkt_ptr[ PKT_SN_MSB ] * 256);
+      ctx->tx_info.pkt_ptr = ctx->tx_info.newest_pkt_ptr; 
+      ctx->tx_info.go_back = -1;
 #if (defined(SL_LOGMSG))
-      sprintf(log_buff, ">>>>>TransmitNextPacket: go_back=-1 (SN=%d, NACK/last_sn_txd=%d) \n", tx_info.last_sn_txd, nack);
+      sprintf(log_buff, ">>>>>TransmitNextPacket: go_back=-1 (SN=%d, NACK/last_sn_txd=%d) \n", ctx->tx_info.last_sn_txd, nack);
       LogMsg(log_buff);
 #endif
    }
@@ -947,20 +1416,38 @@ static void TransmitNextPacket(int nack)
  *      Decides what packet should be Tx'd next. 
  *
  * Parameters:
+ *	    ctx - the context of the link.
  *	    rx_nack - the nack value received in last Rx packet. 
  *	    tx_nack - the nack value to send in Tx packet. 
  *
  * Returns:
  *		See documenation in spi_lib.h
  ******************************************************************************/
-static void PickTxPacket(int rx_nack, int tx_nack)
+static void PickTxPacket(SL_CONTEXT *ctx, int rx_nack, int tx_nack)
 {
+   /*
+   ** In selective repeat mode the packet is picked by SL_CtxGetPacketToTx from the 
+   ** acknowledgements received.  While the window drains (the other node has been
+   ** reset and no longer advertises a window) its NACK, the next SN it expects, 
+   ** acknowledges the packets before it.  A NACK of zero is not used, the packet
+   ** it accepts may be the first one Rx'd after the reset.
+   */
+   if (ctx->win.tx_active != 0)
+   {
+      ctx->tx_info.next_nack = tx_nack;
+      if (!WIN_NEGOTIATED(ctx) && (rx_nack != 0))
+      {
+         WinTxAck(ctx, rx_nack, 0);
+      }
+      return;
+   }
+
    if (rx_nack == 0)
    {
       /* 
       ** NACK of zero indicates no NACK, so move on and transmit next packet.
       */
-      TransmitNextPacket(tx_nack);
+      TransmitNextPacket(ctx, tx_nack);
    } 
    else 
    { 
@@ -969,37 +1456,433 @@ static void PickTxPacket(int rx_nack, int tx_nack)
       ** Tx'd assume that the other node Rx'd it successfully and advance to next packet.  
       ** If NACK is for next packet, also need to advance to next packet.
       */
-      if ((rx_nack == tx_info.last_sn_txd) || (rx_nack == ComputeNextSN(tx_info.last_sn_txd)))
+      if ((rx_nack == ctx->tx_info.last_sn_txd) || (rx_nack == ComputeNextSN(ctx->tx_info.last_sn_txd)))
       {
 #if (defined(SL_LOGMSG))
-         sprintf(log_buff, ">>>>>PickTxPacket: trans next packet (rx_nack=%d, last_sn_txd=%d, tx_nack=%d) \n", rx_nack, tx_info.last_sn_txd, tx_nack);
+         sprintf(log_buff, ">>>>>PickTxPacket: trans next packet (rx_nack=%d, last_sn_txd=%d, tx_nack=%d) \n", rx_nack, ctx->tx_info.last_sn_txd, tx_nack);
          LogMsg(log_buff);
 #endif
-         TransmitNextPacket(tx_nack);
+         TransmitNextPacket(ctx, tx_nack);
       }
       else
       {
          /* NACK must be for previous packet, so go back */
 #if (defined(SL_LOGMSG))
-         sprintf(log_buff, ">>>>>PickTxPacket: go_back=-2 (rx_nack=%d, last_sn_txd=%d, tx_nack=%d) \n", rx_nack, tx_info.last_sn_txd, tx_nack);
+         sprintf(log_buff, ">>>>>PickTxPacket: go_back=-2 (rx_nack=%d, last_sn_txd=%d, tx_nack=%d) \n", rx_nack, ctx->tx_info.last_sn_txd, tx_nack);
          LogMsg(log_buff);
 #endif
-         tx_info.go_back = -2;
-         RetransmitPacket(rx_info.next_sn);
+         ctx->tx_info.go_back = -2;
+         RetransmitPacket(ctx, ctx->rx_info.next_sn);
       }
    }
 }
 
 /*******************************************************************************
- * Function: SL_UnloadPacketStart
+ * Function: WinFindAck
+ *      Checks if a packet starts with a LINK ACK message (selective repeat mode).
  *
  * Parameters:
- *		See documentation in spi_lib.h.
+ *	    packet_ptr - the packet, its CRC has been verified.
+ *
+ * Returns:
+ *		Non-0 if the packet starts with a LINK ACK message.
+ ******************************************************************************/
+static int WinFindAck(U8 *packet_ptr)
+{
+   U8 *msg_ptr = &packet_ptr[ PKT_HDR_BYTES ];
+
+   return(((packet_ptr[ PKT_MSG_COUNT_LSB ] != 0) || (packet_ptr[ PKT_MSG_COUNT_MSB ] != 0)) &&
+          (msg_ptr[ MSG_ID_LSB ] == 0) && (msg_ptr[ MSG_ID_MSB ] == 0) &&
+          (msg_ptr[ MSG_LEN_LSB ] == (LEN_LINK_ACK_MSG + MSG_HDR_BYTES)) && (msg_ptr[ MSG_LEN_MSB ] == 0) &&
+          (msg_ptr[ MSG_HDR_BYTES + MSG_ID_LSB ] == ID_LINK_ACK_MSG) && (msg_ptr[ MSG_HDR_BYTES + MSG_ID_MSB ] == 0) &&
+          (msg_ptr[ MSG_HDR_BYTES + MSG_LEN_LSB ] == LEN_LINK_ACK_MSG) && (msg_ptr[ MSG_HDR_BYTES + MSG_LEN_MSB ] == 0));
+}
+
+/*******************************************************************************
+ * Function: WinLoadAck
+ *      Loads the data of a LINK ACK message with the packets Rx'd so far.
+ *
+ * Parameters:
+ *	    ctx - the context of the link.
+ *	    ack - the LEN_LINK_ACK_MSG bytes of message data.
+ *
+ * Returns:
+ *		None.
+ ******************************************************************************/
+static void WinLoadAck(SL_CONTEXT *ctx, U8 *ack)
+{
+   int ack_map = 0;
+   int i;
+
+   for (i = 1; i < ctx->win.size; ++i)
+   {
+      if (ctx->win.rx_held[ (ctx->win.rx_base_slot + i) % ctx->win.size ] != 0)
+      {
+         ack_map |= 1 << (i - 1);
+      }
+   }
+
+   ack[ LINK_ACK_SN_LSB ] = GET_LSB(ctx->rx_info.next_sn);
+   ack[ LINK_ACK_SN_MSB ] = GET_MSB(ctx->rx_info.next_sn);
+   ack[ LINK_ACK_MAP_LSB ] = GET_LSB(ack_map);
+   ack[ LINK_ACK_MAP_MSB ] = GET_MSB(ack_map);
+   ack[ LINK_ACK_WINDOW ] = (U8) ctx->win.size;
+   if (ctx->win.tx_active != 0)
+   {
+      ack[ LINK_ACK_WINDOW ] |= LINK_ACK_FLAG_TX;
+   }
+}
+
+/*******************************************************************************
+ * Function: WinRxAck
+ *      Processes the LINK ACK message of a packet Rx'd.  Packets are Tx'd in
+ *      selective repeat mode from the first acknowledgement Rx'd once both nodes
+ *      have advertised a window, the LINK ACK advertises the window as well.
+ *
+ * Parameters:
+ *	    ctx - the context of the link.
+ *	    ack - the data of the LINK ACK message.
+ *
+ * Returns:
+ *		None.
+ ******************************************************************************/
+static void WinRxAck(SL_CONTEXT *ctx, U8 *ack)
+{
+   int ack_sn = ack[ LINK_ACK_SN_LSB ] + (ack[ LINK_ACK_SN_MSB ] * 256);
+   int ack_map = ack[ LINK_ACK_MAP_LSB ] + (ack[ LINK_ACK_MAP_MSB ] * 256);
+   int window = ack[ LINK_ACK_WINDOW ] & LINK_ACK_WINDOW_MASK;
+
+   if ((ack[ LINK_ACK_WINDOW ] & LINK_ACK_FLAG_TX) != 0)
+   {
+      ctx->win.rx_active = 1;
+   }
+   if ((window >= 2) && (window <= SL_MAX_WINDOW))
+   {
+      ctx->win.peer_size = window;
+   }
+
+   if (!WIN_NEGOTIATED(ctx))
+   {
+      return;
+   }
+   if (ctx->win.tx_active == 0)
+   {
+      WinTxStart(ctx, ack_sn);
+   }
+   if (ctx->win.tx_active != 0)
+   {
+      WinTxAck(ctx, ack_sn, ack_map);
+   }
+}
+
+/*******************************************************************************
+ * Function: WinTxStart
+ *      Switches Tx to selective repeat mode.  The packets Tx'd in stop-and-wait
+ *      mode which the other node has not Rx'd yet (at most the last two loaded)
+ *      are copied to the window.  If the other node is further behind the switch
+ *      waits for a later acknowledgement.
+ *
+ * Parameters:
+ *	    ctx - the context of the link.
+ *	    ack_sn - the next SN expected by the other node.
+ *
+ * Returns:
+ *		None.
+ ******************************************************************************/
+static void WinTxStart(SL_CONTEXT *ctx, int ack_sn)
+{
+   U8 *pkt_ptr[2];
+   int outstanding;
+   int sn;
+   int i;
+
+   outstanding = SnDistance(ack_sn, ctx->tx_info.next_sn);
+   if ((ack_sn == 0) || (outstanding > 2) || (outstanding > WIN_USED(ctx)))
+   {
+      return;
+   }
+
+   pkt_ptr[0] = (outstanding == 2) ? ctx->tx_info.oldest_pkt_ptr : ctx->tx_info.newest_pkt_ptr;
+   pkt_ptr[1] = ctx->tx_info.newest_pkt_ptr;
+   for (i = 0, sn = ack_sn; i < outstanding; ++i, sn = ComputeNextSN(sn))
+   {
+      if ((pkt_ptr[i][ PKT_SN_LSB ] + (pkt_ptr[i][ PKT_SN_MSB ] * 256)) != sn)
+      {
+         return;
+      }
+   }
+
+   ctx->win.tx_base_sn = ack_sn;
+   ctx->win.tx_base_slot = 0;
+   memset(ctx->win.tx_state, WIN_FREE, sizeof(ctx->win.tx_state));
+   for (i = 0, sn = ack_sn; i < outstanding; ++i, sn = ComputeNextSN(sn))
+   {
+      memcpy(WIN_TX_BUFFER(ctx, i), pkt_ptr[i], YZ_SPI_PKT_SIZE);
+      ctx->win.tx_state[i] = WIN_SENT;
+      ctx->win.tx_xfer[i] = (sn == ctx->tx_info.last_sn_txd) ? ctx->win.xfer : (ctx->win.xfer - 1);
+   }
+
+   ctx->win.tx_active = 1;
+   ctx->tx_info.go_back = 0;
+   ctx->tx_info.pkt_ptr = NULL;
+}
+
+/*******************************************************************************
+ * Function: WinTxStop
+ *      Switches Tx back to stop-and-wait mode once the window has drained.
+ *
+ * Parameters:
+ *	    ctx - the context of the link.
+ *
+ * Returns:
+ *		None.
+ ******************************************************************************/
+static void WinTxStop(SL_CONTEXT *ctx)
+{
+   ctx->win.tx_active = 0;
+   ctx->tx_info.go_back = 0;
+   ctx->tx_info.pkt_ptr = NULL;
+}
+
+/*******************************************************************************
+ * Function: WinTxAck
+ *      Releases the packets acknowledged by the other node and marks those it 
+ *      has not Rx'd for retransmission.  The other node loaded its packet after 
+ *      unloading the one Tx'd in the previous transfer, so the acknowledgement
+ *      covers every packet except the one Tx'd in this transfer.
+ *
+ * Parameters:
+ *	    ctx - the context of the link.
+ *	    ack_sn - the next SN expected by the other node.
+ *	    ack_map - bit i set when packet ack_sn+1+i has been Rx'd.
+ *
+ * Returns:
+ *		None.
+ ******************************************************************************/
+static void WinTxAck(SL_CONTEXT *ctx, int ack_sn, int ack_map)
+{
+   int outstanding;
+   int slot;
+   int i;
+
+   /*
+   ** Ignore an acknowledgement of packets not Tx'd (the other node has been reset).
+   */
+   outstanding = SnDistance(ctx->win.tx_base_sn, ctx->tx_info.next_sn);
+   if ((ack_sn == 0) || (SnDistance(ctx->win.tx_base_sn, ack_sn) > outstanding))
+   {
+      return;
+   }
+
+   while (ctx->win.tx_base_sn != ack_sn)
+   {
+      ctx->win.tx_state[ ctx->win.tx_base_slot ] = WIN_FREE;
+      ctx->win.tx_base_slot = (ctx->win.tx_base_slot + 1) % ctx->win.size;
+      ctx->win.tx_base_sn = ComputeNextSN(ctx->win.tx_base_sn);
+   }
+
+   outstanding = SnDistance(ctx->win.tx_base_sn, ctx->tx_info.next_sn);
+   for (i = 0; i < outstanding; ++i)
+   {
+      slot = (ctx->win.tx_base_slot + i) % ctx->win.size;
+      if ((i > 0) && ((ack_map & (1 << (i - 1))) != 0))
+      {
+         ctx->win.tx_state[ slot ] = WIN_ACKED;
+      }
+      else if ((ctx->win.tx_state[ slot ] == WIN_SENT) && (ctx->win.tx_xfer[ slot ] != ctx->win.xfer))
+      {
+         ctx->win.tx_state[ slot ] = WIN_LOST;
+      }
+   }
+}
+
+/*******************************************************************************
+ * Function: WinTxPick
+ *      Decides what packet should be Tx'd next in selective repeat mode.  The 
+ *      oldest packet lost is retransmitted first since the other node holds the
+ *      packets Rx'd after it, otherwise a new packet is loaded if the window is
+ *      not full.  A full window without any packet lost means acknowledgements
+ *      were not Rx'd, the oldest packet not acknowledged is retransmitted.  No 
+ *      new packet is loaded while the window drains, Tx returns to stop-and-wait
+ *      mode once it is empty.
+ *
+ * Parameters:
+ *	    ctx - the context of the link.
+ *
+ * Returns:
+ *		None, tx_info.pkt_ptr is the packet to retransmit or NULL to load a new one.
+ ******************************************************************************/
+static void WinTxPick(SL_CONTEXT *ctx)
+{
+   int outstanding;
+   int slot;
+   int i;
+
+   outstanding = SnDistance(ctx->win.tx_base_sn, ctx->tx_info.next_sn);
+   if ((outstanding == 0) && !WIN_NEGOTIATED(ctx))
+   {
+      /*
+      ** The window has drained, continue in stop-and-wait mode.
+      */
+      WinTxStop(ctx);
+      return;
+   }
+   for (i = 0; i < outstanding; ++i)
+   {
+      slot = (ctx->win.tx_base_slot + i) % ctx->win.size;
+      if (ctx->win.tx_state[ slot ] == WIN_LOST)
+      {
+         WinTxRetransmit(ctx, slot);
+         return;
+      }
+   }
+
+   if (outstanding < WIN_USED(ctx))
+   {
+      return;
+   }
+
+   for (i = 0; i < outstanding; ++i)
+   {
+      slot = (ctx->win.tx_base_slot + i) % ctx->win.size;
+      if (ctx->win.tx_state[ slot ] == WIN_SENT)
+      {
+         WinTxRetransmit(ctx, slot);
+         return;
+      }
+   }
+   WinTxRetransmit(ctx, ctx->win.tx_base_slot);
+}
+
+/*******************************************************************************
+ * Function: WinTxRetransmit
+ *      Retransmits a packet of the window with the current NACK and 
+ *      acknowledgement.
+ *
+ * Parameters:
+ *	    ctx - the context of the link.
+ *	    slot - the Tx buffer of the packet.
+ *
+ * Returns:
+ *		None.
+ ******************************************************************************/
+static void WinTxRetransmit(SL_CONTEXT *ctx, int slot)
+{
+   U8 *pkt_ptr = WIN_TX_BUFFER(ctx, slot);
+   U16 crc;
+
+   INCREMENT_STAT(ctx->stats.pkt_tx_retries);
+   pkt_ptr[ PKT_NACK_LSB ] = GET_LSB(ctx->tx_info.next_nack);
+   pkt_ptr[ PKT_NACK_MSB ] = GET_MSB(ctx->tx_info.next_nack);
+   if (WinFindAck(pkt_ptr) != 0)
+   {
+      WinLoadAck(ctx, &pkt_ptr[ LINK_ACK_OFFSET ]);
+   }
+   crc = CalculateCrc(&pkt_ptr[sizeof(crc)], (YZ_SPI_PKT_SIZE-sizeof(crc)));
+   pkt_ptr[ PKT_CRC_LSB ] = GET_LSB(crc);
+   pkt_ptr[ PKT_CRC_MSB ] = GET_MSB(crc);
+   ctx->tx_info.last_sn_txd = pkt_ptr[ PKT_SN_LSB ] + (pkt_ptr[ PKT_SN_MSB ] * 256);
+   ctx->tx_info.pkt_ptr = pkt_ptr;
+}
+
+/*******************************************************************************
+ * Function: WinTxSent
+ *      Records that the packet of tx_info.pkt_ptr has been handed out for Tx.
+ *
+ * Parameters:
+ *	    ctx - the context of the link.
+ *
+ * Returns:
+ *		None.
+ ******************************************************************************/
+static void WinTxSent(SL_CONTEXT *ctx)
+{
+   int slot;
+
+   slot = WinTxSlot(ctx, ctx->tx_info.pkt_ptr[ PKT_SN_LSB ] + (ctx->tx_info.pkt_ptr[ PKT_SN_MSB ] * 256));
+   ctx->win.tx_state[ slot ] = WIN_SENT;
+   ctx->win.tx_xfer[ slot ] = ctx->win.xfer;
+}
+
+/*******************************************************************************
+ * Function: WinTxSlot
+ *      Computes the Tx buffer of a packet of the window.
+ *
+ * Parameters:
+ *	    ctx - the context of the link.
+ *	    sn - the SN of the packet.
+ *
+ * Returns:
+ *		The index of the Tx buffer.
+ ******************************************************************************/
+static int WinTxSlot(SL_CONTEXT *ctx, int sn)
+{
+   return((ctx->win.tx_base_slot + SnDistance(ctx->win.tx_base_sn, sn)) % ctx->win.size);
+}
+
+/*******************************************************************************
+ * Function: WinPeerReset
+ *      Returns Rx to stop-and-wait mode when a COMM RESET is Rx'd, the window 
+ *      of the other node is advertised again in the same packet.  The Tx window
+ *      drains unless it is.  The window of this node is advertised again in the
+ *      next packet.
+ *
+ * Parameters:
+ *	    ctx - the context of the link.
+ *
+ * Returns:
+ *		None.
+ ******************************************************************************/
+static void WinPeerReset(SL_CONTEXT *ctx)
+{
+   ctx->win.peer_size = 0;
+   ctx->win.rx_active = 0;
+   memset(ctx->win.rx_held, 0, sizeof(ctx->win.rx_held));
+   if (ctx->win.size != 0)
+   {
+      ctx->win.version_flag = 1;
+   }
+}
+
+/*******************************************************************************
+ * Function: WinRxNext
+ *      Continues unloading with the packet held for the next SN expected, if any.
+ *
+ * Parameters:
+ *	    ctx - the context of the link.
+ *
+ * Returns:
+ *		Non-0 if unloading continues with a packet held.
+ ******************************************************************************/
+static int WinRxNext(SL_CONTEXT *ctx)
+{
+   int slot = ctx->win.rx_base_slot;
+
+   if ((ctx->win.size == 0) || (ctx->win.rx_held[ slot ] == 0))
+   {
+      return(0);
+   }
+
+   ctx->win.rx_held[ slot ] = 0;
+   ctx->win.rx_base_slot = (slot + 1) % ctx->win.size;
+   ctx->rx_info.pkt_ptr = WIN_RX_BUFFER(ctx, slot);
+   ctx->rx_info.msgs_left = ctx->rx_info.pkt_ptr[ PKT_MSG_COUNT_LSB ] + (ctx->rx_info.pkt_ptr[ PKT_MSG_COUNT_MSB ] * 256);
+   ctx->rx_info.unload_index = PKT_HDR_BYTES;
+   ctx->rx_info.next_sn = ComputeNextSN(ctx->rx_info.next_sn);
+   INCREMENT_STAT(ctx->stats.pkts_consumed);
+   return(1);
+}
+
+/*******************************************************************************
+ * Function: SL_CtxUnloadPacketStart
+ *
+ * Parameters:
+ *		See documentation in spi_lib.h.
  *
  * Returns:
  *		See documenation in spi_lib.h
  ******************************************************************************/
-int SL_UnloadPacketStart(U8 *packet_ptr)
+int SL_CtxUnloadPacketStart(SL_CONTEXT *ctx, U8 *packet_ptr)
 {
    U16 crc_expected;
    U16 crc_packet;
@@ -1010,11 +1893,13 @@ int SL_UnloadPacketStart(U8 *packet_ptr)
    int next_index;
    int nack;
    int msg_cnt;
+   int ahead;
+   int slot;
 
    /*
    ** Confirm state is valid to start unloading.
    */
-   if (api_state != WAIT_UNLOAD_START)
+   if (ctx->api_state != WAIT_UNLOAD_START)
    {
       return(SL_SEQ_ERROR);
    }
@@ -1023,7 +1908,7 @@ int SL_UnloadPacketStart(U8 *packet_ptr)
    /*
    ** If TPL is enabled, clear the MSG_UNLOADED flag for each message xfer in progress.
    */
-   TPLClearUnload();
+   TPLClearUnload(ctx);
 #endif
 
 #if 0
@@ -1058,10 +1943,10 @@ int SL_UnloadPacketStart(U8 *packet_ptr)
       sprintf(log_buff, ">>>>>SL_UnloadPacketStart: Invalid CRC (crc_packet=0x%X  crc_expected=0x%X) \n", crc_packet, crc_expected);
       LogMsg(log_buff);
 #endif
-      RetransmitPacket(rx_info.next_sn);
-      INCREMENT_STAT(stats.crc_errors);
-      INCREMENT_STAT(stats.pkts_discarded);
-      api_state = WAIT_GET_TX_PKT;
+      RetransmitPacket(ctx, ctx->rx_info.next_sn);
+      INCREMENT_STAT(ctx->stats.crc_errors);
+      INCREMENT_STAT(ctx->stats.pkts_discarded);
+      ctx->api_state = WAIT_GET_TX_PKT;
       return(SL_INVALID_CRC);
    }
    /*
@@ -1106,13 +1991,13 @@ int SL_UnloadPacketStart(U8 *packet_ptr)
          ** Treat EOP error just like a CRC error. 
          */
 #if (defined(SL_LOGMSG))
-         sprintf(log_buff, ">>>>>SL_UnloadPacketStart: EOP, re-transmit last packet w/NACK=%d \n", rx_info.next_sn);
+         sprintf(log_buff, ">>>>>SL_UnloadPacketStart: EOP, re-transmit last packet w/NACK=%d \n", ctx->rx_info.next_sn);
          LogMsg(log_buff);
 #endif
-         RetransmitPacket(rx_info.next_sn);
-         INCREMENT_STAT(stats.pkts_discarded);
-         INCREMENT_STAT(stats.EOP_errors);
-         api_state = WAIT_GET_TX_PKT;
+         RetransmitPacket(ctx, ctx->rx_info.next_sn);
+         INCREMENT_STAT(ctx->stats.pkts_discarded);
+         INCREMENT_STAT(ctx->stats.EOP_errors);
+         ctx->api_state = WAIT_GET_TX_PKT;
          return(SL_EOP_ERROR);  
       }
    } 
@@ -1123,7 +2008,7 @@ int SL_UnloadPacketStart(U8 *packet_ptr)
    nack = packet_ptr[ PKT_NACK_LSB ] + (packet_ptr[ PKT_NACK_MSB ] * 256);
    if (nack != 0)
    {
-      INCREMENT_STAT(stats.nack_rx_nz);
+      INCREMENT_STAT(ctx->stats.nack_rx_nz);
    }
 
    sn = (U16) (packet_ptr[ PKT_SN_LSB ] + (packet_ptr[ PKT_SN_MSB ] * 256));
@@ -1152,37 +2037,79 @@ int SL_UnloadPacketStart(U8 *packet_ptr)
                  (packet_ptr[ PKT_HDR_BYTES + MSG_HDR_BYTES + MSG_ID_MSB ] * 256);
          if (msg_id == ID_COMM_RESET_MSG)
          {
-            rx_info.next_sn = 1;
+            ctx->rx_info.next_sn = 1;
+            WinPeerReset(ctx);
          }
       }
    }
 
+   /*
+   ** In selective repeat mode every packet starts with a LINK ACK message.  It is 
+   ** processed before the SN is checked, the acknowledgement in a packet Rx'd twice 
+   ** is as recent as any other.  The message will be unloaded (and ignored) later.
+   */
+   if ((ctx->win.size != 0) && (WinFindAck(packet_ptr) != 0))
+   {
+      WinRxAck(ctx, &packet_ptr[ LINK_ACK_OFFSET ]);
+   }
+
    /*
    ** Next SN to Rx is set to 0 during initilaization and since the other node may have been up 
    ** and running already just accept it's sequence number as valid and continue from there.
    */
-   if (rx_info.next_sn == 0)
+   if (ctx->rx_info.next_sn == 0)
    {
-      rx_info.next_sn = sn; 
+      ctx->rx_info.next_sn = sn; 
    }
    
    /*
    ** Verify the SN is as expected.
    */
-   if (sn != rx_info.next_sn)
+   if ((sn != ctx->rx_info.next_sn) && (ctx->win.rx_active != 0))
+   {
+      ahead = SnDistance(ctx->rx_info.next_sn, sn);
+      if (ahead < ctx->win.size)
+      {
+         /*
+         ** In selective repeat mode a packet Rx'd ahead of a missing one is held, it is 
+         ** unloaded after the missing one is retransmitted.
+         */
+         slot = (ctx->win.rx_base_slot + ahead) % ctx->win.size;
+         if (ctx->win.rx_held[ slot ] == 0)
+         {
+            memcpy(WIN_RX_BUFFER(ctx, slot), packet_ptr, YZ_SPI_PKT_SIZE);
+            ctx->win.rx_held[ slot ] = 1;
+         }
+         PickTxPacket(ctx, nack, 0);
+         ctx->api_state = WAIT_GET_TX_PKT;
+         return(SL_PKT_HELD);
+      }
+      if (SnDistance(sn, ctx->rx_info.next_sn) <= ctx->win.size)
+      {
+         /*
+         ** Packet already Rx'd, retransmitted before its acknowledgement was Rx'd.
+         */
+         PickTxPacket(ctx, nack, 0);
+         INCREMENT_STAT(ctx->stats.pkts_discarded);
+         ctx->api_state = WAIT_GET_TX_PKT;
+         return(SL_INVALID_SN);
+      }
+   }
+
+   if (sn != ctx->rx_info.next_sn)
    {
       /*
       ** SN is not as expected, so the packet must be discarded.  The packet to Tx will 
       ** be based on the NACK received.
       */
 #if (defined(SL_LOGMSG))
-      sprintf(log_buff, ">>>>SL_UnloadPacketStart:Invalid SN expected SN %d got %d (NACK=%d)\n", rx_info.next_sn, sn, nack);
+      sprintf(log_buff, ">>>>SL_UnloadPacketStart:Invalid SN expected SN %d got %d (NACK=%d)\n", ctx->rx_info.next_sn, sn, nack);
       LogMsg(log_buff);
 #endif
-      PickTxPacket(nack, rx_info.next_sn);
-      INCREMENT_STAT(stats.sn_errors);
-      INCREMENT_STAT(stats.pkts_discarded);
-      api_state = WAIT_GET_TX_PKT;
+      PickTxPacket(ctx, nack, ctx->rx_info.next_sn);
+      INCREMENT_STAT(ctx->stats.sn_errors);
+      INCREMENT_STAT(ctx->stats.pkts_discarded);
+      ctx->api_state = WAIT_GET_TX_PKT;
       
       return(SL_INVALID_SN);
    }
@@ -1190,23 +2117,27 @@ int SL_UnloadPacketStart(U8 *packet_ptr)
    /*
    ** If we get here, the incoming packet is valid so prepare for unloading.
    */
-   INCREMENT_STAT(stats.pkts_consumed);
-   api_state = UNLOADING;
-   rx_info.msgs_left =  msg_cnt;
-   rx_info.next_sn = ComputeNextSN(rx_info.next_sn); 
-   rx_info.unload_index = PKT_HDR_BYTES;
-   rx_info.pkt_ptr = packet_ptr;
+   INCREMENT_STAT(ctx->stats.pkts_consumed);
+   ctx->api_state = UNLOADING;
+   ctx->rx_info.msgs_left =  msg_cnt;
+   ctx->rx_info.next_sn = ComputeNextSN(ctx->rx_info.next_sn); 
+   ctx->rx_info.unload_index = PKT_HDR_BYTES;
+   ctx->rx_info.pkt_ptr = packet_ptr;
+   if (ctx->win.size != 0)
+   {
+      ctx->win.rx_base_slot = (ctx->win.rx_base_slot + 1) % ctx->win.size;
+   }
 
    /*
    ** Lastly, decide what packet to Tx next (which will be based on the NACK received).
    */
-   PickTxPacket(nack, 0);
+   PickTxPacket(ctx, nack, 0);
 
    return(SL_SUCCESS);
 }
 
 /*******************************************************************************
- * Function: SL_UnloadPacketMsg
+ * Function: SL_CtxUnloadPacketMsg
  *
  * Parameters:
  *		See documentation in spi_lib.h.
@@ -1214,14 +2145,14 @@ int SL_UnloadPacketStart(U8 *packet_ptr)
  * Returns:
  *		See documenation in spi_lib.h
  ******************************************************************************/
-int SL_UnloadPacketMsg(int *msg_id, int *msg_size_bytes, U8 **buff_ptr)
+int SL_CtxUnloadPacketMsg(SL_CONTEXT *ctx, int *msg_id, int *msg_size_bytes, U8 **buff_ptr)
 {
    int rc = 0;
 
    /*
    ** Confirm state is valid for unloading.
    */
-   if (api_state != UNLOADING)
+   if (ctx->api_state != UNLOADING)
    {
       return(SL_SEQ_ERROR);
    }
@@ -1231,18 +2162,25 @@ int SL_UnloadPacketMsg(int *msg_id, int *msg_size_bytes, U8 **buff_ptr)
    */
    do 
    {
-      if (rx_info.msgs_left == 0)
+      /*
+      ** In selective repeat mode continue with the packets held that are now in sequence.
+      */
+      while ((ctx->rx_info.msgs_left == 0) && (WinRxNext(ctx) != 0))
+      {
+      }
+
+      if (ctx->rx_info.msgs_left == 0)
       {
          /*
          ** No more messages to unload, next API state is to get (or load) next Tx packet.
          */
-         api_state = WAIT_GET_TX_PKT;
+         ctx->api_state = WAIT_GET_TX_PKT;
 
 #if (YZ_SPI_TPL_ENABLE != 0)
    /*
    ** If TPL is enabled, check the MSG_UNLOADED flag for each message xfer in progress.
    */
-   TPLCheckUnload();
+   TPLCheckUnload(ctx);
 #endif
 
          return(SL_NO_MORE_MSGS);
@@ -1251,17 +2189,17 @@ int SL_UnloadPacketMsg(int *msg_id, int *msg_size_bytes, U8 **buff_ptr)
       /*
       ** Unload message id and length. 
       */
-	  *msg_id = rx_info.pkt_ptr[ rx_info.unload_index + MSG_ID_LSB ] + 
-                (rx_info.pkt_ptr[ rx_info.unload_index + MSG_ID_MSB ] * 256);
-      *msg_size_bytes = rx_info.pkt_ptr[ rx_info.unload_index + MSG_LEN_LSB ] + 
-                        (rx_info.pkt_ptr[ rx_info.unload_index + MSG_LEN_MSB ] * 256);
-      --rx_info.msgs_left;
+	  *msg_id = ctx->rx_info.pkt_ptr[ ctx->rx_info.unload_index + MSG_ID_LSB ] + 
+                (ctx->rx_info.pkt_ptr[ ctx->rx_info.unload_index + MSG_ID_MSB ] * 256);
+      *msg_size_bytes = ctx->rx_info.pkt_ptr[ ctx->rx_info.unload_index + MSG_LEN_LSB ] + 
+                        (ctx->rx_info.pkt_ptr[ ctx->rx_info.unload_index + MSG_LEN_MSB ] * 256);
+      --ctx->rx_info.msgs_left;
 
       if (*msg_id == ID_STATUS_MSG)
       {
-         rx_info.unload_index += MSG_HDR_BYTES;  /* Advance to StatusMsg ID */
-         INCREMENT_STAT(stats.msgs_unloaded);
-         rc = UnloadStatusMsg(msg_id, msg_size_bytes, buff_ptr);
+         ctx->rx_info.unload_index += MSG_HDR_BYTES;  /* Advance to StatusMsg ID */
+         INCREMENT_STAT(ctx->stats.msgs_unloaded);
+         rc = UnloadStatusMsg(ctx, msg_id, msg_size_bytes, buff_ptr);
          if (rc != 0)
          {
             return(SL_SUCCESS_STATUS_MSG);
@@ -1280,28 +2218,28 @@ int SL_UnloadPacketMsg(int *msg_id, int *msg_size_bytes, U8 **buff_ptr)
       */
       else if (*msg_id == ID_TPL_MSG)
       {
-         rx_info.unload_index += MSG_HDR_BYTES;  /* Advance to TPLMsgID */
-         UnloadTPLMsg(*msg_size_bytes);
-         INCREMENT_STAT(stats.msgs_unloaded);
+         ctx->rx_info.unload_index += MSG_HDR_BYTES;  /* Advance to TPLMsgID */
+         UnloadTPLMsg(ctx, *msg_size_bytes);
+         INCREMENT_STAT(ctx->stats.msgs_unloaded);
       }
 #endif
    
       /*
       ** Check to see if the "regular" message unloaded has a valid ID.
       */
-      else if ( (*msg_id < rx_info.min_msg_id) || (*msg_id > rx_info.max_msg_id))
+      else if ( (*msg_id < ctx->rx_info.min_msg_id) || (*msg_id > ctx->rx_info.max_msg_id))
       {
-         rx_info.unload_index += MSG_HDR_BYTES + *msg_size_bytes;  /* Advance past msg w/invalid ID */
-         INCREMENT_STAT(stats.msg_id_errors);
+         ctx->rx_info.unload_index += MSG_HDR_BYTES + *msg_size_bytes;  /* Advance past msg w/invalid ID */
+         INCREMENT_STAT(ctx->stats.msg_id_errors);
       }
-   } while ( (*msg_id < rx_info.min_msg_id) || (*msg_id > rx_info.max_msg_id) );
+   } while ( (*msg_id < ctx->rx_info.min_msg_id) || (*msg_id > ctx->rx_info.max_msg_id) );
    
    /*
    ** A valid "regular" message was unloaded.
    */
-   INCREMENT_STAT(stats.msgs_unloaded);
-   *buff_ptr = &rx_info.pkt_ptr[ rx_info.unload_index + MSG_HDR_BYTES ]; 
-   rx_info.unload_index += MSG_HDR_BYTES + *msg_size_bytes;
+   INCREMENT_STAT(ctx->stats.msgs_unloaded);
+   *buff_ptr = &ctx->rx_info.pkt_ptr[ ctx->rx_info.unload_index + MSG_HDR_BYTES ]; 
+   ctx->rx_info.unload_index += MSG_HDR_BYTES + *msg_size_bytes;
    return(SL_SUCCESS);
 }
 
@@ -1316,10 +2254,19 @@ int SL_UnloadPacketMsg(int *msg_id, int *msg_size_bytes, U8 **buff_ptr)
  ******************************************************************************/
 void SL_DispatchMsg(int msg_id, int msg_size_bytes, U8 * const msg_data)
 {
-   if ((msg_id > 0) && (msg_id <= LAST_MSG_DISPATCH_TABLE_ID))
+   DISPATCH_ENTRY *entry;
+   int i;
+
+   if ((msg_id > 0) && (msg_id < SL_MSG_ID_SLOTS))
    {
+      DispatchInitTable();
       //PRINTF("SL_Dispatch: invoking dispatch function\n");
-      (*msg_dispatch_table[ msg_id ])(msg_size_bytes, msg_data);
+      entry = &dispatch_table[ msg_id ];
+      (void)__atomic_add_fetch(&entry->dispatch_cnt, 1, __ATOMIC_RELAXED);   /* links may dispatch concurrently */
+      for (i = 0; i < entry->num_handlers; ++i)
+      {
+         (*entry->handler[ i ])(msg_size_bytes, msg_data);
+      }
    }
    else
    {
@@ -1327,34 +2274,283 @@ void SL_DispatchMsg(int msg_id, int msg_size_bytes, U8 * const msg_data)
    }
 }
 
-
 /*******************************************************************************
- * Function: SL_GetProtocolVersion
+ * Function: DispatchInitTable
+ *      Registers the handler of msg_dispatch_table for each msg id, the first
+ *      time it is called.  Safe to call from several threads (links) at once:
+ *      one thread registers the handlers, the others wait until it is done.
  *
  * Parameters:
- *		See documentation in spi_lib.h.
+ *		None.
  *
  * Returns:
- *		See documenation in spi_lib.h
+ *		None.
  ******************************************************************************/
-int SL_GetProtocolVersion(void)
+static void DispatchInitTable(void)
 {
-   return(SUPPORTED_SPI_PROTOCOL_VERSION);
+   int state = DISPATCH_TABLE_EMPTY;
+   int msg_id;
+
+   if (__atomic_load_n(&dispatch_table_state, __ATOMIC_ACQUIRE) == DISPATCH_TABLE_READY)
+   {
+      return;
+   }
+   if (!__atomic_compare_exchange_n(&dispatch_table_state, &state, DISPATCH_TABLE_BUSY, FALSE,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+   {
+      while (__atomic_load_n(&dispatch_table_state, __ATOMIC_ACQUIRE) != DISPATCH_TABLE_READY)
+      {
+         /* another thread is registering the handlers */
+      }
+      return;
+   }
+
+   for (msg_id = 1; (msg_id <= (int)LAST_MSG_DISPATCH_TABLE_ID) && (msg_id < SL_MSG_ID_SLOTS); ++msg_id)
+   {
+      if (msg_dispatch_table[ msg_id ] != NULL)
+      {
+         (void)DispatchAddHandler(&dispatch_table[ msg_id ], msg_dispatch_table[ msg_id ]);
+      }
+   }
+   __atomic_store_n(&dispatch_table_state, DISPATCH_TABLE_READY, __ATOMIC_RELEASE);
 }
 
 /*******************************************************************************
- * Function: SL_GetStatistics
- *		See documentation in spi_lib.h.
- * 
+ * Function: DispatchAddHandler
+ *      Adds a handler to the handlers of a msg id, after those already there.
+ *
+ * Parameters:
+ *		entry - the handlers of the msg id.
+ *		handler - the handler to add.
+ *
+ * Returns:
+ *		SL_SUCCESS if added (or already there), SL_HANDLER_LIMIT if the entry is full.
+ ******************************************************************************/
+static int DispatchAddHandler(DISPATCH_ENTRY *entry, MsgHandler handler)
+{
+   int i;
+
+   for (i = 0; i < entry->num_handlers; ++i)
+   {
+      if (entry->handler[ i ] == handler)
+      {
+         return(SL_SUCCESS);
+      }
+   }
+   if (entry->num_handlers == SL_MAX_MSG_HANDLERS)
+   {
+      return(SL_HANDLER_LIMIT);
+   }
+   entry->handler[ entry->num_handlers++ ] = handler;
+   return(SL_SUCCESS);
+}
+
+/*******************************************************************************
+ * Function: SL_RegisterMsgHandler
+ *
+ * Parameters:
+ *		See documentation in spi_lib.h.
+ *
+ * Returns:
+ *		See documenation in spi_lib.h
+ ******************************************************************************/
+int SL_RegisterMsgHandler(int msg_id, SL_MSG_HANDLER handler)
+{
+   if ((msg_id <= 0) || (msg_id >= SL_MSG_ID_SLOTS) || (handler == NULL))
+   {
+      return(SL_INVALID_ID);
+   }
+   DispatchInitTable();
+
+   return(DispatchAddHandler(&dispatch_table[ msg_id ], handler));
+}
+
+/*******************************************************************************
+ * Function: SL_UnregisterMsgHandler
+ *
+ * Parameters:
+ *		See documentation in spi_lib.h.
+ *
+ * Returns:
+ *		See documenation in spi_lib.h
+ ******************************************************************************/
+int SL_UnregisterMsgHandler(int msg_id, SL_MSG_HANDLER handler)
+{
+   DISPATCH_ENTRY *entry;
+   int i;
+
+   if ((msg_id <= 0) || (msg_id >= SL_MSG_ID_SLOTS))
+   {
+      return(SL_INVALID_ID);
+   }
+   DispatchInitTable();
+
+   entry = &dispatch_table[ msg_id ];
+   for (i = 0; i < entry->num_handlers; ++i)
+   {
+      if (entry->handler[ i ] == handler)
+      {
+         --entry->num_handlers;
+         for (; i < entry->num_handlers; ++i)
+         {
+            entry->handler[ i ] = entry->handler[ i + 1 ];
+         }
+         return(SL_SUCCESS);
+      }
+   }
+   return(SL_INVALID_ID);
+}
+
+/*******************************************************************************
+ * Function: SL_GetDispatchCount
+ *
+ * Parameters:
+ *		See documentation in spi_lib.h.
+ *
+ * Returns:
+ *		See documenation in spi_lib.h
+ ******************************************************************************/
+U32 SL_GetDispatchCount(int msg_id)
+{
+   if ((msg_id <= 0) || (msg_id >= SL_MSG_ID_SLOTS))
+   {
+      return(0);
+   }
+   return(__atomic_load_n(&dispatch_table[ msg_id ].dispatch_cnt, __ATOMIC_RELAXED));
+}
+
+
+/*******************************************************************************
+ * Function: SL_GetProtocolVersion
+ *
+ * Parameters:
+ *		See documentation in spi_lib.h.
+ *
+ * Returns:
+ *		See documenation in spi_lib.h
+ ******************************************************************************/
+int SL_GetProtocolVersion(void)
+{
+   return(SUPPORTED_SPI_PROTOCOL_VERSION);
+}
+
+/*******************************************************************************
+ * Function: SL_CtxGetStatistics
+ *		See documentation in spi_lib.h.
+ * 
  * Parameters:
  *		See documentation in spi_lib.h.
  *
  * Returns: 
  *		See documentation in spi_lib.h.
  ******************************************************************************/
-void SL_GetStatistics(SL_STATS_RECORD *stats_buff)
+void SL_CtxGetStatistics(SL_CONTEXT *ctx, SL_STATS_RECORD *stats_buff)
 {
-   *stats_buff = stats;
+   *stats_buff = ctx->stats;
+}
+
+/*******************************************************************************
+ * Function: SL_CtxEnableWindow
+ *		See documentation of SL_EnableWindow in spi_lib.h.
+ * 
+ * Parameters:
+ *		See documentation in spi_lib.h.
+ *
+ * Returns: 
+ *		See documentation in spi_lib.h.
+ ******************************************************************************/
+int SL_CtxEnableWindow(SL_CONTEXT *ctx, U8 *buffers, int window)
+{
+   if ((window != 0) && ((window < 2) || (window > SL_MAX_WINDOW) || (buffers == NULL)))
+   {
+      return(SL_NOT_SUPPORTED);
+   }
+   if ((ctx->win.tx_active != 0) || (ctx->win.rx_active != 0))
+   {
+      return(SL_SEQ_ERROR);
+   }
+
+   ctx->win.size = window;
+   ctx->win.tx_buffers = buffers;
+   ctx->win.rx_buffers = (window != 0) ? &buffers[ window * YZ_SPI_PKT_SIZE ] : NULL;
+   ctx->win.rx_base_slot = 0;
+   memset(ctx->win.rx_held, 0, sizeof(ctx->win.rx_held));
+
+   /*
+   ** Advertise the window in the next packet (a COMM RESET pending advertises it too).
+   */
+   ctx->win.version_flag = 1;
+   return(SL_SUCCESS);
+}
+
+/*******************************************************************************
+ * Function: SL_SetCrcEngine
+ *		See documentation in spi_lib.h.
+ * 
+ * Parameters:
+ *		See documentation in spi_lib.h.
+ *
+ * Returns: 
+ *		See documentation in spi_lib.h.
+ ******************************************************************************/
+int SL_SetCrcEngine(int engine)
+{
+   int selected = engine;
+   CrcFunction function;
+
+   /*
+   ** Slice-by-8 is the fastest engine measured with SL_TEST_CrcBenchmark, including
+   ** on CPUs with PCLMULQDQ (see CalculateCrcClmul).
+   */
+   if (engine == SL_CRC_ENGINE_AUTO)
+   {
+      selected = SL_CRC_ENGINE_SLICE8;
+   }
+
+   switch (selected)
+   {
+   case SL_CRC_ENGINE_BITWISE:
+      function = CalculateCrcBitwise;
+      break;
+   case SL_CRC_ENGINE_SLICE4:
+      function = CalculateCrcSlice4;
+      break;
+   case SL_CRC_ENGINE_SLICE8:
+      function = CalculateCrcSlice8;
+      break;
+#ifdef SL_CRC_HAVE_CLMUL
+   case SL_CRC_ENGINE_CLMUL:
+      if (!__builtin_cpu_supports("pclmul"))
+      {
+         return(SL_NOT_SUPPORTED);
+      }
+      function = CalculateCrcClmul;
+      break;
+#endif
+   default:
+      return(SL_NOT_SUPPORTED);
+   }
+
+   CrcInitTables();
+   __atomic_store_n(&crc_engine_req, engine, __ATOMIC_RELAXED);
+   __atomic_store_n(&crc_engine, selected, __ATOMIC_RELAXED);
+   __atomic_store_n(&crc_function, function, __ATOMIC_RELEASE);
+   return(SL_SUCCESS);
+}
+
+/*******************************************************************************
+ * Function: SL_GetCrcEngine
+ *		See documentation in spi_lib.h.
+ * 
+ * Parameters:
+ *		See documentation in spi_lib.h.
+ *
+ * Returns: 
+ *		See documentation in spi_lib.h.
+ ******************************************************************************/
+int SL_GetCrcEngine(void)
+{
+   return(__atomic_load_n(&crc_engine, __ATOMIC_RELAXED));
 }
 
 /*******************************************************************************
@@ -1381,30 +2577,73 @@ static int ComputeNextSN(int current_sn)
    return(next_sn);
 }
 
+/*******************************************************************************
+ * Function: SnDistance
+ *      Computes the number of packets from one SN to another, SN's wrap from
+ *      MAX_PKT_SN to 1 (see ComputeNextSN).
+ *
+ * Parameters:
+ *	    from_sn - the first SN
+ *	    to_sn - the second SN
+ *
+ * Returns:
+ *		The number of times ComputeNextSN is applied to from_sn to get to_sn.
+ ******************************************************************************/
+static int SnDistance(int from_sn, int to_sn)
+{
+   return((to_sn - from_sn + MAX_PKT_SN) % MAX_PKT_SN);
+}
+
 /********************************************************************************************
 *  Function: SendCommResetMsg
 *       Sends a COMM reset status message and a Protocol ID status message.
 *
 *  Parameters:    
-*       None. 
+*       ctx - the context of the link.
 *
 *  Returns:     
 *       None. 
 ********************************************************************************************/ 
-static void SendCommResetMsg(void)
+static void SendCommResetMsg(SL_CONTEXT *ctx)
 {
-   U8 protocol_version[LEN_PROTOCOL_VERSION_MSG];
    int bytes_left;
 
     /*
     ** The COMM reset msg must be sent first per the protocol definition.  There is no need to 
     ** check return codes since these messages are the first loaded in a packet.
     */
-   (void) LoadPacketStatusMsg(ID_COMM_RESET_MSG, sizeof(tx_info.comm_reset_reason), &tx_info.comm_reset_reason, &bytes_left);
+   (void) LoadPacketStatusMsg(ctx, ID_COMM_RESET_MSG, sizeof(ctx->tx_info.comm_reset_reason), &ctx->tx_info.comm_reset_reason, &bytes_left);
 
+   SendProtocolVersionMsg(ctx);
+}
+
+/********************************************************************************************
+*  Function: SendProtocolVersionMsg
+*       Sends a Protocol ID status message.  When the selective repeat mode is enabled the 
+*       window of this node follows the version, a node which does not support the mode 
+*       only reads the version.
+*
+*  Parameters:    
+*       ctx - the context of the link.
+*
+*  Returns:     
+*       None. 
+********************************************************************************************/ 
+static void SendProtocolVersionMsg(SL_CONTEXT *ctx)
+{
+   U8 protocol_version[LEN_PROTOCOL_VERSION_WIN_MSG];
+   int bytes_left;
+
+   /*
+   ** There is no need to check return codes since this message is loaded at the start of 
+   ** a packet.
+   */
    protocol_version[0] = SUPPORTED_SPI_PROTOCOL_VERSION % 256;  /* LSB */
    protocol_version[1] = SUPPORTED_SPI_PROTOCOL_VERSION / 256;  /* MSB */
-   (void) LoadPacketStatusMsg(ID_PROTOCOL_VERSION_MSG, sizeof(protocol_version), &protocol_version[0], &bytes_left);
+   protocol_version[2] = (U8) ctx->win.size;
+   (void) LoadPacketStatusMsg(ctx, ID_PROTOCOL_VERSION_MSG, 
+                              (ctx->win.size != 0) ? LEN_PROTOCOL_VERSION_WIN_MSG : LEN_PROTOCOL_VERSION_MSG, 
+                              &protocol_version[0], &bytes_left);
 }
 
 /*******************************************************************************
@@ -1416,6 +2655,7 @@ static void SendCommResetMsg(void)
  *         Status Message ID field 
  *
  * Parameters:
+ *      ctx - the context of the link.
  *      msg_id - ID of the status message unloaded
  *      msg_size_bytes - length of status message unloaded
  *      msg_data - pointer to first byte in status message unloaded
@@ -1426,7 +2666,7 @@ static void SendCommResetMsg(void)
  *          to the MM for processing)
  *      
  ******************************************************************************/
-static int UnloadStatusMsg(int *msg_id, int *msg_size_bytes, U8 **msg_data)
+static int UnloadStatusMsg(SL_CONTEXT *ctx, int *msg_id, int *msg_size_bytes, U8 **msg_data)
 {
    int rc = 1;
    U16 protocol_id;
@@ -1434,19 +2674,19 @@ static int UnloadStatusMsg(int *msg_id, int *msg_size_bytes, U8 **msg_data)
    /*
    ** Unload "status" message id and length (note their are no id checks for status messages).
    */
-   *msg_id = rx_info.pkt_ptr[ rx_info.unload_index + MSG_ID_LSB ] + 
-                   (rx_info.pkt_ptr[ rx_info.unload_index + MSG_ID_MSB ] * 256);
-   *msg_size_bytes = rx_info.pkt_ptr[ rx_info.unload_index + MSG_LEN_LSB ] + 
-                           (rx_info.pkt_ptr[ rx_info.unload_index + MSG_LEN_MSB ] * 256);
-   *msg_data = &rx_info.pkt_ptr[ rx_info.unload_index + MSG_HDR_BYTES ];
+   *msg_id = ctx->rx_info.pkt_ptr[ ctx->rx_info.unload_index + MSG_ID_LSB ] + 
+                   (ctx->rx_info.pkt_ptr[ ctx->rx_info.unload_index + MSG_ID_MSB ] * 256);
+   *msg_size_bytes = ctx->rx_info.pkt_ptr[ ctx->rx_info.unload_index + MSG_LEN_LSB ] + 
+                           (ctx->rx_info.pkt_ptr[ ctx->rx_info.unload_index + MSG_LEN_MSB ] * 256);
+   *msg_data = &ctx->rx_info.pkt_ptr[ ctx->rx_info.unload_index + MSG_HDR_BYTES ];
 
    switch (*msg_id)
    {
       case ID_COMM_RESET_MSG:
 #if (YZ_SPI_TPL_ENABLE != 0)
-         TPLAbortTxMsgs();
-         TPLAbortRxMsgs();
-         TPLInit();
+         TPLAbortTxMsgs(ctx);
+         TPLAbortRxMsgs(ctx);
+         TPLInit(ctx);
 #endif
          SLx_ErrorCallback( ERC_COMM_RESET_RXD );
          rc = 0;
@@ -1459,16 +2699,33 @@ static int UnloadStatusMsg(int *msg_id, int *msg_size_bytes, U8 **msg_data)
          {
             SLx_ErrorCallback( ERC_SPI_LIB_VER_MISMATCH );
          }
+
+         /*
+         ** Window of the other node, absent if it does not support the selective repeat mode.
+         */
+         ctx->win.peer_size = 0;
+         if ((*msg_size_bytes >= LEN_PROTOCOL_VERSION_WIN_MSG) && 
+             ((*msg_data)[2] >= 2) && ((*msg_data)[2] <= SL_MAX_WINDOW))
+         {
+            ctx->win.peer_size = (*msg_data)[2];
+         }
+         rc = 0;
+      break;
+
+      case ID_LINK_ACK_MSG:
+         /*
+         ** Already processed by SL_CtxUnloadPacketStart.
+         */
          rc = 0;
       break;
 
       case ID_TPL_TX_ABT_MSG:
 #if (YZ_SPI_TPL_ENABLE != 0)
-         *msg_id = rx_info.pkt_ptr[ rx_info.unload_index + MSG_ID_LSB + MSG_HDR_BYTES ] + 
-                  (rx_info.pkt_ptr[ rx_info.unload_index + MSG_ID_MSB + MSG_HDR_BYTES ] * 256);
+         *msg_id = ctx->rx_info.pkt_ptr[ ctx->rx_info.unload_index + MSG_ID_LSB + MSG_HDR_BYTES ] + 
+                  (ctx->rx_info.pkt_ptr[ ctx->rx_info.unload_index + MSG_ID_MSB + MSG_HDR_BYTES ] * 256);
 		 //I changed (RyanS) from msg_id to *msg_id
 		 //  also changed from *msg_data to *(msg_data[0]+2)
-         TPLIncomingTxAbort(*msg_id, *(msg_data[0]+2));
+         TPLIncomingTxAbort(ctx, *msg_id, *(msg_data[0]+2));
          rc = 0;
 #endif
       break;
@@ -1476,49 +2733,345 @@ static int UnloadStatusMsg(int *msg_id, int *msg_size_bytes, U8 **msg_data)
    /*
    ** Adjust unload index to point to the next message.
    */
-   rx_info.unload_index += MSG_HDR_BYTES + *msg_size_bytes;
+   ctx->rx_info.unload_index += MSG_HDR_BYTES + *msg_size_bytes;
    return(rc);
 }
 
 /********************************************************************************************
-*  Function: CalculateCrc
-*       Calculate the Cyclic Redundancy Code for the contents of the buffer.
+*  Function: CalculateCrc
+*       Calculate the Cyclic Redundancy Code for the contents of the buffer with the
+*       engine selected by SL_SetCrcEngine.
+*
+*  Parameters:    
+*       pbuf - Pointer to the buffer
+*       length - number of bytes in the buffer. 
+*
+*  Returns:     
+*       The CRC value. 
+********************************************************************************************/ 
+static U16 CalculateCrc(U8 * pBuf, int length)
+{
+   return(__atomic_load_n(&crc_function, __ATOMIC_ACQUIRE)(pBuf, length));
+}
+
+/********************************************************************************************
+*  Function: CalculateCrcBitwise
+*       Calculate the Cyclic Redundancy Code for the contents of the buffer, one bit
+*       per iteration.  This is the reference of the other engines: each byte is 
+*       XORed into the remainder then shifted 7 times (not 8), the other engines
+*       reproduce it exactly so the CRC on the link is unchanged.
+*
+*  Parameters:    
+*       pbuf - Pointer to the buffer
+*       length - number of bytes in the buffer. 
+*
+*  Returns:     
+*       The CRC value. 
+********************************************************************************************/ 
+#define POLYNOMIAL 0x1021  // x^16+x^12+x^5+1 = (1) 0001 0000 0010 0001 = 0x1021
+static U16 CalculateCrcBitwise(U8 * pBuf, int length) {
+int rem=0;
+int i;
+int j;
+int Byte;
+
+for(i=0; i < length;i++, pBuf++)
+{
+  Byte = (int)(*pBuf);
+  rem = rem ^ (Byte << 8);
+  for(j = 1; j < 8; j++)  // Assuming 8 bits per byte
+  {
+     if(rem & 0x8000)     // if leftmost (most significant) bit is set
+       rem = ((rem << 1) ^ POLYNOMIAL);
+     else
+       rem = (rem << 1);
+     rem = rem & 0xFFFF;  // Trim remainder to 16 bits
+   } // for(j) 
+} // for(i)
+
+// CRC of 0 is not allowed to prevent a packet of all 0's being considered a valid packet.
+if (rem == 0)
+{
+  rem = CRC_ZERO_VAL;
+}
+return rem;  
+} // end of CalculateCrcBitwise()
+
+/********************************************************************************************
+*  Function: CrcInitTables
+*       Builds the tables of the slice-by-4 and slice-by-8 engines (and the constants
+*       of the carry-less multiply engine) the first time it is called.  Every table
+*       is derived from the byte step of CalculateCrcBitwise.  Safe to call from 
+*       several threads at once: one thread builds the tables, the others wait 
+*       until it is done.
+*
+*  Parameters:    
+*       None.
+*
+*  Returns:     
+*       None. 
+********************************************************************************************/ 
+static void CrcInitTables(void)
+{
+   int state = CRC_INIT_EMPTY;
+   int b;
+   int n;
+   int j;
+   U16 rem;
+
+   if (__atomic_load_n(&crc_tables_state, __ATOMIC_ACQUIRE) == CRC_INIT_READY)
+   {
+      return;
+   }
+   if (!__atomic_compare_exchange_n(&crc_tables_state, &state, CRC_INIT_BUSY, FALSE,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+   {
+      while (__atomic_load_n(&crc_tables_state, __ATOMIC_ACQUIRE) != CRC_INIT_READY)
+      {
+         /* another thread is building the tables */
+      }
+      return;
+   }
+
+   for (b = 0; b < 256; b++)
+   {
+      /* One byte step from the byte b, as in CalculateCrcBitwise */
+      rem = (U16)(b << 8);
+      for (j = 1; j < 8; j++)
+      {
+         rem = (U16)((rem & 0x8000) ? ((rem << 1) ^ POLYNOMIAL) : (rem << 1));
+      }
+      crc_table[0][b] = rem;
+   }
+   for (b = 0; b < 256; b++)
+   {
+      /* Each further byte of 0 is one more step */
+      for (n = 1; n < 8; n++)
+      {
+         rem = crc_table[n-1][b];
+         crc_table[n][b] = (U16)(crc_table[0][rem >> 8] ^ ((rem & 0xFF) << 7));
+      }
+      rem = (U16)(b << 7);
+      for (n = 1; n < 8; n++)
+      {
+         if (n == 4)
+         {
+            crc_low4[b] = rem;
+         }
+         rem = (U16)(crc_table[0][rem >> 8] ^ ((rem & 0xFF) << 7));
+      }
+      crc_low8[b] = rem;
+   }
+
+#ifdef SL_CRC_HAVE_CLMUL
+   {
+      unsigned __int128 div = ((unsigned __int128)1) << 64;
+      unsigned long long r = 1;
+
+      for (n = 1; n <= 88; n++)
+      {
+         r <<= 1;
+         if (r & 0x10000)
+         {
+            r ^= CRC_POLY_FULL;
+         }
+         if (n == 56)
+         {
+            crc_clmul_k56 = r;
+         }
+      }
+      crc_clmul_k88 = r;
+
+      crc_clmul_mu = 0;
+      for (n = 48; n >= 0; n--)
+      {
+         if ((div >> (n + 16)) & 1)
+         {
+            crc_clmul_mu |= (1ULL << n);
+            div ^= ((unsigned __int128)CRC_POLY_FULL) << n;
+         }
+      }
+   }
+#endif
+
+   __atomic_store_n(&crc_tables_state, CRC_INIT_READY, __ATOMIC_RELEASE);
+}
+
+/********************************************************************************************
+*  Function: CrcInitEngine
+*       Selects the CRC engine requested with SL_SetCrcEngine (SL_CRC_ENGINE_AUTO by
+*       default) the first time it is called.  Safe to call from several threads at
+*       once, as CrcInitTables.
+*
+*  Parameters:    
+*       None.
+*
+*  Returns:     
+*       None. 
+********************************************************************************************/ 
+static void CrcInitEngine(void)
+{
+   int state = CRC_INIT_EMPTY;
+
+   if (__atomic_load_n(&crc_engine_state, __ATOMIC_ACQUIRE) == CRC_INIT_READY)
+   {
+      return;
+   }
+   if (!__atomic_compare_exchange_n(&crc_engine_state, &state, CRC_INIT_BUSY, FALSE,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+   {
+      while (__atomic_load_n(&crc_engine_state, __ATOMIC_ACQUIRE) != CRC_INIT_READY)
+      {
+         /* another thread is selecting the engine */
+      }
+      return;
+   }
+   (void)SL_SetCrcEngine(__atomic_load_n(&crc_engine_req, __ATOMIC_RELAXED));
+   __atomic_store_n(&crc_engine_state, CRC_INIT_READY, __ATOMIC_RELEASE);
+}
+
+/*
+** CRC_STEP - Remainder after one more byte, using the first slice table.
+*/
+#define CRC_STEP(rem, byte)  ((U16)(crc_table[0][((rem) >> 8) ^ (byte)] ^ (((rem) & 0xFF) << 7)))
+
+/********************************************************************************************
+*  Function: CalculateCrcSlice4
+*       Calculate the Cyclic Redundancy Code for the contents of the buffer, 4 bytes
+*       per iteration with the slice tables.  The remainder is linear in the bytes
+*       so the remainder after 4 bytes is the XOR of the table entry of every byte
+*       and of the previous remainder.
+*
+*  Parameters:    
+*       pbuf - Pointer to the buffer
+*       length - number of bytes in the buffer. 
+*
+*  Returns:     
+*       The CRC value, as computed by CalculateCrcBitwise. 
+********************************************************************************************/ 
+static U16 CalculateCrcSlice4(U8 * pBuf, int length)
+{
+   U16 rem = 0;
+
+   for ( ; length >= 4; length -= 4, pBuf += 4)
+   {
+      rem = (U16)(crc_table[3][(rem >> 8) ^ pBuf[0]] ^ crc_low4[rem & 0xFF] ^
+                  crc_table[2][pBuf[1]] ^ crc_table[1][pBuf[2]] ^ crc_table[0][pBuf[3]]);
+   }
+   for ( ; length > 0; length--, pBuf++)
+   {
+      rem = CRC_STEP(rem, *pBuf);
+   }
+
+   return((rem == 0) ? CRC_ZERO_VAL : rem);
+}
+
+/********************************************************************************************
+*  Function: CalculateCrcSlice8
+*       Calculate the Cyclic Redundancy Code for the contents of the buffer, 8 bytes
+*       per iteration with the slice tables, see CalculateCrcSlice4.
+*
+*  Parameters:    
+*       pbuf - Pointer to the buffer
+*       length - number of bytes in the buffer. 
+*
+*  Returns:     
+*       The CRC value, as computed by CalculateCrcBitwise. 
+********************************************************************************************/ 
+static U16 CalculateCrcSlice8(U8 * pBuf, int length)
+{
+   U16 rem = 0;
+
+   for ( ; length >= 8; length -= 8, pBuf += 8)
+   {
+      rem = (U16)(crc_table[7][(rem >> 8) ^ pBuf[0]] ^ crc_low8[rem & 0xFF] ^
+                  crc_table[6][pBuf[1]] ^ crc_table[5][pBuf[2]] ^ crc_table[4][pBuf[3]] ^
+                  crc_table[3][pBuf[4]] ^ crc_table[2][pBuf[5]] ^ crc_table[1][pBuf[6]] ^
+                  crc_table[0][pBuf[7]]);
+   }
+   for ( ; length > 0; length--, pBuf++)
+   {
+      rem = CRC_STEP(rem, *pBuf);
+   }
+
+   return((rem == 0) ? CRC_ZERO_VAL : rem);
+}
+
+#ifdef SL_CRC_HAVE_CLMUL
+/********************************************************************************************
+*  Function: ClmulLow, ClmulReduce
+*       Carry-less multiply of two 64 bit polynomials (low 64 bits of the product), and
+*       Barrett reduction modulo P of a polynomial of degree < 64.
+********************************************************************************************/ 
+__attribute__((target("pclmul")))
+static inline __m128i Clmul(unsigned long long a, unsigned long long b)
+{
+   return(_mm_clmulepi64_si128(_mm_cvtsi64_si128((long long)a), _mm_cvtsi64_si128((long long)b), 0x00));
+}
+
+__attribute__((target("pclmul")))
+static inline unsigned long long ClmulLow(unsigned long long a, unsigned long long b)
+{
+   return((unsigned long long)_mm_cvtsi128_si64(Clmul(a, b)));
+}
+
+__attribute__((target("pclmul")))
+static inline U16 ClmulReduce(unsigned long long v)
+{
+   __m128i t = Clmul(v >> 16, crc_clmul_mu);
+   unsigned long long q;
+
+   /* q = (v / x^16) * (x^64 / P) / x^48, exact for GF(2) polynomials */
+   q = ((unsigned long long)_mm_cvtsi128_si64(t) >> 48) |
+       ((unsigned long long)_mm_cvtsi128_si64(_mm_srli_si128(t, 8)) << 16);
+   return((U16)(v ^ ClmulLow(q, CRC_POLY_FULL)));
+}
+
+/********************************************************************************************
+*  Function: CalculateCrcClmul
+*       Calculate the Cyclic Redundancy Code for the contents of the buffer, 8 bytes
+*       per iteration with carry-less multiplies.  CalculateCrcBitwise computes 
+*       M(x) * x^15 mod P where M(x) is the sum of the bytes b[k] * x^(7*(n-1-k)), 
+*       the bytes overlapping by one bit since they are shifted 7 times.  8 bytes 
+*       form a 57 bit chunk C(x).  The 64 bit accumulator a = a1 * x^32 + a0, equal 
+*       to M(x) modulo P, is folded as a = a1 * (x^88 mod P) + a0 * (x^56 mod P) + C(x)
+*       so it is only reduced once at the end.  Packing the bytes at a 7 bit stride 
+*       costs about as much as the slice-by-8 lookups, so this engine is not faster
+*       than CalculateCrcSlice8 and is not selected by SL_CRC_ENGINE_AUTO.
 *
 *  Parameters:    
 *       pbuf - Pointer to the buffer
 *       length - number of bytes in the buffer. 
 *
 *  Returns:     
-*       The CRC value. 
+*       The CRC value, as computed by CalculateCrcBitwise. 
 ********************************************************************************************/ 
-#define POLYNOMIAL 0x1021  // x^16+x^12+x^5+1 = (1) 0001 0000 0010 0001 = 0x1021
-static U16 CalculateCrc(U8 * pBuf, int length) {
-int rem=0;
-int i;
-int j;
-int Byte;
-
-for(i=0; i < length;i++, pBuf++)
+__attribute__((target("pclmul")))
+static U16 CalculateCrcClmul(U8 * pBuf, int length)
 {
-  Byte = (int)(*pBuf);
-  rem = rem ^ (Byte << 8);
-  for(j = 1; j < 8; j++)  // Assuming 8 bits per byte
-  {
-     if(rem & 0x8000)     // if leftmost (most significant) bit is set
-       rem = ((rem << 1) ^ POLYNOMIAL);
-     else
-       rem = (rem << 1);
-     rem = rem & 0xFFFF;  // Trim remainder to 16 bits
-   } // for(j) 
-} // for(i)
+   unsigned long long acc = 0;
+   unsigned long long chunk;
+   U16 rem;
+   int i;
 
-// CRC of 0 is not allowed to prevent a packet of all 0's being considered a valid packet.
-if (rem == 0)
-{
-  rem = 0x5aa5;
+   for ( ; length >= 8; length -= 8, pBuf += 8)
+   {
+      chunk = 0;
+      for (i = 0; i < 8; i++)
+      {
+         chunk = (chunk << 7) ^ pBuf[i];
+      }
+      acc = ClmulLow(acc >> 32, crc_clmul_k88) ^ ClmulLow(acc & 0xFFFFFFFFULL, crc_clmul_k56) ^ chunk;
+   }
+   rem = ClmulReduce((unsigned long long)ClmulReduce(acc) << 15);
+   for ( ; length > 0; length--, pBuf++)
+   {
+      rem = CRC_STEP(rem, *pBuf);
+   }
+
+   return((rem == 0) ? CRC_ZERO_VAL : rem);
 }
-return rem;  
-} // end of CalculateCrc()
+#endif /* SL_CRC_HAVE_CLMUL */
 
 
 #if  0   /* CURRENTLY NO USED */
@@ -1582,8 +3135,8 @@ return rem;
 ** TPL_RX_RECORDS - Number of records in the tpl_rx_table
 ** TPL_TX_RECORDS - Number of records in the tpl_tx_table
 */
-#define TPL_TX_RECORDS   (sizeof(tpl_tx_table)/sizeof(TPL_TX_RECORD))
-#define TPL_RX_RECORDS   (sizeof(tpl_rx_table)/sizeof(TPL_RX_RECORD))
+#define TPL_TX_RECORDS   (YZ_SPI_TPL_MAX_SIM_TFRS)
+#define TPL_RX_RECORDS   (YZ_SPI_TPL_MAX_SIM_TFRS)
 
 /*
 ** Bits flags for "tpl_rx_table[ i].flags" field.
@@ -1595,7 +3148,7 @@ return rem;
 #define TPL_RXF_MSG_UNLOADED (0x0004u)
 
 /*
-** NULL_NODE - value used to indicate there is no more nodes in the Tx message list.
+** NULL_NODE - value used to indicate no record (msg id not in use, record not in the Tx heap).
 */
 #define NULL_NODE (-1)
 
@@ -1617,99 +3170,67 @@ typedef struct TPL_ABT_MSG
    U16 error_code;           /* reason TxABT was generated */
 } TPL_ABT_MSG;
 
-/*
- * Typedef: TPL_TX_RECORD
- *
- * 	Record holding TPL Tx Msg information
- */
-typedef struct TPL_TX_RECORD
-{
-	int   msg_id;             /* Message id */
-	U8   *buffer_ptr;         /* Pointer to first byte of Tx buffer OR NULL if record not in use */
-    int   msg_sz_bytes;       /* Message size in bytes */
-    int   min_bytes_packet;   /* Min number of bytes to send in a single packet */
-    int   next_seg_num;       /* Next seg # to Tx */
-    int   load_index;         /* Offset of next byte to load */
-    int   next_node;          /* Offset of next node in the Tx message list */
-} TPL_TX_RECORD;
-
-/*
- * Typedef: TPL_RX_RECORD
- *
- * 	Record holding TPL Rx Msg information
- */
-typedef struct TPL_RX_RECORD
-{
-	int   msg_id;          /* Message id */
-	U8   *buffer_ptr;      /* Pointer to first byte of Rx buffer */
-    int   msg_sz_bytes;    /* Message size in bytes */
-    int   next_seg_num;    /* Next seg # expected */
-    int   unload_index;    /* Offset of next byte to unload */
-    int   flags;           /* IN_USE: !=0 for record in use; =0 for record free */ 
-                           /* TX_ABT: !=0 for generated TxTPLABT status message */ 
-                           /* MSG_UNLOADED: =0 if no message unloaded since last clear; !=0 for message unloaded */ 
-    int   tx_abort_code;   /* Reason for sending TxTPLABT (applies only when TX_ABT flag is !=0) */
-
-} TPL_RX_RECORD;
-
 /******************************************************************************/
 /*     F U N C T I O N   P R O T O T Y P E S                                  */
 /******************************************************************************/
-static void LinkTPLTxNode(int new_node, int id);
-static void UnlinkTPLTxNode(int msg_id);
-static int FindFreeRxTableRec(void);
-static int FindTxTableRec(int msg_id);
+static void LinkTPLTxNode(SL_CONTEXT *ctx, int new_node, int msg_id);
+static void UnlinkTPLTxNode(SL_CONTEXT *ctx, int msg_id);
+static void TPLTxHeapInsert(SL_CONTEXT *ctx, int node);
+static void TPLTxHeapRemove(SL_CONTEXT *ctx, int pos);
+static void TPLTxHeapSet(SL_CONTEXT *ctx, int pos, int node);
+static void TPLTxHeapSift(SL_CONTEXT *ctx, int pos);
+static int AllocRxTableRec(SL_CONTEXT *ctx, int msg_id);
+static void FreeRxTableRec(SL_CONTEXT *ctx, int rec);
+static int FindTxTableRec(SL_CONTEXT *ctx, int msg_id);
 
 /******************************************************************************/
 /*     M E M O R Y   A L L O C A T I O N                                      */
 /******************************************************************************/
-/*
-** tpl_tx_table - table holding information describing TPL Tx messages currently
-** in progress (each record that is "IN_USE" describes one transfer).
-*/
-TPL_TX_RECORD tpl_tx_table[ YZ_SPI_TPL_MAX_SIM_TFRS ];
-
-/*
-** tpl_rx_table - table holding information describing TPL Rx messages currently
-** in progress (each record that is "IN_USE" describes one transfer).
-*/
-TPL_RX_RECORD tpl_rx_table[ YZ_SPI_TPL_MAX_SIM_TFRS ];
-
-/*
-** tx_msg_list_head - "points" to the first node in the list of TPL Tx messages in the tpl_tx_table.  The list is 
-** maintained in priority order, highest priority messages first in list.
-*/
-int   tx_msg_list_head = NULL_NODE;
-
-
 /*******************************************************************************
  * Function: TPLInit 
- *      Performs TPL initialization.
+ *      Performs TPL initialization.  All records are freed, the Tx heap and the
+ *      list of Rx records in use are emptied.
  *
  * Parameters:
- *      None.
+ *      ctx - the context of the link.
  *
  * Returns: 
  *      None.
  ******************************************************************************/
- static void TPLInit(void)
+ static void TPLInit(SL_CONTEXT *ctx)
  {
    int i;
 
-   tx_msg_list_head = NULL_NODE;
+   ctx->tpl_tx_heap_size = 0;
+   ctx->tpl_tx_free_top = 0;
+   ctx->tpl_tx_min_bytes = 0;
+   ctx->tpl_rx_active_cnt = 0;
+   ctx->tpl_rx_free_top = 0;
 
-   for (i=0; i<TPL_TX_RECORDS; ++i)
+   /*
+   ** Push the records in reverse order so the lowest offsets are used first.
+   */
+   for (i=TPL_TX_RECORDS-1; i>=0; --i)
    {   
-      tpl_tx_table[ i ].buffer_ptr = NULL;
-      tpl_tx_table[ i ].next_node = NULL_NODE;
-
-      tpl_rx_table[ i ].flags = 0;
-      tpl_rx_table[ i ].tx_abort_code = 0;
+      ctx->tpl_tx_table[ i ].buffer_ptr = NULL;
+      ctx->tpl_tx_table[ i ].heap_pos = NULL_NODE;
+      ctx->tpl_tx_free[ ctx->tpl_tx_free_top++ ] = i;
+   }
+   for (i=TPL_RX_RECORDS-1; i>=0; --i)
+   {   
+      ctx->tpl_rx_table[ i ].flags = 0;
+      ctx->tpl_rx_table[ i ].tx_abort_code = 0;
+      ctx->tpl_rx_free[ ctx->tpl_rx_free_top++ ] = i;
+   }
+   for (i=0; i<SL_MSG_ID_SLOTS; ++i)
+   {   
+      ctx->tpl_tx_by_id[ i ] = NULL_NODE;
+      ctx->tpl_rx_by_id[ i ] = NULL_NODE;
    }
  }
 
 /*******************************************************************************
- * Function: SL_TxTPLMsg 
+ * Function: SL_CtxTxTPLMsg 
  *      Transmits a message using the transport layer.
  *
  * Parameters:
@@ -1718,16 +3239,15 @@ int   tx_msg_list_head = NULL_NODE;
  * Returns:
  *		See documenation in spi_lib.h
  ******************************************************************************/
-int SL_TxTPLMsg(int msg_id, int msg_sz_bytes, U8 *msg_data, int min_bytes_packet)
+int SL_CtxTxTPLMsg(SL_CONTEXT *ctx, int msg_id, int msg_sz_bytes, U8 *msg_data, int min_bytes_packet)
 {
-   int i;
    int empty_record_idx;
    int tpl_bytes_packet;
 
    /*
    ** Confirm id is valid.
    */
-   if ((msg_id < tx_info.min_msg_id) || (msg_id > tx_info.max_msg_id))
+   if ((msg_id < ctx->tx_info.min_msg_id) || (msg_id > ctx->tx_info.max_msg_id))
    {
       return(SL_INVALID_ID);
    }
@@ -1740,172 +3260,210 @@ int SL_TxTPLMsg(int msg_id, int msg_sz_bytes, U8 *msg_data, int min_bytes_packet
       return(SL_MSG_TOO_LONG);
    }
 
-   /*
-   ** Get sum of min_packet_bytes for all messages.  Find an empty record at the same time.
-   */
-   tpl_bytes_packet = min_bytes_packet + MSG_HDR_BYTES + TPL_MSG_HDR_BYTES;
-   empty_record_idx = -1;
-   for (i=0; i<TPL_TX_RECORDS; ++i)
-   {   
-      
-	   if (tpl_tx_table[ i ].buffer_ptr != NULL) 
-      {
-        if (tpl_tx_table[ i ].msg_id == msg_id) 
-         {
-            /* 
-            ** TPL transfer for this message id is already in progress and multiple not allowed
-            */
-            return(SL_INVALID_ID);
-         }
-	
-         tpl_bytes_packet += tpl_tx_table[ i ].min_bytes_packet + MSG_HDR_BYTES + TPL_MSG_HDR_BYTES;
-      }
-      else
-      {
-         empty_record_idx = i;
-      }
+   if (ctx->tpl_tx_by_id[ msg_id ] != NULL_NODE) 
+   {
+      /* 
+      ** TPL transfer for this message id is already in progress and multiple not allowed
+      */
+      return(SL_INVALID_ID);
    }
 
    /*
    ** Confirm the sum of min_packet_bytes for all messages is within the limit.
    */
-   if (tpl_bytes_packet > MAX_PKT_BYTES_FOR_TPL_MSGS) 
+   tpl_bytes_packet = min_bytes_packet + MSG_HDR_BYTES + TPL_MSG_HDR_BYTES;
+   if ((ctx->tpl_tx_min_bytes + tpl_bytes_packet) > MAX_PKT_BYTES_FOR_TPL_MSGS) 
    {
       return(SL_MSG_TOO_LONG);
    }
 
    /*
-   ** Confirm an empty record was found (if not the max number of simultaneous transfers is in progress). 
+   ** Confirm a free record is left (if not the max number of simultaneous transfers is in progress). 
    */
-   if (empty_record_idx == -1) 
+   if (ctx->tpl_tx_free_top == 0) 
    {
       return(SL_TPL_XFER_LIMIT);
    }
+   empty_record_idx = ctx->tpl_tx_free[ --ctx->tpl_tx_free_top ];
 
    /*
    ** Initialize the record.
    */
-   LinkTPLTxNode(empty_record_idx, msg_id);
-   tpl_tx_table[ empty_record_idx ].buffer_ptr = msg_data; 
-   tpl_tx_table[ empty_record_idx ].msg_sz_bytes = msg_sz_bytes;
-   tpl_tx_table[ empty_record_idx ].min_bytes_packet = min_bytes_packet;
-   tpl_tx_table[ empty_record_idx ].next_seg_num = 1;
-   tpl_tx_table[ empty_record_idx ].load_index = 0;
+   ctx->tpl_tx_table[ empty_record_idx ].buffer_ptr = msg_data; 
+   ctx->tpl_tx_table[ empty_record_idx ].msg_sz_bytes = msg_sz_bytes;
+   ctx->tpl_tx_table[ empty_record_idx ].min_bytes_packet = min_bytes_packet;
+   ctx->tpl_tx_table[ empty_record_idx ].next_seg_num = 1;
+   ctx->tpl_tx_table[ empty_record_idx ].load_index = 0;
+   ctx->tpl_tx_min_bytes += tpl_bytes_packet;
+   LinkTPLTxNode(ctx, empty_record_idx, msg_id);
 
    return(SL_SUCCESS);
 }
 
 /*******************************************************************************
  * Function: LinkTPLTxNode
- *      Adds a node into the linked list of currently active TPL message transfers.
- *      The new node will be inserted such that message id's are in ascending order
- *      (highest msg_id's first).
+ *      Adds a record to the currently active TPL message transfers.  The record
+ *      is indexed by its message id and inserted in the Tx heap, which keeps the
+ *      lowest message id (the highest priority) at its top.
  *
  * Parameters:
- *      msg_id - id of message in node to be added to the linked list.
+ *      ctx - the context of the link.
  *      new_node - record offset within the tpl_tx_table of the new node to be inserted
+ *      msg_id - id of message in node to be added.
  *
  * Returns: 
  *	    None. 
  *      
  ******************************************************************************/
-static void  LinkTPLTxNode(int new_node, int msg_id)
+static void  LinkTPLTxNode(SL_CONTEXT *ctx, int new_node, int msg_id)
 {
-   int last_node;
-   int next_node;
-   int link_found = 0;
-   int temp;
+   ctx->tpl_tx_table[ new_node ].msg_id = msg_id;   
+   ctx->tpl_tx_by_id[ msg_id ] = new_node;
+   TPLTxHeapInsert(ctx, new_node);
+}
 
-   tpl_tx_table[ new_node ].msg_id = msg_id;   
+/*******************************************************************************
+ * Function: UnlinkTPLTxNode
+ *      Removes a record from the currently active TPL message transfers and
+ *      returns it to the free stack. 
+ *
+ * Parameters:
+ *      ctx - the context of the link.
+ *      msg_id - id of message in node to be removed.
+ *
+ * Returns: 
+ *	    None. 
+ *      
+ ******************************************************************************/
+static void  UnlinkTPLTxNode(SL_CONTEXT *ctx, int msg_id)
+{
+   int node = ctx->tpl_tx_by_id[ msg_id ];
+   SL_TPL_TX_RECORD *tpl_tx_rec;
 
-   if (tx_msg_list_head == NULL_NODE)
+   if (node == NULL_NODE)
    {
-      /* 
-      ** Start new list.
-      */
-      tx_msg_list_head = new_node;
-      tpl_tx_table[ new_node ].next_node = NULL_NODE;
-   }
-   else if (msg_id < tpl_tx_table[ tx_msg_list_head ].msg_id)
-   {
-      /* 
-      ** Add to start of list.
-      */
-      temp = tx_msg_list_head;
-      tx_msg_list_head = new_node;
-      tpl_tx_table[ new_node ].next_node = temp;
+      return;
    }
-   else
+   tpl_tx_rec = &ctx->tpl_tx_table[ node ];
+
+   /*
+   ** The record is off the heap while LoadTPLMsgsFill is loading it.
+   */
+   if (tpl_tx_rec->heap_pos != NULL_NODE)
    {
-      /*
-      ** Traverse list until spot to insert is found. 
-      */
-      last_node = tx_msg_list_head;
-      next_node = tpl_tx_table[ last_node ].next_node;
-      while ((tpl_tx_table[ next_node ].next_node != NULL) && (link_found == 0))
-      {
-         if (msg_id < tpl_tx_table[ next_node ].msg_id)
-         {
-            link_found = 1;
-         }
-         else
-         {
-            last_node = next_node;
-            next_node = tpl_tx_table[ next_node ].next_node;
-         }
-      }
-      /*
-      ** Insert in list.
-      */
-      temp = tpl_tx_table[ last_node ].next_node;
-      tpl_tx_table[ last_node ].next_node = new_node;
-      tpl_tx_table[ new_node ].next_node = temp;
+      TPLTxHeapRemove(ctx, tpl_tx_rec->heap_pos);
    }
+   ctx->tpl_tx_by_id[ msg_id ] = NULL_NODE;
+   ctx->tpl_tx_min_bytes -= tpl_tx_rec->min_bytes_packet + MSG_HDR_BYTES + TPL_MSG_HDR_BYTES;
+   tpl_tx_rec->buffer_ptr = NULL;
+   ctx->tpl_tx_free[ ctx->tpl_tx_free_top++ ] = node;
 }
+
 /*******************************************************************************
- * Function: UnlinkTPLTxNode
- *      Removes a node from the linked list of currently active TPL message transfers.
- * 
+ * Function: TPLTxHeapSet
+ *      Stores a record at a position of the Tx heap.
  *
  * Parameters:
- *      None.
+ *      ctx - the context of the link.
+ *      pos - position in the heap.
+ *      node - record offset within the tpl_tx_table.
  *
  * Returns: 
  *	    None. 
  *      
  ******************************************************************************/
-static void  UnlinkTPLTxNode(int msg_id)
+static void TPLTxHeapSet(SL_CONTEXT *ctx, int pos, int node)
 {
-   int last_node;
-   int node;
+   ctx->tpl_tx_heap[ pos ] = node;
+   ctx->tpl_tx_table[ node ].heap_pos = pos;
+}
+
+/*******************************************************************************
+ * Function: TPLTxHeapSift
+ *      Moves the record at a position of the Tx heap up, then down, until the
+ *      msg id of every record is lower than the msg id of its children.
+ *
+ * Parameters:
+ *      ctx - the context of the link.
+ *      pos - position in the heap.
+ *
+ * Returns: 
+ *	    None. 
+ *      
+ ******************************************************************************/
+static void TPLTxHeapSift(SL_CONTEXT *ctx, int pos)
+{
+   int node = ctx->tpl_tx_heap[ pos ];
+   int msg_id = ctx->tpl_tx_table[ node ].msg_id;
+   int parent;
+   int child;
 
-   if (tpl_tx_table[ tx_msg_list_head ].msg_id == msg_id)
+   while (pos > 0)
    {
-      /*
-      ** Remove head of list.
-      */
-      tx_msg_list_head = tpl_tx_table[ tx_msg_list_head  ].next_node;
+      parent = (pos - 1) / 2;
+      if (ctx->tpl_tx_table[ ctx->tpl_tx_heap[ parent ] ].msg_id < msg_id)
+      {
+         break;
+      }
+      TPLTxHeapSet(ctx, pos, ctx->tpl_tx_heap[ parent ]);
+      pos = parent;
    }
-   else
+
+   while ((child = (2 * pos) + 1) < ctx->tpl_tx_heap_size)
    {
-      /*
-      ** Traverse list until the node to remove is found.
-      */
-      last_node = tx_msg_list_head;
-      node = tpl_tx_table[ last_node ].next_node;
-      while ((tpl_tx_table[ node ].msg_id != msg_id) && (tpl_tx_table[ node ].next_node != NULL_NODE)) 
+      if (((child + 1) < ctx->tpl_tx_heap_size) &&
+          (ctx->tpl_tx_table[ ctx->tpl_tx_heap[ child + 1 ] ].msg_id < ctx->tpl_tx_table[ ctx->tpl_tx_heap[ child ] ].msg_id))
       {
-         last_node = node;
-         node = tpl_tx_table[ last_node ].next_node;
+         ++child;
       }
-
-      if (tpl_tx_table[ node ].msg_id == msg_id)
+      if (msg_id < ctx->tpl_tx_table[ ctx->tpl_tx_heap[ child ] ].msg_id)
       {
-         /*
-         ** Remove node from list.
-         */
-         tpl_tx_table[ last_node ].next_node = tpl_tx_table[ node ].next_node;
+         break;
       }
+      TPLTxHeapSet(ctx, pos, ctx->tpl_tx_heap[ child ]);
+      pos = child;
+   }
+   TPLTxHeapSet(ctx, pos, node);
+}
+
+/*******************************************************************************
+ * Function: TPLTxHeapInsert
+ *      Inserts a record in the Tx heap.
+ *
+ * Parameters:
+ *      ctx - the context of the link.
+ *      node - record offset within the tpl_tx_table.
+ *
+ * Returns: 
+ *	    None. 
+ *      
+ ******************************************************************************/
+static void TPLTxHeapInsert(SL_CONTEXT *ctx, int node)
+{
+   TPLTxHeapSet(ctx, ctx->tpl_tx_heap_size, node);
+   TPLTxHeapSift(ctx, ctx->tpl_tx_heap_size++);
+}
+
+/*******************************************************************************
+ * Function: TPLTxHeapRemove
+ *      Removes the record at a position of the Tx heap, the last record of the
+ *      heap takes its place.
+ *
+ * Parameters:
+ *      ctx - the context of the link.
+ *      pos - position in the heap.
+ *
+ * Returns: 
+ *	    None. 
+ *      
+ ******************************************************************************/
+static void TPLTxHeapRemove(SL_CONTEXT *ctx, int pos)
+{
+   ctx->tpl_tx_table[ ctx->tpl_tx_heap[ pos ] ].heap_pos = NULL_NODE;
+   if (pos != --ctx->tpl_tx_heap_size)
+   {
+      TPLTxHeapSet(ctx, pos, ctx->tpl_tx_heap[ ctx->tpl_tx_heap_size ]);
+      TPLTxHeapSift(ctx, pos);
    }
 }
 
@@ -1914,6 +3472,7 @@ static void  UnlinkTPLTxNode(int msg_id)
  *      Processes an incoming TPL Tx ABT message. 
  *
  * Parameters:
+ *      ctx - the context of the link.
  *      msg_id - id of the message to be aborted. 
  *      error_code - the reason why the Tx ABT was generated. 
  *
@@ -1921,43 +3480,72 @@ static void  UnlinkTPLTxNode(int msg_id)
  *	    None.
  *      
  ******************************************************************************/
-static void TPLIncomingTxAbort(int msg_id, U8 error_code)
+static void TPLIncomingTxAbort(SL_CONTEXT *ctx, int msg_id, U8 error_code)
 {
    int record_id;
-   record_id = FindTxTableRec(msg_id);
+   record_id = FindTxTableRec(ctx, msg_id);
    if (record_id != -1)
    {
-      SLx_TPLTxMsgComplete(tpl_tx_table[ record_id ].msg_id, tpl_tx_table[ record_id ].msg_sz_bytes,
-                           tpl_tx_table[ record_id ].buffer_ptr, error_code);
-      tpl_tx_table[ record_id ].buffer_ptr = NULL;
-      UnlinkTPLTxNode(msg_id);
+      SLx_TPLTxMsgComplete(ctx->tpl_tx_table[ record_id ].msg_id, ctx->tpl_tx_table[ record_id ].msg_sz_bytes,
+                           ctx->tpl_tx_table[ record_id ].buffer_ptr, error_code);
+      UnlinkTPLTxNode(ctx, msg_id);
    }
 }
 
 
 /*******************************************************************************
- * Function: FindFreeRxTableRec
- *      Finds a free Rx Table record that is available for use.
+ * Function: AllocRxTableRec
+ *      Takes a free Rx Table record off the free stack and puts it in use for
+ *      the specified message id.  The flags of the record are left to the caller.
  *
  * Parameters:
- *      void 
+ *      ctx - the context of the link.
+ *      msg_id - message id of the record.
  *
  * Returns: 
- *	    -1 for table full (no free records), otherwise the index of a free 
- *      record is returned.
+ *	    -1 for table full (no free records), otherwise the index of the record
+ *      is returned.
  *      
  ******************************************************************************/
-static int FindFreeRxTableRec(void)
+static int AllocRxTableRec(SL_CONTEXT *ctx, int msg_id)
 {
    int i;
-   for (i=0; (i < TPL_RX_RECORDS); ++i)
+
+   if (ctx->tpl_rx_free_top == 0)
    {
-      if ((tpl_rx_table[ i ].flags & TPL_RXF_IN_USE) == 0)
-      {
-         return(i); 
-      }
+      return(-1);
    }
-   return(-1);
+   i = ctx->tpl_rx_free[ --ctx->tpl_rx_free_top ];
+   ctx->tpl_rx_table[ i ].msg_id = msg_id;
+   ctx->tpl_rx_table[ i ].active_pos = ctx->tpl_rx_active_cnt;
+   ctx->tpl_rx_active[ ctx->tpl_rx_active_cnt++ ] = i;
+   ctx->tpl_rx_by_id[ msg_id ] = i;
+   return(i);
+}
+
+/*******************************************************************************
+ * Function: FreeRxTableRec
+ *      Returns an Rx Table record in use to the free stack.  The last record
+ *      of the list of records in use takes its place in the list.
+ *
+ * Parameters:
+ *      ctx - the context of the link.
+ *      rec - index of the record.
+ *
+ * Returns: 
+ *	    None. 
+ *      
+ ******************************************************************************/
+static void FreeRxTableRec(SL_CONTEXT *ctx, int rec)
+{
+   SL_TPL_RX_RECORD  *tpl_rx_rec = &ctx->tpl_rx_table[ rec ];
+   int last = ctx->tpl_rx_active[ --ctx->tpl_rx_active_cnt ];
+
+   ctx->tpl_rx_active[ tpl_rx_rec->active_pos ] = last;
+   ctx->tpl_rx_table[ last ].active_pos = tpl_rx_rec->active_pos;
+   ctx->tpl_rx_by_id[ tpl_rx_rec->msg_id ] = NULL_NODE;
+   ctx->tpl_rx_free[ ctx->tpl_rx_free_top++ ] = rec;
+   tpl_rx_rec->flags = 0;
 }
 
 /*******************************************************************************
@@ -1966,27 +3554,17 @@ static int FindFreeRxTableRec(void)
  *      
  *
  * Parameters:
- *      msg_id - message id to find in the table.
+ *      ctx - the context of the link.
+ *      msg_id - message id to find in the table, within the Rx id range.
  *
  * Returns: 
  *	    -1 for message id not found in table, otherwise the index to the record 
  *      containing the message id is returned.
  *      
  ******************************************************************************/
-static int FindRxTableRec(int msg_id)
+static int FindRxTableRec(SL_CONTEXT *ctx, int msg_id)
 {
-   int i;
-   for (i=0; (i < TPL_RX_RECORDS); ++i)
-   {
-      if ((tpl_rx_table[ i ].flags & TPL_RXF_IN_USE) != 0)
-      {
-		  if ( msg_id == tpl_rx_table[ i ].msg_id)
-         {
-            return(i); 
-         }
-      }
-   }
-   return(-1);
+   return(ctx->tpl_rx_by_id[ msg_id ]);
  } 
  
  /*******************************************************************************
@@ -1994,6 +3572,7 @@ static int FindRxTableRec(int msg_id)
  *      Finds the Tx Table record containing the specified message id. 
  *
  * Parameters:
+ *      ctx - the context of the link.
  *      msg_id - message id to find in the table.
  *
  * Returns: 
@@ -2001,20 +3580,13 @@ static int FindRxTableRec(int msg_id)
  *      containing the message id is returned.
  *      
  ******************************************************************************/
-static int FindTxTableRec(int msg_id)
+static int FindTxTableRec(SL_CONTEXT *ctx, int msg_id)
 {
-   int i;
-   for (i=0; (i < TPL_TX_RECORDS); ++i)
+   if ((msg_id < ctx->tx_info.min_msg_id) || (msg_id > ctx->tx_info.max_msg_id))
    {
-      if (tpl_tx_table[ i ].buffer_ptr != NULL)
-      {
-         if (msg_id == tpl_tx_table[ i ].msg_id)
-         {
-            return(i); 
-         }
-      }
+      return(-1);
    }
-   return(-1);
+   return(ctx->tpl_tx_by_id[ msg_id ]);
 }
 
 /*******************************************************************************
@@ -2026,43 +3598,53 @@ static int FindTxTableRec(int msg_id)
  *         field in the transport header.
  *
  * Parameters:
+ *      ctx - the context of the link.
  *      msg_length - length of the incoming transport layer message in bytes
  *
  * Returns: 
  *	    None. 
  *      
  ******************************************************************************/
-static void UnloadTPLMsg(int msg_length)
+static void UnloadTPLMsg(SL_CONTEXT *ctx, int msg_length)
 {
    int i;
    int msg_id;
    int bytes_remaining;
    int seg_number;
    int seg_length;
-   TPL_RX_RECORD  *tpl_rx_rec;
+   SL_TPL_RX_RECORD  *tpl_rx_rec;
 
-   msg_id = rx_info.pkt_ptr[ rx_info.unload_index + TPL_MSG_ID_LSB ] +
-           (rx_info.pkt_ptr[ rx_info.unload_index + TPL_MSG_ID_MSB ] * 256);
+   msg_id = ctx->rx_info.pkt_ptr[ ctx->rx_info.unload_index + TPL_MSG_ID_LSB ] +
+           (ctx->rx_info.pkt_ptr[ ctx->rx_info.unload_index + TPL_MSG_ID_MSB ] * 256);
   
-   bytes_remaining = rx_info.pkt_ptr[ rx_info.unload_index + TPL_MSG_BYTES_REM_LSB ] +
-                    (rx_info.pkt_ptr[ rx_info.unload_index + TPL_MSG_BYTES_REM_MSB ] * 256);
+   bytes_remaining = ctx->rx_info.pkt_ptr[ ctx->rx_info.unload_index + TPL_MSG_BYTES_REM_LSB ] +
+                    (ctx->rx_info.pkt_ptr[ ctx->rx_info.unload_index + TPL_MSG_BYTES_REM_MSB ] * 256);
 
-   seg_number = rx_info.pkt_ptr[ rx_info.unload_index + TPL_SEG_NUMBER_LSB ] +
-               (rx_info.pkt_ptr[ rx_info.unload_index + TPL_SEG_NUMBER_MSB ] * 256);
+   seg_number = ctx->rx_info.pkt_ptr[ ctx->rx_info.unload_index + TPL_SEG_NUMBER_LSB ] +
+               (ctx->rx_info.pkt_ptr[ ctx->rx_info.unload_index + TPL_SEG_NUMBER_MSB ] * 256);
 
-   rx_info.unload_index += TPL_MSG_HDR_BYTES;
+   ctx->rx_info.unload_index += TPL_MSG_HDR_BYTES;
    seg_length = msg_length - TPL_MSG_HDR_BYTES;
 
+   if ((msg_id < ctx->rx_info.min_msg_id) || (msg_id > ctx->rx_info.max_msg_id))
+   {
+      /*
+      ** Not an id the other node can send, so there is no record to report it with.
+      */
+      ctx->rx_info.unload_index += seg_length;
+      return;
+   }
+
    /*
    ** Find msg ID.
    */
-   i = FindRxTableRec(msg_id);
+   i = FindRxTableRec(ctx, msg_id);
    if (i == -1)
    {
       /* 
-      ** Message ID was not found in TPL Rx table, find a free record for new xfer.
+      ** Message ID was not found in TPL Rx table, take a free record for new xfer.
       */
-      i = FindFreeRxTableRec();
+      i = AllocRxTableRec(ctx, msg_id);
       if (i == -1)
       {
          /* 
@@ -2070,12 +3652,12 @@ static void UnloadTPLMsg(int msg_length)
          ** TODO: Decide if any action needs done here.
          ** Can't send Tx ABT since no records available...send COM reset???
          */
-		 rx_info.unload_index += seg_length;
+		 ctx->rx_info.unload_index += seg_length;
          return;
       }
       else
       {
-		 tpl_rx_rec = &tpl_rx_table[ i ];
+		 tpl_rx_rec = &ctx->tpl_rx_table[ i ];
          
          if (seg_number != 1) 
          {
@@ -2084,7 +3666,7 @@ static void UnloadTPLMsg(int msg_length)
             */
             tpl_rx_rec->flags = (TPL_RXF_IN_USE | TPL_RXF_GEN_TX_ABT);
             tpl_rx_rec->tx_abort_code = TPL_ABT_INVL_SEG_NUM;  
-			rx_info.unload_index += seg_length;
+			ctx->rx_info.unload_index += seg_length;
             return;
          }
          /* 
@@ -2105,7 +3687,7 @@ static void UnloadTPLMsg(int msg_length)
             /*
             ** Store the first fragment.
             */
-            (void) memcpy(tpl_rx_rec->buffer_ptr, &rx_info.pkt_ptr[ rx_info.unload_index ], seg_length); 
+            (void) memcpy(tpl_rx_rec->buffer_ptr, &ctx->rx_info.pkt_ptr[ ctx->rx_info.unload_index ], seg_length); 
             tpl_rx_rec->msg_id = msg_id;
             tpl_rx_rec->msg_sz_bytes = seg_length + bytes_remaining;
             tpl_rx_rec->next_seg_num = 2;
@@ -2120,7 +3702,7 @@ static void UnloadTPLMsg(int msg_length)
       /*
       ** Message ID found in TPL Rx Table.
       */
-      tpl_rx_rec = &tpl_rx_table[ i ];
+      tpl_rx_rec = &ctx->tpl_rx_table[ i ];
 	  
 	  if( (tpl_rx_rec->flags & TPL_RXF_GEN_TX_ABT) != 0)
 	  {
@@ -2128,7 +3710,7 @@ static void UnloadTPLMsg(int msg_length)
 		  ** In this case we have already processed atleast one segment for 
 		  **  this message in the current packet which generated an abort condition, so we don't need to process this segment
 		  */
-		  rx_info.unload_index += seg_length;
+		  ctx->rx_info.unload_index += seg_length;
           return;
 	  }
 
@@ -2139,7 +3721,7 @@ static void UnloadTPLMsg(int msg_length)
          */
          tpl_rx_rec->flags = (TPL_RXF_IN_USE | TPL_RXF_GEN_TX_ABT);
          tpl_rx_rec->tx_abort_code = TPL_ABT_INVL_SEG_NUM;
-		 rx_info.unload_index += seg_length;
+		 ctx->rx_info.unload_index += seg_length;
          return;
       }
       if (bytes_remaining != (tpl_rx_rec->msg_sz_bytes - (tpl_rx_rec->unload_index + seg_length)) )
@@ -2149,14 +3731,14 @@ static void UnloadTPLMsg(int msg_length)
          */
          tpl_rx_rec->flags = (TPL_RXF_IN_USE | TPL_RXF_GEN_TX_ABT);
          tpl_rx_rec->tx_abort_code = TPL_ABT_INVL_BYTES_REM;
-		 rx_info.unload_index += seg_length;
+		 ctx->rx_info.unload_index += seg_length;
 		 return;
       }
       /*
       ** Accept this fragment and copy to Rx buffer.
       */
       (void) memcpy(&tpl_rx_rec->buffer_ptr[ tpl_rx_rec->unload_index ], 
-                    &rx_info.pkt_ptr[ rx_info.unload_index ], seg_length); 
+                    &ctx->rx_info.pkt_ptr[ ctx->rx_info.unload_index ], seg_length); 
       tpl_rx_rec->unload_index += seg_length; 
 	  tpl_rx_rec->next_seg_num++;
 	  tpl_rx_rec->flags |= TPL_RXF_MSG_UNLOADED;
@@ -2166,7 +3748,7 @@ static void UnloadTPLMsg(int msg_length)
          ** This was the last segment so free the TPL Rx table record and deliver
          ** the message.
          */
-         tpl_rx_rec->flags = 0;
+         FreeRxTableRec(ctx, i);
          SLx_TPLRxMsgComplete(tpl_rx_rec->msg_id, tpl_rx_rec->msg_sz_bytes,
                    tpl_rx_rec->buffer_ptr, SL_SUCCESS);
       }
@@ -2175,7 +3757,7 @@ static void UnloadTPLMsg(int msg_length)
    /* 
    ** Advance to next message in packet.
    */
-   rx_info.unload_index += seg_length;
+   ctx->rx_info.unload_index += seg_length;
 }
 
 /*******************************************************************************
@@ -2184,18 +3766,18 @@ static void UnloadTPLMsg(int msg_length)
  *      BEFORE any messages in a packet are unloaded (from UnloadPacketStart).
  *
  * Parameters:
- *      None.
+ *      ctx - the context of the link.
  *
  * Returns: 
  *	    None. 
  *      
  ******************************************************************************/
-static void TPLClearUnload(void)
+static void TPLClearUnload(SL_CONTEXT *ctx)
 {
    int i;
-   for (i=0; i<TPL_RX_RECORDS; ++i)
+   for (i=0; i<ctx->tpl_rx_active_cnt; ++i)
    {
-      tpl_rx_table[ i ].flags &= ~(TPL_RXF_MSG_UNLOADED);
+      ctx->tpl_rx_table[ ctx->tpl_rx_active[ i ] ].flags &= ~(TPL_RXF_MSG_UNLOADED);
    }
 }
 
@@ -2205,20 +3787,20 @@ static void TPLClearUnload(void)
  *      AFTER any messages in a packet are unloaded (with SL_NO_MORE_MSGS returned).
  *
  * Parameters:
- *      None.
+ *      ctx - the context of the link.
  *
  * Returns: 
  *	    None. 
  *      
  ******************************************************************************/
-static void TPLCheckUnload(void)
+static void TPLCheckUnload(SL_CONTEXT *ctx)
 {
    int i;
-   TPL_RX_RECORD  *tpl_rx_rec;
+   SL_TPL_RX_RECORD  *tpl_rx_rec;
 
-   for (i=0; i<TPL_RX_RECORDS; ++i)
+   for (i=0; i<ctx->tpl_rx_active_cnt; ++i)
    {
-      tpl_rx_rec = &tpl_rx_table[ i ];
+      tpl_rx_rec = &ctx->tpl_rx_table[ ctx->tpl_rx_active[ i ] ];
 	  if (((tpl_rx_rec->flags & TPL_RXF_IN_USE) !=0) && 
 		  ((tpl_rx_rec->flags & TPL_RXF_MSG_UNLOADED) == 0) &&
 		  ((tpl_rx_rec->flags & TPL_RXF_GEN_TX_ABT) == 0))
@@ -2238,6 +3820,7 @@ static void TPLCheckUnload(void)
  *      Loads a TPL related messages in an outgoing packet. 
  *
  * Parameters:
+ *	    ctx - the context of the link.
  *	    msg_id - id of message
  *      msg_sz_bytes - size of message in bytes
  *      msg_data - pointer to message data
@@ -2248,41 +3831,41 @@ static void TPLCheckUnload(void)
  *	    SL_SUCCESS if successful
  *      SL_MSG_TO_LONG if message wont fit in available space in outgoing packet.
  ******************************************************************************/
-static int LoadOneTPLMsg(int msg_id, int msg_sz_bytes, U8 *msg_data, int bytes_remaining, int seg_number)
+static int LoadOneTPLMsg(SL_CONTEXT *ctx, int msg_id, int msg_sz_bytes, U8 *msg_data, int bytes_remaining, int seg_number)
 {
    /*
    ** Confirm message will fit.
    */
-   if (((tx_info.load_index-1) + MSG_HDR_BYTES + TPL_MSG_HDR_BYTES + msg_sz_bytes) > OFFSET_LAST_PKT_BYTE) 
+   if (((ctx->tx_info.load_index-1) + MSG_HDR_BYTES + TPL_MSG_HDR_BYTES + msg_sz_bytes) > OFFSET_LAST_PKT_BYTE) 
    {
       return(SL_MSG_TOO_LONG);
    }
 
-   tx_info.pkt_ptr[ tx_info.load_index + MSG_ID_LSB ] = (U8) 0xFF;  /* ID of TPL msg is 0xFFFF*/
-   tx_info.pkt_ptr[ tx_info.load_index + MSG_ID_MSB ] = (U8) 0xFF;  /* ID of TPL msg is 0xFFFF*/
+   ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + MSG_ID_LSB ] = (U8) 0xFF;  /* ID of TPL msg is 0xFFFF*/
+   ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + MSG_ID_MSB ] = (U8) 0xFF;  /* ID of TPL msg is 0xFFFF*/
    
-   tx_info.pkt_ptr[ tx_info.load_index + MSG_LEN_LSB ] = GET_LSB(msg_sz_bytes + TPL_MSG_HDR_BYTES);
-   tx_info.pkt_ptr[ tx_info.load_index + MSG_LEN_MSB ] = GET_MSB(msg_sz_bytes + TPL_MSG_HDR_BYTES);
+   ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + MSG_LEN_LSB ] = GET_LSB(msg_sz_bytes + TPL_MSG_HDR_BYTES);
+   ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + MSG_LEN_MSB ] = GET_MSB(msg_sz_bytes + TPL_MSG_HDR_BYTES);
 
-   tx_info.load_index += MSG_HDR_BYTES;
+   ctx->tx_info.load_index += MSG_HDR_BYTES;
 
-   tx_info.pkt_ptr[ tx_info.load_index + TPL_MSG_ID_LSB ] = GET_LSB(msg_id);
-   tx_info.pkt_ptr[ tx_info.load_index + TPL_MSG_ID_MSB ] = GET_MSB(msg_id);
+   ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + TPL_MSG_ID_LSB ] = GET_LSB(msg_id);
+   ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + TPL_MSG_ID_MSB ] = GET_MSB(msg_id);
 
-   tx_info.pkt_ptr[ tx_info.load_index + TPL_MSG_BYTES_REM_LSB ] = GET_LSB(bytes_remaining); 
-   tx_info.pkt_ptr[ tx_info.load_index + TPL_MSG_BYTES_REM_MSB ] = GET_MSB(bytes_remaining);
+   ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + TPL_MSG_BYTES_REM_LSB ] = GET_LSB(bytes_remaining); 
+   ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + TPL_MSG_BYTES_REM_MSB ] = GET_MSB(bytes_remaining);
   
-   tx_info.pkt_ptr[ tx_info.load_index + TPL_SEG_NUMBER_LSB ] = GET_LSB(seg_number); 
-   tx_info.pkt_ptr[ tx_info.load_index + TPL_SEG_NUMBER_MSB ] = GET_MSB(seg_number);
+   ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + TPL_SEG_NUMBER_LSB ] = GET_LSB(seg_number); 
+   ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + TPL_SEG_NUMBER_MSB ] = GET_MSB(seg_number);
 
-   memcpy(&tx_info.pkt_ptr[ tx_info.load_index + TPL_MSG_HDR_BYTES ], msg_data, msg_sz_bytes);
-   INCREMENT_STAT(stats.msgs_loaded);
+   memcpy(&ctx->tx_info.pkt_ptr[ ctx->tx_info.load_index + TPL_MSG_HDR_BYTES ], msg_data, msg_sz_bytes);
+   INCREMENT_STAT(ctx->stats.msgs_loaded);
 
    /*
    ** Update load control variables.
    */
-   ++tx_info.msg_count;
-   tx_info.load_index += (msg_sz_bytes + TPL_MSG_HDR_BYTES);
+   ++ctx->tx_info.msg_count;
+   ctx->tx_info.load_index += (msg_sz_bytes + TPL_MSG_HDR_BYTES);
    return(SL_SUCCESS);
 }
 
@@ -2293,30 +3876,34 @@ static int LoadOneTPLMsg(int msg_id, int msg_sz_bytes, U8 *msg_data, int bytes_r
  *      messages loaded in the packet.
  *
  * Parameters:
- *	    None.	
+ *	    ctx - the context of the link.
  *
  * Returns: 
  *	    None. 
  ******************************************************************************/
-static void LoadTPLMsgs(void)
+static void LoadTPLMsgs(SL_CONTEXT *ctx)
 {
    int i;
    int rc;
    int bytes_left; 
+   int rec;
    TPL_ABT_MSG    abt_msg;
-   TPL_RX_RECORD  *tpl_rx_rec = &tpl_rx_table[ 0 ];
+   SL_TPL_RX_RECORD  *tpl_rx_rec;
 
    /*
-   ** First take care of any Tx ABT's that need to be sent.
+   ** First take care of any Tx ABT's that need to be sent.  The list of records in use is 
+   ** walked backwards since freeing a record moves the last record of the list in its place.
    */
-   for (i=0; i<TPL_RX_RECORDS; ++i)
+   for (i=ctx->tpl_rx_active_cnt-1; i>=0; --i)
    {
+      rec = ctx->tpl_rx_active[ i ];
+      tpl_rx_rec = &ctx->tpl_rx_table[ rec ];
       if (((tpl_rx_rec->flags & TPL_RXF_IN_USE) !=0) && ((tpl_rx_rec->flags & TPL_RXF_GEN_TX_ABT) != 0))
       {
          abt_msg.msg_id = tpl_rx_rec->msg_id;
          abt_msg.error_code = tpl_rx_rec->tx_abort_code;
-         rc = SL_LoadPacketStatusMsg(ID_TPL_TX_ABT_MSG, sizeof(abt_msg), (U8 *) &abt_msg, &bytes_left);
-         tpl_rx_rec->flags = 0;  /* Mark record as free */
+         rc = SL_CtxLoadPacketStatusMsg(ctx, ID_TPL_TX_ABT_MSG, sizeof(abt_msg), (U8 *) &abt_msg, &bytes_left);
+         FreeRxTableRec(ctx, rec);
 		 /*
 		 ** To prevent unwanted RxMsgComplete calls, make sure the buffer is not NULL
 		 */
@@ -2328,13 +3915,12 @@ static void LoadTPLMsgs(void)
             /* We should never here, if we do treat as fatal error. */
          }
       }
-      ++tpl_rx_rec;
    }
 
    /*
    ** Now load each TPL message with "min bytes per packet" message length.
    */
-   LoadTPLMsgsFill(0);
+   LoadTPLMsgsFill(ctx, 0);
 }
 
 /*******************************************************************************
@@ -2346,28 +3932,34 @@ static void LoadTPLMsgs(void)
  *      LoadFinish function. 
  *
  * Parameters:
+ *	    ctx - the context of the link.
  *	    fill_packet - =0 -> load min_bytes_packet bytes in each packet
  *                   !=0 -> load as many bytes as will fit.
  * Returns: 
  *	    None. 
  ******************************************************************************/
 #define EMPTY_SLOT    (-1)
-static void LoadTPLMsgsFill(unsigned int fill_packet)
+static void LoadTPLMsgsFill(SL_CONTEXT *ctx, unsigned int fill_packet)
 {
    int rc;
-   int node = tx_msg_list_head; 
+   int node;
    int bytes_to_tx;
    int bytes_remaining;
-   int bytes_left = YZ_SPI_PKT_SIZE - tx_info.load_index;
-   TPL_TX_RECORD  *tpl_tx_rec = &tpl_tx_table[ 0 ];
+   int bytes_left = YZ_SPI_PKT_SIZE - ctx->tx_info.load_index;
+   int num_loaded = 0;
+   int loaded[ TPL_TX_RECORDS ];
+   SL_TPL_TX_RECORD  *tpl_tx_rec;
 
    /*
-   ** Traverse the Tx message list and load the next segment for all active message transfers until
-   ** end of the Tx list is reached or the packet is full.
+   ** Take the active message transfers off the Tx heap in priority order and load the next segment
+   ** of each until the heap is empty or the packet is full.  The transfers still in progress are
+   ** put back on the heap afterwards, so each one is loaded at most once per call.
    */
-   while ((node != NULL_NODE) && (bytes_left > (MSG_HDR_BYTES + TPL_MSG_HDR_BYTES)))
+   while ((ctx->tpl_tx_heap_size > 0) && (bytes_left > (MSG_HDR_BYTES + TPL_MSG_HDR_BYTES)))
    {
-      tpl_tx_rec = &tpl_tx_table[ node ];
+      node = ctx->tpl_tx_heap[ 0 ];
+      TPLTxHeapRemove(ctx, 0);
+      tpl_tx_rec = &ctx->tpl_tx_table[ node ];
       /*
       ** Calculate number of bytes desired to Tx (either bytes remaining in message or min_bytes_packet).
       */
@@ -2383,14 +3975,14 @@ static void LoadTPLMsgsFill(unsigned int fill_packet)
       /*
       ** Clamp bytes to Tx based on bytes left in packet.
       */
-      if (bytes_to_tx > (YZ_SPI_PKT_SIZE - tx_info.load_index - MSG_HDR_BYTES - TPL_MSG_HDR_BYTES))
+      if (bytes_to_tx > (YZ_SPI_PKT_SIZE - ctx->tx_info.load_index - MSG_HDR_BYTES - TPL_MSG_HDR_BYTES))
       {
-         bytes_to_tx = (YZ_SPI_PKT_SIZE - tx_info.load_index - MSG_HDR_BYTES - TPL_MSG_HDR_BYTES);
+         bytes_to_tx = (YZ_SPI_PKT_SIZE - ctx->tx_info.load_index - MSG_HDR_BYTES - TPL_MSG_HDR_BYTES);
       }
 
       bytes_remaining =  (tpl_tx_rec->msg_sz_bytes - tpl_tx_rec->load_index) - bytes_to_tx;
 
-      rc = LoadOneTPLMsg(tpl_tx_rec->msg_id, bytes_to_tx, &tpl_tx_rec->buffer_ptr[ tpl_tx_rec->load_index ], 
+      rc = LoadOneTPLMsg(ctx, tpl_tx_rec->msg_id, bytes_to_tx, &tpl_tx_rec->buffer_ptr[ tpl_tx_rec->load_index ], 
                                      bytes_remaining, tpl_tx_rec->next_seg_num);
       if (rc != SL_SUCCESS)
       {
@@ -2400,26 +3992,24 @@ static void LoadTPLMsgsFill(unsigned int fill_packet)
       {
          tpl_tx_rec->load_index += bytes_to_tx;
          ++tpl_tx_rec->next_seg_num;
+         loaded[ num_loaded++ ] = node;
       }
       else
       {
          /*
          ** Message transfer is done, so do the following:
          ** (1) Notify, via callback function, that the message transfer is complete.
-         ** (2) Unlink the node from the Tx message list.
-         ** (3) Free up the node in the TPL Tx table
+         ** (2) Unlink the node and free it up in the TPL Tx table
          */
          SLx_TPLTxMsgComplete(tpl_tx_rec->msg_id, tpl_tx_rec->msg_sz_bytes, tpl_tx_rec->buffer_ptr, SL_SUCCESS);
-         UnlinkTPLTxNode(tpl_tx_rec->msg_id);
-         tpl_tx_rec->buffer_ptr = NULL;
-		 tpl_tx_rec->next_node = NULL_NODE;
+         UnlinkTPLTxNode(ctx, tpl_tx_rec->msg_id);
       }
-      bytes_left =  YZ_SPI_PKT_SIZE - tx_info.load_index;
-	  //RyanS added IF statement 
-	  //Reason: If tpl_tx_table[ node ] is not the same as tpl_tx_rec (which it is initially set to) then a message was UNLINKED
-	  //	and it was the head message. We must NOT move to the next_node in this case.
-	  if (&tpl_tx_table[ node ] == tpl_tx_rec)
-		  node = tpl_tx_table[ node ].next_node;
+      bytes_left =  YZ_SPI_PKT_SIZE - ctx->tx_info.load_index;
+   }
+
+   while (num_loaded > 0)
+   {
+      TPLTxHeapInsert(ctx, loaded[ --num_loaded ]);
    }
 }
 
@@ -2428,27 +4018,25 @@ static void LoadTPLMsgsFill(unsigned int fill_packet)
  *      Aborts all TPL Tx messages in progress due to COMM_RESET.
  *
  * Parameters:
- *	    None.	
+ *	    ctx - the context of the link.
  *
  * Returns: 
  *	    None. 
  ******************************************************************************/
-static void TPLAbortTxMsgs(void)
+static void TPLAbortTxMsgs(SL_CONTEXT *ctx)
  {
    int i;
-   TPL_TX_RECORD *tpl_tx_rec;
+   SL_TPL_TX_RECORD *tpl_tx_rec;
 
-   for (i=0; i<TPL_RX_RECORDS; ++i)
+   for (i=0; i<TPL_TX_RECORDS; ++i)
    {
-      tpl_tx_rec = &tpl_tx_table[ i ];
+      tpl_tx_rec = &ctx->tpl_tx_table[ i ];
       if (tpl_tx_rec->buffer_ptr != NULL) 
       {
          SLx_TPLTxMsgComplete(tpl_tx_rec->msg_id, tpl_tx_rec->msg_sz_bytes, tpl_tx_rec->buffer_ptr, TPL_ABT_COMM_RESET);
-         UnlinkTPLTxNode(tpl_tx_rec->msg_id);
-         tpl_tx_rec->buffer_ptr = NULL;
+         UnlinkTPLTxNode(ctx, tpl_tx_rec->msg_id);
       }
    }
-   tx_msg_list_head = NULL_NODE;
  }
 
 /*******************************************************************************
@@ -2456,30 +4044,98 @@ static void TPLAbortTxMsgs(void)
  *      Aborts all TPL Rx messages in progress due to COMM_RESET.
  *
  * Parameters:
- *	    None.	
+ *	    ctx - the context of the link.
  *
  * Returns: 
  *	    None. 
  ******************************************************************************/
-static void TPLAbortRxMsgs(void)
+static void TPLAbortRxMsgs(SL_CONTEXT *ctx)
  {
    int i;
-   TPL_RX_RECORD  *tpl_rx_rec;
+   SL_TPL_RX_RECORD  *tpl_rx_rec;
 
-   for (i=0; i<TPL_RX_RECORDS; ++i)
+   while (ctx->tpl_rx_active_cnt > 0)
    {
-      tpl_rx_rec = &tpl_rx_table[ i ];
-      if ((tpl_rx_rec->flags & TPL_RXF_IN_USE) !=0) 
-      {
-         SLx_TPLTxMsgComplete(tpl_rx_rec->msg_id, tpl_rx_rec->msg_sz_bytes, tpl_rx_rec->buffer_ptr, TPL_ABT_COMM_RESET);
-         tpl_rx_rec->flags = 0;
-      }
+      i = ctx->tpl_rx_active[ ctx->tpl_rx_active_cnt - 1 ];
+      tpl_rx_rec = &ctx->tpl_rx_table[ i ];
+      SLx_TPLTxMsgComplete(tpl_rx_rec->msg_id, tpl_rx_rec->msg_sz_bytes, tpl_rx_rec->buffer_ptr, TPL_ABT_COMM_RESET);
+      FreeRxTableRec(ctx, i);
    }
  }
 
 
 
-#endif /* #if (YZ_SPI_TPL_ENABLE != 0) */
+#endif /* #if (YZ_SPI_TPL_ENABLE != 0) */
+
+/******************************************************************************/
+/*     D E F A U L T   L I N K   F U N C T I O N S                            */
+/******************************************************************************/
+/*
+** The functions of the single link API apply the SL_Ctx function of the same 
+** name to the context pointed to by sl_ctx.
+*/
+
+void SL_Initialize(U8 *buffer1_ptr, U8 *buffer2_ptr, U8 reason_for_init)
+{
+   SL_CtxInitialize(sl_ctx, buffer1_ptr, buffer2_ptr, reason_for_init);
+}
+
+int SL_GetPacketToTx(U8 **packet_ptr)
+{
+   return(SL_CtxGetPacketToTx(sl_ctx, packet_ptr));
+}
+
+int SL_LoadPacketStart(int *bytes_left)
+{
+   return(SL_CtxLoadPacketStart(sl_ctx, bytes_left));
+}
+
+int SL_LoadPacketMsg(int msg_id, int msg_size_bytes, U8 *msg_data, int *bytes_left)
+{
+   return(SL_CtxLoadPacketMsg(sl_ctx, msg_id, msg_size_bytes, msg_data, bytes_left));
+}
+
+int SL_LoadPacketStatusMsg(int status_msg_id, int status_msg_size_bytes, U8 *msg_data, int *bytes_left)
+{
+   return(SL_CtxLoadPacketStatusMsg(sl_ctx, status_msg_id, status_msg_size_bytes, msg_data, bytes_left));
+}
+
+int SL_LoadPacketFinish(void)
+{
+   return(SL_CtxLoadPacketFinish(sl_ctx));
+}
+
+int SL_UnloadPacketStart(U8 *packet_ptr)
+{
+   return(SL_CtxUnloadPacketStart(sl_ctx, packet_ptr));
+}
+
+int SL_UnloadPacketMsg(int *msg_id, int *msg_size_bytes, U8 **buff_ptr)
+{
+   return(SL_CtxUnloadPacketMsg(sl_ctx, msg_id, msg_size_bytes, buff_ptr));
+}
+
+void SL_GetStatistics(SL_STATS_RECORD *stats_buff)
+{
+   SL_CtxGetStatistics(sl_ctx, stats_buff);
+}
+
+int SL_EnableWindow(U8 *buffers, int window)
+{
+   return(SL_CtxEnableWindow(sl_ctx, buffers, window));
+}
+
+int SL_LoadPacketPacked(SL_PACK_QUEUE *queue, int *bytes_left)
+{
+   return(SL_CtxLoadPacketPacked(sl_ctx, queue, bytes_left));
+}
+
+#if (YZ_SPI_TPL_ENABLE != 0)
+int SL_TxTPLMsg(int msg_id, int msg_sz_bytes, U8 *msg_data, int min_bytes_packet)
+{
+   return(SL_CtxTxTPLMsg(sl_ctx, msg_id, msg_sz_bytes, msg_data, min_bytes_packet));
+}
+#endif
 
 #ifdef SL_TEST
 /*******************************************************************************************/
@@ -2487,7 +4143,8 @@ static void TPLAbortRxMsgs(void)
 /*******************************************************************************************/
 /*****  TEST FUNCTIONS - THE FOLLOWING FUNCTIONS ARE PROVIDED FOR TESTING ONLY.        *****/
 /*****  THEY ARE NOT INTENDED TO BE USED DURING NORMAL OPERATIONAL USAGE AND ARE       *****/
-/*****  THEREFORE NOT INCLUDED IN spi_lib.h.                                           *****/
+/*****  THEREFORE NOT INCLUDED IN spi_lib.h (EXCEPT SL_TEST_VirtualLink, WHOSE        *****/
+/*****  PARAMETER TYPES ARE NEEDED BY ITS CALLERS).                                   *****/
 /*******************************************************************************************/
 /*******************************************************************************************/
 
@@ -2509,6 +4166,74 @@ U16 SL_TEST_CalculateCrc(U8 * pBuf, int length)
     return(CalculateCrc(pBuf, length));
 }
 
+/********************************************************************************************
+*  Function: SL_TEST_CrcBenchmark
+*       THIS IS A FUNCTION TO SUPPORT UNIT TEST ONLY!!!!!
+*       Computes the CRC of num_pkts packets (taken in turn from a set of random 
+*       packets) with every CRC engine supported by the node, checks that each engine
+*       gives the results of the bitwise engine and measures the time taken by each
+*       of them.  The engine in use is restored.
+*
+*  Parameters:    
+*       num_pkts - number of packets to compute the CRC of.
+*       usecs - array of SL_CRC_NUM_ENGINES entries, returns the time in usec taken
+*          by each engine (indexed by SL_CRC_ENGINE_ value), 0 if not supported.
+*
+*  Returns:     
+*       SL_SUCCESS - every engine gave the same CRC.
+*       SL_INVALID_CRC - an engine gave a different CRC. 
+********************************************************************************************/ 
+#define BENCH_NUM_PKTS  (16)
+int SL_TEST_CrcBenchmark(int num_pkts, U32 usecs[])
+{
+   static U8 pkts[BENCH_NUM_PKTS][YZ_SPI_PKT_SIZE];
+   int saved_req = crc_engine_req;
+   int rc = SL_SUCCESS;
+   int engine;
+   int i;
+   int j;
+   U32 sum;
+   U32 ref_sum = 0;
+   clock_t start;
+
+   for (i = 0; i < BENCH_NUM_PKTS; i++)
+   {
+      for (j = 0; j < (int)YZ_SPI_PKT_SIZE; j++)
+      {
+         pkts[i][j] = (U8)rand();
+      }
+   }
+
+   for (engine = SL_CRC_ENGINE_BITWISE; engine < SL_CRC_NUM_ENGINES; engine++)
+   {
+      usecs[engine] = 0;
+      if (SL_SetCrcEngine(engine) != SL_SUCCESS)
+      {
+         continue;
+      }
+      /* A position weighted sum of the CRCs, the bitwise engine (first) is the reference */
+      sum = 0;
+      start = clock();
+      for (i = 0; i < num_pkts; i++)
+      {
+         sum += CalculateCrc(&pkts[i % BENCH_NUM_PKTS][2], YZ_SPI_PKT_SIZE - 2) * (U32)(i + 1);
+      }
+      usecs[engine] = (U32)(((clock() - start) * 1000000.0) / CLOCKS_PER_SEC);
+      if (engine == SL_CRC_ENGINE_BITWISE)
+      {
+         ref_sum = sum;
+      }
+      else if (sum != ref_sum)
+      {
+         rc = SL_INVALID_CRC;
+      }
+      PRINTF("SL_TEST_CrcBenchmark: engine %d, %d packets in %u usec\n", engine, num_pkts, usecs[engine]);
+   }
+
+   (void)SL_SetCrcEngine(saved_req);
+   return(rc);
+}
+
 /********************************************************************************************
 *  Function: SL_TEST_Unload
 *       THIS IS A FUNCTION TO SUPPORT UNIT TEST ONLY!!!!!
@@ -2523,7 +4248,7 @@ U16 SL_TEST_CalculateCrc(U8 * pBuf, int length)
 ********************************************************************************************/ 
 void SL_TEST_Unload(void)
 {
-   api_state = WAIT_UNLOAD_START;
+   sl_ctx->api_state = WAIT_UNLOAD_START;
 }
 
 /*******************************************************************************
@@ -2663,41 +4388,14 @@ void SL_TEST_DumpPacket(U8 *pkt_ptr)
 }
 
 /*
-** The following variables are prefixed with either "vp_" or "gp_" to 
-** represent the state information that is maintained to support node-to-node
-** testing.  During node-to-node testing packets are "transmitted" (via memcpy) 
-** between the VP and GP nodes.  Doing so requires node specific state information 
-** to be maintained by the library.  The library is inheritly single instance and
-** making the library multi-instance will make the code more difficult to 
-** maintain, larger, and slower so the approach taken is to store copies
-** of global variables for each node and copy node specific variables to the
-** library global variables when the "focus" is changed to a new node via the  
+** The following contexts hold the state of the VP and GP nodes to support 
+** node-to-node testing.  During node-to-node testing packets are "transmitted" 
+** (via memcpy) between the VP and GP nodes.  The SL_ functions without a context
+** parameter drive the node that has "focus", which is changed via the 
 ** SL_TEST_SetFocusVP and SL_TEST_SetFocusGP functions.
 */
-static int vp_api_state = WAIT_INIT;
-static int gp_api_state = WAIT_INIT;
-
-static TX_INFO  vp_tx_info;
-static TX_INFO  gp_tx_info;
-
-static RX_INFO  vp_rx_info;
-static RX_INFO  gp_rx_info;
-
-static SL_STATS_RECORD vp_stats;
-static SL_STATS_RECORD gp_stats;
-
-#if (YZ_SPI_TPL_ENABLE != 0)
-   static TPL_TX_RECORD gp_tpl_tx_table[ YZ_SPI_TPL_MAX_SIM_TFRS ];
-   static TPL_TX_RECORD vp_tpl_tx_table[ YZ_SPI_TPL_MAX_SIM_TFRS ];
-
-   static TPL_RX_RECORD gp_tpl_rx_table[ YZ_SPI_TPL_MAX_SIM_TFRS ];
-   static TPL_RX_RECORD vp_tpl_rx_table[ YZ_SPI_TPL_MAX_SIM_TFRS ];
-
-   static int   vp_tx_msg_list_head = NULL_NODE;
-   static int   gp_tx_msg_list_head = NULL_NODE;
-#endif
-
-static int current_focus;  /* Stores what node currently has focus */
+static SL_CONTEXT vp_ctx;
+static SL_CONTEXT gp_ctx;
 
 /*******************************************************************************
  * Function: SL_TEST_InitNodes
@@ -2714,33 +4412,14 @@ static int current_focus;  /* Stores what node currently has focus */
  ******************************************************************************/
 void SL_TEST_InitNodes(U8 *vp_buffer1_ptr, U8 *vp_buffer2_ptr, U8 *gp_buffer1_ptr, U8 *gp_buffer2_ptr)
 {
-   SL_Initialize(vp_buffer1_ptr, vp_buffer2_ptr, RFI_CPU_RESET );
-   SL_VPSpecificInit();
-   vp_api_state = api_state;
-   vp_tx_info = tx_info;
-   vp_rx_info = rx_info;
-#if (YZ_SPI_TPL_ENABLE != 0)
-   memcpy(vp_tpl_tx_table, tpl_tx_table, sizeof(tpl_tx_table) );
-   memcpy(vp_tpl_rx_table, tpl_rx_table, sizeof(tpl_rx_table) );
-   vp_tx_msg_list_head = tx_msg_list_head;
-
-   memcpy(gp_tpl_tx_table, tpl_tx_table, sizeof(tpl_tx_table) );
-   memcpy(gp_tpl_rx_table, tpl_rx_table, sizeof(tpl_rx_table) );
-   gp_tx_msg_list_head = tx_msg_list_head;
-#endif
-   vp_stats = stats;
+   SL_CtxInitialize(&vp_ctx, vp_buffer1_ptr, vp_buffer2_ptr, RFI_CPU_RESET );
+   SL_VPSpecificInit(&vp_ctx);
 
-   SL_Initialize(gp_buffer1_ptr, gp_buffer2_ptr, RFI_CPU_RESET );
-   SL_GPSpecificInit();
-   gp_api_state = api_state;
-   gp_tx_info = tx_info;
-   gp_rx_info = rx_info;
-   
-
-   gp_stats = stats;
+   SL_CtxInitialize(&gp_ctx, gp_buffer1_ptr, gp_buffer2_ptr, RFI_CPU_RESET );
+   SL_GPSpecificInit(&gp_ctx);
 
    /* Set focus to GP_NODE since is was initialized last. */
-   current_focus = GP_NODE;
+   sl_ctx = &gp_ctx;
 }
 
 /*******************************************************************************
@@ -2757,31 +4436,7 @@ void SL_TEST_InitNodes(U8 *vp_buffer1_ptr, U8 *vp_buffer2_ptr, U8 *gp_buffer1_pt
  ******************************************************************************/
 void SL_TEST_SetFocusVP(void)
 {
-   if (current_focus == GP_NODE)
-   {
-      /*
-      ** Current focus is GP so a swap to VP is necessary.
-      */
-      gp_api_state = api_state;
-      gp_tx_info = tx_info;
-      gp_rx_info = rx_info;
-      gp_stats = stats;
-#if (YZ_SPI_TPL_ENABLE != 0)
-	  memcpy(gp_tpl_tx_table, tpl_tx_table, sizeof(tpl_tx_table) );
-      memcpy(gp_tpl_rx_table, tpl_rx_table, sizeof(tpl_rx_table) );
-	  gp_tx_msg_list_head = tx_msg_list_head;
-
-	  memcpy(tpl_tx_table, vp_tpl_tx_table, sizeof(vp_tpl_tx_table) );
-      memcpy(tpl_rx_table, vp_tpl_rx_table, sizeof(vp_tpl_rx_table) );
-	  tx_msg_list_head = vp_tx_msg_list_head;
-#endif
-      api_state = vp_api_state;
-      tx_info = vp_tx_info;
-      rx_info = vp_rx_info;
-	  
-      stats = vp_stats;
-      current_focus = VP_NODE;
-   }
+   sl_ctx = &vp_ctx;
 }
 
 /*******************************************************************************
@@ -2798,30 +4453,7 @@ void SL_TEST_SetFocusVP(void)
  ******************************************************************************/
 void SL_TEST_SetFocusGP(void)
 {
-   if (current_focus == VP_NODE)
-   {
-      /*
-      ** Current focus is VP so a swap to GP is necessary.
-      */
-      vp_api_state = api_state;
-      vp_tx_info = tx_info;
-      vp_rx_info = rx_info;
-      vp_stats = stats;
-#if (YZ_SPI_TPL_ENABLE != 0)
-	  memcpy(vp_tpl_tx_table, tpl_tx_table, sizeof(tpl_tx_table) );
-      memcpy(vp_tpl_rx_table, tpl_rx_table, sizeof(tpl_rx_table) );
-	  vp_tx_msg_list_head = tx_msg_list_head;
-
-      memcpy(tpl_tx_table, gp_tpl_tx_table, sizeof(gp_tpl_tx_table) );
-      memcpy(tpl_rx_table, gp_tpl_rx_table, sizeof(gp_tpl_rx_table) );
-	  tx_msg_list_head = gp_tx_msg_list_head;
-#endif
-	  api_state = gp_api_state;
-      tx_info = gp_tx_info;
-      rx_info = gp_rx_info;
-      stats = gp_stats;
-      current_focus = GP_NODE;
-   }
+   sl_ctx = &gp_ctx;
 }
 
 /*******************************************************************************
@@ -2836,20 +4468,452 @@ void SL_TEST_SetFocusGP(void)
  ******************************************************************************/
 void SL_TEST_ResetStats(void)
 {
-   vp_stats.crc_errors = 0;
-   vp_stats.EOP_errors = 0;
-   vp_stats.msg_id_errors = 0;
-   vp_stats.msgs_loaded = 0;
-   vp_stats.msgs_unloaded = 0;
-   vp_stats.nack_rx_nz = 0;
-   vp_stats.pkt_tx_cnt = 0;
-   vp_stats.pkt_tx_retries = 0;
-   vp_stats.pkts_consumed = 0;
-   vp_stats.pkts_discarded = 0;
-   vp_stats.sn_errors = 0;
-
-   gp_stats = vp_stats;
-   stats = vp_stats;
+   vp_ctx.stats.crc_errors = 0;
+   vp_ctx.stats.EOP_errors = 0;
+   vp_ctx.stats.msg_id_errors = 0;
+   vp_ctx.stats.msgs_loaded = 0;
+   vp_ctx.stats.msgs_unloaded = 0;
+   vp_ctx.stats.nack_rx_nz = 0;
+   vp_ctx.stats.pkt_tx_cnt = 0;
+   vp_ctx.stats.pkt_tx_retries = 0;
+   vp_ctx.stats.pkts_consumed = 0;
+   vp_ctx.stats.pkts_discarded = 0;
+   vp_ctx.stats.sn_errors = 0;
+
+   gp_ctx.stats = vp_ctx.stats;
+   sl_default_ctx.stats = vp_ctx.stats;
+}
+
+/*
+** The following definitions support the virtual SPI link of SL_TEST_VirtualLink.
+** Each node keeps the offer time of its messages from the moment they are offered
+** until the other node unloads them, indexed by message sequence number.  Every 
+** message carries its sequence number in its first 4 bytes, the other bytes are 
+** derived from it so the receiver can check the message data.
+*/
+#define VLINK_QUEUE_SIZE      (4096)   /* Messages offered but not delivered, per node */
+#define VLINK_LAT_PER_XFER    (32)     /* Latency units per transfer period */
+#define VLINK_LAT_SUB_BITS    (6)      /* Log2 of the number of linear buckets */
+#define VLINK_LAT_SUB_HALF    (1 << (VLINK_LAT_SUB_BITS - 1))  /* Buckets per power of 2 above them */
+#define VLINK_LAT_BUCKETS     ((33 - VLINK_LAT_SUB_BITS) * VLINK_LAT_SUB_HALF + VLINK_LAT_SUB_HALF)  /* Buckets of the latency histogram, up to 2^32 units */
+
+typedef struct 
+{
+   U32    next_seq;            /* Sequence number of the next message offered */
+   U32    load_seq;            /* Sequence number of the next message to load */
+   U32    peer_seq;            /* Sequence number of the next message the peer expects */
+   U32    msgs_per_sec;        /* Rate of the offers */
+   double next_offer_usec;     /* Time of the next offer */
+   double offer_usec[ VLINK_QUEUE_SIZE ];   /* Offer time of each message, by sequence number */
+} VLINK_NODE;
+
+/*
+** Variable: vlink_node
+**    State of the clients of the VP (index 0) and GP (index 1) nodes.
+*/
+static VLINK_NODE vlink_node[2];
+
+/*
+** Variable: vlink_latency
+**    Histogram of the message latency in latency units (1/VLINK_LAT_PER_XFER of 
+**    the transfer period).  The first 2^VLINK_LAT_SUB_BITS buckets are one unit
+**    wide, above them each power of 2 is split in VLINK_LAT_SUB_HALF buckets, so
+**    the width of a bucket stays within 1/VLINK_LAT_SUB_HALF of its latency 
+**    whatever the range of the run.
+*/
+static U32 vlink_latency[ VLINK_LAT_BUCKETS ];
+
+/*
+** Variable: vlink_focus
+**    Functions giving the focus to the VP (index 0) and GP (index 1) nodes.
+*/
+static void (* const vlink_focus[2])(void) = { SL_TEST_SetFocusVP, SL_TEST_SetFocusGP };
+
+/*******************************************************************************
+ * Function: VLinkOffer
+ *      Offers the messages of the clients of a node up to the current time. A
+ *      message offered while VLINK_QUEUE_SIZE messages of the node are waiting
+ *      to be delivered is dropped.
+ *		
+ * Parameters:
+ *	    node - the node.	
+ *	    now_usec - the current time.	
+ *	    report - counts the messages offered and dropped.	
+ *
+ * Returns: 
+ *		None.
+ ******************************************************************************/
+static void VLinkOffer(VLINK_NODE *node, double now_usec, SL_VLINK_REPORT *report)
+{
+   if (node->msgs_per_sec == 0)
+   {
+      return;
+   }
+   while (node->next_offer_usec <= now_usec)
+   {
+      ++report->msgs_offered;
+      if ((node->next_seq - node->peer_seq) < VLINK_QUEUE_SIZE)
+      {
+         node->offer_usec[ node->next_seq % VLINK_QUEUE_SIZE ] = node->next_offer_usec;
+         ++node->next_seq;
+      }
+      else
+      {
+         ++report->msgs_dropped;
+      }
+      node->next_offer_usec += 1000000.0 / node->msgs_per_sec;
+   }
+}
+
+/*******************************************************************************
+ * Function: VLinkGetPacket
+ *      Gets the packet the node in focus transmits next.  When a new packet is
+ *      needed it is loaded with as many of the messages offered as fit.
+ *		
+ * Parameters:
+ *	    node - the node in focus.	
+ *	    msg_size_bytes - size of every message.	
+ *	    packet_ptr - returns the packet to transmit.	
+ *
+ * Returns: 
+ *		The return code of SL_GetPacketToTx.
+ ******************************************************************************/
+static int VLinkGetPacket(VLINK_NODE *node, int msg_size_bytes, U8 **packet_ptr)
+{
+   U8  msg[ YZ_SPI_PKT_MAX_MSG_SIZE ];
+   int bytes_left;
+   int rc;
+   int i;
+
+   rc = SL_GetPacketToTx(packet_ptr);
+   if ((rc != SL_SUCCESS) || (*packet_ptr != NULL))
+   {
+      return(rc);
+   }
+
+   (void)SL_LoadPacketStart(&bytes_left);
+   while ((node->load_seq != node->next_seq) && (msg_size_bytes <= bytes_left))
+   {
+      msg[0] = GET_LSB(node->load_seq);
+      msg[1] = GET_MSB(node->load_seq);
+      msg[2] = GET_LSB(node->load_seq >> 16);
+      msg[3] = GET_MSB(node->load_seq >> 16);
+      for (i = 4; i < msg_size_bytes; i++)
+      {
+         msg[i] = (U8)(node->load_seq + i);
+      }
+      if (SL_LoadPacketMsg(sl_ctx->tx_info.min_msg_id, msg_size_bytes, msg, &bytes_left) != SL_SUCCESS)
+      {
+         break;
+      }
+      ++node->load_seq;
+   }
+   (void)SL_LoadPacketFinish();
+
+   return(SL_GetPacketToTx(packet_ptr));
+}
+
+/*******************************************************************************
+ * Function: VLinkLatBucket
+ *      Returns the bucket of the latency histogram of a latency.
+ *		
+ * Parameters:
+ *	    units - the latency in latency units.	
+ *
+ * Returns: 
+ *		The bucket, VLINK_LAT_BUCKETS if the latency is beyond the histogram.
+ ******************************************************************************/
+static U32 VLinkLatBucket(double units)
+{
+   U32 value;
+   U32 shift = 0;
+
+   if (units >= 4294967296.0)
+   {
+      return(VLINK_LAT_BUCKETS);
+   }
+   value = (U32)units;
+   while ((value >> shift) >= (1u << VLINK_LAT_SUB_BITS))
+   {
+      ++shift;
+   }
+   return((shift * VLINK_LAT_SUB_HALF) + (value >> shift));
+}
+
+/*******************************************************************************
+ * Function: VLinkLatBucketEnd
+ *      Returns the end of a bucket of the latency histogram.
+ *		
+ * Parameters:
+ *	    bucket - the bucket.	
+ *
+ * Returns: 
+ *		The first latency in latency units above the bucket.
+ ******************************************************************************/
+static double VLinkLatBucketEnd(U32 bucket)
+{
+   U32 shift;
+
+   if (bucket < (1u << VLINK_LAT_SUB_BITS))
+   {
+      return(bucket + 1.0);
+   }
+   shift = (bucket / VLINK_LAT_SUB_HALF) - 1;
+   return((double)(bucket - (shift * VLINK_LAT_SUB_HALF) + 1) * (double)(1u << shift));
+}
+
+/*******************************************************************************
+ * Function: VLinkUnload
+ *      Unloads a packet received by the node in focus and checks the messages
+ *      sent by its peer.  The latency of each message delivered is recorded.
+ *		
+ * Parameters:
+ *	    peer - the node that sent the packet.	
+ *	    packet_ptr - the packet received.	
+ *	    now_usec - the time the transfer ended.	
+ *	    unit_usec - the latency unit of the latency histogram.	
+ *	    report - counts the messages and bytes delivered, the bad messages and
+ *	             the latencies beyond the histogram.	
+ *
+ * Returns: 
+ *		None.
+ ******************************************************************************/
+static void VLinkUnload(VLINK_NODE *peer, U8 *packet_ptr, double now_usec, double unit_usec,
+                        SL_VLINK_REPORT *report)
+{
+   U8  *msg;
+   int msg_id;
+   int msg_size_bytes;
+   int rc;
+   int i;
+   U32 seq;
+   U32 bucket;
+   double latency;
+
+   if (SL_UnloadPacketStart(packet_ptr) != SL_SUCCESS)
+   {
+      /* Discarded, the library has already scheduled a retransmit. */
+      return;
+   }
+   while ((rc = SL_UnloadPacketMsg(&msg_id, &msg_size_bytes, &msg)) != SL_NO_MORE_MSGS)
+   {
+      if (rc == SL_SUCCESS_STATUS_MSG)
+      {
+         continue;
+      }
+      if (rc != SL_SUCCESS)
+      {
+         break;
+      }
+
+      seq = ((U32)msg[0]) | ((U32)msg[1] << 8) | ((U32)msg[2] << 16) | ((U32)msg[3] << 24);
+      for (i = 4; i < msg_size_bytes; i++)
+      {
+         if (msg[i] != (U8)(seq + i))
+         {
+            break;
+         }
+      }
+      if ((seq != peer->peer_seq) || (i < msg_size_bytes))
+      {
+         PRINTF("VLinkUnload: message %u received, %u expected\n", seq, peer->peer_seq);
+         ++report->msgs_bad;
+         continue;
+      }
+
+      latency = now_usec - peer->offer_usec[ seq % VLINK_QUEUE_SIZE ];
+      bucket = VLinkLatBucket(latency / unit_usec);
+      if (bucket < VLINK_LAT_BUCKETS)
+      {
+         ++vlink_latency[ bucket ];
+      }
+      else
+      {
+         ++report->latency_overflow;
+      }
+      if (latency > report->latency_max_usec)
+      {
+         report->latency_max_usec = (U32)latency;
+      }
+      ++peer->peer_seq;
+      ++report->msgs_delivered;
+      report->bytes_delivered += msg_size_bytes;
+   }
+}
+
+/*******************************************************************************
+ * Function: VLinkPercentile
+ *      Returns a percentile of the latency recorded in the histogram, rounded
+ *      up to the end of its bucket.  A percentile among the latencies beyond
+ *      the histogram is reported as the largest latency.
+ *		
+ * Parameters:
+ *	    percent - the percentile.	
+ *	    unit_usec - the latency unit of the latency histogram.	
+ *	    report - the messages delivered and the largest latency.	
+ *
+ * Returns: 
+ *		The percentile in usec.
+ ******************************************************************************/
+static U32 VLinkPercentile(U32 percent, double unit_usec, const SL_VLINK_REPORT *report)
+{
+   U32 target = (U32)(((double)report->msgs_delivered * percent + 99) / 100);
+   U32 count = 0;
+   U32 bucket;
+   double latency;
+
+   for (bucket = 0; bucket < VLINK_LAT_BUCKETS; bucket++)
+   {
+      count += vlink_latency[ bucket ];
+      if (count >= target)
+      {
+         break;
+      }
+   }
+   if (bucket == VLINK_LAT_BUCKETS)
+   {
+      return(report->latency_max_usec);
+   }
+   latency = VLinkLatBucketEnd(bucket) * unit_usec;
+   if (latency > report->latency_max_usec)
+   {
+      return(report->latency_max_usec);
+   }
+   return((U32)latency);
+}
+
+/*******************************************************************************
+ * Function: SL_TEST_VirtualLink
+ *      Runs a VP node and a GP node connected by a virtual SPI link.  For each
+ *      transfer both nodes get (or load) the packet to transmit, the packets 
+ *      are exchanged through copies (the "wire") which may be corrupted, then 
+ *      each node unloads the packet of the other node.  The transfer takes the
+ *      time needed to shift YZ_SPI_PKT_SIZE bytes at YZ_SPI_CLOCK_FREQ_HZ.
+ *      The latency histogram has a resolution of 1/VLINK_LAT_PER_XFER of the 
+ *      transfer period for short latencies and 1/VLINK_LAT_SUB_HALF of the 
+ *      latency for longer ones, the latencies beyond it are only counted.
+ *		
+ * Parameters:
+ *	    See documentation in spi_lib.h.
+ *
+ * Returns: 
+ *	    See documentation in spi_lib.h.
+ ******************************************************************************/
+int SL_TEST_VirtualLink(const SL_VLINK_CONFIG *config, SL_VLINK_REPORT *report)
+{
+   static U8 tx_buffers[2][2][ YZ_SPI_PKT_SIZE ];
+   static U8 win_buffers[2][ 2 * SL_MAX_WINDOW * YZ_SPI_PKT_SIZE ];
+   static U8 wire[2][ YZ_SPI_PKT_SIZE ];
+   U8     *tx_pkt[2];
+   SL_STATS_RECORD node_stats;
+   double period_usec;
+   double shift_usec;
+   double unit_usec;
+   double now_usec;
+   double run_sec;
+   clock_t start;
+   U32    xfer;
+   int    n;
+
+   memset(report, 0, sizeof(*report));
+   if ((config->msg_size_bytes < 4) || (config->msg_size_bytes > (int)YZ_SPI_PKT_MAX_MSG_SIZE) ||
+       (config->msg_size_bytes > (int)(YZ_SPI_PKT_SIZE - (PKT_HDR_BYTES + MSG_HDR_BYTES))))
+   {
+      return(SL_MSG_TOO_LONG);
+   }
+
+   period_usec = config->xfer_period_usec;
+   if (period_usec == 0)
+   {
+      period_usec = YZ_SPI_TFR_RATE_MS * 1000.0;
+   }
+   shift_usec = (YZ_SPI_PKT_SIZE * 8 * 1000000.0) / YZ_SPI_CLOCK_FREQ_HZ;
+   unit_usec = period_usec / VLINK_LAT_PER_XFER;
+
+   memset(vlink_node, 0, sizeof(vlink_node));
+   memset(vlink_latency, 0, sizeof(vlink_latency));
+   vlink_node[0].msgs_per_sec = config->vp_msgs_per_sec;
+   vlink_node[1].msgs_per_sec = config->gp_msgs_per_sec;
+   srand(config->seed);
+
+   SL_TEST_InitNodes(tx_buffers[0][0], tx_buffers[0][1], tx_buffers[1][0], tx_buffers[1][1]);
+   SL_TEST_ResetStats();
+   for (n = 0; n < 2; n++)
+   {
+      vlink_focus[n]();
+      if (SL_EnableWindow((config->window != 0) ? win_buffers[n] : NULL, config->window) != SL_SUCCESS)
+      {
+         return(SL_NOT_SUPPORTED);
+      }
+   }
+
+   start = clock();
+   for (xfer = 0; xfer < config->num_xfers; xfer++)
+   {
+      now_usec = xfer * period_usec;
+
+      /*
+      ** Both nodes load the packet to transmit before the transfer.
+      */
+      for (n = 0; n < 2; n++)
+      {
+         vlink_focus[n]();
+         VLinkOffer(&vlink_node[n], now_usec, report);
+         if (VLinkGetPacket(&vlink_node[n], config->msg_size_bytes, &tx_pkt[n]) != SL_SUCCESS)
+         {
+            return(SL_SEQ_ERROR);
+         }
+      }
+
+      /*
+      ** The transfer is full duplex, wire[n] is the packet received by node n.
+      */
+      for (n = 0; n < 2; n++)
+      {
+         memcpy(wire[n], tx_pkt[1 - n], YZ_SPI_PKT_SIZE);
+         if (((U32)rand() % 1000000u) < config->error_ppm)
+         {
+            wire[n][ (U32)rand() % YZ_SPI_PKT_SIZE ] ^= (U8)(1u << ((U32)rand() % 8));
+            ++report->pkts_corrupted;
+         }
+      }
+
+      for (n = 0; n < 2; n++)
+      {
+         vlink_focus[n]();
+         VLinkUnload(&vlink_node[1 - n], wire[n], now_usec + shift_usec, unit_usec, report);
+      }
+   }
+   report->host_usec = (U32)(((clock() - start) * 1000000.0) / CLOCKS_PER_SEC);
+
+   for (n = 0; n < 2; n++)
+   {
+      vlink_focus[n]();
+      SL_GetStatistics(&node_stats);
+      report->pkt_tx_cnt += node_stats.pkt_tx_cnt;
+      report->pkt_tx_retries += node_stats.pkt_tx_retries;
+   }
+
+   run_sec = (config->num_xfers * period_usec) / 1000000.0;
+   if (run_sec > 0)
+   {
+      report->msgs_per_sec = report->msgs_delivered / run_sec;
+      report->bytes_per_sec = report->bytes_delivered / run_sec;
+   }
+   if (report->pkt_tx_cnt != 0)
+   {
+      report->retransmit_ratio = (double)report->pkt_tx_retries / report->pkt_tx_cnt;
+   }
+   report->latency_p50_usec = VLinkPercentile(50, unit_usec, report);
+   report->latency_p90_usec = VLinkPercentile(90, unit_usec, report);
+   report->latency_p99_usec = VLinkPercentile(99, unit_usec, report);
+
+   PRINTF("SL_TEST_VirtualLink: %u msgs delivered (%u bad), %.0f msgs/s, %.0f bytes/s, retransmit ratio %.4f, latency p50/p90/p99/max %u/%u/%u/%u usec (%u beyond histogram)\n",
+          report->msgs_delivered, report->msgs_bad, report->msgs_per_sec, report->bytes_per_sec, 
+          report->retransmit_ratio, report->latency_p50_usec, report->latency_p90_usec, 
+          report->latency_p99_usec, report->latency_max_usec, report->latency_overflow);
+
+   return((report->msgs_bad == 0) ? SL_SUCCESS : SL_INVALID_SN);
 }
 
 
@@ -64,6 +64,10 @@ extern "C" {
 #define  SL_NO_MORE_MSGS       (-7)		/*!< no more messages to unload from packet */
 #define  SL_EOP_ERROR          (-8)		/*!< end of packet reached before end of message data */
 #define  SL_TPL_XFER_LIMIT     (-9)		/*!< the maximum number of TPL tx messages allowed already in progress. */
+#define  SL_NOT_SUPPORTED      (-10)	/*!< the requested option is not supported on this node */
+#define  SL_PKT_HELD           (-11)	/*!< packet Rx'd ahead of a missing one, it is unloaded after the missing one (see SL_EnableWindow) */
+#define  SL_QUEUE_FULL         (-12)	/*!< the packing queue has no room for another message (see SL_PackQueueMsg) */
+#define  SL_HANDLER_LIMIT      (-13)	/*!< the message id already has SL_MAX_MSG_HANDLERS handlers (see SL_RegisterMsgHandler) */
 
 /*!
 	Identification macros - Used to identify the target system.
@@ -82,10 +86,45 @@ extern "C" {
 #define RFI_WD_TIMEOUT   (0x61)			/*!< the VP uses this value when a watchdog timeout occurs
 					   						 waiting for the GP to do a SPI transfer). */
 
+/*!
+	CRC engines.  These values are used for the "engine" parameter when calling
+	the SL_SetCrcEngine function.  Every engine computes the same CRC.
+*/
+#define SL_CRC_ENGINE_AUTO     (0)		/*!< fastest engine on every node, slice-by-8 (default) */
+#define SL_CRC_ENGINE_BITWISE  (1)		/*!< one bit per iteration, no tables */
+#define SL_CRC_ENGINE_SLICE4   (2)		/*!< table driven, 4 bytes per iteration */
+#define SL_CRC_ENGINE_SLICE8   (3)		/*!< table driven, 8 bytes per iteration */
+#define SL_CRC_ENGINE_CLMUL    (4)		/*!< carry-less multiply, 8 bytes per iteration (x86-64 with PCLMULQDQ) */
+#define SL_CRC_NUM_ENGINES     (5)		/*!< number of CRC engine values */
+
+/*!
+	Message packing.  Priorities of the messages of a packing queue go from 0 
+	(highest) to SL_PACK_PRIORITIES-1.  A message left in the queue is promoted
+	one priority every SL_PACK_AGING_PKTS packets loaded from the queue, so the 
+	messages of low priority are not held back forever.
+*/
+#define SL_PACK_PRIORITIES     (4)		/*!< number of message priorities */
+#define SL_PACK_AGING_PKTS     (8)		/*!< packets loaded per promotion of a waiting message */
+
+/*!
+	Message dispatch.  SL_DispatchMsg calls up to SL_MAX_MSG_HANDLERS handlers per 
+	message id.  Tables indexed by message id have SL_MSG_ID_SLOTS entries, enough
+	for the ids sent by either node.
+*/
+#define SL_MAX_MSG_HANDLERS    (4)		/*!< max number of handlers of a message id */
+#define SL_MSG_ID_SLOTS        (((int)VP_TX_MAX_MSG_ID_PLUS_1 > (int)GP_TX_MAX_MSG_ID_PLUS_1) ? \
+                                (int)VP_TX_MAX_MSG_ID_PLUS_1 : (int)GP_TX_MAX_MSG_ID_PLUS_1)
+
 /******************************************************************************/
 /*     T Y P E S   A N D   E N U M E R A T I O N S                            */
 /******************************************************************************/
 
+/*!
+	SL_MSG_HANDLER - A function called by SL_DispatchMsg to process an Rx'd
+	 "regular" message (see SL_DispatchMsg for the conditions it must observe).
+*/
+typedef void (*SL_MSG_HANDLER)(int msg_size_bytes, U8 * const msg_data);
+
 /*!
 	SL_STATS_RECORD - This structure contains the statistics maintained by 
 	 the SPI library.  By design each statistic field increments when 
@@ -107,8 +146,172 @@ typedef struct
    U32  pkt_tx_retries;		/*!< Number of packet re-transmits */
    U32  msgs_loaded;   		/*!< Number of messages loaded for Tx */
    U32  msgs_unloaded; 		/*!< Number of messages unloaded during Rx */
+   U32  pkts_loaded;   		/*!< Number of packets loaded (retransmits are not loaded again) */
+   U32  pkt_bytes_loaded;	/*!< Bytes used by the messages, headers included, of the packets loaded.
+   								 The packet utilization is pkt_bytes_loaded divided by 
+   								 pkts_loaded * (YZ_SPI_PKT_SIZE - 8), 8 being the packet header. */
 } SL_STATS_RECORD;
 
+/*!
+	SL_PACK_MSG - A message waiting in a packing queue.  Private to the SPI library.
+*/
+typedef struct SL_PACK_MSG
+{
+   int   msg_id;             	/*!< Message id */
+   int   msg_size_bytes;     	/*!< Message size in bytes */
+   int   priority;           	/*!< Priority given when queued, 0 is the highest */
+   int   pkts_waited;        	/*!< Packets loaded from the queue since the message was queued */
+   int   next_node;          	/*!< Offset of the next message in the queue or free list, -1 for none */
+   U8    msg_data[ YZ_SPI_PKT_MAX_MSG_SIZE ];	/*!< Message data */
+} SL_PACK_MSG;
+
+/*!
+	SL_PACK_QUEUE - Messages waiting to be loaded by SL_LoadPacketPacked, listed
+	 in the order they were queued.  Allocated by the caller, the fields are
+	 private to the SPI library.
+*/
+typedef struct SL_PACK_QUEUE
+{
+   SL_PACK_MSG *msgs;        	/*!< Storage of the messages */
+   int   max_msgs;           	/*!< Number of messages in msgs */
+   int   num_msgs;           	/*!< Number of messages queued */
+   int   head;               	/*!< Offset of the oldest message, -1 if the queue is empty */
+   int   tail;               	/*!< Offset of the newest message */
+   int   free_head;          	/*!< Offset of the first free message, -1 if the queue is full */
+} SL_PACK_QUEUE;
+
+/*!
+	SL_TX_INFO - Tx related information of a link.  Private to the SPI library.
+*/
+typedef struct SL_TX_INFO
+{
+   int min_msg_id;      		/*!< Min msg_id that can be Tx'd */ 
+   int max_msg_id;      		/*!< Max msg_id that can be Tx'd */
+   int next_sn;         		/*!< Sequence number to Tx in next packet */
+   int next_nack;       		/*!< NACK value to Tx in next packet */ 
+   int msg_count;       		/*!< Number of messages loaded in packet */
+   int load_index;      		/*!< Index to next byte to load in packet buffer */
+   int go_back;         		/*!< Maintains what packet to Tx in "go back" scenarios */ 
+   U16 last_sn_txd;     		/*!< The SN sent in the last packet Tx'd */ 
+   U8 *oldest_pkt_ptr;  		/*!< Pointer to oldest packet (next to overwrite when a new packet loaded for Tx) */
+   U8 *newest_pkt_ptr;  		/*!< Pointer to newest packet */ 
+   U8 *pkt_ptr;         		/*!< Pointer to packet to load next */
+   U8 comm_reset_flag;  		/*!< a non-0 value indicates Tx of a COMM RESET status message has been requested */ 
+   U8 comm_reset_reason; 		/*!< indicates reason for Txing COMM RESET message */
+} SL_TX_INFO;
+
+/*!
+	SL_RX_INFO - Rx related information of a link.  Private to the SPI library.
+*/
+typedef struct SL_RX_INFO
+{
+   int min_msg_id;      		/*!< Min msg_id that can be Rx'd */
+   int max_msg_id;      		/*!< Max msg_id that can be Rx'd */
+   int next_sn;         		/*!< Sequence number expected in next Rx packet */
+   int msgs_left;       		/*!< Number of messages left to unload from Rx packet*/
+   U8 *pkt_ptr;         		/*!< Pointer to start of Rx packet */
+   int unload_index;    		/*!< Index to next byte to unload from Rx packet */
+} SL_RX_INFO;
+
+#define SL_MAX_WINDOW   (16)	/*!< Max number of packets in the selective repeat window, see SL_EnableWindow */
+
+/*!
+	SL_WINDOW_INFO - Selective repeat window of a link, see SL_EnableWindow.  
+	 Private to the SPI library.
+*/
+typedef struct SL_WINDOW_INFO
+{
+   int  size;           		/*!< Number of packets in the window of this node, 0 if the mode is disabled */
+   int  peer_size;      		/*!< Number of packets in the window of the other node, 0 until advertised */
+   U8  *tx_buffers;     		/*!< Packets Tx'd and not acknowledged yet, size packets */
+   U8  *rx_buffers;     		/*!< Packets Rx'd ahead of a missing one, size packets */
+   U8   tx_active;      		/*!< a non-0 value indicates packets are Tx'd in selective repeat mode */
+   U8   rx_active;      		/*!< a non-0 value indicates the other node Tx's in selective repeat mode */
+   U8   version_flag;   		/*!< a non-0 value indicates Tx of a PROTOCOL VERSION status message has been requested */
+   U32  xfer;           		/*!< Number of packets handed out for Tx */
+   int  tx_base_sn;     		/*!< Oldest SN Tx'd and not acknowledged */
+   int  tx_base_slot;   		/*!< Tx buffer of tx_base_sn */
+   int  rx_base_slot;   		/*!< Rx buffer of the SN expected in the next Rx packet */
+   U32  tx_xfer[ SL_MAX_WINDOW ];	/*!< Value of xfer when each Tx buffer was last handed out */
+   U8   tx_state[ SL_MAX_WINDOW ];	/*!< State of each Tx buffer */
+   U8   rx_held[ SL_MAX_WINDOW ];	/*!< a non-0 value indicates the Rx buffer holds a packet */
+} SL_WINDOW_INFO;
+
+#if (YZ_SPI_TPL_ENABLE != 0)
+
+/*!
+	YZ_SPI_TPL_MAX_SIM_TFRS - Max number of TPL transfers in progress, per direction.  The
+	 transfers are found by msg id and scheduled with a heap, so the cost per packet grows
+	 with the number of transfers actually in progress (log n per transfer serviced).  The
+	 sum of their min bytes per packet must still fit in a packet.
+*/
+#define YZ_SPI_TPL_MAX_SIM_TFRS   (2)
+
+/*!
+	SL_TPL_TX_RECORD - TPL Tx message information.  Private to the SPI library.
+*/
+typedef struct SL_TPL_TX_RECORD
+{
+   int   msg_id;             	/*!< Message id */
+   U8   *buffer_ptr;         	/*!< Pointer to first byte of Tx buffer OR NULL if record not in use */
+   int   msg_sz_bytes;       	/*!< Message size in bytes */
+   int   min_bytes_packet;   	/*!< Min number of bytes to send in a single packet */
+   int   next_seg_num;       	/*!< Next seg # to Tx */
+   int   load_index;         	/*!< Offset of next byte to load */
+   int   heap_pos;           	/*!< Offset of the record in the Tx priority heap */
+} SL_TPL_TX_RECORD;
+
+/*!
+	SL_TPL_RX_RECORD - TPL Rx message information.  Private to the SPI library.
+*/
+typedef struct SL_TPL_RX_RECORD
+{
+   int   msg_id;          		/*!< Message id */
+   U8   *buffer_ptr;      		/*!< Pointer to first byte of Rx buffer */
+   int   msg_sz_bytes;    		/*!< Message size in bytes */
+   int   next_seg_num;    		/*!< Next seg # expected */
+   int   unload_index;    		/*!< Offset of next byte to unload */
+   int   flags;           		/*!< IN_USE: !=0 for record in use; =0 for record free 
+                                 	 TX_ABT: !=0 for generated TxTPLABT status message  
+                                 	 MSG_UNLOADED: =0 if no message unloaded since last clear; !=0 for message unloaded */ 
+   int   tx_abort_code;   		/*!< Reason for sending TxTPLABT (applies only when TX_ABT flag is !=0) */
+   int   active_pos;      		/*!< Offset of the record in the list of Rx records in use */
+} SL_TPL_RX_RECORD;
+
+#endif /* #if (YZ_SPI_TPL_ENABLE != 0) */
+
+/*!
+	SL_CONTEXT - The state of one SPI link.  The SL_Ctx functions drive the link
+	 of the context passed to them, the other SL_ functions drive a default link
+	 held by the library.  A context is allocated by the caller and must be all
+	 0's before it is first initialized (as a static variable is), the fields
+	 are private to the SPI library.  Statistics are kept across 
+	 initializations like those of the default link.
+*/
+typedef struct SL_CONTEXT
+{
+   int              api_state;  	/*!< API state, determines which functions may be called */
+   SL_TX_INFO       tx_info;    	/*!< Information used for loading and transmitting packets */
+   SL_RX_INFO       rx_info;    	/*!< Information used for receiving and unloading packets */
+   SL_STATS_RECORD  stats;      	/*!< Statistics of the link */
+   SL_WINDOW_INFO   win;        	/*!< Selective repeat window, kept across initializations */
+#if (YZ_SPI_TPL_ENABLE != 0)
+   SL_TPL_TX_RECORD tpl_tx_table[ YZ_SPI_TPL_MAX_SIM_TFRS ];	/*!< TPL Tx messages in progress */
+   SL_TPL_RX_RECORD tpl_rx_table[ YZ_SPI_TPL_MAX_SIM_TFRS ];	/*!< TPL Rx messages in progress */
+   int              tpl_tx_heap[ YZ_SPI_TPL_MAX_SIM_TFRS ];	/*!< TPL Tx records in use, a min-heap on msg id (lowest id = highest priority) */
+   int              tpl_tx_heap_size;	/*!< Number of records in tpl_tx_heap */
+   int              tpl_tx_free[ YZ_SPI_TPL_MAX_SIM_TFRS ];	/*!< Stack of free TPL Tx records */
+   int              tpl_tx_free_top;	/*!< Number of records in tpl_tx_free */
+   int              tpl_tx_min_bytes;	/*!< Packet bytes reserved by the TPL Tx messages in progress */
+   int              tpl_rx_active[ YZ_SPI_TPL_MAX_SIM_TFRS ];	/*!< TPL Rx records in use, in no particular order */
+   int              tpl_rx_active_cnt;	/*!< Number of records in tpl_rx_active */
+   int              tpl_rx_free[ YZ_SPI_TPL_MAX_SIM_TFRS ];	/*!< Stack of free TPL Rx records */
+   int              tpl_rx_free_top;	/*!< Number of records in tpl_rx_free */
+   int              tpl_tx_by_id[ SL_MSG_ID_SLOTS ];	/*!< TPL Tx record of each msg id, -1 for none */
+   int              tpl_rx_by_id[ SL_MSG_ID_SLOTS ];	/*!< TPL Rx record of each msg id, -1 for none */
+#endif
+} SL_CONTEXT;
+
 
 /******************************************************************************/
 /*     F U N C T I O N   P R O T O T Y P E S                                  */
@@ -246,6 +449,9 @@ int SL_LoadPacketFinish(void);
  *      SL_EOP_ERROR - end of packet reached while parsing messages (discard packet 
  *         and proceed to getting/loading packet for Tx). 
  *      SL_INVALID_SN - sequence number in packet is invalid. 
+ *      SL_PKT_HELD - the packet was Rx'd ahead of a missing one in selective repeat 
+ *         mode, its messages are unloaded after those of the missing one (proceed
+ *         to getting/loading packet for Tx).
  ******************************************************************************/
 int SL_UnloadPacketStart(U8 *packet_ptr);
 
@@ -300,9 +506,12 @@ int SL_TxTPLMsg(int id, int msg_sz_bytes, U8 *msg_data, int min_bytes_packet);
 
 /*******************************************************************************
  * Function: SL_DispatchMsg
- *      Dispatches a USER DEFINED receive function to process the message specified 
- *      by the input parameters.  USER DEFINED functions are configured in the 
- *      spi_node_config.h file via the PS_RX_MSG_HANDLER_LIST macro.  This function
+ *      Dispatches the USER DEFINED receive functions of the message specified 
+ *      by the input parameters, in the order they were registered.  The function
+ *      configured for each id in the spi_node_config.h file via the 
+ *      PS_RX_MSG_HANDLER_LIST macro is registered first, more functions can be
+ *      registered with SL_RegisterMsgHandler.  The number of messages dispatched
+ *      is counted per id (see SL_GetDispatchCount).  This function
  *      is intended to be called immediately after the SL_UnloadPacketMsg function
  *      is called (when SL_UnloadPacketMsg returns SL_SUCCESS).  The parameters
  *      passed to this function should be as returned by SL_UnloadPacketMsg.
@@ -327,6 +536,57 @@ int SL_TxTPLMsg(int id, int msg_sz_bytes, U8 *msg_data, int min_bytes_packet);
  ******************************************************************************/
 void SL_DispatchMsg(int msg_id, int msg_size_bytes, U8 * const msg_data);
 
+/*******************************************************************************
+ * Function: SL_RegisterMsgHandler
+ *      Adds a function to the receive functions dispatched by SL_DispatchMsg for
+ *      a message id, after those already registered.  Registering a function the
+ *      id already has does nothing.  The handlers are shared by every link and 
+ *      kept across calls to SL_Initialize.  Handlers are meant to be registered
+ *      at startup: this function and SL_UnregisterMsgHandler must not be called
+ *      while SL_DispatchMsg may be running.  SL_DispatchMsg itself may run on
+ *      several links (threads) at once.
+ * 
+ * Parameters:
+ *	    msg_id - the id of the messages to be dispatched to the function.
+ *	    handler - the function.
+ *
+ * Returns: 
+ *	    SL_SUCCESS - successful
+ *      SL_INVALID_ID - "msg_id" is out of range or "handler" is NULL
+ *      SL_HANDLER_LIMIT - the id already has SL_MAX_MSG_HANDLERS functions
+ ******************************************************************************/
+int SL_RegisterMsgHandler(int msg_id, SL_MSG_HANDLER handler);
+
+/*******************************************************************************
+ * Function: SL_UnregisterMsgHandler
+ *      Removes a function from the receive functions dispatched for a message id,
+ *      the order of the others is kept.  The function configured with the
+ *      PS_RX_MSG_HANDLER_LIST macro may be removed as well.
+ * 
+ * Parameters:
+ *	    msg_id - the id of the messages dispatched to the function.
+ *	    handler - the function.
+ *
+ * Returns: 
+ *	    SL_SUCCESS - successful
+ *      SL_INVALID_ID - "msg_id" is out of range or "handler" is not registered for it
+ ******************************************************************************/
+int SL_UnregisterMsgHandler(int msg_id, SL_MSG_HANDLER handler);
+
+/*******************************************************************************
+ * Function: SL_GetDispatchCount
+ *      Returns the number of messages passed to SL_DispatchMsg with a message id,
+ *      whether or not the id has any function registered.  Like the statistics, 
+ *      the count is cumulative.
+ * 
+ * Parameters:
+ *	    msg_id - the message id.
+ *
+ * Returns: 
+ *	    The number of messages dispatched, 0 for an id out of range. 
+ ******************************************************************************/
+U32 SL_GetDispatchCount(int msg_id);
+
 /*******************************************************************************
  * Function: SL_GetProtocolVersion
  *      Returns the version of the "Hydra SPI Protocol Specification" document that
@@ -357,6 +617,256 @@ int SL_GetProtocolVersion(void);
  ******************************************************************************/
 void SL_GetStatistics(SL_STATS_RECORD *stats_buff);
 
+/*******************************************************************************
+ * Function: SL_SetCrcEngine
+ *      Selects the implementation used to compute the CRC of every packet 
+ *      transmitted and received.  The selection is kept across calls to 
+ *      SL_Initialize.  SL_CRC_ENGINE_AUTO is used until this function is called.
+ * 
+ * Parameters:
+ *	    engine - one of the SL_CRC_ENGINE_ values.	
+ *
+ * Returns: 
+ *	    SL_SUCCESS - successful
+ *      SL_NOT_SUPPORTED - the engine is invalid or not supported on this node, 
+ *         the engine in use is unchanged.
+ ******************************************************************************/
+int SL_SetCrcEngine(int engine);
+
+/*******************************************************************************
+ * Function: SL_GetCrcEngine
+ *      Returns the CRC engine in use. 
+ * 
+ * Parameters:
+ *	    None.	
+ *
+ * Returns: 
+ *	    The SL_CRC_ENGINE_ value of the engine in use, never SL_CRC_ENGINE_AUTO. 
+ ******************************************************************************/
+int SL_GetCrcEngine(void);
+
+/*******************************************************************************
+ * Function: SL_EnableWindow
+ *      Enables the selective repeat mode of the link.  By default only the last
+ *      two packets Tx'd are kept and, when the other node reports an Rx error,
+ *      they are retransmitted before any new packet (stop-and-wait).  In 
+ *      selective repeat mode up to "window" packets may be waiting for an 
+ *      acknowledgement, each packet acknowledges the packets Rx'd (with a bitmap
+ *      of those Rx'd ahead of a missing one) and only the missing packets are
+ *      retransmitted, so new packets keep flowing on a noisy link.  An
+ *      acknowledgement takes 13 bytes of each packet.
+ *
+ *      The window is advertised in the PROTOCOL VERSION status message.  The mode
+ *      is used once both nodes have advertised a window, with the smaller of the
+ *      two; otherwise the packets Tx'd are unchanged, so a node with the mode
+ *      enabled works with a node without it.  A window of 4 or more packets 
+ *      rides out an isolated Rx error without holding up new packets.
+ *
+ *      The window is kept across calls to SL_Initialize.  It cannot be changed 
+ *      while either node Tx's in selective repeat mode.
+ * 
+ * Parameters:
+ *	    buffers - 2 * window * YZ_SPI_PKT_SIZE bytes for the packets of the window,
+ *         which must remain valid while the mode is enabled.  May be NULL when
+ *         window is 0.
+ *	    window - number of packets in the window, 2 to SL_MAX_WINDOW, or 0 to 
+ *         disable the mode.
+ *
+ * Returns: 
+ *	    SL_SUCCESS - successful
+ *      SL_NOT_SUPPORTED - window or buffers is invalid, the window is unchanged.
+ *      SL_SEQ_ERROR - a node Tx's in selective repeat mode, call SL_Initialize first.
+ ******************************************************************************/
+int SL_EnableWindow(U8 *buffers, int window);
+
+/*******************************************************************************
+ * Function: SL_PackInit
+ *      Initializes an empty packing queue.  Messages put in the queue with 
+ *      SL_PackQueueMsg are loaded by SL_LoadPacketPacked, which fills each 
+ *      packet as fully as it can instead of ending it at the first message that
+ *      does not fit.  A queue is not tied to a link and is not locked, the 
+ *      caller serializes the calls (as spi_buf does with SB_ObtainLock).
+ * 
+ * Parameters:
+ *	    queue - the queue.
+ *	    msgs - storage for max_msgs messages, which must remain valid while the
+ *         queue is used.
+ *	    max_msgs - number of messages the queue can hold.
+ *
+ * Returns: 
+ *	    None. 
+ ******************************************************************************/
+void SL_PackInit(SL_PACK_QUEUE *queue, SL_PACK_MSG *msgs, int max_msgs);
+
+/*******************************************************************************
+ * Function: SL_PackQueueMsg
+ *      Copies a message to a packing queue. 
+ * 
+ * Parameters:
+ *	    queue - the queue.
+ *		msg_id - id of the message. 
+ *      msg_size_bytes - message size in bytes.
+ *      msg_data - pointer to message data.
+ *      priority - priority of the message, 0 (highest) to SL_PACK_PRIORITIES-1.
+ *
+ * Returns: 
+ *	    SL_SUCCESS - successful
+ *      SL_MSG_TOO_LONG - size of message is invalid (greater than YZ_SPI_PKT_MAX_MSG_SIZE).
+ *      SL_NOT_SUPPORTED - the priority is invalid.
+ *      SL_QUEUE_FULL - the queue holds max_msgs messages already.
+ ******************************************************************************/
+int SL_PackQueueMsg(SL_PACK_QUEUE *queue, int msg_id, int msg_size_bytes, U8 *msg_data, int priority);
+
+/*******************************************************************************
+ * Function: SL_PackNumMsgs
+ *      Returns the number of messages waiting in a packing queue. 
+ * 
+ * Parameters:
+ *	    queue - the queue.
+ *
+ * Returns: 
+ *	    The number of messages queued. 
+ ******************************************************************************/
+int SL_PackNumMsgs(const SL_PACK_QUEUE *queue);
+
+/*******************************************************************************
+ * Function: SL_LoadPacketPacked
+ *      Loads messages of a packing queue into the packet, it may be called 
+ *      between SL_LoadPacketStart and SL_LoadPacketFinish like SL_LoadPacketMsg.
+ *      Of the queued messages that fit in the space left, the one loaded next 
+ *      is the one of highest priority and, for equal priorities, the largest 
+ *      (best fit).  The messages of one id are loaded in the order they were 
+ *      queued.  Loading stops when none of the messages left fits.
+ *
+ * Parameters:
+ *	    queue - the queue.
+ *	    bytes_left - upon successful return, contains the bytes left in the packet 
+ *         for message data (see SL_LoadPacketMsg).
+ *
+ * Returns: 
+ *      SL_SEQ_ERROR - call sequence error.
+ *	    SL_SUCCESS - successful
+ *      SL_INVALID_ID - a message with an id out of range was removed from the 
+ *         queue without being loaded, the other messages were loaded.
+ ******************************************************************************/
+int SL_LoadPacketPacked(SL_PACK_QUEUE *queue, int *bytes_left);
+
+/******************************************************************************/
+/*     M U L T I P L E   L I N K   F U N C T I O N S                          */
+/******************************************************************************/
+
+/*******************************************************************************
+ * Functions: SL_Ctx*
+ *      Each of the following functions is the SL_ function of the same name 
+ *      without "Ctx" applied to the link of the context passed in ctx instead of
+ *      the default link, see the documentation of that function.  
+ *
+ *      Links of different contexts are independent, so each link may be driven
+ *      from its own thread without locking.  The calls on one context must not
+ *      overlap.  The CRC engine is shared by every link: SL_SetCrcEngine, and 
+ *      the first initialization of any link, must not overlap other calls.  The
+ *      SLx_ callbacks (see spi_callbacks.h) are shared by every link as well.
+ ******************************************************************************/
+void SL_CtxInitialize(SL_CONTEXT *ctx, U8 *buffer1_ptr, U8 *buffer2_ptr, U8 reason_for_init);
+int SL_CtxGetPacketToTx(SL_CONTEXT *ctx, U8 **packet_ptr);
+int SL_CtxLoadPacketStart(SL_CONTEXT *ctx, int *bytes_left);
+int SL_CtxLoadPacketMsg(SL_CONTEXT *ctx, int msg_id, int msg_size_bytes, U8 *msg_data, int *bytes_left);
+int SL_CtxLoadPacketStatusMsg(SL_CONTEXT *ctx, int status_msg_id, int status_msg_size_bytes, U8 *msg_data, int *bytes_left);
+int SL_CtxLoadPacketFinish(SL_CONTEXT *ctx);
+int SL_CtxUnloadPacketStart(SL_CONTEXT *ctx, U8 *packet_ptr);
+int SL_CtxUnloadPacketMsg(SL_CONTEXT *ctx, int *msg_id, int *msg_size_bytes, U8 **buff_ptr);
+int SL_CtxTxTPLMsg(SL_CONTEXT *ctx, int id, int msg_sz_bytes, U8 *msg_data, int min_bytes_packet);
+void SL_CtxGetStatistics(SL_CONTEXT *ctx, SL_STATS_RECORD *stats_buff);
+int SL_CtxEnableWindow(SL_CONTEXT *ctx, U8 *buffers, int window);
+int SL_CtxLoadPacketPacked(SL_CONTEXT *ctx, SL_PACK_QUEUE *queue, int *bytes_left);
+
+#ifdef SL_TEST
+/*******************************************************************************
+ * Function: SL_TEST_CrcBenchmark
+ *      Computes the CRC of num_pkts random packets with every CRC engine 
+ *      supported by the node in focus, checks that they all give the CRC of 
+ *      the bitwise engine and measures them.  The engine in use is restored.
+ * 
+ * Parameters:
+ *	    num_pkts - number of packets to compute the CRC of.	
+ *	    usecs - array of SL_CRC_NUM_ENGINES entries, returns the CPU time in 
+ *	            usec of each engine (indexed by SL_CRC_ENGINE_ value), 0 for 
+ *	            the engines not supported.	
+ *
+ * Returns: 
+ *	    SL_SUCCESS - every engine gave the same CRC.
+ *      SL_INVALID_CRC - an engine gave a different CRC.
+ ******************************************************************************/
+int SL_TEST_CrcBenchmark(int num_pkts, U32 usecs[]);
+
+/******************************************************************************/
+/*     V I R T U A L   L I N K   ( S L _ T E S T   B U I L D S   O N L Y )    */
+/******************************************************************************/
+
+/*!
+	SL_VLINK_CONFIG - Parameters of a run of SL_TEST_VirtualLink.  Time is 
+	 simulated: the clients of each node offer messages at a constant rate and 
+	 one SPI transfer takes place every xfer_period_usec.
+*/
+typedef struct 
+{
+   U32  num_xfers;          	/*!< Number of SPI transfers simulated */
+   U32  xfer_period_usec;   	/*!< Time between transfers, 0 selects YZ_SPI_TFR_RATE_MS */
+   U32  vp_msgs_per_sec;    	/*!< Messages offered per second by the VP clients */
+   U32  gp_msgs_per_sec;    	/*!< Messages offered per second by the GP clients */
+   int  msg_size_bytes;     	/*!< Size of every message, 4 to YZ_SPI_PKT_MAX_MSG_SIZE */
+   U32  error_ppm;          	/*!< Chance per million that a packet is corrupted on the wire */
+   unsigned int seed;       	/*!< Seed of the error injection */
+   int  window;             	/*!< Window of both nodes (see SL_EnableWindow), 0 for stop-and-wait */
+} SL_VLINK_CONFIG;
+
+/*!
+	SL_VLINK_REPORT - Results of a run of SL_TEST_VirtualLink, both directions 
+	 of the link are added together.  Rates are per simulated second.
+*/
+typedef struct 
+{
+   U32  msgs_offered;       	/*!< Messages offered by the clients */
+   U32  msgs_dropped;       	/*!< Messages offered while the Tx queue of the node was full */
+   U32  msgs_delivered;     	/*!< Messages unloaded in sequence by the receiving node */
+   U32  msgs_bad;           	/*!< Messages unloaded out of sequence, duplicated or with bad data */
+   U32  bytes_delivered;    	/*!< Message data bytes of the messages delivered */
+   U32  pkts_corrupted;     	/*!< Packets corrupted by the error injection */
+   U32  pkt_tx_cnt;         	/*!< Number of packet transmits */
+   U32  pkt_tx_retries;     	/*!< Number of packet re-transmits */
+   double msgs_per_sec;     	/*!< Messages delivered per second */
+   double bytes_per_sec;    	/*!< Message data bytes delivered per second */
+   double retransmit_ratio; 	/*!< pkt_tx_retries / pkt_tx_cnt */
+   U32  latency_p50_usec;   	/*!< Median time from offer to delivery of a message */
+   U32  latency_p90_usec;   	/*!< 90th percentile of the latency */
+   U32  latency_p99_usec;   	/*!< 99th percentile of the latency */
+   U32  latency_max_usec;   	/*!< Largest latency */
+   U32  latency_overflow;   	/*!< Messages with a latency beyond the latency histogram */
+   U32  host_usec;          	/*!< CPU time used by the run */
+} SL_VLINK_REPORT;
+
+/*******************************************************************************
+ * Function: SL_TEST_VirtualLink
+ *      Runs a VP node and a GP node in this process, connected by a virtual 
+ *      SPI link, and measures the throughput and latency of the link protocol.
+ *      Both nodes are initialized with SL_TEST_InitNodes and their statistics
+ *      are reset.  The focus is left on the GP node.
+ * 
+ * Parameters:
+ *	    config - parameters of the run.	
+ *	    report - returns the results of the run.	
+ *
+ * Returns: 
+ *	    SL_SUCCESS - every message was delivered once, in sequence and intact.
+ *      SL_INVALID_SN - a message was delivered out of sequence or corrupted.
+ *      SL_MSG_TOO_LONG - config->msg_size_bytes is invalid.
+ *      SL_NOT_SUPPORTED - config->window is invalid.
+ *      SL_SEQ_ERROR - a node could not get a packet to transmit.
+ ******************************************************************************/
+int SL_TEST_VirtualLink(const SL_VLINK_CONFIG *config, SL_VLINK_REPORT *report);
+
+#endif /* #ifdef SL_TEST */
+
 /******************************************************************************/
 /*     F U N C T I O N   P R O T O T Y P E S                                  */
 /******************************************************************************/
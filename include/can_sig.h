@@ -0,0 +1,82 @@
+/**
+	@file 		can_sig.h
+	@version 	1.0
+	@brief		Extraction of bit-packed CAN signals into the datapool. The signal
+				definitions (GP_CanMsgDefnMsg, CAN_MSG_SIGNAL records) are compiled
+				once by CanSig_Compile() into one extraction plan per CAN message,
+				kept as shift/mask/sign tables. CanSig_Extract() then loads the
+				payload of a received frame as a single 64 bit word and pulls every
+				signal of the message out of it with a shift and a mask, without a
+				branch per signal, and sets all their datapool items at once.
+*/
+#ifndef _CAN_SIG_H_
+#define _CAN_SIG_H_
+
+#include <stdint.h>
+#include "gp_types.h"
+#include "IPC/spi_common_config.h"
+
+/*****************************************************************************/
+/*    M A C R O S                                                            */
+/*****************************************************************************/
+#define CAN_SIG_MAX_SIGS		512u	/*!< Max number of signals of all the plans */
+#define CAN_SIG_MAX_MSGS		128u	/*!< Max number of CAN messages with a plan */
+#define CAN_SIG_MAX_PER_MSG		64u		/*!< Max number of signals of one CAN message */
+#define CAN_SIG_PAYLOAD_BITS	64u		/*!< Size in bits of a (classic) CAN payload */
+#define CAN_SIG_MAX_BITS		32u		/*!< Max size in bits of a signal */
+
+/*****************************************************************************/
+/*    T Y P E S   A N D   E N U M E R A T I O N S                            */
+/*****************************************************************************/
+/**
+	@brief	can_sig_def_t definition of a CAN signal, as carried by a
+			CAN_MSG_SIGNAL record (see CANSIGID_IDX), and its datapool item.
+			Signals are Intel (little endian) ordered: StartBit is the
+			position of the LSB, bit 0 being the LSB of the first payload byte.
+*/
+typedef struct{
+	uint16_t SigId;			/*!< CAN signal ID */
+	uint8_t  StartBit;		/*!< Position of the LSB of the signal in the payload */
+	uint8_t  BitLen;		/*!< Size in bits of the signal (CANSIGDLC), 1 to CAN_SIG_MAX_BITS */
+	uint32_t CanMsgId;		/*!< ID of the CAN message carrying the signal */
+	uint8_t  Bus;			/*!< CAN bus of the message */
+	uint16_t ElemId;		/*!< Datapool item of the signal, numeric item */
+}can_sig_def_t;
+
+/*****************************************************************************/
+/*    P U B L I C   F U N C T I O N S                                        */
+/*****************************************************************************/
+/**
+	@brief CanSig_ParseDef()	Decodes a CAN_MSG_SIGNAL record, ElemId is left
+								for the caller to fill
+	@param[out] can_sig_def_t * pDef	the decoded definition
+	@param[in] const uint8_t * pBuf	CANSIG_DEF_MSG_SZ bytes of an encoded record
+	@return the number of bytes read (CANSIG_DEF_MSG_SZ)
+*/
+uint8_t CanSig_ParseDef(can_sig_def_t * pDef, const uint8_t * pBuf);
+
+/**
+	@brief CanSig_Compile()	Replaces the extraction plans with the plans of
+							the signal definitions. Every signal shall fit in
+							the payload and in its datapool item.
+	@param[in] const can_sig_def_t defs[]	the signal definitions, in any order
+	@param[in] uint16_t num	the number of entries in defs, up to CAN_SIG_MAX_SIGS
+	@return GP_SUCCESS, or an error code and the plans are left empty
+*/
+gp_retcode_t CanSig_Compile(const can_sig_def_t defs[], uint16_t num);
+
+/**
+	@brief CanSig_Extract()	Extracts the signals of a received CAN frame and
+							sets their datapool items with a single SetElems()
+	@param[in] uint8_t bus	the CAN bus of the frame
+	@param[in] uint32_t canMsgId	the CAN message ID of the frame
+	@param[in] const uint8_t * pData	the payload of the frame
+	@param[in] uint8_t dlc	the size in bytes of the payload
+	@param[out] uint16_t * pNum	the number of signals extracted, may be NULL
+	@return GP_SUCCESS (also for a message without a plan, 0 signals),
+			GP_DP_DATA_ERR if the payload is shorter than the signals of its
+			plan, else the SetElems() error
+*/
+gp_retcode_t CanSig_Extract(uint8_t bus, uint32_t canMsgId, const uint8_t * pData, uint8_t dlc, uint16_t * pNum);
+
+#endif
@@ -0,0 +1,100 @@
+/**
+	@file 		can_tmo.h
+	@version 	1.0
+	@brief		CAN message/signal timeout tracker. Every tracked signal has a
+				deadline in a hierarchical timer wheel (CAN_TMO_LEVELS levels of
+				CAN_TMO_SLOTS slots, one tick is CAN_TMO_TICK_MS), so arming,
+				refreshing and removing a deadline are O(1) whatever the number of
+				signals, and a single thread advances the wheel instead of a
+				POSIX timer per signal. When a deadline expires its datapool item
+				is marked stale (SetPoolStale()), a refresh marks it valid again,
+				and the registered hook is told of both.
+*/
+#ifndef _CAN_TMO_H_
+#define _CAN_TMO_H_
+
+#include <stdint.h>
+#include "gp_types.h"
+#include "pool_def.h"
+
+/*****************************************************************************/
+/*    M A C R O S                                                            */
+/*****************************************************************************/
+#define CAN_TMO_TICK_MS		10u		/*!< Period in msec of the wheel tick */
+#define CAN_TMO_SLOT_BITS	6u		/*!< Log2 of the number of slots of a level */
+#define CAN_TMO_SLOTS		(1u << CAN_TMO_SLOT_BITS)	/*!< Number of slots of a level */
+#define CAN_TMO_LEVELS		3u		/*!< Number of levels, the longest timeout is CAN_TMO_MAX_TICKS ticks */
+#define CAN_TMO_MAX_TICKS	((1u << (CAN_TMO_SLOT_BITS * CAN_TMO_LEVELS)) - 1)	/*!< Longest timeout in ticks, longer ones are clamped */
+#define CAN_TMO_MAX_TIMERS	4096u	/*!< Max number of tracked deadlines */
+#define CAN_TMO_NONE		UINT16_MAX	/*!< Invalid can_tmo_id_t */
+
+/*****************************************************************************/
+/*    T Y P E S   A N D   E N U M E R A T I O N S                            */
+/*****************************************************************************/
+/** @brief	can_tmo_id_t handle of a tracked deadline */
+typedef uint16_t can_tmo_id_t;
+
+/**
+	@brief	can_tmo_hook_t callback executed after datapool items became stale
+			(stale true) or valid again (stale false). p_changed is the bitmap
+			(DP_DIRTY_WORDS words) of those items.
+*/
+typedef void (*can_tmo_hook_t)(const uint32_t p_changed[], bool stale);
+
+/*****************************************************************************/
+/*    P U B L I C   F U N C T I O N S                                        */
+/*****************************************************************************/
+/**
+	@brief CanTmo_Init()	Empties the wheel, shall be called before any other
+							function. The wheel is then advanced by calling
+							CanTmo_Advance().
+	@param[in] can_tmo_hook_t hook	the staleness change callback, may be NULL
+	@return GP_SUCCESS
+*/
+gp_retcode_t CanTmo_Init(can_tmo_hook_t hook);
+
+/**
+	@brief CanTmo_Start()	Empties the wheel (see CanTmo_Init()) and starts the
+							thread advancing it every CAN_TMO_TICK_MS
+	@param[in] can_tmo_hook_t hook	the staleness change callback, may be NULL
+	@return GP_SUCCESS, else GP_INIT_ERR
+*/
+gp_retcode_t CanTmo_Start(can_tmo_hook_t hook);
+
+/**
+	@brief CanTmo_Add()		Tracks a signal, its deadline is armed now
+	@param[in] uint16_t elemId	the datapool item of the signal
+	@param[in] uint32_t timeoutMs	the timeout of the signal in msec
+	@param[out] can_tmo_id_t * pId	the handle of the deadline
+	@return GP_SUCCESS, GP_DP_PARMS_ERR or GP_MALLOC_ERR if CAN_TMO_MAX_TIMERS
+			deadlines are tracked
+*/
+gp_retcode_t CanTmo_Add(uint16_t elemId, uint32_t timeoutMs, can_tmo_id_t * pId);
+
+/**
+	@brief CanTmo_Refresh()	Restarts the timeout of a signal that was received,
+							a stale item is marked valid again
+	@param[in] can_tmo_id_t id	the handle of the deadline
+	@return GP_SUCCESS or GP_DP_PARMS_ERR
+*/
+gp_retcode_t CanTmo_Refresh(can_tmo_id_t id);
+
+/**
+	@brief CanTmo_Remove()	Stops tracking a signal, its item staleness is left
+							as is
+	@param[in] can_tmo_id_t id	the handle of the deadline
+	@return GP_SUCCESS or GP_DP_PARMS_ERR
+*/
+gp_retcode_t CanTmo_Remove(can_tmo_id_t id);
+
+/**
+	@brief CanTmo_Advance()	Runs the wheel up to a time and expires the
+							deadlines reached, called by the thread of
+							CanTmo_Start() (or directly if it is not started).
+							The first call only sets the time of the wheel.
+	@param[in] uint32_t nowMs	the current time in msec, it may wrap
+	@return the number of deadlines expired
+*/
+uint32_t CanTmo_Advance(uint32_t nowMs);
+
+#endif
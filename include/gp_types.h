@@ -23,7 +23,7 @@ extern "C" {
 #include <ctype.h>
 #include "types.h"
 
-typedef void (*function_cb_t)(void *);
+typedef void (*function_cb_t)(void *, uint16_t);
 
 #define MAX_MSG_BUFFER 256 
 
@@ -25,6 +25,16 @@
 #define CommonHmi_ConPath "./common_Hmi"
 #define CommonHmi2_ConPath "./common_Hmi2"
 
+/*C O N N E C T I O N S 	T R A N S P O R T S*/
+/*both sides of a connection must use the same transport, see SetMsgTransport()*/
+#define HmiMgrWrkTsk1DpMgr_Transport MSG_TRANSPORT_RING
+
+/*S H A R E D 	M E M O R Y*/
+/*when DpMgr_SharedPool is true the datapool manager owns the datapool in this segment
+  and the HMI reads it in place, see InitPoolShared()/AttachPoolShared()*/
+#define CommonDp_ShmName "/common_Dp_pool"
+#define DpMgr_SharedPool true
+
 /*N A M E D 	S E M A P H O R E S*/
 #define dp_semaphore "/dp_semaphore"
 #define hmi_semaphore "/hmi_semaphore"
@@ -8,6 +8,8 @@
 				is to provide a way to identify wHich process are allowed to
 				comunicate between each others.
 */
+#ifndef _MSG_API_SIGNALS_H_
+#define _MSG_API_SIGNALS_H_
 #include <stdint.h>
 #include <sys/types.h>
 #include <sys/syscall.h>
@@ -17,6 +19,7 @@
 #include <sys/stat.h>        
 #include "types.h"
 #include "signal_definitions.h"
+#include "msg_ring.h"
 /**
 	@brief 	component_info_t this struct is used to group the relevant data of 
 			every "component" at runtime.
@@ -26,6 +29,24 @@ typedef struct{
 	pid_t 	Tid;		/*!< This is the id of the process as seen by the kernel*/
 	int8_t 	Fd;			/*!< This is the file descriptor of the socket used for msg*/
 }component_info_t;
+/**
+	@brief 	msg_transport_t selects how TxMsg()/RxMsg() move the data of a
+			connection, the signal used to notify the peer is the same for
+			both.
+*/
+typedef enum{
+	MSG_TRANSPORT_SOCKET = 0,	/*!< write()/read() on the unix domain socket (default)*/
+	MSG_TRANSPORT_RING			/*!< shared-memory ring created by GetTids()/PostTid()*/
+}msg_transport_t;
+/**
+	@brief 	msg_batch_entry_t one message of a batch sent with TxMsgBatch()
+*/
+typedef struct{
+	uint8_t * Data;		/*!< The message, same format as the data of TxMsg()*/
+	uint8_t   DataSz;	/*!< The size in bytes of the message*/
+}msg_batch_entry_t;
+
+#define MSG_BATCH_MAX	32	/*!< Max number of messages sent by one TxMsgBatch() call */
 /**
 	@brief GetTids() 	This function is used to retrieve the tid (unique for 
 						each process) at runtime, of the processes specified 
@@ -98,10 +119,31 @@ int8_t SetRxOn(const char connection_path[]);
 	@param[in] uint8_t * data A pointer to a previously allocated memory 
 					(usually a char array)
 	@param[in] uint8_t dataSz The size in bytes of the allocated memory
-	@return  On error this function return -1, on Succes 0 is returned
+	@return  On error this function return -1, on Succes 0 is returned. When
+					the connection uses MSG_TRANSPORT_RING one message is
+					read per call and -1 is returned once the ring is empty.
 
 */
 int8_t RxMsg(int8_t socket_fd, uint8_t * data, uint8_t dataSz);
+/**
+	@brief RxMsgSz() 	Same as RxMsg(), also returns the size of the message read
+	@param[in] int8_t socket_fd A socket file descriptor previously created
+					with a call to SetRxOn() function.
+	@param[in] uint8_t * data A pointer to a previously allocated memory
+	@param[in] uint8_t dataSz The size in bytes of the allocated memory
+	@param[out] uint16_t * pRxSz The number of bytes stored in data, may be NULL
+	@return  Same as RxMsg()
+*/
+int8_t RxMsgSz(int8_t socket_fd, uint8_t * data, uint8_t dataSz, uint16_t * pRxSz);
+/**
+	@brief EncodeMsg() 	Prepends the callback flag to a message in place, the 
+					flag is written in the byte in front of "dataToEncode".
+	@param[in] uint8_t * dataToEncode The message, preceded by at least one byte
+					of headroom (see Msg_GetMsgBuf() in msg_buf.h)
+	@param[in] bool cb Wheter or not a callback should be executed
+	@return Pointer to the encoded message (dataToEncode - 1)
+*/
+uint8_t * EncodeMsg(uint8_t * dataToEncode, bool cb);
 /**
 	@brief SetTxOn() 	This function will set a client socket in the function
 						that calls this function, the intendi s that this 
@@ -133,6 +175,28 @@ int8_t SetTxOn(const char connection_path[]);
 	@return On error this function return -1, on Succes 0 is returned
 */
 int8_t TxMsg(int8_t socket_fd, pid_t tid, uint8_t ImComponent, uint8_t * data, uint8_t dataSz, bool cb);
+/**
+	@brief TxMsgBatch() 	This function sends several messages to the same
+					peer at the cost of one: all the frames are written with a
+					single writev() (or pushed to the ring) and the peer is
+					notified once for the whole batch. The receiver gets each
+					message separately, exactly as if TxMsg() had been called
+					for each of them.
+	@param[in] int8_t socket_fd	The file descriptor of the socket file you want 
+					to write
+	@param[in] pid_t tid The tid of the process you want to send the messages to
+	@param[in] uint8_t ImComponent The "user defined" id as defined in 
+					identification_data.h
+	@param[in] msg_batch_entry_t msgs[] The messages to send, in order
+	@param[in] uint8_t numMsgs The number of messages in msgs[], at most
+					MSG_BATCH_MAX
+	@param[in] bool cb Wheter or not a callback should be executed when the 
+					messages are received.
+	@return On error this function return -1, on Succes 0 is returned. With the
+					ring transport the messages that fit before the ring got
+					full are still delivered.
+*/
+int8_t TxMsgBatch(int8_t socket_fd, pid_t tid, uint8_t ImComponent, msg_batch_entry_t msgs[], uint8_t numMsgs, bool cb);
 /**
 	@brief WaitSemaphore() 	This function will wait till the specified semaphore
 							is available.
@@ -151,4 +215,27 @@ int8_t WaitSemaphore(const char named_semaphore[]);
 							incremented.
 	@return  On error this function return -1, on Succes 0 is returned
 */
-int8_t PostSemaphore(const char named_semaphore[], uint8_t semaphores_count);
\ No newline at end of file
+int8_t PostSemaphore(const char named_semaphore[], uint8_t semaphores_count);
+/**
+	@brief SetMsgTransport() This function selects the transport used by
+						TxMsg() and RxMsg() for the socket in componentInfo.
+						The shared-memory ring of a connection is created by
+						GetTids() and mapped by PostTid(), so this function
+						must be called after the rendezvous and after the
+						socket has been set with SetRxOn()/SetTxOn(). Both
+						sides of a connection must select the same transport.
+	@param[in] component_info_t * componentInfo The Tid and Fd of the peer
+	@param[in] msg_transport_t transport The transport to use
+	@return On error (no ring available for the peer) this function return
+						-1, on Succes 0 is returned
+*/
+int8_t SetMsgTransport(component_info_t * componentInfo, msg_transport_t transport);
+/**
+	@brief GetMsgTransport() This function returns the transport selected for
+						the socket with the file descriptor socket_fd.
+	@param[in] int8_t socket_fd The file descriptor of the socket
+	@return The transport of the connection, MSG_TRANSPORT_SOCKET if none was
+						selected
+*/
+msg_transport_t GetMsgTransport(int8_t socket_fd);
+#endif
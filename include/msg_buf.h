@@ -41,10 +41,51 @@
 /*****************************************************************************/
 /*    M A C R O S                                                            */
 /*****************************************************************************/ 
+#define MSG_BUF_MIN_SZ		4u		/*!< Size in bytes of the smallest buffers */
+#define MSG_BUF_MAX_SZ		256u	/*!< Size in bytes of the biggest buffers */
+#define MSG_BUF_MAX_CLASSES	7u		/*!< Number of buffer sizes, powers of two from MSG_BUF_MIN_SZ to MSG_BUF_MAX_SZ */
+
+/*! Bytes of pool memory taken by a buffer of sz bytes: its 8 byte header, the buffer
+	and 3 control bytes, rounded up to 8 bytes */
+#define MSG_BUF_STRIDE(sz)	((8u + (sz) + 3u + 7u) & ~7u)
+
+/*! Size in bytes of the memory of each buffer pool, the hard limit of Msg_InitBufsCfg():
+	the sum of NumBufs * MSG_BUF_STRIDE(BufSz) of its classes shall not exceed it.  The
+	default only fits the default classes of Msg_InitBufs(), define it at build time
+	(-DMSG_BUF_POOL_MEM_SZ=n) for bigger configurations.  Every pool (4 per process)
+	takes this memory statically. */
+#ifndef MSG_BUF_POOL_MEM_SZ
+#define MSG_BUF_POOL_MEM_SZ	4128u
+#endif
 
 /*****************************************************************************/
 /*    T Y P E S   A N D   E N U M E R A T I O N S                            */
 /*****************************************************************************/
+/*! Configuration of a buffer size class, see Msg_InitBufsCfg() */
+typedef struct {
+	uint16_t BufSz;		/*!< Size in bytes of the buffers, a power of two from MSG_BUF_MIN_SZ to MSG_BUF_MAX_SZ */
+	uint16_t NumBufs;	/*!< Number of buffers of the class */
+} MsgBufCfgType;
+
+/*! Usage statistics of a buffer size class, see Msg_GetBufStats() */
+typedef struct {
+	uint16_t BufSz;		/*!< Size in bytes of the buffers */
+	uint16_t NumBufs;	/*!< Number of buffers of the class */
+	uint16_t InUse;		/*!< Number of buffers in use */
+	uint16_t HighWater;	/*!< Highest number of buffers in use at once since init */
+	uint32_t Failed;	/*!< Number of requests that found no buffer available */
+} MsgBufStatsType;
+
+/*! Message composed in a buffer of the pool with headroom reserved in front of it, so
+	that the protocol headers are written in place ahead of the payload */
+typedef struct {
+	uint8_t * pData;	/*!< Start of the message: the last header pushed, else the payload */
+	uint32_t DataSz;	/*!< Size in bytes of the message from pData */
+	uint32_t Headroom;	/*!< Number of bytes still free in front of pData */
+	uint32_t BufSz;		/*!< Size requested to Msg_GetBuf() */
+	uint32_t BufIdx;	/*!< Index returned by Msg_GetBuf() */
+	uint8_t Component;	/*!< Buffer pool of the task */
+} MsgBufType;
 
 /*****************************************************************************/
 /*    M E M O R Y   A L L O C A T I O N                                      */
@@ -64,6 +105,37 @@
 ******************************************************************************/
 gp_retcode_t Msg_InitBufs(uint8_t component);
 
+/******************************************************************************
+*  Function Name: Msg_InitBufsCfg
+*
+*  Description: Same as Msg_InitBufs() with the given size classes instead of
+*    the default ones. A request is served by the smallest configured class
+*    holding it.
+*
+*  Input(s):    component - buffer pool of the task, cfg - size and number of
+*               buffers of each class, numCfg - number of entries in cfg.
+*
+*  Outputs(s):  None.
+*
+*  Returns:     GP_SUCCESS, GP_INIT_ERR if a class is invalid or the buffers
+*               don't fit the pool memory (MSG_BUF_POOL_MEM_SZ bytes).
+******************************************************************************/
+gp_retcode_t Msg_InitBufsCfg(uint8_t component, const MsgBufCfgType cfg[], uint8_t numCfg);
+
+/******************************************************************************
+*  Function Name: Msg_GetBufStats
+*
+*  Description: Returns the usage statistics of the configured size classes.
+*
+*  Input(s):    component - buffer pool of the task.
+*
+*  Outputs(s):  stats - MSG_BUF_MAX_CLASSES entries, smallest class first,
+*               pNumClasses - number of entries stored.
+*
+*  Returns:     GP_SUCCESS, GP_GENERR if component is invalid.
+******************************************************************************/
+gp_retcode_t Msg_GetBufStats(uint8_t component, MsgBufStatsType stats[], uint8_t * pNumClasses);
+
 /******************************************************************************
 *  Function Name: 
 *
@@ -90,5 +162,47 @@ uint8_t * Msg_GetBuf(uint32_t reqSz, uint32_t * bufIdx, uint8_t component);
 ******************************************************************************/
 void Msg_FreeBuf(uint32_t bufSz, uint32_t bufIdx, uint8_t component);
 
+/******************************************************************************
+*  Function Name: Msg_GetMsgBuf
+*
+*  Description: Reserves a buffer for a payload of dataSz bytes preceded by
+*    headroom bytes for the headers. pMsg->pData points to the payload.
+*
+*  Input(s):    headroom - bytes reserved in front of the payload, dataSz -
+*               payload size, component - buffer pool of the task.
+*
+*  Outputs(s):  pMsg - the message buffer.
+*
+*  Returns:     GP_SUCCESS, GP_MSG_NONEAVAIL if no buffer is available.
+******************************************************************************/
+gp_retcode_t Msg_GetMsgBuf(MsgBufType * pMsg, uint32_t headroom, uint32_t dataSz, uint8_t component);
+
+/******************************************************************************
+*  Function Name: Msg_PushHdr
+*
+*  Description: Takes hdrSz bytes of headroom in front of the message, the
+*    caller writes its header there.
+*
+*  Input(s):    pMsg - the message buffer, hdrSz - header size.
+*
+*  Outputs(s):  pMsg->pData and pMsg->DataSz include the header.
+*
+*  Returns:     Pointer to the header, NULL if the headroom is too small.
+******************************************************************************/
+uint8_t * Msg_PushHdr(MsgBufType * pMsg, uint32_t hdrSz);
+
+/******************************************************************************
+*  Function Name: Msg_FreeMsgBuf
+*
+*  Description: Releases the buffer of a message (see Msg_FreeBuf()).
+*
+*  Input(s):    pMsg - the message buffer.
+*
+*  Outputs(s):  None.
+*
+*  Returns:     None.
+******************************************************************************/
+void Msg_FreeMsgBuf(MsgBufType * pMsg);
+
 #endif
 /* MSG_BUF_H */
@@ -109,7 +109,16 @@ typedef enum MsgId {
     UdsResponseMsg, 	/* 23: UDS response message from VP */
     SleepRequestMsg, 	/* 24: Sleep request message from VP */
     AppStatusMsg,      /* 25: Aplication status message. Uses ::APP_STAT_CODE_T and :: APP_STAT_TARG from cmd_conn.h*/
-    MsgIdMax = AppStatusMsg,
+    PoolDeltaReq,  		/* 26: Request the datapool items changed since a version */
+    PoolDeltaRes,  		/* 27: Datapool items changed since the requested version */
+    ElemSubscribeReq,	/* 28: Subscribe to changes of datapool items */
+    ElemUnsubscribeReq,	/* 29: Unsubscribe from changes of datapool items */
+    ElemChangeNotify,	/* 30: Subscribed datapool items that changed */
+    SetElemsReq,		/* 31: Set several datapool items at once */
+    GetElemsReq,		/* 32: Get a snapshot of several datapool items */
+    GetElemsRes,		/* 33: Snapshot of the requested datapool items */
+    ElemStaleNotify,	/* 34: Datapool items stale (timed out) or valid again */
+    MsgIdMax = ElemStaleNotify,
     MsgIdInvalid,
 } MsgId;
 
@@ -166,6 +175,31 @@ typedef enum {
 #define MSG_STAT_DATLEN (MSG_STAT_CODE+1)
 #define MSG_STAT_SZ     (2 + MSG_STAT_DATLEN)
 
+/*! PoolDeltaReq/PoolDeltaRes message definitions.  These offsets are relative to the end of 
+	the IPC message ID field.  The PoolDeltaRes payload is the delta image built by 
+	GetPoolDelta(): new version, dirty bitmap, then the value of every item in the bitmap. */
+#define MSG_POOLDELTA_VER		0						/*!< Offset to the datapool version (4 bytes) */
+#define MSG_POOLDELTAREQ_SZ		(MSG_ID_SZ + 4)			/*!< Size in bytes of a PoolDeltaReq message */
+
+/*! ElemSubscribeReq/ElemUnsubscribeReq message definitions.  These offsets are relative to 
+	the end of the IPC message ID field.  The ElemChangeNotify payload is a delta image, 
+	like the one of PoolDeltaRes, of the subscribed items that changed. */
+#define MSG_ELEMSUB_NUM			0						/*!< Offset to the number of datapool item IDs (1 byte) */
+#define MSG_ELEMSUB_IDS			(MSG_ELEMSUB_NUM + 1)	/*!< Offset to the datapool item IDs */
+#define MSG_ELEMSUB_ID_SZ		2						/*!< Size in bytes of a datapool item ID */
+
+/*! SetElemsReq/GetElemsReq/GetElemsRes message definitions.  These offsets are relative to 
+	the end of the IPC message ID field.  SetElemsReq and GetElemsRes carry (item ID, value) 
+	tuples, each value encoded as in SetElemReq; GetElemsReq carries the item IDs only. */
+#define MSG_ELEMS_NUM			0						/*!< Offset to the number of datapool items (1 byte) */
+#define MSG_ELEMS_ITEMS			(MSG_ELEMS_NUM + 1)		/*!< Offset to the first datapool item */
+#define MSG_ELEMS_MAX			16						/*!< Max number of datapool items per message */
+
+/*! ElemStaleNotify message definitions.  These offsets are relative to the end of the IPC 
+	message ID field.  The payload is the stale bitmap returned by GetPoolStale(). */
+#define MSG_ELEMSTALE_BITMAP	0						/*!< Offset to the stale bitmap (::DP_DIRTY_WORDS 32 bit words) */
+#define MSG_ELEMSTALE_SZ		(MSG_ID_SZ + (4 * DP_DIRTY_WORDS))	/*!< Size in bytes of an ElemStaleNotify message */
+
 /*! SpiTxReq message definitions */
 #define SPI_HEADER_SZ 4			/*!< Size in bytes of a SPI message header */
 #define MSG_SPITXREQ_MIN_SZ (SPI_HEADER_SZ + 1)
@@ -0,0 +1,45 @@
+/**
+	@file 		msg_evloop.h
+	@version 	1.0
+	@brief		Event driven message reception. A dedicated receive thread waits
+				with epoll() on the sockets of every connection of the component
+				and drains each of them completely per wakeup, then executes the
+				"component" callback for every message on that thread instead of
+				inside a real-time signal handler.
+				The CB_TRUE/CB_FALSE signals sent by TxMsg() are still used as a
+				doorbell: their handler only forwards the sender "component" id
+				to the receive thread through a pipe, which is how connections
+				using MSG_TRANSPORT_RING (no socket data) are woken up.
+*/
+#ifndef _MSG_EVLOOP_H_
+#define _MSG_EVLOOP_H_
+
+#include "gp_types.h"
+#include "msg_api_signals.h"
+
+/*****************************************************************************/
+/*    M A C R O S                                                            */
+/*****************************************************************************/
+#define MSG_EVLOOP_MAX_CONNS	4		/*!< Max number of connections served by the receive thread */
+#define MSG_EVLOOP_RX_BUF_SZ	MAX_MSG_BUFFER	/*!< Size in bytes of the receive buffer of a connection */
+#define MSG_EVLOOP_MAX_EVENTS	8		/*!< Max number of events handled per epoll_wait() */
+
+/*****************************************************************************/
+/*    P U B L I C   F U N C T I O N S                                        */
+/*****************************************************************************/
+/**
+	@brief MsgEvLoop_Start()	Registers the connections of the component and
+								starts the receive thread. CB_TRUE and CB_FALSE
+								are (re)installed to wake the thread, so any
+								previous sigaction() of these signals is replaced.
+	@param[in] component_info_t * componentsId	the connections, as filled by
+								GetTids()/PostTid() and SetRxOn()/SetTxOn()
+	@param[in] uint8_t numComponents	the number of entries in componentsId
+	@param[in] function_cb_t handlers[]	the callback executed for the messages
+								of each connection, same order as componentsId,
+								it is given the payload and its size in bytes
+	@return -1 on error, 0 on success
+*/
+int8_t MsgEvLoop_Start(component_info_t * componentsId, uint8_t numComponents, function_cb_t handlers[]);
+
+#endif
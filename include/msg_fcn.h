@@ -30,5 +30,38 @@
 */
 int32_t TxBufMsg(uint8_t component, int socket_fd, uint16_t id, pid_t tid, uint8_t * data, uint32_t size);
 
+/**
+	@brief	Sends the same message to several destinations, the message is 
+			composed once and TxMsg() copies it to every destination
+	@param[in] uint8_t 	component The type of "component" sending the message
+	@param[in] const component_info_t dest[] The connections of the 
+						destinations (see GetTids()/PostTid() and SetTxOn() on
+						msg_api_signals.h), only Fd and Tid are used.
+	@param[in] uint8_t numDest The number of entries in dest
+	@param[in] uint16_t id The id of the message as defined in the enum MsgId
+	@param[in] uint8_t * data The data you wish to send
+	@param[in] uint32_t size the size in bytes of "data"
+	@return 0 on success, -1 if no buffer is available for the message, -2 if 
+			the transfer to any destination failed
+*/
+int32_t TxBufMsgFanout(uint8_t component, const component_info_t dest[], uint8_t numDest, uint16_t id, uint8_t * data, uint32_t size);
+
+/**
+	@brief	Same as TxBufMsgFanout() for a payload already composed in a 
+			message buffer, the message id is written in its headroom so the
+			payload is not copied to build the message.  The fan-out is
+			copy based: each TxMsg() copies the message to its socket or ring
+	@param[in] uint8_t 	component The type of "component" sending the message
+	@param[in] const component_info_t dest[] The connections of the destinations
+	@param[in] uint8_t numDest The number of entries in dest
+	@param[in] uint16_t id The id of the message as defined in the enum MsgId
+	@param[in] MsgBufType * pMsg The payload, from Msg_GetMsgBuf() with at least
+						MSG_ID_SZ bytes of headroom (see msg_buf.h). Its buffer
+						is released by this function.
+	@return 0 on success, -1 if the message can't be built, -2 if the transfer
+			to any destination failed
+*/
+int32_t TxMsgBufFanout(uint8_t component, const component_info_t dest[], uint8_t numDest, uint16_t id, MsgBufType * pMsg);
+
 #endif
 
@@ -0,0 +1,107 @@
+/**
+	@file 		msg_frame.h
+	@version 	1.0
+	@brief		Framing of the messages sent on the socket transport of
+				TxMsg()/RxMsg() (see msg_api_signals.h). SOCK_STREAM does not
+				keep message boundaries, a burst of writes may be merged into
+				a single read() or a message may be split across reads, so every
+				message is preceded by a msg_frame_hdr_t. The receiver feeds the
+				bytes it reads to a msg_frame_reasm_t and pulls every complete
+				message out of it.
+*/
+#ifndef _MSG_FRAME_H_
+#define _MSG_FRAME_H_
+
+#include <stdint.h>
+#include "types.h"
+
+/*****************************************************************************/
+/*    M A C R O S                                                            */
+/*****************************************************************************/
+#define MSG_FRAME_HDR_SZ		8u		/*!< Size in bytes of an encoded msg_frame_hdr_t */
+#define MSG_FRAME_REASM_SZ		4096u	/*!< Size in bytes of the reassembly buffer */
+#define MSG_FRAME_MAX_PAYLOAD	(MSG_FRAME_REASM_SZ - MSG_FRAME_HDR_SZ)	/*!< Largest payload of a frame */
+
+/*****************************************************************************/
+/*    T Y P E S   A N D   E N U M E R A T I O N S                            */
+/*****************************************************************************/
+/**
+	@brief	msg_frame_hdr_t header sent before every message, encoded in the
+			IPC byte order (gp_Store16bit()/gp_Store32bit())
+*/
+typedef struct{
+	uint16_t Len;		/*!< Size in bytes of the payload following the header */
+	uint16_t MsgId;		/*!< IPC message id found at the start of the payload, MsgIdInvalid if none */
+	uint32_t Seq;		/*!< Sequence number of the frame on its connection */
+}msg_frame_hdr_t;
+
+/**
+	@brief	msg_frame_reasm_t incremental reassembler of one connection. The
+			bytes between Start and End have been received but not consumed yet.
+*/
+typedef struct{
+	uint16_t Start;							/*!< Offset of the first unconsumed byte */
+	uint16_t End;							/*!< Offset past the last received byte */
+	uint32_t NextSeq;						/*!< Expected sequence number of the next frame */
+	bool	 SeqValid;						/*!< false until the first frame is received */
+	uint32_t SeqErrors;						/*!< Number of frames received out of sequence */
+	uint8_t  Buf[MSG_FRAME_REASM_SZ];		/*!< Received bytes */
+}msg_frame_reasm_t;
+
+/*****************************************************************************/
+/*    P U B L I C   F U N C T I O N S                                        */
+/*****************************************************************************/
+/**
+	@brief MsgFrame_PutHdr()	Encodes a frame header
+	@param[out] uint8_t * pBuf	storage of at least MSG_FRAME_HDR_SZ bytes
+	@param[in] const uint8_t * data	the payload, its first bytes give the msg id
+	@param[in] uint16_t dataSz	size in bytes of the payload
+	@param[in] uint32_t seq	sequence number of the frame
+	@return the number of bytes written (MSG_FRAME_HDR_SZ)
+*/
+uint8_t MsgFrame_PutHdr(uint8_t * pBuf, const uint8_t * data, uint16_t dataSz, uint32_t seq);
+
+/**
+	@brief MsgFrame_GetHdr()	Decodes a frame header
+	@param[out] msg_frame_hdr_t * pHdr	the decoded header
+	@param[in] uint8_t * pBuf	MSG_FRAME_HDR_SZ bytes of an encoded header
+	@return the number of bytes read (MSG_FRAME_HDR_SZ)
+*/
+uint8_t MsgFrame_GetHdr(msg_frame_hdr_t * pHdr, uint8_t * pBuf);
+
+/**
+	@brief MsgFrame_InitReasm()	Empties a reassembler and resets its sequence
+	@param[in] msg_frame_reasm_t * pReasm	the reassembler
+*/
+void MsgFrame_InitReasm(msg_frame_reasm_t * pReasm);
+
+/**
+	@brief MsgFrame_RxSpace()	Returns where the next read() shall store its
+								data, the unconsumed bytes are moved to the
+								start of the buffer first
+	@param[in] msg_frame_reasm_t * pReasm	the reassembler
+	@param[out] uint16_t * pSpace	the number of bytes that can be stored
+	@return pointer to the free space of the buffer
+*/
+uint8_t * MsgFrame_RxSpace(msg_frame_reasm_t * pReasm, uint16_t * pSpace);
+
+/**
+	@brief MsgFrame_RxCommit()	Accounts for the bytes stored at the pointer
+								returned by MsgFrame_RxSpace()
+	@param[in] msg_frame_reasm_t * pReasm	the reassembler
+	@param[in] uint16_t count	the number of bytes stored
+*/
+void MsgFrame_RxCommit(msg_frame_reasm_t * pReasm, uint16_t count);
+
+/**
+	@brief MsgFrame_Next()	Pulls the next complete frame out of the reassembler
+	@param[in] msg_frame_reasm_t * pReasm	the reassembler
+	@param[out] msg_frame_hdr_t * pHdr	the header of the frame
+	@param[out] uint8_t ** ppPayload	the payload of the frame, valid until
+								the next call to MsgFrame_RxSpace()
+	@return 1 if a frame was returned, 0 if more data is needed, -1 if the
+			stream is corrupted (the reassembler is emptied)
+*/
+int8_t MsgFrame_Next(msg_frame_reasm_t * pReasm, msg_frame_hdr_t * pHdr, uint8_t ** ppPayload);
+
+#endif
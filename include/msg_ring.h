@@ -0,0 +1,128 @@
+/**
+	@file 		msg_ring.h
+	@version 	1.0
+	@brief		Shared-memory single-producer/single-consumer message ring used
+				as an alternative transport for TxMsg()/RxMsg() (see
+				msg_api_signals.h). One POSIX shared-memory segment is created
+				per component pair during the GetTids()/PostTid() rendezvous,
+				it holds one ring for each direction of the connection.
+				Once the segment is mapped, pushing and popping messages does
+				not need any system call; the peer is only notified when its
+				consumer has drained its ring and armed a wakeup.
+*/
+#ifndef _MSG_RING_H_
+#define _MSG_RING_H_
+
+#include <stdint.h>
+#include "types.h"
+
+/*****************************************************************************/
+/*    M A C R O S                                                            */
+/*****************************************************************************/
+#define MSG_RING_SHM_NAME	"/msg_ring_%u_%u"	/*!< Segment name, <server component>_<client component> */
+#define MSG_RING_MAGIC		0x52474E52u			/*!< "RNGR", marks an initialized segment */
+#define MSG_RING_VERSION	1u					/*!< Layout version of msg_ring_shm_t */
+
+#define MSG_RING_SZ			4096u				/*!< Bytes of ring data per direction, must be a power of 2 */
+#define MSG_RING_REC_HDR_SZ	2u					/*!< Each record is prefixed by its 16 bit length */
+#define MSG_RING_CACHE_LINE	64u					/*!< Keeps producer and consumer indexes in separate lines */
+
+/*****************************************************************************/
+/*    T Y P E S   A N D   E N U M E R A T I O N S                            */
+/*****************************************************************************/
+/**
+	@brief	Direction of the rings inside a msg_ring_shm_t segment
+*/
+typedef enum{
+	MSG_RING_SERVER_TX = 0,		/*!< Written by the GetTids() side, read by the PostTid() side */
+	MSG_RING_CLIENT_TX,			/*!< Written by the PostTid() side, read by the GetTids() side */
+	MSG_RING_NUM_DIRS
+}msg_ring_dir_t;
+
+/**
+	@brief	msg_ring_t one direction of a connection. Head is only written by
+			the producer and Tail/RxArmed are only written by the consumer
+			(RxArmed is also cleared by the producer when it sends a wakeup).
+			Head and Tail are free running byte counters, the data offset is
+			obtained by masking them with (MSG_RING_SZ - 1).
+*/
+typedef struct{
+	uint32_t Head;									/*!< Producer index */
+	uint8_t  HeadPad[MSG_RING_CACHE_LINE - sizeof(uint32_t)];
+	uint32_t Tail;									/*!< Consumer index */
+	uint32_t RxArmed;								/*!< Non-zero when the consumer waits for a wakeup */
+	uint8_t  TailPad[MSG_RING_CACHE_LINE - (2 * sizeof(uint32_t))];
+	uint8_t  Data[MSG_RING_SZ];						/*!< Length prefixed message records */
+}msg_ring_t;
+
+/**
+	@brief	msg_ring_shm_t layout of the shared-memory segment of a connection
+*/
+typedef struct{
+	uint32_t Magic;									/*!< MSG_RING_MAGIC once initialized */
+	uint32_t Version;								/*!< MSG_RING_VERSION */
+	uint8_t  HdrPad[MSG_RING_CACHE_LINE - (2 * sizeof(uint32_t))];
+	msg_ring_t Ring[MSG_RING_NUM_DIRS];				/*!< Indexed by msg_ring_dir_t */
+}msg_ring_shm_t;
+
+/*****************************************************************************/
+/*    P U B L I C   F U N C T I O N S                                        */
+/*****************************************************************************/
+/**
+	@brief MsgRing_Create()	Creates (or re-creates) and maps the segment shared
+							by the server and client components, both rings are
+							left empty and armed.
+	@param[in] uint8_t server	"component" id of the GetTids() side
+	@param[in] uint8_t client	"component" id of the PostTid() side
+	@return Pointer to the mapped segment, NULL on error
+*/
+msg_ring_shm_t * MsgRing_Create(uint8_t server, uint8_t client);
+
+/**
+	@brief MsgRing_Open()	Maps a segment previously created by MsgRing_Create()
+	@param[in] uint8_t server	"component" id of the GetTids() side
+	@param[in] uint8_t client	"component" id of the PostTid() side
+	@return Pointer to the mapped segment, NULL on error
+*/
+msg_ring_shm_t * MsgRing_Open(uint8_t server, uint8_t client);
+
+/**
+	@brief MsgRing_Close()	Unmaps a segment returned by MsgRing_Create() or
+							MsgRing_Open()
+	@param[in] msg_ring_shm_t * pShm	the segment to unmap
+*/
+void MsgRing_Close(msg_ring_shm_t * pShm);
+
+/**
+	@brief MsgRing_Push()	Copies one message into the ring (producer side)
+	@param[in] msg_ring_t * pRing	the ring to write
+	@param[in] const uint8_t * data	the message to copy
+	@param[in] uint16_t dataSz	size in bytes of the message
+	@param[out] bool * pWake	set to true when the consumer armed a wakeup
+							and must be notified by the caller
+	@return -1 if there is not enough room in the ring, 0 on success
+*/
+int8_t MsgRing_Push(msg_ring_t * pRing, const uint8_t * data, uint16_t dataSz, bool * pWake);
+
+/**
+	@brief MsgRing_Free()	Room left in the ring (producer side), a message of
+							dataSz bytes takes MSG_RING_REC_HDR_SZ + dataSz.
+							The room can only grow until the producer pushes.
+	@param[in] const msg_ring_t * pRing	the ring to write
+	@return the number of free bytes
+*/
+uint32_t MsgRing_Free(const msg_ring_t * pRing);
+
+/**
+	@brief MsgRing_Pop()	Copies the oldest message out of the ring (consumer
+							side). When the ring is found empty the consumer
+							wakeup is armed before returning.
+	@param[in] msg_ring_t * pRing	the ring to read
+	@param[out] uint8_t * data	storage for the message
+	@param[in] uint16_t dataSz	size in bytes of data, a longer message is
+							truncated to this size
+	@return the size in bytes of the message, 0 if the ring is empty
+*/
+uint16_t MsgRing_Pop(msg_ring_t * pRing, uint8_t * data, uint16_t dataSz);
+
+#endif
@@ -5,10 +5,9 @@
  *  \copyright	Yazaki 2016-17
  *
  *  \brief		Header file with datapool item IDs, control table, and data allocation.
- *				To add a new datapool item, do the following:
- *				-# Add an ID definition to the datapool ID enumeration, #DP_ELEMENT_IDS.
- *				-# Add a storage entry for the datapool item to ::DP_ITEM_STORAGE_T.
- *				-# Add a datapool access table entry of type ::DP_ITEM_ENTRY_T for the datapool item.
+ *				To add a new datapool item, add an entry to the datapool element schema,
+ *				#DP_ELEMENT_SCHEMA.  The ID enumeration #DP_ELEMENT_IDS, ::DP_ITEM_STORAGE_T,
+ *				the default values and the datapool access table are generated from it.
  *
  *  \author		E. Gunarta, D. Kageff
  *
@@ -78,46 +77,66 @@
 #define MAX_VPSWVERSION_LEN  (VP_SW_VERSION_SZ+1)		/*!< VP SW version string.  Allow for NULL termination */
 #define MAX_VPPARTNUMBER_LEN (VP_SW_PART_NUMBER_SZ+1)	/*!< VP part number string.  Allow for NULL termination */
 
+/*! Storage type of each numeric GP data type */
+#define DP_CTYPE_GP_INT32	int32_t
+#define DP_CTYPE_GP_UINT32	uint32_t
+#define DP_CTYPE_GP_INT64	int64_t
+#define DP_CTYPE_GP_UINT64	uint64_t
+#define DP_CTYPE_GP_FLOAT	float
+#define DP_CTYPE_GP_DBL		double
+#define DP_CTYPE_GP_INT16	int16_t
+#define DP_CTYPE_GP_UINT16	uint16_t
+#define DP_CTYPE_GP_UINT8	uint8_t
+
+/*! Datapool element schema, one entry per datapool item in ID order:
+	- DP_ELEM(id, field, type, dflt): numeric item of GP data type 'type', stored as DP_CTYPE_<type>
+	- DP_STR(id, field, len, dflt): NULL terminated string item of 'len' bytes
+	Each user of the schema passes the two macros generating what it needs. */
+#define DP_ELEMENT_SCHEMA(DP_ELEM, DP_STR) \
+	DP_ELEM(YzTdTurnLeftSig,		TurnLeftSig,		GP_UINT32,	0)		/* ID 0: Left turn signal state */ \
+	DP_ELEM(YzTdTurnRightSig,		TurnRightSig,		GP_UINT32,	0)		/* ID 1: Right turn signal state */ \
+	DP_ELEM(YzTdSpeedValue,			SpeedValue,			GP_INT32,	0)		/* ID 2: Speed signal value */ \
+	DP_ELEM(YzTdPRNDL,				PRNDL,				GP_UINT32,	0)		/* ID 3: PRNDL signal state */ \
+	DP_ELEM(YzTdTestPattern,		Test_Pattern,		GP_UINT32,	0)		/* ID 4: Test pattern selection */ \
+	DP_ELEM(YzTdCruise,				Cruise,				GP_UINT32,	0)		/* ID 5: Cruise control signal state */ \
+	DP_ELEM(YzTdHazard,				Hazard,				GP_UINT32,	0)		/* ID 6: Hazard indicators signal state */ \
+	DP_ELEM(YzTdWarpLoad,			WarpLoad,			GP_UINT8,	0)		/* ID 7: Which mesh data to load */ \
+	DP_ELEM(YzTdWarpDisplay,		WarpDisplay,		GP_UINT8,	0)		/* ID 8: Which content to display/which mesh to use */ \
+	DP_ELEM(YzTdReserved1,			Reserved1,			GP_UINT32,	0)		/* ID 9: TBD */ \
+	DP_ELEM(YzTdReserved2,			Reserved2,			GP_UINT32,	0)		/* ID 10: TBD */ \
+	DP_ELEM(YzTdReserved3,			Reserved3,			GP_UINT32,	0)		/* ID 11: TBD */ \
+	DP_ELEM(YzTdMirrorPos,			MirrorPos,			GP_UINT32,	0)		/* ID 12: Mirror current position */ \
+	DP_ELEM(YzTdoSpeedMotorFront,	SpeedMotorFront,	GP_UINT32,	0)		/* ID 13: Front motor speed from PTC_EMotorSpeed CAN message */ \
+	DP_ELEM(YzTdoSpeedMotorRL,		SpeedMotorRL,		GP_UINT32,	0)		/* ID 14: Left rear motor speed from PTC_EMotorSpeed CAN message */ \
+	DP_ELEM(YzTdoSpeedMotorRR,		SpeedMotorRR,		GP_UINT32,	0)		/* ID 15: Right rear motor speed from PTC_EMotorSpeed CAN message */ \
+	DP_ELEM(YzTdoTorqueActualFront,	TorqueActualFront,	GP_INT32,	0)		/* ID 16: Front motor torque from PTC_EMotorStatus CAN message */ \
+	DP_ELEM(YzTdoTorqueActualRL,	TorqueActualRL,		GP_INT32,	0)		/* ID 17: Left rear motor torque from PTC_EMotorStatus CAN message */ \
+	DP_ELEM(YzTdoTorqueActualRR,	TorqueActualRR,		GP_INT32,	0)		/* ID 18: Right rear motor torque from PTC_EMotorStatus CAN message */ \
+	DP_ELEM(YzTdoNavOpts,			NavOpts,			GP_UINT32,	0)		/* ID 19: HMI Navigation display control options */ \
+	DP_ELEM(YzTdoAudioOpts,			AudioOpts,			GP_UINT32,	0)		/* ID 20: HMI audio display control options */ \
+	DP_STR(YzTdoNavSimFname,		NavSimFname,		MAX_FNAME_LEN,	"nav_frame_")	/* ID 21: HMI NavSimFname: Base simulation filename */ \
+	DP_ELEM(YzTdoNavSimFrames,		NavSimFrames,		GP_UINT16,	0)		/* ID 22: HMI NavSimFrames: Number of simulation frames */ \
+	DP_ELEM(YzTdoNavFrameDly,		NavFrameDly,		GP_UINT16,	0)		/* ID 23: HMI NavSimFrameDlyMs: Inter frame delay in msec */ \
+	DP_ELEM(YzTdoNavLoopDly,		NavLoopDly,			GP_UINT32,	0)		/* ID 24: HMI NavSimLoopDlyMs: Inter loop delay in msec */ \
+	DP_STR(YzTdoAudioSimFname,		AudioSimFname,		MAX_FNAME_LEN,	"audio_frame_")	/* ID 25: HMI AudioSimFname: Base simulation filename */ \
+	DP_ELEM(YzTdoAudioSimFrames,	AudioSimFrames,		GP_UINT16,	0)		/* ID 26: HMI AudioSimFrames: Number of simulation frames */ \
+	DP_ELEM(YzTdoAudioFrameDly,		AudioFrameDly,		GP_UINT16,	0)		/* ID 27: HMI AudioSimFrameDlyMs: Inter frame delay in msec */ \
+	DP_ELEM(YzTdoAudioLoopDly,		AudioLoopDly,		GP_UINT32,	0)		/* ID 28: HMI AudioSimLoopDlyMs: Inter loop delay in msec */ \
+	DP_STR(YzTdVpSwVersion,			VpSwVersion,		MAX_VPSWVERSION_LEN,	"")	/* ID 29: VP SW verson */ \
+	DP_STR(YzTdVpPartNumber,		VpPartNumber,		MAX_VPPARTNUMBER_LEN,	"")	/* ID 30: VP part number */ \
+	DP_ELEM(YzTdAutoDrvCtrl,		AutoDriveCtrl,		GP_UINT32,	0)		/* ID 31: Autonomous drive mode control */
+
 /*****************************************************************************/
 /*    T Y P E S   A N D   E N U M E R A T I O N S                            */
 /*****************************************************************************/
-/*! Datapool element IDs enumeration */
+/*! Datapool element IDs enumeration, generated from #DP_ELEMENT_SCHEMA */
+#define DP_ENUM_ELEM(id, field, type, dflt)	id,
+#define DP_ENUM_STR(id, field, len, dflt)	id,
 enum DP_ELEMENT_IDS
 {
-    ELEM_MIN_ID = 0,					/*!< Starting ID for datapool items */
-    YzTdTurnLeftSig = ELEM_MIN_ID,		/*!< ID 0: Left turn signal state */
-    YzTdTurnRightSig,					/*!< ID 1: Right turn signal state */
-    YzTdSpeedValue,						/*!< ID 2: Speed signal value */
-    YzTdPRNDL,							/*!< ID 3: PRNDL signal state */
-    YzTdTestPattern,					/*!< ID 4: Test pattern selection */
-    YzTdCruise,							/*!< ID 5: Cruise control signal state */
-    YzTdHazard,							/*!< ID 6: Hazard indicators signal state */
-    YzTdWarpLoad,						/*!< ID 7: Which mesh data to load */
-    YzTdWarpDisplay,					/*!< ID 8: Which content to display/which mesh to use */
-    YzTdReserved1,					/*!< ID 9: TBD */
-    YzTdReserved2,					/*!< ID 10: TBD */
-    YzTdReserved3,					/*!< ID 11: TBD */
-    YzTdMirrorPos,						/*!< ID 12: Mirror current position */
-	YzTdoSpeedMotorFront,				/*!< ID 13: Front motor speed from PTC_EMotorSpeed CAN message */
-	YzTdoSpeedMotorRL,					/*!< ID 14: Left rear motor speed from PTC_EMotorSpeed CAN message */
-	YzTdoSpeedMotorRR,					/*!< ID 15: Right rear motor speed from PTC_EMotorSpeed CAN message */
-	YzTdoTorqueActualFront,				/*!< ID 16: Front motor torque from PTC_EMotorStatus CAN message */
-	YzTdoTorqueActualRL,				/*!< ID 17: Left rear motor torque from PTC_EMotorStatus CAN message */
-	YzTdoTorqueActualRR,				/*!< ID 18: Right rear motor torque from PTC_EMotorStatus CAN message */
-	YzTdoNavOpts,						/*!< ID 19: HMI Navigation display control options */
-	YzTdoAudioOpts,						/*!< ID 20: HMI audio display control options */
-	YzTdoNavSimFname,					/*!< ID 21: HMI NavSimFname: Base simulation filename */
-	YzTdoNavSimFrames,					/*!< ID 22: HMI NavSimFrames: Number of simulation frames */
-	YzTdoNavFrameDly,					/*!< ID 23: HMI NavSimFrameDlyMs: Inter frame delay in msec */
-	YzTdoNavLoopDly,					/*!< ID 24: HMI NavSimLoopDlyMs: Inter loop delay in msec */
-	YzTdoAudioSimFname,					/*!< ID 25: HMI AudioSimFname: Base simulation filename */
-	YzTdoAudioSimFrames,				/*!< ID 26: HMI AudioSimFrames: Number of simulation frames */
-	YzTdoAudioFrameDly,					/*!< ID 27: HMI AudioSimFrameDlyMs: Inter frame delay in msec */
-	YzTdoAudioLoopDly,					/*!< ID 28: HMI AudioSimLoopDlyMs: Inter loop delay in msec */
-	YzTdVpSwVersion,                    /*!< ID 29: VP SW verson */
-	YzTdVpPartNumber,                   /*!< ID 30: VP part number */
-	YzTdAutoDrvCtrl,                   	/*!< ID 31: Autonomous drive mode control */
-	ELEM_MAX_ID							/*!< Number of datapool items.  This entry must be last */
+	DP_ELEMENT_SCHEMA(DP_ENUM_ELEM, DP_ENUM_STR)
+	ELEM_MAX_ID,						/*!< Number of datapool items.  This entry must be last */
+	ELEM_MIN_ID = 0						/*!< Starting ID for datapool items */
 };
 
 
@@ -134,42 +153,21 @@ typedef struct {
 	void		   *p_default;			/*!< Pointer to the element default value */
 } DP_ITEM_ENTRY_T;
 
-/*! Datapool item storage structure definition. Element size must match settings in dp_tbl[] */
+/*! Storage of a datapool item, see #DP_ELEMENT_SCHEMA */
+#define DP_STORAGE_ELEM(id, field, type, dflt)	DP_CTYPE_##type field;
+#define DP_STORAGE_STR(id, field, len, dflt)	char field[len];
+
+/*! Datapool item storage structure definition, generated from #DP_ELEMENT_SCHEMA */
 typedef struct {
-	uint32_t TurnLeftSig;				/*!< ID 0: Left turn signal */
-	uint32_t TurnRightSig;				/*!< ID 1: Right turn signal */
-    int32_t  SpeedValue;				/*!< ID 2: Speed signal value */
-    uint32_t PRNDL;						/*!< ID 3: PRNDL signal state */
-    uint32_t Test_Pattern;				/*!< ID 4: Test pattern selection */
-    uint32_t Cruise;					/*!< ID 5: Cruise control signal state */
-    uint32_t Hazard;					/*!< ID 6: Hazard indicators signal state */
-    uint8_t WarpLoad;					/*!< ID 7: Which mesh data to load */
-    uint8_t WarpDisplay;				/*!< ID 8: Which content to display/which mesh to use */
-    uint32_t Reserved1;			/*!< ID 9: TBD */
-    uint32_t Reserved2;				/*!< ID 10: TBD */
-    uint32_t Reserved3;				/*!< ID 11: TBD */
-    uint32_t MirrorPos;					/*!< ID 12: Mirror current position */
-	uint32_t SpeedMotorFront;			/*!< ID 13: Front motor speed from PTC_EMotorSpeed CAN message */
-	uint32_t SpeedMotorRL;				/*!< ID 14: Left rear motor speed from PTC_EMotorSpeed CAN message */
-	uint32_t SpeedMotorRR;				/*!< ID 15: Right rear motor speed from PTC_EMotorSpeed CAN message */
-	int32_t  TorqueActualFront;			/*!< ID 16: Front motor torque from PTC_EMotorStatus CAN message */
-	int32_t  TorqueActualRL;			/*!< ID 17: Left rear motor torque from PTC_EMotorStatus CAN message */
-	int32_t  TorqueActualRR;			/*!< ID 18: Right rear motor torque from PTC_EMotorStatus CAN message */
-	uint32_t NavOpts;					/*!< ID 19: HMI Navigation display control options */
-	uint32_t AudioOpts;					/*!< ID 20: HMI audio display control options */
-	char NavSimFname[MAX_FNAME_LEN] ;	/*!< ID 21: HMI NavSimFname: Base simulation filename */
-	uint16_t NavSimFrames;				/*!< ID 22: HMI NavSimFrames: Number of simulation frames */
-	uint16_t NavFrameDly;				/*!< ID 23: HMI NavSimFrameDlyMs: Inter frame delay in msec */
-	uint32_t NavLoopDly;				/*!< ID 24: HMI NavSimLoopDlyMs: Inter loop delay in msec */
-	char AudioSimFname[MAX_FNAME_LEN];	/*!< ID 25: HMI AudioSimFname: Base simulation filename */
-	uint16_t AudioSimFrames;			/*!< ID 26: HMI AudioSimFrames: Number of simulation frames */
-	uint16_t AudioFrameDly;				/*!< ID 27: HMI AudioSimFrameDlyMs: Inter frame delay in msec */
-	uint32_t AudioLoopDly;				/*!< ID 28: HMI AudioSimLoopDlyMs: Inter loop delay in msec */
-	char VpSwVersion[MAX_VPSWVERSION_LEN];		/*!< ID 29: VP SW verson */
-	char VpPartNumber[MAX_VPPARTNUMBER_LEN];	/*!< ID 30: VP part number */
-    uint32_t AutoDriveCtrl;				/*!< ID 31: Autonomous drive mode control */
+	DP_ELEMENT_SCHEMA(DP_STORAGE_ELEM, DP_STORAGE_STR)
 } DP_ITEM_STORAGE_T;
 
+/*! Storage large and aligned enough for the value of any datapool item */
+typedef union {
+	DP_ELEMENT_SCHEMA(DP_STORAGE_ELEM, DP_STORAGE_STR)
+	uint64_t Align;						/*!< Alignment of the largest numeric type */
+} DP_ITEM_VALUE_T;
+
 
 /*! Datapool copy request response message structure definition */
 typedef struct {
@@ -177,6 +175,51 @@ typedef struct {
     DP_ITEM_STORAGE_T Dt;	/*!< Datapool image */
 } PoolCopyResType;
 
+/* Shared-memory datapool definitions (see InitPoolShared()) */
+#define DP_SHM_MAGIC	(0x44504F4Cu)	/*!< "DPOL", set once the shared datapool is initialized */
+#define DP_SHM_VERSION	(1u)			/*!< Increment whenever DP_ITEM_STORAGE_T or DP_SHM_T changes */
+
+/*! Header of the shared-memory datapool */
+typedef struct {
+	uint32_t Magic;			/*!< DP_SHM_MAGIC once initialized */
+	uint32_t Version;		/*!< DP_SHM_VERSION of the owner */
+	uint32_t PoolSz;		/*!< sizeof(DP_ITEM_STORAGE_T) of the owner */
+	uint32_t Seq;			/*!< Datapool sequence counter, odd while the owner is writing */
+} DP_SHM_HDR_T;
+
+/*! Layout of the shared-memory datapool segment */
+typedef struct {
+	DP_SHM_HDR_T Hdr;		/*!< Segment header */
+	DP_ITEM_STORAGE_T Dt;	/*!< Datapool image, read in place by the attached processes */
+} DP_SHM_T;
+
+/* Datapool change tracking definitions (see GetPoolDirty() and GetPoolDelta()) */
+#define DP_DIRTY_WORDS	((ELEM_MAX_ID + 31) / 32)		/*!< Number of 32 bit words of a dirty bitmap, bit n is item ID n */
+#define DP_DELTA_HDR_SZ	(4 + (4 * DP_DIRTY_WORDS))		/*!< Size in bytes of the version and dirty bitmap of a delta image */
+#define DP_DIRTY_SET(p_dirty, id)	((p_dirty)[(id) / 32] |= (1u << ((id) % 32)))			/*!< Set the bit of an item ID */
+#define DP_DIRTY_CLR(p_dirty, id)	((p_dirty)[(id) / 32] &= ~(1u << ((id) % 32)))			/*!< Clear the bit of an item ID */
+#define DP_DIRTY_TEST(p_dirty, id)	(((p_dirty)[(id) / 32] & (1u << ((id) % 32))) != 0)	/*!< Test the bit of an item ID */
+
+/* CAN signal to datapool item map definitions (see SetCanSigMap() and SetCanSigElems()) */
+#define DP_CANSIG_CHAN_BODY		(0)		/*!< Body CAN, signals of VP_BCanSigDataMsg */
+#define DP_CANSIG_CHAN_CHASSIS	(1)		/*!< Chassis CAN, signals of VP_CCanSigDataMsg */
+#define DP_CANSIG_NUM_CHAN		(2)		/*!< Number of CAN channels */
+#define DP_CANSIG_MAX			(64)	/*!< Max number of signals mapped per CAN channel */
+
+/*! CAN signal to datapool item map entry */
+typedef struct {
+	uint16_t SigId;			/*!< CAN signal ID, as sent by the VP */
+	uint8_t  DataSz;		/*!< Size in bytes of the signal data, 1 to SIGNAL_DATA_SZ_MAX */
+	uint16_t ElemId;		/*!< Datapool item ID of the signal, numeric item */
+} DP_CANSIG_MAP_T;
+
+/*! How the raw data of a CAN signal is stored in its datapool item, see GetCanSigStore() */
+typedef struct {
+	uint64_t Sign;			/*!< Sign bit of the signal data for a signed item, else 0 */
+	uint8_t  Width;			/*!< Size in bytes of the item value */
+	uint8_t  Offset;		/*!< Offset of the Width low order bytes in a uint64_t */
+} DP_CANSIG_STORE_T;
+
 		
 /*****************************************************************************/
 /*    				M E M O R Y   A L L O C A T I O N                        */
@@ -190,62 +233,22 @@ static DP_ITEM_STORAGE_T dp_data;				/*!< Datapool item storage */
 
 /*! Datapool item default value storage structure. It has the same structure format as the datapool 
 	storage structure. */
+#define DP_DFLT_ELEM(id, field, type, dflt)	.field = (dflt),
+#define DP_DFLT_STR(id, field, len, dflt)	.field = dflt,
 static DP_ITEM_STORAGE_T dp_dfltvals =
 {
-	0, 0, 0, 0, 0,							/* TurnLeftSig, TurnRightSig, SpeedValue, PRNDL, Test_Pattern, */
-	0, 0, 0, 0,								/* Cruise, Hazard, WarpMesh, WarpContent, */
-	0, 0, 0, 0,					/* MirrorPosShort, MirrorPosMed, MirrorPosTall, MirrorPos, */		
-	0, 0, 0,								/* SpeedMotorFront, SpeedMotorRL, SpeedMotorRR, */
-	0, 0, 0,								/* TorqueActualFront, TorqueActualRL, TorqueActualRR */		
-	0, 0,									/* NavOpts, AudioOpts */
-	"nav_frame_",				            /* NavSimFname */
-	0, 0, 0,								/* NavSimFrames, NavFrameDly, NavLoopDly */
-	"audio_frame_",				            /* AudioSimFname */
-	0, 0, 0,								/* AudioSimFrames, AudioFrameDly, AudioLoopDly */
-	"",                                     /* YzTdVpSwVersion */
-	"",                                     /* YzTdVpPartNumber */
-	0										/* YzTdAutoDrvCtrl */
+	DP_ELEMENT_SCHEMA(DP_DFLT_ELEM, DP_DFLT_STR)
 };	
 
-
-/*! Datapool item access table allocation. This is indexed by the datapool item ID enum
-   so entries must be in the same order as defined in the datapool ID enumeration. */
+/*! Datapool item access table allocation. This is indexed by the datapool item ID enum,
+   both are generated from #DP_ELEMENT_SCHEMA so they are always in the same order. */
+#define DP_TBL_ELEM(id, field, type, dflt)	\
+	{ id, type, sizeof(dp_data.field), (void *)&dp_data.field, (void *)&dp_dfltvals.field },
+#define DP_TBL_STR(id, field, len, dflt)	\
+	{ id, GP_STRING, (len), (void *)&dp_data.field, (void *)&dp_dfltvals.field },
 static const DP_ITEM_ENTRY_T dp_tbl[] = {
-/*	*id*					*type*		*datlen* *p_data*				*/
-{ 	YzTdTurnLeftSig, 		GP_UINT32,	4,		(void *)&dp_data.TurnLeftSig, (void *)&dp_dfltvals.TurnLeftSig },
-{	YzTdTurnRightSig, 		GP_UINT32,	4,		(void *)&dp_data.TurnRightSig, (void *)&dp_dfltvals.TurnRightSig },	
-{  	YzTdSpeedValue,			GP_INT32,	4,		(void *)&dp_data.SpeedValue, (void *)&dp_dfltvals.SpeedValue },			
-{  	YzTdPRNDL,				GP_UINT32,	4,		(void *)&dp_data.PRNDL, (void *)&dp_dfltvals.PRNDL },							
-{  	YzTdTestPattern,		GP_UINT32,	4,		(void *)&dp_data.Test_Pattern, (void *)&dp_dfltvals.Test_Pattern },		
-{  	YzTdCruise,				GP_UINT32,	4,		(void *)&dp_data.Cruise, (void *)&dp_dfltvals.Cruise },				
-{  	YzTdHazard,				GP_UINT32,	4,		(void *)&dp_data.Hazard, (void *)&dp_dfltvals.Hazard },				
-{  	YzTdWarpLoad,			GP_UINT8,	1,		(void *)&dp_data.WarpLoad, (void *)&dp_dfltvals.WarpLoad },				
-{  	YzTdWarpDisplay,		GP_UINT8,	1,		(void *)&dp_data.WarpDisplay, (void *)&dp_dfltvals.WarpDisplay },		
-{  	YzTdReserved1,		GP_UINT32,	4,		(void *)&dp_data.Reserved1, (void *)&dp_dfltvals.Reserved1 },	
-{  	YzTdReserved2,		GP_UINT32,	4,		(void *)&dp_data.Reserved2, (void *)&dp_dfltvals.Reserved2 },		
-{  	YzTdReserved3,		GP_UINT32,	4,		(void *)&dp_data.Reserved3, (void *)&dp_dfltvals.Reserved3 },		
-{  	YzTdMirrorPos,			GP_UINT32,	4,		(void *)&dp_data.MirrorPos, (void *)&dp_dfltvals.MirrorPos },			
-{  	YzTdoSpeedMotorFront, 	GP_UINT32,	4,		(void *)&dp_data.SpeedMotorFront, (void *)&dp_dfltvals.SpeedMotorFront },	
-{  	YzTdoSpeedMotorRL,		GP_UINT32,	4,		(void *)&dp_data.SpeedMotorRL, (void *)&dp_dfltvals.SpeedMotorRL },		
-{  	YzTdoSpeedMotorRR,		GP_UINT32,	4,		(void *)&dp_data.SpeedMotorRR, (void *)&dp_dfltvals.SpeedMotorRR },		
-{  	YzTdoTorqueActualFront, GP_INT32,	4,		(void *)&dp_data.TorqueActualFront, (void *)&dp_dfltvals.TorqueActualFront },	
-{  	YzTdoTorqueActualRL,	GP_INT32,	4,		(void *)&dp_data.TorqueActualRL, (void *)&dp_dfltvals.TorqueActualRL },	
-{  	YzTdoTorqueActualRR,	GP_INT32,	4,		(void *)&dp_data.TorqueActualRR, (void *)&dp_dfltvals.TorqueActualRR },	
-{  	YzTdoNavOpts,			GP_UINT32,	4,		(void *)&dp_data.NavOpts, (void *)&dp_dfltvals.NavOpts },			
-{  	YzTdoAudioOpts,			GP_UINT32,	4,		(void *)&dp_data.AudioOpts, (void *)&dp_dfltvals.AudioOpts },			
-{  	YzTdoNavSimFname,		GP_STRING, MAX_FNAME_LEN,	(void *)&dp_data.NavSimFname, (void *)&dp_dfltvals.NavSimFname },		
-{  	YzTdoNavSimFrames,		GP_UINT16,	2,		(void *)&dp_data.NavSimFrames, (void *)&dp_dfltvals.NavSimFname },		
-{  	YzTdoNavFrameDly,		GP_UINT16,	2,		(void *)&dp_data.NavFrameDly, (void *)&dp_dfltvals.NavFrameDly },		
-{  	YzTdoNavLoopDly,		GP_UINT32,	4,		(void *)&dp_data.NavLoopDly, (void *)&dp_dfltvals.NavLoopDly },		
-{  	YzTdoAudioSimFname,		GP_STRING, MAX_FNAME_LEN,	(void *)&dp_data.AudioSimFname, (void *)&dp_dfltvals.AudioSimFname },		
-{  	YzTdoAudioSimFrames, 	GP_UINT16,	2,		(void *)&dp_data.AudioSimFrames, (void *)&dp_dfltvals.AudioSimFrames },	
-{  	YzTdoAudioFrameDly,		GP_UINT16,	2,		(void *)&dp_data.AudioFrameDly, (void *)&dp_dfltvals.AudioFrameDly },		
-{  	YzTdoAudioLoopDly,		GP_UINT32,	4,		(void *)&dp_data.AudioLoopDly, (void *)&dp_dfltvals.AudioLoopDly },
-{   YzTdVpSwVersion,        GP_STRING, MAX_VPSWVERSION_LEN, (void *)&dp_data.VpSwVersion, (void *)&dp_dfltvals.VpSwVersion },
-{   YzTdVpPartNumber,       GP_STRING, MAX_VPPARTNUMBER_LEN, (void *)&dp_data.VpPartNumber, (void *)&dp_dfltvals.VpPartNumber },
-{  	YzTdAutoDrvCtrl,		GP_UINT32,	4,		(void *)&dp_data.AutoDriveCtrl, (void *)&dp_dfltvals.AutoDriveCtrl },			
-};																		
-
+	DP_ELEMENT_SCHEMA(DP_TBL_ELEM, DP_TBL_STR)
+};
 #endif		// End ifdef _DATAPOOL_C
 
 